@@ -1,28 +1,73 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include "vm.h"
 
+/**
+ * Parses the options given before the positional arguments into the given
+ * VMOptions. Returns the number of arguments consumed, or -1 if an option
+ * is not recognized.
+ * */
+int parseOptions(int argc, char **argv, VMOptions* options)
+{
+    int i;
+    for(i = 1; i < argc && !strncmp(argv[i], "--", 2); i++)
+    {
+        if( !strcmp(argv[i], "--engine=switch") )        options->engine = VM_ENGINE_SWITCH;
+        else if( !strcmp(argv[i], "--engine=threaded") ) options->engine = VM_ENGINE_THREADED;
+        else if( !strcmp(argv[i], "--trace=full") )      options->trace = VM_TRACE_FULL;
+        else if( !strcmp(argv[i], "--trace=none") )      options->trace = VM_TRACE_NONE;
+        else if( !strcmp(argv[i], "--trace=ring") )      options->trace = VM_TRACE_RING;
+        else if( !strncmp(argv[i], "--trace-ring-size=", 18) && atoi(argv[i] + 18) > 0 )
+        {
+            options->trace = VM_TRACE_RING;
+            options->traceRingSize = atoi(argv[i] + 18);
+        }
+        else if( !strncmp(argv[i], "--stack-limit=", 14) && atoi(argv[i] + 14) > 0 )
+            options->stackLimit = atoi(argv[i] + 14);
+        else if( !strncmp(argv[i], "--code-limit=", 13) && atoi(argv[i] + 13) > 0 )
+            options->codeLimit = atoi(argv[i] + 13);
+        else
+        {
+            fprintf(stderr, "Unknown option \"%s\"\n", argv[i]);
+            return -1;
+        }
+    }
+
+    return i - 1;
+}
+
 int main(int argc, char **argv)
 {
     FILE *inp, *outp, *vm_inp, *vm_outp;
 
+    // Options come before the positional arguments
+    VMOptions options = getDefaultVMOptions();
+    int optionCount = parseOptions(argc, argv, &options);
+
+    if(optionCount < 0) return -1;
+
+    argv[optionCount] = argv[0];
+    argv += optionCount;
+    argc -= optionCount;
+
     if(argc == 3)
     {
-        inp     = fopen(argv[1], "r");
+        inp     = fopen(argv[1], "rb");
         outp    = fopen(argv[2], "w");
 
         vm_inp  = stdin;
         vm_outp = stdout;
 
-        simulateVM(inp, outp, vm_inp, vm_outp);
+        simulateVMWithOptions(inp, outp, vm_inp, vm_outp, options);
 
         fclose(inp);
         fclose(outp);
     }
     else if(argc == 5)
     {
-        inp     = fopen(argv[1], "r");
+        inp     = fopen(argv[1], "rb");
         outp    = fopen(argv[2], "w");
 
         // vm_inp
@@ -33,7 +78,7 @@ int main(int argc, char **argv)
         if( strcmp(argv[3], "-") ) vm_outp = fopen(argv[4], "w");
         else                       vm_outp = stdout;
 
-        simulateVM(inp, outp, vm_inp, vm_outp);
+        simulateVMWithOptions(inp, outp, vm_inp, vm_outp, options);
 
         fclose(inp);
         fclose(outp);
@@ -46,10 +91,32 @@ int main(int argc, char **argv)
     }
     else
     {
-        fprintf(stderr, "Usage: vm.out (ins_inp_file) (simul_outp_file) [vm_inp_file=stdin] [vm_outp_file=stdout]\n");
+        fprintf(stderr, "Usage: vm.out [options] (ins_inp_file) (simul_outp_file) [vm_inp_file=stdin] [vm_outp_file=stdout]\n");
+
+        fprintf(stderr, "\n\t--engine=threaded  Run the program on the threaded engine, which decodes the"
+                        "\n\t                   code memory once and dispatches directly between handlers."
+                        "\n\t                   This is the default.\n");
+        fprintf(stderr, "\n\t--engine=switch    Run the program on the switch engine, which fetches and"
+                        "\n\t                   decodes every instruction as it is executed.\n");
+        fprintf(stderr, "\n\t--trace=full       Write the machine state after every executed instruction"
+                        "\n\t                   to simul_outp_file. This is the default.\n");
+        fprintf(stderr, "\n\t--trace=none       Write only the code memory to simul_outp_file and skip the"
+                        "\n\t                   execution history. Useful for fast runs.\n");
+        fprintf(stderr, "\n\t--trace=ring       Keep the last executed instructions in memory and write"
+                        "\n\t                   them to simul_outp_file when the machine halts.\n");
+        fprintf(stderr, "\n\t--trace-ring-size=N"
+                        "\n\t                   The number of instructions --trace=ring keeps (default %d).\n",
+                        VM_DEFAULT_TRACE_RING_SIZE);
+        fprintf(stderr, "\n\t--stack-limit=N    The number of ints the stack could grow to (default %d)."
+                        "\n\t                   A call or INC past it halts with a stack overflow.\n",
+                        VM_DEFAULT_STACK_LIMIT);
+        fprintf(stderr, "\n\t--code-limit=N     The number of instructions the code memory could hold"
+                        "\n\t                   (default %d).\n",
+                        VM_DEFAULT_CODE_LIMIT);
 
         fprintf(stderr, "\n\tins_inp_file  The path to the file containing the list of instructions to"
-                        "\n\t              be loaded to code memory of the virtual machine.\n");
+                        "\n\t              be loaded to code memory of the virtual machine, either as"
+                        "\n\t              text or as a binary object file.\n");
 
         fprintf(stderr, "\n\tsimul_outp_file  The path to the file to write the simulation output, which"
                         "\n\t                 contains both code memory and execution history.\n");
@@ -1,5 +1,6 @@
 tests="tests_grader.txt"
 vm="../vm.out"
+vm_flags="$VM_FLAGS"
 
 i=0
 passed=0
@@ -21,7 +22,7 @@ while read inp out vm_in vm_out gt_out gt_vm_out ; do
     mkdir -p "$vm_out_dir"
     
     # run the input on virtual machine
-    ./"$vm" "$inp" "$out" "$vm_in" "$vm_out"
+    ./"$vm" $vm_flags "$inp" "$out" "$vm_in" "$vm_out"
     
     # compare the output with groundtruth
     _diff_simul_out="$(diff -B -w $out $gt_out)"
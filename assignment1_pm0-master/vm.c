@@ -2,18 +2,81 @@
 #include "vm.h"
 #include "data.h"
 #include <stdlib.h>
+#include <string.h>
+
+/**
+ * Object files are loaded by mapping them into memory where mmap is available.
+ * The stack is reserved as an anonymous mapping as well, see reserveZeroed().
+ * */
+#if defined(__unix__) || defined(__APPLE__)
+#define VM_HAVE_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define VM_HAVE_MMAP 0
+#endif
 
 /* ************************************************************************************ */
 /* Declarations                                                                         */
 /* ************************************************************************************ */
 
+/**
+ * The code memory of the virtual machine.
+ * ins     : the loaded instructions, allocated by loadCode() if not mapped
+ * numOfIns: the number of instructions
+ * mapping : the mapped object file ins points into, NULL if not mapped
+ * mappingSize: the size of the mapping in bytes
+ * */
+typedef struct {
+    Instruction* ins;
+    int numOfIns;
+    void* mapping;
+    size_t mappingSize;
+} CodeMemory;
+
+/**
+ * A step recorded by the trace ring: the executed instruction, its address and
+ * the BP and SP after its execution.
+ * */
+typedef struct {
+    int pc, op, r, l, m, bp, sp;
+} TraceRecord;
+
+/**
+ * Fixed size ring buffer holding the last executed steps of a VM_TRACE_RING run.
+ * records: the buffer of size records
+ * next   : the index the next step is written to
+ * count  : the number of steps recorded so far, including the overwritten ones
+ * */
+typedef struct {
+    TraceRecord* records;
+    int size;
+    int next;
+    long long count;
+} TraceRing;
+
 /**
  * Recommended design includes the following functions implemented.
  * However, you are free to change them as you wish inside the vm.c file.
  * */
-void initVM(VirtualMachine*);
+void* reserveZeroed(size_t size);
 
-int readInstructions(FILE*, Instruction*);
+void releaseZeroed(void* memory, size_t size);
+
+int initVM(VirtualMachine*, int stackLimit);
+
+void deleteVM(VirtualMachine*);
+
+int readInstructions(FILE*, Instruction** ins, int codeLimit);
+
+unsigned int objectChecksum(const Instruction* ins, int numOfIns);
+
+int readObject(FILE*, CodeMemory* code, int codeLimit);
+
+int loadCode(FILE*, CodeMemory* code, int codeLimit);
+
+void unloadCode(CodeMemory* code);
 
 void dumpInstructions(FILE*, Instruction*, int numOfIns);
 
@@ -23,6 +86,12 @@ void dumpStack(FILE*, int* stack, int sp, int bp);
 
 int executeInstruction(VirtualMachine* vm, Instruction ins, FILE* vmIn, FILE* vmOut);
 
+int runSwitchEngine(VirtualMachine* vm, Instruction* ins, int numOfIns, FILE* traceOut, TraceRing* ring, FILE* vmIn, FILE* vmOut);
+
+int runThreadedEngine(VirtualMachine* vm, Instruction* ins, int numOfIns, FILE* traceOut, TraceRing* ring, FILE* vmIn, FILE* vmOut);
+
+void dumpTraceRing(FILE*, TraceRing* ring, VirtualMachine* vm);
+
 /* ************************************************************************************ */
 /* Global Data and misc structs & enums                                                 */
 /* ************************************************************************************ */
@@ -40,29 +109,132 @@ const char *opcodes[] =
     "lss", "leq", "gtr", "geq"
 };
 
+/**
+ * Returns the string of the given opcode, that of opcode 0 if it is illegal.
+ * */
+const char* opcodeName(int op)
+{
+    return (op >= 1 && op <= 24) ? opcodes[op] : opcodes[0];
+}
+
 enum { CONT, HALT };
 
+/**
+ * The threaded engine dispatches through label addresses (computed goto) when
+ * the compiler supports them. Define VM_NO_COMPUTED_GOTO to force the switch
+ * based dispatch instead.
+ * */
+#if defined(__GNUC__) && !defined(VM_NO_COMPUTED_GOTO)
+#define VM_COMPUTED_GOTO 1
+#else
+#define VM_COMPUTED_GOTO 0
+#endif
+
+/**
+ * An instruction decoded for the threaded engine.
+ * handler: the address of the code executing the instruction (computed goto only)
+ * op     : the opcode, 0 (illegal) if the loaded opcode is out of range
+ * */
+typedef struct {
+    const void* handler;
+    int op, r, l, m;
+} ThreadedInstruction;
+
+/**
+ * The threaded engine keeps a display: the base pointer of the innermost
+ * active activation record of each lexical level. LOD, STO and CAL read the
+ * base pointer from it instead of walking the static links. Define
+ * VM_NO_DISPLAY to walk the static links through getBasePointer() instead.
+ * */
+#define VM_MAX_DISPLAY_LEVELS 64
+
+/**
+ * Display state saved by CAL for the activation record it creates, and
+ * restored by RTN. Kept aside the stack so that the stack layout, and thus
+ * the simulation output, does not change.
+ * display: the display entry the new activation record replaced
+ * level  : the lexical level of the caller plus one, 0 if not entered by CAL.
+ *          Hence the links, which are zeroed lazily, need no initialization.
+ * */
+typedef struct {
+    int display;
+    int level;
+} DisplayLink;
+
 /* ************************************************************************************ */
 /* Definitions                                                                          */
 /* ************************************************************************************ */
 
 /**
- * Initialize Virtual Machine
+ * Returns zeroed memory of the given size in bytes, or NULL if it could not be
+ * allocated. Where mmap is available, the memory is an anonymous mapping that
+ * is only reserved: the system zeroes each page as it is first touched, and
+ * the page mapped after the end is left inaccessible, so that running past
+ * the end faults instead of overwriting other memory. Otherwise, calloc.
+ * */
+void* reserveZeroed(size_t size)
+{
+#if VM_HAVE_MMAP
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t reserved = (size + pageSize - 1) / pageSize * pageSize;
+
+    char* memory = mmap(NULL, reserved + pageSize, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if(memory == MAP_FAILED) return NULL;
+
+    // Guard page
+    mprotect(memory + reserved, pageSize, PROT_NONE);
+
+    return memory;
+#else
+    return calloc(1, size ? size : 1);
+#endif
+}
+
+/**
+ * Releases the memory of the given size returned by reserveZeroed().
  * */
-void initVM(VirtualMachine* vm)
+void releaseZeroed(void* memory, size_t size)
+{
+    if(!memory) return;
+
+#if VM_HAVE_MMAP
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t reserved = (size + pageSize - 1) / pageSize * pageSize;
+
+    munmap(memory, reserved + pageSize);
+#else
+    free(memory);
+#endif
+}
+
+/**
+ * Initialize Virtual Machine, with a stack of stackLimit ints.
+ * The stack is not zeroed here, see reserveZeroed(): a machine starts in
+ * constant time whatever its stack limit is.
+ * Returns 0 on success, -1 if the stack could not be reserved.
+ * */
+int initVM(VirtualMachine* vm, int stackLimit)
 {
 	int i = 0;
 	
     if(vm)
     {
-		// set initial stack and register file values to 0
+		// set initial register file values to 0
 		for (i = 0; i < 16; i++)
 		{
 			vm->RF[i] = 0;
 		}
-		for (i = 0; i < MAX_STACK_HEIGHT; i++)
+
+		// the stack starts zeroed
+		vm->stackSize = stackLimit;
+		vm->stack = reserveZeroed((size_t)stackLimit * sizeof(int));
+
+		if(!vm->stack)
 		{
-			vm->stack[i] = 0;
+			fprintf(stderr, "Could not reserve a stack of %d ints.\n", stackLimit);
+			return -1;
 		}
 		
 		// sp = 0, bp = 1, pc = 0,
@@ -72,26 +244,225 @@ void initVM(VirtualMachine* vm)
 		vm->PC = 0;
 		vm->IR = 0;
     }
+
+    return 0;
+}
+
+/**
+ * Releases the stack of the virtual machine.
+ * */
+void deleteVM(VirtualMachine* vm)
+{
+    releaseZeroed(vm->stack, (size_t)vm->stackSize * sizeof(int));
+
+    vm->stack = NULL;
+    vm->stackSize = 0;
 }
 
 /**
- * Fill the (ins)tructions array by reading instructions from (in)put file
+ * Fill the (ins)tructions array by reading instructions from (in)put file.
+ * The array is allocated here and grows as the instructions are read, up to
+ * codeLimit instructions. It should be freed by the caller.
  * Return the number of instructions read
  * */
-int readInstructions(FILE* in, Instruction* ins)
+int readInstructions(FILE* in, Instruction** ins, int codeLimit)
 {
     // Instruction index
     int i = 0;
-    
-    while(fscanf(in, "%d %d %d %d", &ins[i].op, &ins[i].r, &ins[i].l, &ins[i].m) != EOF)
+
+    // Small programs fit into the initial capacity
+    int capacity = 256;
+    Instruction* buffer = malloc(capacity * sizeof(Instruction));
+
+    while(buffer && i < codeLimit)
     {
+        if(i == capacity)
+        {
+            capacity = (capacity > codeLimit / 2) ? codeLimit : capacity * 2;
+
+            Instruction* grown = realloc(buffer, capacity * sizeof(Instruction));
+
+            if(!grown)
+            {
+                fprintf(stderr, "Could not allocate the code memory. The rest of the instructions are ignored.\n");
+                break;
+            }
+
+            buffer = grown;
+        }
+
+        if(fscanf(in, "%d %d %d %d", &buffer[i].op, &buffer[i].r, &buffer[i].l, &buffer[i].m) == EOF)
+            break;
+
         i++;
     }
 
+    // Whatever does not fit into the code memory is ignored
+    if(i == codeLimit && fscanf(in, "%*d") != EOF)
+    {
+        fprintf(stderr, "Code limit (%d) reached. The rest of the instructions are ignored.\n", codeLimit);
+    }
+
+    *ins = buffer;
+
     // Return the number of instructions read
     return i;
 }
 
+/**
+ * Returns the checksum stored in the ObjectHeader of an object file holding
+ * the given (ins)tructions: 32-bit FNV-1a over the bytes of the instructions.
+ * */
+unsigned int objectChecksum(const Instruction* ins, int numOfIns)
+{
+    const unsigned char* bytes = (const unsigned char*)ins;
+    unsigned int hash = 2166136261u;
+
+    size_t i;
+    for(i = 0; i < numOfIns * sizeof(Instruction); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Loads the code memory from a binary object file (see ObjectHeader).
+ * The file is mapped into memory and the instructions are used in place.
+ * If it cannot be mapped (e.g. it is a pipe), the instructions are read into
+ * .. an array allocated for them instead.
+ * Returns 0 on success, -1 if the object file is invalid or holds more than
+ * .. codeLimit instructions.
+ * */
+int readObject(FILE* in, CodeMemory* code, int codeLimit)
+{
+    ObjectHeader header;
+
+    code->ins = NULL;
+    code->numOfIns = 0;
+    code->mapping = NULL;
+    code->mappingSize = 0;
+
+#if VM_HAVE_MMAP
+    struct stat st;
+
+    // Map the whole file when reading it from the beginning
+    if( ftell(in) == 0 && fstat(fileno(in), &st) == 0 && S_ISREG(st.st_mode) &&
+        st.st_size >= (off_t)sizeof(ObjectHeader) )
+    {
+        void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(in), 0);
+
+        if(mapping != MAP_FAILED)
+        {
+            code->mapping = mapping;
+            code->mappingSize = st.st_size;
+
+            memcpy(&header, mapping, sizeof(ObjectHeader));
+            code->ins = (Instruction*)((char*)mapping + sizeof(ObjectHeader));
+        }
+    }
+#endif
+
+    if(!code->mapping)
+    {
+        if(fread(&header, sizeof(ObjectHeader), 1, in) != 1)
+        {
+            fprintf(stderr, "Object file is truncated.\n");
+            return -1;
+        }
+    }
+
+    if( memcmp(header.magic, PM0_OBJECT_MAGIC, sizeof(header.magic)) ||
+        header.version != PM0_OBJECT_VERSION )
+    {
+        fprintf(stderr, "Not a PM/0 object file of version %d.\n", PM0_OBJECT_VERSION);
+        return -1;
+    }
+
+    if(header.numOfIns > (unsigned int)codeLimit)
+    {
+        fprintf(stderr, "Object file has %u instructions, more than the code limit (%d).\n",
+            header.numOfIns, codeLimit);
+        return -1;
+    }
+
+    if(code->mapping)
+    {
+        if(code->mappingSize < sizeof(ObjectHeader) + header.numOfIns * sizeof(Instruction))
+        {
+            fprintf(stderr, "Object file is truncated.\n");
+            return -1;
+        }
+    }
+    else if( !(code->ins = malloc(header.numOfIns * sizeof(Instruction) + 1)) )
+    {
+        fprintf(stderr, "Could not allocate the code memory.\n");
+        return -1;
+    }
+    else if(fread(code->ins, sizeof(Instruction), header.numOfIns, in) != header.numOfIns)
+    {
+        fprintf(stderr, "Object file is truncated.\n");
+        return -1;
+    }
+
+    code->numOfIns = header.numOfIns;
+
+    if(objectChecksum(code->ins, code->numOfIns) != header.checksum)
+    {
+        fprintf(stderr, "Object file checksum mismatch.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Loads the code memory from the given file, which is either a binary object
+ * file or a text file of instructions (one "op r l m" per line), of at most
+ * codeLimit instructions. Returns 0 on success, -1 if the code could not be
+ * loaded. The code memory should be released by unloadCode().
+ * */
+int loadCode(FILE* in, CodeMemory* code, int codeLimit)
+{
+    // A text file starts with a number, an object file with its magic
+    int first = getc(in);
+    ungetc(first, in);
+
+    if(first == PM0_OBJECT_MAGIC[0])
+    {
+        int err = readObject(in, code, codeLimit);
+
+        if(err) unloadCode(code);
+        return err;
+    }
+
+    code->numOfIns = readInstructions(in, &code->ins, codeLimit);
+    code->mapping = NULL;
+    code->mappingSize = 0;
+
+    return code->ins ? 0 : -1;
+}
+
+/**
+ * Releases the object file mapping of the code memory, or the instructions
+ * allocated by loadCode().
+ * */
+void unloadCode(CodeMemory* code)
+{
+#if VM_HAVE_MMAP
+    if(code->mapping) munmap(code->mapping, code->mappingSize);
+#endif
+
+    if(!code->mapping) free(code->ins);
+
+    code->ins = NULL;
+    code->mapping = NULL;
+    code->mappingSize = 0;
+    code->numOfIns = 0;
+}
+
 /**
  * Dump instructions to the output file
  * */
@@ -110,7 +481,7 @@ void dumpInstructions(FILE* out, Instruction* ins, int numOfIns)
         fprintf(
             out,
             "%3d %3s %3d %3d %3d \n", // formatting
-            i, opcodes[ins[i].op], ins[i].r, ins[i].l, ins[i].m
+            i, opcodeName(ins[i].op), ins[i].r, ins[i].l, ins[i].m
         );
     }
 }
@@ -132,36 +503,61 @@ int getBasePointer(int *stack, int currentBP, int L)
 
 // Function that dumps the whole stack into output file
 // Do not forget to use '|' character between stack frames
+// The activation records are found by walking the dynamic links, and printed
+// .. from the bottom-most one. The stack could hold many more activation
+// .. records than this function could recurse, hence no recursion.
 void dumpStack(FILE* out, int* stack, int sp, int bp)
 {
-    if(bp == 0)
-        return;
+    // The base pointers of the activation records, top-most first
+    int local[64];
+    int* bps = local;
+    int count = 0, capacity = 64;
 
-    // bottom-most level, where a single zero value lies
-    if(bp == 1)
+    int b;
+    for(b = bp; b != 0; b = (b == 1) ? 0 : stack[b + 2])
     {
-        fprintf(out, "%3d ", 0);
+        if(count == capacity)
+        {
+            int* grown = malloc(2 * capacity * sizeof(int));
+            if(!grown) break;
+
+            memcpy(grown, bps, count * sizeof(int));
+            if(bps != local) free(bps);
+
+            bps = grown;
+            capacity *= 2;
+        }
+
+        bps[count++] = b;
     }
 
-    // former levels - if exists
-    if(bp != 1)
+    // bottom-most level, where a single zero value lies
+    if(count > 0 && bps[count - 1] == 1)
     {
-        dumpStack(out, stack, bp - 1, stack[bp + 2]);            
+        fprintf(out, "%3d ", 0);
     }
 
-    // top level: current activation record
-    if(bp <= sp)
+    int k;
+    for(k = count - 1; k >= 0; k--)
     {
-        // indicate a new activation record
-        fprintf(out, "| ");
+        // an activation record ends where the one above it starts
+        int top = (k == 0) ? sp : bps[k - 1] - 1;
 
-        // print the activation record
-        int i;
-        for(i = bp; i <= sp; i++)
+        if(bps[k] <= top)
         {
-            fprintf(out, "%3d ", stack[i]);
+            // indicate a new activation record
+            fprintf(out, "| ");
+
+            // print the activation record
+            int i;
+            for(i = bps[k]; i <= top; i++)
+            {
+                fprintf(out, "%3d ", stack[i]);
+            }
         }
     }
+
+    if(bps != local) free(bps);
 }
 
 /**
@@ -188,16 +584,37 @@ int executeInstruction(VirtualMachine* vm, Instruction ins, FILE* vmIn, FILE* vm
 			
 		// LOD
 		case 3 :
-			vm->RF[ins.r] = vm->stack[getBasePointer(vm->stack, vm->BP, ins.l) + ins.m];
+		{
+			int address = getBasePointer(vm->stack, vm->BP, ins.l) + ins.m;
+			if (address < 0 || address >= vm->stackSize)
+			{
+				fprintf(stderr, "Stack overflow?");
+				return HALT;
+			}
+			vm->RF[ins.r] = vm->stack[address];
 			break;
+		}
 			
 		// STO
 		case 4 :
-			vm->stack[getBasePointer(vm->stack, vm->BP, ins.l) + ins.m] = vm->RF[ins.r];
+		{
+			int address = getBasePointer(vm->stack, vm->BP, ins.l) + ins.m;
+			if (address < 0 || address >= vm->stackSize)
+			{
+				fprintf(stderr, "Stack overflow?");
+				return HALT;
+			}
+			vm->stack[address] = vm->RF[ins.r];
 			break;
+		}
 			
 		// CAL
 		case 5 :
+			if (vm->SP + 4 >= vm->stackSize)
+			{
+				fprintf(stderr, "Stack overflow?");
+				return HALT;
+			}
 			vm->stack[vm->SP + 1] = 0;
 			vm->stack[vm->SP + 2] = getBasePointer(vm->stack, vm->BP, ins.l);
 			vm->stack[vm->SP + 3] = vm->BP;
@@ -208,6 +625,11 @@ int executeInstruction(VirtualMachine* vm, Instruction ins, FILE* vmIn, FILE* vm
 			
 		// INC
 		case 6 :
+			if (vm->SP + ins.m >= vm->stackSize)
+			{
+				fprintf(stderr, "Stack overflow?");
+				return HALT;
+			}
 			vm->SP = vm->SP + ins.m;
 			break;
 			
@@ -311,6 +733,494 @@ int executeInstruction(VirtualMachine* vm, Instruction ins, FILE* vmIn, FILE* vm
     return CONT;
 }
 
+/**
+ * Records a step to the trace (ring), overwriting the oldest one if it is full.
+ * */
+#define RECORD_STEP(ring, PC, OP, R, L, M, BP, SP)                          \
+    {                                                                       \
+        TraceRecord* record = &(ring)->records[(ring)->next];               \
+        record->pc = (PC); record->op = (OP);                               \
+        record->r  = (R);  record->l  = (L);  record->m = (M);              \
+        record->bp = (BP); record->sp = (SP);                               \
+        if(++(ring)->next == (ring)->size) (ring)->next = 0;                \
+        (ring)->count++;                                                    \
+    }
+
+/**
+ * Writes the steps held by the trace (ring) in the ***Execution*** layout.
+ * The stack is not recorded per step; it is printed for the last step only,
+ * .. from the current state of the (v)irtual (m)achine.
+ * */
+void dumpTraceRing(FILE* out, TraceRing* ring, VirtualMachine* vm)
+{
+    int held = (ring->count < ring->size) ? (int)ring->count : ring->size;
+    int first = (ring->count < ring->size) ? 0 : ring->next;
+
+    fprintf(out, "\n***Execution***\n");
+    fprintf(
+        out,
+        "%3s %3s %3s %3s %3s %3s %3s %3s %3s \n",         // formatting
+        "#", "OP", "R", "L", "M", "PC", "BP", "SP", "STK" // titles
+    );
+
+    if(ring->count > held)
+    {
+        fprintf(out, "... %lld earlier steps not recorded\n", ring->count - held);
+    }
+
+    int i;
+    for(i = 0; i < held; i++)
+    {
+        TraceRecord* record = &ring->records[(first + i) % ring->size];
+
+        // The PC after a step is the address of the following step
+        int nextPC = (i + 1 < held) ? ring->records[(first + i + 1) % ring->size].pc : vm->PC;
+
+        fprintf(
+            out,
+            "%3d %3s %3d %3d %3d %3d %3d %3d ",
+            record->pc, opcodeName(record->op), record->r, record->l, record->m,
+            nextPC, record->bp, record->sp
+        );
+
+        // Print stack info of the last step
+        if(i == held - 1)
+            dumpStack(out, vm->stack, vm->SP, vm->BP);
+
+        fprintf(out, "\n");
+    }
+}
+
+/**
+ * Fetches and executes the instructions one by one through executeInstruction()
+ * until halting. The state of the machine is written to traceOut after each step,
+ * .. unless traceOut is NULL. If a trace (ring) is given, each step is recorded
+ * .. to it instead.
+ * */
+int runSwitchEngine(VirtualMachine* vm, Instruction* ins_array, int numOfIns, FILE* traceOut, TraceRing* ring, FILE* vmIn, FILE* vmOut)
+{
+	int status = CONT, instrBeingExecuted = 0;
+	Instruction ins;
+
+    // Fetch&Execute the instructions on the virtual machine until halting
+    while (status == CONT)
+    {
+        // Fetch - outside of the loaded program, the instruction is illegal
+        if (vm->PC < 0 || vm->PC >= numOfIns)
+        {
+            ins.op = ins.r = ins.l = ins.m = 0;
+        }
+        else
+        {
+        ins.op = ins_array[vm->PC].op;
+		ins.r = ins_array[vm->PC].r;
+		ins.l = ins_array[vm->PC].l;
+		ins.m = ins_array[vm->PC].m;
+        }
+
+        // Advance PC - before execution!
+        instrBeingExecuted = vm->PC++;
+
+        // Execute the instruction
+        status = executeInstruction(vm, ins, vmIn, vmOut);
+
+        // Ring trace: keep the step in memory only
+        if(ring)
+        {
+            RECORD_STEP(ring, instrBeingExecuted, ins.op, ins.r, ins.l, ins.m, vm->BP, vm->SP);
+            continue;
+        }
+
+        // Untraced run: nothing to print
+        if(!traceOut) continue;
+
+        // Print current state
+        // Following is a possible way of printing the current state
+        // .. where instrBeingExecuted is the address of the instruction at vm
+        // ..  memory and instr is the instruction being executed.
+        fprintf(
+            traceOut,
+            "%3d %3s %3d %3d %3d %3d %3d %3d ",
+            instrBeingExecuted, // place of instruction at memory
+             opcodeName(ins.op), ins.r, ins.l, ins.m, // instruction info
+             vm->PC, vm->BP, vm->SP // vm info
+        );
+
+        // Print stack info
+		dumpStack(traceOut, vm->stack, vm->SP, vm->BP);
+
+        fprintf(traceOut, "\n");
+    }
+
+    return status;
+}
+
+/**
+ * Decodes the (ins)tructions into a handler table once, then runs the program
+ * by jumping directly from one handler to the next one. The fetch, the copy of
+ * the instruction and the switch of executeInstruction() are not done per step.
+ * The registers are kept in locals and written back to the (v)irtual (m)achine
+ * on halt. The state written to traceOut after each step is the same as the one
+ * runSwitchEngine() writes. Nothing is written if traceOut is NULL. If a trace
+ * (ring) is given, each step is recorded to it instead.
+ * */
+int runThreadedEngine(VirtualMachine* vm, Instruction* ins, int numOfIns, FILE* traceOut, TraceRing* ring, FILE* vmIn, FILE* vmOut)
+{
+    // The decoded program, followed by an illegal instruction: falling off the
+    // .. end of the program executes it. The jumps out of the program are
+    // .. caught by VM_JUMP() instead.
+    ThreadedInstruction* code = malloc((numOfIns + 1) * sizeof(ThreadedInstruction));
+    const ThreadedInstruction* ip;
+
+    if(!code)
+    {
+        fprintf(stderr, "Could not allocate the code memory.\n");
+        return HALT;
+    }
+
+    int* stack = vm->stack;
+    int stackSize = vm->stackSize;
+    int* RF = vm->RF;
+    int PC = vm->PC, BP = vm->BP, SP = vm->SP;
+
+#ifndef VM_NO_DISPLAY
+    // lev is the lexical level of the current activation record. If the
+    // .. program leaves the static chain (e.g. more levels than the display
+    // .. holds), the display is dropped and the static links are walked.
+    // .. The links, one per stack slot, are zeroed lazily like the stack.
+    int display[VM_MAX_DISPLAY_LEVELS];
+    DisplayLink* links = reserveZeroed((size_t)stackSize * sizeof(DisplayLink));
+    int lev = 0, displayValid = (links != NULL);
+
+    display[0] = BP;
+
+#define VM_BASE(L)                                                          \
+    ((displayValid && (unsigned)(L) <= (unsigned)lev) ?                    \
+        display[lev - (L)] : getBasePointer(stack, BP, (L)))
+#else
+#define VM_BASE(L) getBasePointer(stack, BP, (L))
+#endif
+
+#if VM_COMPUTED_GOTO
+    // Handler of each opcode, indexed by opcode
+    static const void* handlers[] =
+    {
+        &&op_illegal,
+        &&op_lit, &&op_rtn, &&op_lod, &&op_sto, &&op_cal,
+        &&op_inc, &&op_jmp, &&op_jpc, &&op_write, &&op_read,
+        &&op_halt, &&op_neg, &&op_add, &&op_sub, &&op_mul,
+        &&op_div, &&op_odd, &&op_mod, &&op_eql, &&op_neq,
+        &&op_lss, &&op_leq, &&op_gtr, &&op_geq
+    };
+#endif
+
+    // Decode the whole code memory. The slot after the loaded program, and the
+    // .. instructions with an unknown opcode, execute as illegal instructions.
+    int i;
+    for(i = 0; i <= numOfIns; i++)
+    {
+        if(i < numOfIns && ins[i].op >= 1 && ins[i].op <= 24)
+        {
+            code[i].op = ins[i].op;
+            code[i].r  = ins[i].r;
+            code[i].l  = ins[i].l;
+            code[i].m  = ins[i].m;
+        }
+        else
+        {
+            code[i].op = 0;
+            code[i].r  = (i < numOfIns) ? ins[i].r : 0;
+            code[i].l  = (i < numOfIns) ? ins[i].l : 0;
+            code[i].m  = (i < numOfIns) ? ins[i].m : 0;
+        }
+
+#if VM_COMPUTED_GOTO
+        code[i].handler = handlers[code[i].op];
+#else
+        code[i].handler = NULL;
+#endif
+    }
+
+/**
+ * The state line of runSwitchEngine(), printed after each step of a traced run,
+ * .. or the step recorded to the trace ring. ADDR is the address of the step.
+ * */
+#define VM_TRACE_AT(ADDR)                                                   \
+    if(ring)                                                                \
+        RECORD_STEP(ring, (ADDR), ip->op, ip->r, ip->l, ip->m, BP, SP)      \
+    else if(traceOut)                                                       \
+    {                                                                       \
+        fprintf(traceOut, "%3d %3s %3d %3d %3d %3d %3d %3d ",               \
+            (ADDR), opcodeName(ip->op), ip->r, ip->l, ip->m,                \
+            PC, BP, SP);                                                    \
+        dumpStack(traceOut, stack, SP, BP);                                 \
+        fprintf(traceOut, "\n");                                            \
+    }
+
+#define VM_TRACE() VM_TRACE_AT((int)(ip - code))
+
+/**
+ * Sets PC to the (target) of a jump, call or return. A target out of the loaded
+ * .. program is not fetched from the code memory: see outside.
+ * */
+#define VM_JUMP(target)                                                     \
+    {                                                                       \
+        PC = (target);                                                      \
+        if ((unsigned)PC >= (unsigned)numOfIns) goto outside;               \
+    }
+
+#if VM_COMPUTED_GOTO
+#define VM_CASE(label, opcode) label:
+#define VM_NEXT() { VM_TRACE(); ip = &code[PC++]; goto *ip->handler; }
+
+    // Fetch the first instruction and jump to its handler
+    ip = &code[PC++];
+    goto *ip->handler;
+#else
+#define VM_CASE(label, opcode) case opcode:
+#define VM_NEXT() { VM_TRACE(); continue; }
+
+    for(;;)
+    {
+        ip = &code[PC++];
+
+        switch(ip->op)
+        {
+#endif
+        // LIT
+        VM_CASE(op_lit, 1)
+            RF[ip->r] = ip->m;
+            VM_NEXT();
+
+        // RTN
+        VM_CASE(op_rtn, 2)
+#ifndef VM_NO_DISPLAY
+            // Restore the display entry and the level of the caller
+            if (displayValid)
+            {
+                if ((unsigned)BP < (unsigned)stackSize && links[BP].level > 0)
+                {
+                    display[lev] = links[BP].display;
+                    lev = links[BP].level - 1;
+                }
+                else displayValid = 0;
+            }
+#endif
+            SP = BP - 1;
+            BP = stack[SP + 3];
+            VM_JUMP(stack[SP + 4]);
+            VM_NEXT();
+
+        // LOD
+        VM_CASE(op_lod, 3)
+            {
+                int address = VM_BASE(ip->l) + ip->m;
+                if (address < 0 || address >= stackSize) goto overflow;
+                RF[ip->r] = stack[address];
+            }
+            VM_NEXT();
+
+        // STO
+        VM_CASE(op_sto, 4)
+            {
+                int address = VM_BASE(ip->l) + ip->m;
+                if (address < 0 || address >= stackSize) goto overflow;
+                stack[address] = RF[ip->r];
+            }
+            VM_NEXT();
+
+        // CAL
+        VM_CASE(op_cal, 5)
+            if (SP + 4 >= stackSize) goto overflow;
+            stack[SP + 1] = 0;
+            stack[SP + 2] = VM_BASE(ip->l);
+            stack[SP + 3] = BP;
+            stack[SP + 4] = PC;
+            BP = SP + 1;
+#ifndef VM_NO_DISPLAY
+            // The callee is declared L levels out of the caller: it runs at
+            // .. level lev - L + 1 and becomes the display entry of that level
+            if (displayValid)
+            {
+                int calleeLev = lev - ip->l + 1;
+
+                if ((unsigned)ip->l <= (unsigned)lev && calleeLev < VM_MAX_DISPLAY_LEVELS)
+                {
+                    links[BP].display = display[calleeLev];
+                    links[BP].level = lev + 1;
+                    display[calleeLev] = BP;
+                    lev = calleeLev;
+                }
+                else displayValid = 0;
+            }
+#endif
+            VM_JUMP(ip->m);
+            VM_NEXT();
+
+        // INC
+        VM_CASE(op_inc, 6)
+            if (SP + ip->m >= stackSize) goto overflow;
+            SP = SP + ip->m;
+            VM_NEXT();
+
+        // JMP
+        VM_CASE(op_jmp, 7)
+            VM_JUMP(ip->m);
+            VM_NEXT();
+
+        // JPC
+        VM_CASE(op_jpc, 8)
+            if (RF[ip->r] == 0)
+            {
+                VM_JUMP(ip->m);
+            }
+            VM_NEXT();
+
+        // SIO 1
+        VM_CASE(op_write, 9)
+            fprintf(vmOut, "%d", RF[ip->r]);
+            VM_NEXT();
+
+        // SIO 2
+        VM_CASE(op_read, 10)
+            fscanf(vmIn, "%d", &RF[ip->r]);
+            VM_NEXT();
+
+        // SIO 3
+        VM_CASE(op_halt, 11)
+            VM_TRACE();
+            goto halt;
+
+        // NEG
+        VM_CASE(op_neg, 12)
+            RF[ip->r] = 0 - RF[ip->l];
+            VM_NEXT();
+
+        // ADD
+        VM_CASE(op_add, 13)
+            RF[ip->r] = RF[ip->l] + RF[ip->m];
+            VM_NEXT();
+
+        // SUB
+        VM_CASE(op_sub, 14)
+            RF[ip->r] = RF[ip->l] - RF[ip->m];
+            VM_NEXT();
+
+        // MUL
+        VM_CASE(op_mul, 15)
+            RF[ip->r] = RF[ip->l] * RF[ip->m];
+            VM_NEXT();
+
+        // DIV
+        VM_CASE(op_div, 16)
+            RF[ip->r] = RF[ip->l] / RF[ip->m];
+            VM_NEXT();
+
+        // ODD
+        VM_CASE(op_odd, 17)
+            RF[ip->r] = RF[ip->r] % 2;
+            VM_NEXT();
+
+        // MOD
+        VM_CASE(op_mod, 18)
+            RF[ip->r] = RF[ip->l] % RF[ip->m];
+            VM_NEXT();
+
+        // EQL
+        VM_CASE(op_eql, 19)
+            RF[ip->r] = (RF[ip->l] == RF[ip->m]);
+            VM_NEXT();
+
+        // NEQ
+        VM_CASE(op_neq, 20)
+            RF[ip->r] = (RF[ip->l] != RF[ip->m]);
+            VM_NEXT();
+
+        // LSS
+        VM_CASE(op_lss, 21)
+            RF[ip->r] = (RF[ip->l] < RF[ip->m]);
+            VM_NEXT();
+
+        // LEQ
+        VM_CASE(op_leq, 22)
+            RF[ip->r] = (RF[ip->l] <= RF[ip->m]);
+            VM_NEXT();
+
+        // GTR
+        VM_CASE(op_gtr, 23)
+            RF[ip->r] = (RF[ip->l] > RF[ip->m]);
+            VM_NEXT();
+
+        // GEQ
+        VM_CASE(op_geq, 24)
+            RF[ip->r] = (RF[ip->l] >= RF[ip->m]);
+            VM_NEXT();
+
+        VM_CASE(op_illegal, 0)
+            fprintf(stderr, "Illegal instruction?");
+            VM_TRACE();
+            goto halt;
+#if !VM_COMPUTED_GOTO
+        }
+    }
+#endif
+
+overflow:
+    // The stack would grow past its limit: halt without executing
+    fprintf(stderr, "Stack overflow?");
+    VM_TRACE();
+    goto halt;
+
+outside:
+    // The jump left the loaded program. After its step, the instruction at
+    // .. the target is fetched as an illegal one, as runSwitchEngine() does.
+    VM_TRACE();
+    {
+        int addr = PC++;
+        ip = &code[numOfIns];
+
+        fprintf(stderr, "Illegal instruction?");
+        VM_TRACE_AT(addr);
+    }
+    goto halt;
+
+#undef VM_TRACE
+#undef VM_TRACE_AT
+#undef VM_JUMP
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_BASE
+
+halt:
+    // Write the registers back to the virtual machine
+    vm->PC = PC;
+    vm->BP = BP;
+    vm->SP = SP;
+
+#ifndef VM_NO_DISPLAY
+    releaseZeroed(links, (size_t)stackSize * sizeof(DisplayLink));
+#endif
+    free(code);
+
+    return HALT;
+}
+
+/**
+ * Returns the options simulateVM() runs with.
+ * */
+VMOptions getDefaultVMOptions()
+{
+    VMOptions options;
+
+    options.engine = VM_ENGINE_THREADED;
+    options.trace  = VM_TRACE_FULL;
+    options.traceRingSize = VM_DEFAULT_TRACE_RING_SIZE;
+    options.stackLimit = VM_DEFAULT_STACK_LIMIT;
+    options.codeLimit = VM_DEFAULT_CODE_LIMIT;
+
+    return options;
+}
+
 /**
  * inp: The FILE pointer containing the list of instructions to
  *         be loaded to code memory of the virtual machine.
@@ -333,65 +1243,109 @@ void simulateVM(
     FILE* vm_outp
     )
 {
-	int numOfIns = 0, status = 0, instrNum = 0, instrBeingExecuted = 0;
-	Instruction ins;
-	Instruction ins_array[MAX_CODE_LENGTH];
+    simulateVMWithOptions(inp, outp, vm_inp, vm_outp, getDefaultVMOptions());
+}
+
+/**
+ * Same as simulateVM(), but runs the program with the given options.
+ * */
+void simulateVMWithOptions(
+    FILE* inp,
+    FILE* outp,
+    FILE* vm_inp,
+    FILE* vm_outp,
+    VMOptions options
+    )
+{
+	CodeMemory code;
 	
-    // Read instructions from file
-	numOfIns = readInstructions(inp, ins_array);
+    // Load instructions from file, either text or object file
+	if (loadCode(inp, &code, options.codeLimit)) return;
+
+    // Run the loaded instructions
+    simulateCode(code.ins, code.numOfIns, outp, vm_inp, vm_outp, options);
+
+    unloadCode(&code);
+}
+
+void simulateCode(
+    Instruction* ins,
+    int numOfIns,
+    FILE* outp,
+    FILE* vm_inp,
+    FILE* vm_outp,
+    VMOptions options
+    )
+{
+    if(numOfIns > options.codeLimit)
+    {
+        fprintf(stderr, "Program has %d instructions, more than the code limit (%d).\n",
+            numOfIns, options.codeLimit);
+        return;
+    }
+
+    // Without a simulation output, there is nothing to trace
+    if(!outp) options.trace = VM_TRACE_NONE;
 
     // Dump instructions to the output file
-	dumpInstructions(outp, ins_array, numOfIns);
+	if(outp) dumpInstructions(outp, ins, numOfIns);
+
+    // The execution history is written only for traced runs
+    FILE* traceOut = (options.trace == VM_TRACE_FULL) ? outp : NULL;
 
     // Before starting the code execution on the virtual machine,
     // .. write the header for the simulation part (***Execution***)
-    fprintf(outp, "\n***Execution***\n");
-    fprintf(
-        outp,
-        "%3s %3s %3s %3s %3s %3s %3s %3s %3s \n",         // formatting
-        "#", "OP", "R", "L", "M", "PC", "BP", "SP", "STK" // titles
-    );
+    if(traceOut)
+    {
+        fprintf(traceOut, "\n***Execution***\n");
+        fprintf(
+            traceOut,
+            "%3s %3s %3s %3s %3s %3s %3s %3s %3s \n",         // formatting
+            "#", "OP", "R", "L", "M", "PC", "BP", "SP", "STK" // titles
+        );
+    }
 
     // Create a virtual machine
     VirtualMachine *vm = malloc(sizeof(VirtualMachine));
 	
     // Initialize the virtual machine
-    initVM(vm);
-
-    // Fetch&Execute the instructions on the virtual machine until halting
-    while (status == CONT)
+    if(initVM(vm, options.stackLimit))
     {
-        // Fetch
-        ins.op = ins_array[vm->PC].op;
-		ins.r = ins_array[vm->PC].r;
-		ins.l = ins_array[vm->PC].l;
-		ins.m = ins_array[vm->PC].m;
+        free(vm);
+        return;
+    }
 
-        // Advance PC - before execution!
-        instrBeingExecuted = vm->PC++;
+    // Ring trace: the last steps are kept in memory and written on halt
+    TraceRing ring, *ringPtr = NULL;
 
-        // Execute the instruction
-        status = executeInstruction(vm, ins, vm_inp, vm_outp);
+    if(options.trace == VM_TRACE_RING)
+    {
+        ring.size = (options.traceRingSize > 0) ? options.traceRingSize : VM_DEFAULT_TRACE_RING_SIZE;
+        ring.records = malloc(ring.size * sizeof(TraceRecord));
+        ring.next = 0;
+        ring.count = 0;
 
-        // Print current state
-        // Following is a possible way of printing the current state
-        // .. where instrBeingExecuted is the address of the instruction at vm
-        // ..  memory and instr is the instruction being executed.
-        fprintf(
-            outp,
-            "%3d %3s %3d %3d %3d %3d %3d %3d ",
-            instrBeingExecuted, // place of instruction at memory
-             opcodes[ins.op], ins.r, ins.l, ins.m, // instruction info
-             vm->PC, vm->BP, vm->SP // vm info
-        );
+        ringPtr = &ring;
+    }
 
-        // Print stack info
-		dumpStack(outp, vm->stack, vm->SP, vm->BP);
+    // Execute the instructions on the virtual machine until halting
+    if(options.engine == VM_ENGINE_THREADED)
+        runThreadedEngine(vm, ins, numOfIns, traceOut, ringPtr, vm_inp, vm_outp);
+    else
+        runSwitchEngine(vm, ins, numOfIns, traceOut, ringPtr, vm_inp, vm_outp);
 
-        fprintf(outp, "\n");
+    // The machine halted, possibly on an illegal instruction or a stack
+    // .. overflow: write the steps the ring holds
+    if(ringPtr)
+    {
+        dumpTraceRing(outp, ringPtr, vm);
+        free(ring.records);
     }
 
     // Above loop ends when machine halts. Therefore, dump halt message.
-    fprintf(outp, "HLT\n");
+    if(traceOut || ringPtr) fprintf(outp, "HLT\n");
+
+    deleteVM(vm);
+    free(vm);
     return;
 }
\ No newline at end of file
@@ -1,12 +1,75 @@
-
 #ifndef __VM_H__
 #define __VM_H__
 
 #include <stdio.h>
+#include "data.h"
+
+/**
+ * Execution engines of the virtual machine.
+ *  VM_ENGINE_SWITCH  : fetches each instruction and executes it through the
+ *                      switch in executeInstruction().
+ *  VM_ENGINE_THREADED: decodes the code memory into a handler table once and
+ *                      jumps from handler to handler (computed goto where
+ *                      the compiler supports it, a switch otherwise).
+ * Both engines produce the same simulation output.
+ * */
+typedef enum {
+    VM_ENGINE_SWITCH,
+    VM_ENGINE_THREADED
+} VMEngine;
+
+/**
+ * What is written to the simulation output while the program runs.
+ *  VM_TRACE_FULL: the machine state after every executed instruction
+ *                 (***Execution***), followed by HLT.
+ *  VM_TRACE_NONE: nothing. Only the code memory dump is written, and the
+ *                 per-step formatting is not done at all.
+ *  VM_TRACE_RING: the last traceRingSize steps are recorded in memory and
+ *                 written in the ***Execution*** layout when the machine halts
+ *                 (SIO 3, an illegal instruction or a stack overflow). The
+ *                 stack is printed for the last step only.
+ * */
+typedef enum {
+    VM_TRACE_FULL,
+    VM_TRACE_NONE,
+    VM_TRACE_RING
+} VMTraceMode;
+
+/**
+ * The number of steps kept by VM_TRACE_RING when no size is given.
+ * */
+#define VM_DEFAULT_TRACE_RING_SIZE 64
+
+/**
+ * The limits the machine runs with when no limit is given: the number of ints
+ * the stack could grow to, and the number of instructions the code memory
+ * could hold. The stack is reserved up to its limit but only the part a
+ * program touches is ever zeroed, so a large limit does not slow down small
+ * programs.
+ * */
+#define VM_DEFAULT_STACK_LIMIT (1 << 20)
+#define VM_DEFAULT_CODE_LIMIT  (1 << 20)
+
+/**
+ * Options that change how simulateVMWithOptions() runs a program.
+ * */
+typedef struct {
+    VMEngine engine;
+    VMTraceMode trace;
+    int traceRingSize; // VM_TRACE_RING only
+    int stackLimit;    // CAL and INC past it halt with a stack overflow
+    int codeLimit;     // programs longer than it are not loaded
+} VMOptions;
+
+/**
+ * Returns the options simulateVM() runs with.
+ * */
+VMOptions getDefaultVMOptions();
 
 /**
  * inp: The FILE pointer containing the list of instructions to
  *         be loaded to code memory of the virtual machine.
+ *         Either text or a binary object file (see ObjectHeader in data.h).
  * 
  * outp: The FILE pointer to write the simulation output, which
  *       contains both code memory and execution history.
@@ -27,4 +90,31 @@ void simulateVM(
     FILE* vm_outp
 );
 
+/**
+ * Same as simulateVM(), but runs the program with the given options.
+ * */
+void simulateVMWithOptions(
+    FILE* inp,
+    FILE* outp,
+    FILE* vm_inp,
+    FILE* vm_outp,
+    VMOptions options
+);
+
+/**
+ * Same as simulateVMWithOptions(), but runs the given (ins)tructions, which
+ * are already in memory, instead of loading them from a file. Nothing is run
+ * if numOfIns exceeds the code limit of the options.
+ * outp could be NULL, in which case neither the code memory nor the execution
+ * history is written.
+ * */
+void simulateCode(
+    Instruction* ins,
+    int numOfIns,
+    FILE* outp,
+    FILE* vm_inp,
+    FILE* vm_outp,
+    VMOptions options
+);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Every allocation is aligned to ARENA_ALIGNMENT bytes, which is enough for
+ * any type used by the compiler.
+ * */
+#define ARENA_ALIGNMENT 16
+
+/**
+ * The size of the first block of an arena. Each following block is twice the
+ * size of the previous one, up to ARENA_MAX_BLOCK_SIZE, or larger if a single
+ * allocation needs it.
+ * */
+#define ARENA_MIN_BLOCK_SIZE (4 * 1024)
+#define ARENA_MAX_BLOCK_SIZE (1024 * 1024)
+
+/**
+ * Rounds the given size up to a multiple of ARENA_ALIGNMENT.
+ * */
+#define ARENA_ALIGN(size) (((size) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+/**
+ * A block of an arena. The memory handed out follows the header, which is
+ * padded to ARENA_ALIGNMENT.
+ * */
+struct ArenaBlock {
+    ArenaBlock* next; // the previous block of the arena
+    size_t size;      // the number of bytes following the header
+    size_t used;      // the number of bytes handed out
+};
+
+#define ARENA_HEADER_SIZE ARENA_ALIGN(sizeof(ArenaBlock))
+
+/**
+ * Returns the address of the first byte of the given block.
+ * */
+#define ARENA_BLOCK_DATA(block) ((char*)(block) + ARENA_HEADER_SIZE)
+
+/**
+ * The memory of the arenas of the thread. Thread storage is C11, which gcc and
+ * clang take in C99 as well.
+ * */
+_Thread_local ArenaUsage arenaUsage;
+
+/**
+ * Counts the given block as released.
+ * */
+#define ARENA_RELEASE(block) (arenaUsage.held -= ARENA_HEADER_SIZE + (block)->size)
+
+void initArena(Arena* arena)
+{
+    arena->blocks = NULL;
+    arena->last = NULL;
+}
+
+void deleteArena(Arena* arena)
+{
+    if(!arena) return;
+
+    ArenaBlock* block = arena->blocks;
+    while(block)
+    {
+        ArenaBlock* next = block->next;
+        ARENA_RELEASE(block);
+        free(block);
+        block = next;
+    }
+
+    initArena(arena);
+}
+
+void resetArena(Arena* arena)
+{
+    if(!arena->blocks) return;
+
+    ArenaBlock* block = arena->blocks->next;
+    while(block)
+    {
+        ArenaBlock* next = block->next;
+        ARENA_RELEASE(block);
+        free(block);
+        block = next;
+    }
+
+    arena->blocks->next = NULL;
+    arena->blocks->used = 0;
+    arena->last = NULL;
+}
+
+/**
+ * Adds a new block, which has room for at least size bytes, to the arena.
+ * Returns the block, or NULL if it could not be allocated.
+ * */
+ArenaBlock* addArenaBlock(Arena* arena, size_t size)
+{
+    size_t blockSize = arena->blocks ? 2 * arena->blocks->size : ARENA_MIN_BLOCK_SIZE;
+
+    if(blockSize > ARENA_MAX_BLOCK_SIZE) blockSize = ARENA_MAX_BLOCK_SIZE;
+    if(blockSize < size) blockSize = size;
+
+    ArenaBlock* block = (ArenaBlock*)malloc(ARENA_HEADER_SIZE + blockSize);
+    if(!block) return NULL;
+
+    block->next = arena->blocks;
+    block->size = blockSize;
+    block->used = 0;
+
+    arena->blocks = block;
+
+    arenaUsage.held += ARENA_HEADER_SIZE + blockSize;
+    if(arenaUsage.held > arenaUsage.peak) arenaUsage.peak = arenaUsage.held;
+
+    return block;
+}
+
+void* arenaAlloc(Arena* arena, size_t size)
+{
+    size = ARENA_ALIGN(size ? size : 1);
+
+    ArenaBlock* block = arena->blocks;
+
+    if(!block || block->size - block->used < size)
+    {
+        block = addArenaBlock(arena, size);
+        if(!block) return NULL;
+    }
+
+    void* ptr = ARENA_BLOCK_DATA(block) + block->used;
+    block->used += size;
+
+    arena->last = ptr;
+    arenaUsage.allocated += size;
+
+    return ptr;
+}
+
+void* arenaGrow(Arena* arena, void* ptr, size_t oldSize, size_t newSize)
+{
+    if(!ptr) return arenaAlloc(arena, newSize);
+
+    if(newSize <= oldSize) return ptr;
+
+    // The most recent allocation is at the end of the current block
+    ArenaBlock* block = arena->blocks;
+
+    if(ptr == arena->last)
+    {
+        size_t offset = (char*)ptr - ARENA_BLOCK_DATA(block);
+        size_t size = ARENA_ALIGN(newSize);
+
+        if(block->size - offset >= size)
+        {
+            arenaUsage.allocated += offset + size - block->used;
+            block->used = offset + size;
+            return ptr;
+        }
+    }
+
+    void* grown = arenaAlloc(arena, newSize);
+    if(!grown) return NULL;
+
+    memcpy(grown, ptr, oldSize);
+
+    return grown;
+}
+
+ArenaUsage getArenaUsage()
+{
+    return arenaUsage;
+}
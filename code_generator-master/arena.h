@@ -0,0 +1,74 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+/**
+ * Region allocator. Allocations are carved out of large blocks and are never
+ * freed one by one; all of them are released together by deleteArena(), e.g.
+ * at the end of a compilation.
+ * A block is never moved, so a pointer returned by the arena stays valid until
+ * the arena is deleted, however much the arena grows afterwards.
+ * */
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock* blocks; // the block allocations are made from, followed by the older ones
+    void* last;         // the most recent allocation, which arenaGrow() could extend in place
+} Arena;
+
+/**
+ * Initializes the given arena to an empty arena. No memory is allocated until
+ * the first allocation.
+ * */
+void initArena(Arena*);
+
+/**
+ * Releases all the memory allocated from the given arena, and leaves it empty.
+ * */
+void deleteArena(Arena*);
+
+/**
+ * Releases all the allocations of the given arena at once, but keeps its most
+ * recent block for the allocations to come. An arena reused this way, e.g. for
+ * one compilation after another, stops calling malloc once that block is large
+ * enough.
+ * */
+void resetArena(Arena*);
+
+/**
+ * Allocates size bytes from the given arena, aligned for any type.
+ * Returns NULL if the memory could not be allocated.
+ * */
+void* arenaAlloc(Arena*, size_t size);
+
+/**
+ * Grows the allocation ptr of oldSize bytes to newSize bytes, and returns the
+ * address of the grown allocation, which holds the content of ptr.
+ * If ptr is the most recent allocation and its block has room, it is extended
+ * in place. Otherwise, a new allocation is made and ptr is copied into it;
+ * ptr itself stays valid. ptr could be NULL, in which case it is same as
+ * arenaAlloc(). Returns NULL if the memory could not be allocated.
+ * */
+void* arenaGrow(Arena*, void* ptr, size_t oldSize, size_t newSize);
+
+/**
+ * The memory of the arenas of a thread, for the statistics of a run.
+ * allocated: the number of bytes handed out by arenaAlloc() and arenaGrow()
+ * held     : the number of bytes of the blocks the arenas hold now
+ * peak     : the most bytes of blocks the arenas held at once
+ * */
+typedef struct {
+    size_t allocated;
+    size_t held;
+    size_t peak;
+} ArenaUsage;
+
+/**
+ * Returns the memory of the arenas of the calling thread since it started.
+ * Each thread counts its own arenas, so an arena should be deleted by the
+ * thread that allocated from it.
+ * */
+ArenaUsage getArenaUsage();
+
+#endif
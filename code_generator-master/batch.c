@@ -0,0 +1,317 @@
+#include "batch.h"
+#include "front_end.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/**
+ * The programs dealt to a worker, the jobs top to bottom - 1 of the batch. The
+ * worker takes its programs from the bottom; the others steal from the top, so
+ * that they rarely contend with it for the same end.
+ * */
+typedef struct {
+    int top;
+    int bottom;
+    pthread_mutex_t lock;
+} WorkQueue;
+
+/**
+ * A worker thread, its queue and the state of the pool it is part of. The
+ * cache stats are those of the worker, added to those of the batch once done.
+ * */
+typedef struct {
+    Batch* batch;
+    WorkQueue* queues;
+    int numOfWorkers;
+    int index;
+    CodeGeneratorOptions options;
+    const CompilationCache* cache;
+    CacheStats cacheStats;
+} Worker;
+
+/**
+ * Duplicates the given length characters of a string into the arena. Returns
+ * NULL if no memory could be allocated.
+ * */
+char* arenaStrndup(Arena* arena, const char* str, size_t length)
+{
+    char* copy = arenaAlloc(arena, length + 1);
+    if(!copy) return NULL;
+
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+
+    return copy;
+}
+
+int readBatchManifest(FILE* manifest, Arena* arena, Batch* batch)
+{
+    char line[4096];
+    int lineNum = 0;
+
+    batch->jobs = NULL;
+    batch->numOfJobs = 0;
+    batch->capacity = 0;
+    batch->arena = arena;
+    memset(&batch->cacheStats, 0, sizeof(CacheStats));
+
+    while( fgets(line, sizeof(line), manifest) )
+    {
+        lineNum++;
+
+        // The source and the output path, and nothing else
+        char* fields[3];
+        size_t lengths[3];
+        int numOfFields = 0;
+
+        for(char* c = line; *c && numOfFields < 3; )
+        {
+            while(*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n') c++;
+            if(!*c) break;
+
+            fields[numOfFields] = c;
+            while(*c && *c != ' ' && *c != '\t' && *c != '\r' && *c != '\n') c++;
+            lengths[numOfFields] = c - fields[numOfFields];
+            numOfFields++;
+        }
+
+        if(numOfFields == 0 || fields[0][0] == '#') continue;
+        if(numOfFields != 2) return lineNum;
+
+        if(batch->numOfJobs == batch->capacity)
+        {
+            int capacity = batch->capacity ? batch->capacity * 2 : 64;
+            BatchJob* jobs = arenaGrow(arena, batch->jobs, batch->capacity * sizeof(BatchJob), capacity * sizeof(BatchJob));
+            if(!jobs) return -1;
+
+            batch->jobs = jobs;
+            batch->capacity = capacity;
+        }
+
+        BatchJob* job = &batch->jobs[batch->numOfJobs];
+        memset(job, 0, sizeof(BatchJob));
+
+        job->source = arenaStrndup(arena, fields[0], lengths[0]);
+        job->output = arenaStrndup(arena, fields[1], lengths[1]);
+        job->status = BATCH_PENDING;
+        if(!job->source || !job->output) return -1;
+
+        batch->numOfJobs++;
+    }
+
+    return 0;
+}
+
+/**
+ * Lexes and compiles the given program with the given context, allocating from
+ * the given arena, and writes its output. If the worker has a cache, the code
+ * is taken from it, or stored into it once compiled.
+ * */
+void compileBatchJob(BatchJob* job, CompilerContext* context, Arena* arena, Worker* worker)
+{
+    CodeGeneratorOptions options = worker->options;
+
+    FILE* inp = fopen(job->source, "rb");
+    SourceCode sourceCode;
+
+    if(!inp || mapSourceCode(inp, &sourceCode, arena))
+    {
+        job->status = BATCH_SOURCE_ERROR;
+        if(inp) fclose(inp);
+        return;
+    }
+
+    Instruction* code = NULL;
+    int numOfIns = 0;
+    LexerOut lexerOut;
+    CacheKey key = 0;
+
+    if(worker->cache) key = getCacheKey(sourceCode.text, sourceCode.length, options);
+
+    if(worker->cache && lookupCompilation(worker->cache, key, &code, &numOfIns, &worker->cacheStats))
+    {
+        // Compiled before, without errors
+        job->cached = 1;
+        lexerOut.lexerError = NONE;
+        lexerOut.errorLine = 0;
+        job->cgError = 0;
+    }
+    else
+    {
+        job->cgError = compileSourceCode(context, sourceCode, arena, &code, &numOfIns, options, &lexerOut);
+
+        if(worker->cache && lexerOut.lexerError == NONE && !job->cgError)
+            storeCompilation(worker->cache, key, code, numOfIns, &worker->cacheStats);
+    }
+
+    job->lexerError = lexerOut.lexerError;
+    job->errorLine = lexerOut.errorLine;
+
+    unmapSourceCode(&sourceCode);
+    fclose(inp);
+
+    FILE* out = fopen(job->output, options.format == CG_FORMAT_BINARY ? "wb" : "w");
+
+    if(!out)                             job->status = BATCH_OUTPUT_ERROR;
+    else if(lexerOut.lexerError != NONE) job->status = BATCH_LEXER_ERROR;
+    else if(job->cgError)                job->status = BATCH_CG_ERROR;
+    else                                 job->status = BATCH_COMPILED;
+
+    if(job->status == BATCH_LEXER_ERROR) printLexerErr(lexerOut, out);
+    if(job->status == BATCH_CG_ERROR)    printCGErr(job->cgError, out);
+    if(job->status == BATCH_COMPILED)    printCode(code, numOfIns, options.format, out);
+
+    if(out) fclose(out);
+    free(code);
+}
+
+/**
+ * Takes the next program of the given worker: its own, or the one stolen from
+ * the first other worker that has any left. Returns -1 if there is none left
+ * anywhere; programs are never added, so the worker is done.
+ * */
+int takeBatchJob(Worker* worker)
+{
+    WorkQueue* own = &worker->queues[worker->index];
+    int job = -1;
+
+    pthread_mutex_lock(&own->lock);
+    if(own->top < own->bottom) job = --own->bottom;
+    pthread_mutex_unlock(&own->lock);
+
+    for(int i = 1; job < 0 && i < worker->numOfWorkers; i++)
+    {
+        WorkQueue* victim = &worker->queues[(worker->index + i) % worker->numOfWorkers];
+
+        pthread_mutex_lock(&victim->lock);
+        if(victim->top < victim->bottom) job = victim->top++;
+        pthread_mutex_unlock(&victim->lock);
+    }
+
+    return job;
+}
+
+void* runBatchWorker(void* arg)
+{
+    Worker* worker = arg;
+
+    CompilerContext context;
+    initCompilerContext(&context);
+
+    Arena arena;
+    initArena(&arena);
+
+    int job;
+    while( (job = takeBatchJob(worker)) >= 0 )
+    {
+        compileBatchJob(&worker->batch->jobs[job], &context, &arena, worker);
+        resetArena(&arena);
+    }
+
+    deleteArena(&arena);
+    deleteCompilerContext(&context);
+    return NULL;
+}
+
+int runBatch(Batch* batch, int workers, CodeGeneratorOptions options, const CompilationCache* cache)
+{
+    if(workers <= 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = online > 0 ? (int)online : 1;
+    }
+
+    if(workers > batch->numOfJobs) workers = batch->numOfJobs > 0 ? batch->numOfJobs : 1;
+
+    WorkQueue* queues = calloc(workers, sizeof(WorkQueue));
+    Worker* pool = calloc(workers, sizeof(Worker));
+    pthread_t* threads = calloc(workers, sizeof(pthread_t));
+    int started = 0, w;
+
+    if(!queues || !pool || !threads)
+    {
+        free(queues);
+        free(pool);
+        free(threads);
+        return -1;
+    }
+
+    // Worker w is dealt a run of consecutive programs
+    for(w = 0; w < workers; w++)
+    {
+        queues[w].top = (int)((long)batch->numOfJobs * w / workers);
+        queues[w].bottom = (int)((long)batch->numOfJobs * (w + 1) / workers);
+        pthread_mutex_init(&queues[w].lock, NULL);
+
+        pool[w] = (Worker){ batch, queues, workers, w, options, cache, { 0, 0, 0, 0 } };
+    }
+
+    // The calling thread is the first worker
+    for(w = 1; w < workers; w++)
+    {
+        if(pthread_create(&threads[w], NULL, runBatchWorker, &pool[w])) break;
+        started++;
+    }
+
+    runBatchWorker(&pool[0]);
+
+    for(w = 1; w <= started; w++) pthread_join(threads[w], NULL);
+    for(w = 0; w < workers; w++) pthread_mutex_destroy(&queues[w].lock);
+    for(w = 0; w < workers; w++) addCacheStats(&batch->cacheStats, pool[w].cacheStats);
+
+    free(queues);
+    free(pool);
+    free(threads);
+    return workers;
+}
+
+int countBatchFailures(const Batch* batch)
+{
+    int failed = 0;
+
+    for(int i = 0; i < batch->numOfJobs; i++)
+        if(batch->jobs[i].status != BATCH_COMPILED) failed++;
+
+    return failed;
+}
+
+void printBatchSummary(const Batch* batch, int workers, FILE* out)
+{
+    int failed = countBatchFailures(batch);
+
+    fprintf(out, "Compiled %d of %d programs on %d workers, %d failed.\n",
+        batch->numOfJobs - failed, batch->numOfJobs, workers, failed);
+
+    for(int i = 0; i < batch->numOfJobs; i++)
+    {
+        const BatchJob* job = &batch->jobs[i];
+        if(job->status == BATCH_COMPILED) continue;
+
+        fprintf(out, "  %s: ", job->source);
+
+        switch(job->status)
+        {
+            case BATCH_LEXER_ERROR:
+            {
+                LexerOut lexerOut;
+                lexerOut.lexerError = job->lexerError;
+                lexerOut.errorLine = job->errorLine;
+                printLexerErr(lexerOut, out);
+                break;
+            }
+            case BATCH_CG_ERROR:
+                printCGErr(job->cgError, out);
+                break;
+            case BATCH_SOURCE_ERROR:
+                fprintf(out, "Could not read \"%s\"\n", job->source);
+                break;
+            case BATCH_OUTPUT_ERROR:
+                fprintf(out, "Could not open \"%s\"\n", job->output);
+                break;
+            default:
+                fprintf(out, "Not compiled\n");
+                break;
+        }
+    }
+}
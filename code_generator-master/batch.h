@@ -0,0 +1,111 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <stdio.h>
+#include "arena.h"
+#include "code_generator.h"
+#include "cache.h"
+
+/**
+ * Batch compilation: many PL/0 programs, listed in a manifest, lexed and
+ * compiled in one process by a fixed pool of worker threads.
+ *
+ * A line of the manifest is the path of a PL/0 source file followed by the
+ * path of the file to write its code to, separated by white space. Empty lines
+ * and lines starting with # are skipped. Each output is written as
+ * code_generator.out writes it: the code in the format of the options, or the
+ * code generator error. A lexer error is written as la.out prints it.
+ *
+ * Each worker has its own CompilerContext and its own arena, reset between
+ * programs, so the workers share nothing but the list of programs. The
+ * programs are dealt to the workers up front; a worker that runs out of
+ * programs steals one from the others (see runBatch()).
+ * */
+
+/**
+ * What happened to a program of the batch.
+ *  BATCH_PENDING      : it is not compiled yet
+ *  BATCH_COMPILED     : the code was written
+ *  BATCH_LEXER_ERROR  : the source code has a lexer error
+ *  BATCH_CG_ERROR     : the code generator failed, the error was written
+ *  BATCH_SOURCE_ERROR : the source file could not be opened, or is empty
+ *  BATCH_OUTPUT_ERROR : the output file could not be opened
+ * */
+typedef enum {
+    BATCH_PENDING,
+    BATCH_COMPILED,
+    BATCH_LEXER_ERROR,
+    BATCH_CG_ERROR,
+    BATCH_SOURCE_ERROR,
+    BATCH_OUTPUT_ERROR
+} BatchStatus;
+
+/**
+ * A program of the batch, and what happened to it.
+ * lexerError, errorLine: the lexer error, if status is BATCH_LEXER_ERROR
+ * cgError              : the code generator error, if status is BATCH_CG_ERROR
+ * cached               : 1 if the code was taken from the compilation cache
+ * */
+typedef struct {
+    const char* source;
+    const char* output;
+    BatchStatus status;
+    int lexerError;
+    int errorLine;
+    int cgError;
+    int cached;
+} BatchJob;
+
+/**
+ * The programs of a batch, in the order of the manifest. The jobs and their
+ * paths are allocated from the arena. cacheStats are those of all the workers.
+ * */
+typedef struct {
+    BatchJob* jobs;
+    int numOfJobs;
+    int capacity;
+    Arena* arena;
+    CacheStats cacheStats;
+} Batch;
+
+/**
+ * Options of a batch.
+ * manifest: the path of the manifest, NULL if there is no batch to run
+ * workers : the number of worker threads, 0 for one per online processor
+ * cache   : the compilation cache, not used if its directory is NULL
+ * */
+typedef struct {
+    const char* manifest;
+    int workers;
+    CompilationCache cache;
+} BatchOptions;
+
+/**
+ * Reads the manifest from the given file into the given batch, allocating it
+ * from the given arena. Returns 0 on success, or the number of the first line
+ * that is not a source and an output path, -1 if no memory could be allocated.
+ * */
+int readBatchManifest(FILE*, Arena*, Batch*);
+
+/**
+ * Compiles the programs of the given batch with the given options on the given
+ * number of worker threads, 0 for one per online processor, setting the status
+ * of each job. The code of a source code already compiled with the same
+ * options is taken from the given cache instead, if not NULL. Returns the
+ * number of workers used, or -1 if they could not be started.
+ * */
+int runBatch(Batch*, int workers, CodeGeneratorOptions, const CompilationCache*);
+
+/**
+ * Prints a summary of the given batch on the given file: the number of
+ * programs compiled and failed, followed by a line for each program that
+ * failed, with its error.
+ * */
+void printBatchSummary(const Batch*, int workers, FILE*);
+
+/**
+ * Returns the number of programs of the given batch that failed.
+ * */
+int countBatchFailures(const Batch*);
+
+#endif
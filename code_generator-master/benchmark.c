@@ -0,0 +1,589 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+#include "token.h"
+#include "data.h"
+#include "arena.h"
+#include "code_generator.h"
+#include "lexer/lexical_analyzer.h"
+#include "vm/vm.h"
+
+/**
+ * Benchmarks the three stages, the lexer, the code generator and the virtual
+ * machine, on synthetic PL/0 programs generated in memory.
+ *
+ * Each program is generated from a BenchmarkShape: the number of statements of
+ * the loop of the main block, the number of constants and variables declared,
+ * the depth of the chain of nested procedures the loop calls, the depth of the
+ * parentheses of each expression assigned, and the number of iterations of the
+ * loop. An axis varies one of them over a list of values, the others being
+ * those of the base shape. Each program is lexed with lexicalAnalyzer(),
+ * compiled with codeGeneratorToMemory() and run with simulateCode(), untraced,
+ * each stage repeated and timed on its own, so that one stage does not hide the
+ * regressions of another. No file is read or written while timing.
+ *
+ * A line of key=value pairs separated by spaces is printed per program, always
+ * with the same keys in the same order, e.g. to be kept along each release and
+ * compared with the next.
+ * */
+
+/**
+ * The number of lexical levels the virtual machine is designed for, see
+ * MAX_LEXI_LEVELS in vm/data.h, around which the nesting axis is.
+ * */
+#define BENCHMARK_LEXI_LEVELS 3
+
+/**
+ * The largest number a PL/0 literal could be, see MAX_NUM_DIGIT_LENGTH.
+ * */
+#define BENCHMARK_MAX_NUMBER 99999
+
+/**
+ * What a generated program is made of.
+ * statements  : the number of statements of the loop of the main block
+ * declarations: the number of constants and variables declared, half each
+ * nesting     : the depth of the chain of nested procedures, 0 for none
+ * expression  : the depth of the parentheses of the expressions assigned
+ * iterations  : the number of iterations of the loop
+ * */
+typedef struct {
+    int statements;
+    int declarations;
+    int nesting;
+    int expression;
+    int iterations;
+} BenchmarkShape;
+
+/**
+ * An axis of the benchmark: its name, and the default values it takes.
+ * */
+typedef struct {
+    const char* name;
+    int values[8];
+    int numOfValues;
+} BenchmarkAxis;
+
+static const BenchmarkAxis benchmarkAxes[] = {
+    { "size",         { 16, 64, 256, 1024, 4096 }, 5 },
+    { "declarations", { 4, 16, 64, 256, 1024 }, 5 },
+    { "nesting",      { 1, 2, BENCHMARK_LEXI_LEVELS, BENCHMARK_LEXI_LEVELS + 1, BENCHMARK_LEXI_LEVELS + 3 }, 5 },
+    { "expression",   { 1, 4, 16, 64, 256 }, 5 },
+    { "loops",        { 1, 10, 100, 1000, 10000 }, 5 }
+};
+
+#define BENCHMARK_NUM_OF_AXES ((int)(sizeof(benchmarkAxes) / sizeof(benchmarkAxes[0])))
+
+/**
+ * A generated source code, length characters, null terminated, in capacity
+ * allocated.
+ * */
+typedef struct {
+    char* text;
+    size_t length;
+    size_t capacity;
+} BenchmarkSource;
+
+/**
+ * Options of the benchmark.
+ * runs      : the number of times each stage is run on each program
+ * axis      : the name of the axis to run, NULL for all of them
+ * values    : the values of the axis, numOfValues of them, instead of its own
+ * base      : the shape the axes vary a value of
+ * vmOptions : the options the programs are run with
+ * dumpDir   : the directory each generated program is written to, NULL if none
+ * */
+typedef struct {
+    int runs;
+    const char* axis;
+    int values[64];
+    int numOfValues;
+    BenchmarkShape base;
+    VMOptions vmOptions;
+    const char* dumpDir;
+} BenchmarkOptions;
+
+/**
+ * The times of the runs of a stage, in nanoseconds.
+ * */
+typedef struct {
+    long long min;
+    long long median;
+    long long mean;
+} BenchmarkTimes;
+
+/**
+ * Returns the time of the monotonic clock in nanoseconds.
+ * */
+long long getNanoseconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * Appends the formatted text to the given source code, growing it as needed.
+ * */
+void appendSource(BenchmarkSource* source, const char* format, ...)
+{
+    va_list args;
+    int written;
+
+    for(;;)
+    {
+        size_t left = source->capacity - source->length;
+
+        va_start(args, format);
+        written = vsnprintf(source->text + source->length, left, format, args);
+        va_end(args);
+
+        if(written >= 0 && (size_t)written < left) break;
+
+        source->capacity *= 2;
+        source->text = realloc(source->text, source->capacity);
+
+        if(!source->text)
+        {
+            fprintf(stderr, "Could not allocate the source code.\n");
+            exit(0);
+        }
+    }
+
+    source->length += written;
+}
+
+/**
+ * Appends an expression of the given depth of parentheses, on the variables
+ * and the constants of the program, its operands picked from the seed.
+ * The divisions are by a literal only, never 0.
+ * */
+void appendExpression(BenchmarkSource* source, int depth, int seed, int numOfVars, int numOfConsts)
+{
+    static const char* operators[] = { "+", "-", "*", "/" };
+    int d;
+
+    for(d = 0; d < depth; d++) appendSource(source, "(");
+
+    appendSource(source, "v%d", seed % numOfVars);
+
+    for(d = 0; d < depth; d++)
+    {
+        int op = (seed + d) % 4;
+
+        if(op >= 2) appendSource(source, " %s %d)", operators[op], 2 + (seed + d) % 3);
+        else if(d % 2) appendSource(source, " %s c%d)", operators[op], (seed + d) % numOfConsts);
+        else appendSource(source, " %s v%d)", operators[op], (seed + d) % numOfVars);
+    }
+}
+
+/**
+ * Generates the PL/0 source code of the given shape into source.
+ *
+ * The constants c0.. and the variables v0.. are followed by the chain of
+ * procedures p1 to pN, each declared in the previous one, with a variable aK
+ * of its own which it sets from the variable of the procedure it is declared
+ * in, reached through the static links; the innermost adds its own to s. The
+ * main block then loops, assigning the variables expressions, comparing them
+ * and looping on them in turn, and calls p1 at the end of each iteration.
+ * */
+void generateProgram(BenchmarkShape shape, BenchmarkSource* source)
+{
+    int numOfConsts = shape.declarations / 2 > 0 ? shape.declarations / 2 : 1;
+    int numOfVars = shape.declarations - numOfConsts > 0 ? shape.declarations - numOfConsts : 1;
+    int iterations = shape.iterations < BENCHMARK_MAX_NUMBER ? shape.iterations : BENCHMARK_MAX_NUMBER;
+    int i;
+
+    source->length = 0;
+    source->text[0] = '\0';
+
+    appendSource(source, "/* statements=%d declarations=%d nesting=%d expression=%d iterations=%d */\n",
+        shape.statements, shape.declarations, shape.nesting, shape.expression, iterations);
+
+    for(i = 0; i < numOfConsts; i++)
+        appendSource(source, "%s c%d = %d%s", i ? "," : "const", i, 1 + i % 7, i + 1 < numOfConsts ? "" : ";\n");
+
+    appendSource(source, "var i, j, s");
+    for(i = 0; i < numOfVars; i++) appendSource(source, ", v%d", i);
+    appendSource(source, ";\n");
+
+    // The procedures, each declared in the previous one
+    for(i = 1; i <= shape.nesting; i++)
+        appendSource(source, "%*sprocedure p%d;\n%*svar a%d;\n", 2 * (i - 1), "", i, 2 * i, "", i);
+
+    for(i = shape.nesting; i >= 1; i--)
+    {
+        appendSource(source, "%*sbegin\n", 2 * i, "");
+
+        if(i > 1) appendSource(source, "%*sa%d := a%d + 1;\n", 2 * i + 2, "", i, i - 1);
+        else      appendSource(source, "%*sa%d := v0;\n", 2 * i + 2, "", i);
+
+        if(i < shape.nesting) appendSource(source, "%*scall p%d\n", 2 * i + 2, "", i + 1);
+        else                  appendSource(source, "%*ss := s + a%d\n", 2 * i + 2, "", i);
+
+        appendSource(source, "%*send;\n", 2 * i, "");
+    }
+
+    appendSource(source, "begin\n  s := 0;\n");
+    for(i = 0; i < numOfVars; i++) appendSource(source, "  v%d := %d;\n", i, 1 + i % 5);
+
+    appendSource(source, "  i := 0;\n  while i < %d do\n  begin\n", iterations);
+
+    for(i = 0; i < shape.statements; i++)
+    {
+        int v = i % numOfVars, w = (i * 7 + 3) % numOfVars, c = i % numOfConsts;
+
+        switch(i % 4)
+        {
+            case 0:
+            case 2:
+                appendSource(source, "    v%d := ", v);
+                appendExpression(source, shape.expression, i, numOfVars, numOfConsts);
+                appendSource(source, ";\n");
+                break;
+            case 1:
+                appendSource(source, "    if v%d < v%d then v%d := v%d + c%d else v%d := v%d - c%d;\n",
+                    v, w, v, v, c, w, w, c);
+                break;
+            default:
+                appendSource(source, "    j := 0;\n    while j < c%d do begin s := s + v%d; j := j + 1 end;\n", c, v);
+                break;
+        }
+    }
+
+    if(shape.nesting > 0) appendSource(source, "    call p1;\n");
+
+    appendSource(source, "    i := i + 1\n  end;\n  write s\nend.\n");
+}
+
+int compareNanoseconds(const void* a, const void* b)
+{
+    long long ta = *(const long long*)a, tb = *(const long long*)b;
+    return (ta > tb) - (ta < tb);
+}
+
+/**
+ * Returns the min, the median and the mean of the given times of the runs.
+ * The times are sorted.
+ * */
+BenchmarkTimes getBenchmarkTimes(long long* times, int runs)
+{
+    BenchmarkTimes result;
+    long long sum = 0;
+    int i;
+
+    qsort(times, runs, sizeof(long long), compareNanoseconds);
+    for(i = 0; i < runs; i++) sum += times[i];
+
+    result.min = times[0];
+    result.median = (runs % 2) ? times[runs / 2] : (times[runs / 2 - 1] + times[runs / 2]) / 2;
+    result.mean = sum / runs;
+
+    return result;
+}
+
+/**
+ * Writes the given source code to DIR/axis-value.pl0.
+ * */
+void dumpProgram(const char* dir, const char* axis, int value, const BenchmarkSource* source)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s-%d.pl0", dir, axis, value);
+
+    FILE* out = fopen(path, "w");
+    if(!out)
+    {
+        fprintf(stderr, "Could not open \"%s\"\n", path);
+        return;
+    }
+
+    fwrite(source->text, 1, source->length, out);
+    fclose(out);
+}
+
+/**
+ * Lexes, compiles and runs the program of the given shape, each stage the
+ * given number of runs, and prints its line of results on out. Returns 0 on
+ * success, -1 if the program could not be lexed or compiled.
+ * */
+int runBenchmark(const char* axis, int value, BenchmarkShape shape, const BenchmarkOptions* options,
+                 BenchmarkSource* source, FILE* out)
+{
+    long long* times = malloc(options->runs * sizeof(long long));
+    BenchmarkTimes lexTimes, cgTimes, vmTimes;
+    LexerOut lexerOut;
+    Arena arena;
+    Instruction* code = NULL;
+    int numOfIns = 0, numOfTokens = 0, err = 0, run;
+
+    if(!times)
+    {
+        fprintf(stderr, "Could not allocate the benchmark.\n");
+        exit(0);
+    }
+
+    generateProgram(shape, source);
+    if(options->dumpDir) dumpProgram(options->dumpDir, axis, value, source);
+
+    // Lexer, from the source code in memory to the token list
+    for(run = 0; run < options->runs; run++)
+    {
+        initArena(&arena);
+
+        long long start = getNanoseconds();
+        lexerOut = lexicalAnalyzer(source->text, &arena);
+        times[run] = getNanoseconds() - start;
+
+        numOfTokens = lexerOut.tokenList.numberOfTokens;
+        err = (lexerOut.lexerError != NONE);
+
+        deleteLexerOut(&lexerOut);
+        deleteArena(&arena);
+
+        if(err) break;
+    }
+
+    if(err)
+    {
+        fprintf(stderr, "%s=%d: lexer error %d\n", axis, value, (int)lexerOut.lexerError);
+        free(times);
+        return -1;
+    }
+
+    lexTimes = getBenchmarkTimes(times, options->runs);
+
+    // Code generator, from the token list to the code in memory. The token
+    // .. list is lexed once, out of the timing
+    initArena(&arena);
+    lexerOut = lexicalAnalyzer(source->text, &arena);
+
+    for(run = 0; run < options->runs && !err; run++)
+    {
+        free(code);
+        code = NULL;
+
+        long long start = getNanoseconds();
+        err = codeGeneratorToMemory(lexerOut.tokenList, &code, &numOfIns, getDefaultCodeGeneratorOptions());
+        times[run] = getNanoseconds() - start;
+    }
+
+    deleteLexerOut(&lexerOut);
+    deleteArena(&arena);
+
+    if(err)
+    {
+        fprintf(stderr, "%s=%d: ", axis, value);
+        printCGErr(err, stderr);
+        free(code);
+        free(times);
+        return -1;
+    }
+
+    cgTimes = getBenchmarkTimes(times, options->runs);
+
+    // Virtual machine, from the code in memory, untraced. The program reads
+    // .. nothing, and writes a number per run
+    FILE* vmIn = tmpfile();
+    FILE* vmOut = tmpfile();
+
+    if(!vmIn || !vmOut)
+    {
+        fprintf(stderr, "Could not create the streams of the virtual machine.\n");
+        exit(0);
+    }
+
+    for(run = 0; run < options->runs; run++)
+    {
+        long long start = getNanoseconds();
+        simulateCode(code, numOfIns, NULL, vmIn, vmOut, options->vmOptions);
+        times[run] = getNanoseconds() - start;
+    }
+
+    fclose(vmIn);
+    fclose(vmOut);
+
+    vmTimes = getBenchmarkTimes(times, options->runs);
+
+    fprintf(out, "axis=%s value=%d statements=%d declarations=%d nesting=%d expression=%d iterations=%d runs=%d"
+                 " source_bytes=%lu tokens=%d instructions=%d"
+                 " lex_min_ns=%lld lex_median_ns=%lld lex_mean_ns=%lld"
+                 " cg_min_ns=%lld cg_median_ns=%lld cg_mean_ns=%lld"
+                 " vm_min_ns=%lld vm_median_ns=%lld vm_mean_ns=%lld\n",
+        axis, value, shape.statements, shape.declarations, shape.nesting, shape.expression, shape.iterations,
+        options->runs, (unsigned long)source->length, numOfTokens, numOfIns,
+        lexTimes.min, lexTimes.median, lexTimes.mean,
+        cgTimes.min, cgTimes.median, cgTimes.mean,
+        vmTimes.min, vmTimes.median, vmTimes.mean);
+    fflush(out);
+
+    free(code);
+    free(times);
+
+    return 0;
+}
+
+/**
+ * Returns the base shape with the field of the given axis set to value.
+ * */
+BenchmarkShape getAxisShape(BenchmarkShape base, const char* axis, int value)
+{
+    if(!strcmp(axis, "size"))              base.statements = value;
+    else if(!strcmp(axis, "declarations")) base.declarations = value;
+    else if(!strcmp(axis, "nesting"))      base.nesting = value;
+    else if(!strcmp(axis, "expression"))   base.expression = value;
+    else if(!strcmp(axis, "loops"))        base.iterations = value;
+
+    return base;
+}
+
+/**
+ * Returns the index of the axis of the given name, -1 if there is none.
+ * */
+int findBenchmarkAxis(const char* name)
+{
+    int i;
+    for(i = 0; i < BENCHMARK_NUM_OF_AXES; i++)
+        if(!strcmp(benchmarkAxes[i].name, name)) return i;
+
+    return -1;
+}
+
+/**
+ * Parses the comma separated list of values into the given options. Returns 0
+ * on success, -1 if a value is not a positive number, or 0 for nesting.
+ * */
+int parseValues(const char* list, BenchmarkOptions* options)
+{
+    options->numOfValues = 0;
+
+    while(*list && options->numOfValues < 64)
+    {
+        char* end;
+        long value = strtol(list, &end, 10);
+
+        if(end == list || value < 0 || value > 1000000 || (*end && *end != ',')) return -1;
+
+        options->values[options->numOfValues++] = (int)value;
+        list = *end ? end + 1 : end;
+    }
+
+    return options->numOfValues ? 0 : -1;
+}
+
+/**
+ * Parses the options into the given BenchmarkOptions. Returns 0 on success,
+ * -1 if an option is not recognized.
+ * */
+int parseOptions(int argc, char **argv, BenchmarkOptions* options)
+{
+    int i;
+    for(i = 1; i < argc; i++)
+    {
+        if( !strncmp(argv[i], "--runs=", 7) && atoi(argv[i] + 7) > 0 ) options->runs = atoi(argv[i] + 7);
+        else if( !strncmp(argv[i], "--axis=", 7) && findBenchmarkAxis(argv[i] + 7) >= 0 ) options->axis = argv[i] + 7;
+        else if( !strncmp(argv[i], "--values=", 9) )
+        {
+            if(parseValues(argv[i] + 9, options))
+            {
+                fprintf(stderr, "Invalid values \"%s\"\n", argv[i] + 9);
+                return -1;
+            }
+        }
+        else if( !strncmp(argv[i], "--statements=", 13) && atoi(argv[i] + 13) >= 0 )
+            options->base.statements = atoi(argv[i] + 13);
+        else if( !strncmp(argv[i], "--declarations=", 15) && atoi(argv[i] + 15) > 0 )
+            options->base.declarations = atoi(argv[i] + 15);
+        else if( !strncmp(argv[i], "--nesting=", 10) && atoi(argv[i] + 10) >= 0 )
+            options->base.nesting = atoi(argv[i] + 10);
+        else if( !strncmp(argv[i], "--expression=", 13) && atoi(argv[i] + 13) >= 0 )
+            options->base.expression = atoi(argv[i] + 13);
+        else if( !strncmp(argv[i], "--iterations=", 13) && atoi(argv[i] + 13) >= 0 )
+            options->base.iterations = atoi(argv[i] + 13);
+        else if( !strcmp(argv[i], "--engine=switch") )   options->vmOptions.engine = VM_ENGINE_SWITCH;
+        else if( !strcmp(argv[i], "--engine=threaded") ) options->vmOptions.engine = VM_ENGINE_THREADED;
+        else if( !strcmp(argv[i], "--engine=jit") )      options->vmOptions.engine = VM_ENGINE_JIT;
+        else if( !strncmp(argv[i], "--dump-programs=", 16) && argv[i][16] ) options->dumpDir = argv[i] + 16;
+        else
+        {
+            fprintf(stderr, "Unknown option \"%s\"\n", argv[i]);
+            return -1;
+        }
+    }
+
+    if(options->numOfValues && !options->axis)
+    {
+        fprintf(stderr, "--values needs an --axis\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    BenchmarkShape base = { 64, 16, BENCHMARK_LEXI_LEVELS, 4, 100 };
+    BenchmarkOptions options;
+
+    memset(&options, 0, sizeof(options));
+    options.runs = 5;
+    options.base = base;
+    options.vmOptions = getDefaultVMOptions();
+    options.vmOptions.trace = VM_TRACE_NONE;
+
+    if(parseOptions(argc, argv, &options))
+    {
+        fprintf(stderr, "Usage: ./benchmark.out [options]\n");
+
+        fprintf(stderr, "\n       Generates PL/0 programs along each axis, and prints a line of key=value pairs per program\n"
+                        "       with the times of the lexer, the code generator and the virtual machine on it.\n");
+
+        fprintf(stderr, "\n       options:\n"
+                        "         --runs=N                Run each stage N times on each program (default 5).\n"
+                        "         --axis=AXIS             Run the given axis only: size, declarations, nesting, expression\n"
+                        "                                 or loops (default all of them).\n"
+                        "         --values=A,B,..         The values the axis takes, instead of its own.\n"
+                        "         --statements=N, --declarations=N, --nesting=N, --expression=N, --iterations=N\n"
+                        "                                 The base program, whose field of the axis is set to each value\n"
+                        "                                 (default 64, 16, %d, 4 and 100).\n"
+                        "         --engine=...            Same as the option of vm.out: switch, threaded or jit.\n"
+                        "         --dump-programs=DIR     Write each generated program to DIR/axis-value.pl0.\n",
+                        BENCHMARK_LEXI_LEVELS);
+        return -1;
+    }
+
+    BenchmarkSource source;
+    source.capacity = 4096;
+    source.length = 0;
+    source.text = malloc(source.capacity);
+
+    if(!source.text)
+    {
+        fprintf(stderr, "Could not allocate the source code.\n");
+        exit(0);
+    }
+
+    int failed = 0, a, v;
+
+    for(a = 0; a < BENCHMARK_NUM_OF_AXES; a++)
+    {
+        const BenchmarkAxis* axis = &benchmarkAxes[a];
+
+        if(options.axis && strcmp(options.axis, axis->name)) continue;
+
+        const int* values = options.numOfValues ? options.values : axis->values;
+        int numOfValues = options.numOfValues ? options.numOfValues : axis->numOfValues;
+
+        for(v = 0; v < numOfValues; v++)
+        {
+            BenchmarkShape shape = getAxisShape(options.base, axis->name, values[v]);
+
+            if(runBenchmark(axis->name, values[v], shape, &options, &source, stdout)) failed++;
+        }
+    }
+
+    free(source.text);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+#include "cache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/**
+ * The extension of the entries, and the prefix of the temporary files they
+ * are written to.
+ * */
+#define CACHE_ENTRY_EXTENSION ".pm0"
+#define CACHE_TEMP_PREFIX     ".tmp-"
+
+/**
+ * An entry of the cache directory, as seen by the eviction.
+ * */
+typedef struct {
+    char name[32];
+    long size;
+    time_t used;
+} CacheEntry;
+
+/**
+ * Adds the given bytes to the 64-bit FNV-1a hash.
+ * */
+CacheKey hashBytes(CacheKey hash, const void* data, size_t length)
+{
+    const unsigned char* bytes = data;
+
+    for(size_t i = 0; i < length; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+CacheKey getCacheKey(const char* text, size_t length, CodeGeneratorOptions options)
+{
+    // The fields are hashed one by one, so that the padding of the options,
+    // .. and the format, which does not change the code, are left out
+    int fields[] = {
+        CG_CACHE_VERSION,
+        getRegisterCount(),
+        options.peephole,
+        options.fold,
+        options.optimize,
+        options.optimize ? (int)options.optimizer.passes : 0,
+        options.inlineThreshold
+    };
+
+    CacheKey hash = 14695981039346656037ull;
+    unsigned long long sourceLength = length;
+
+    hash = hashBytes(hash, fields, sizeof(fields));
+    hash = hashBytes(hash, &sourceLength, sizeof(sourceLength));
+    hash = hashBytes(hash, text, length);
+
+    return hash;
+}
+
+/**
+ * Writes the path of the entry of the given key into path, of size bytes.
+ * */
+void getEntryPath(const CompilationCache* cache, CacheKey key, char* path, size_t size)
+{
+    snprintf(path, size, "%s/%016llx" CACHE_ENTRY_EXTENSION, cache->dir, key);
+}
+
+int lookupCompilation(const CompilationCache* cache, CacheKey key, Instruction** code, int* numOfIns, CacheStats* stats)
+{
+    char path[4096];
+    getEntryPath(cache, key, path, sizeof(path));
+
+    FILE* in = fopen(path, "rb");
+    Instruction* ins = NULL;
+    int valid = 0;
+
+    if(in)
+    {
+        ObjectHeader header;
+        struct stat st;
+
+        // The header, then exactly the instructions it announces
+        if( fread(&header, sizeof(ObjectHeader), 1, in) == 1
+            && !memcmp(header.magic, PM0_OBJECT_MAGIC, sizeof(header.magic))
+            && header.version == PM0_OBJECT_VERSION
+            && !fstat(fileno(in), &st)
+            && (unsigned long long)st.st_size == sizeof(ObjectHeader) + (unsigned long long)header.numOfIns * sizeof(Instruction) )
+        {
+            ins = malloc((header.numOfIns ? header.numOfIns : 1) * sizeof(Instruction));
+
+            valid = ins
+                && fread(ins, sizeof(Instruction), header.numOfIns, in) == header.numOfIns
+                && codeChecksum(ins, header.numOfIns) == header.checksum;
+
+            if(valid) *numOfIns = header.numOfIns;
+        }
+
+        fclose(in);
+
+        // An entry that could not be read is of no use anymore
+        if(!valid)
+        {
+            free(ins);
+            ins = NULL;
+            unlink(path);
+        }
+    }
+
+    if(valid)
+    {
+        // Most recently used
+        utime(path, NULL);
+        *code = ins;
+    }
+
+    if(stats)
+    {
+        if(valid) stats->hits++;
+        else      stats->misses++;
+    }
+
+    return valid;
+}
+
+/**
+ * Orders the entries from the least to the most recently used.
+ * */
+int compareCacheEntries(const void* a, const void* b)
+{
+    const CacheEntry* x = a;
+    const CacheEntry* y = b;
+
+    if(x->used != y->used) return x->used < y->used ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+/**
+ * Removes the least recently used entries of the given cache, but the one of
+ * the given key, until the entries take at most the size of the cache.
+ * Returns the number of entries removed.
+ * */
+int evictCacheEntries(const CompilationCache* cache, CacheKey keep)
+{
+    DIR* dir = opendir(cache->dir);
+    if(!dir) return 0;
+
+    CacheEntry* entries = NULL;
+    int numOfEntries = 0, capacity = 0;
+    long total = 0;
+    char keptName[32], path[4096];
+    struct dirent* e;
+
+    snprintf(keptName, sizeof(keptName), "%016llx" CACHE_ENTRY_EXTENSION, keep);
+
+    while( (e = readdir(dir)) )
+    {
+        // Only the entries: 16 hexadecimal digits and the extension
+        size_t length = strlen(e->d_name);
+        if(length != 16 + strlen(CACHE_ENTRY_EXTENSION) || strcmp(e->d_name + 16, CACHE_ENTRY_EXTENSION)) continue;
+
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", cache->dir, e->d_name);
+        if(stat(path, &st)) continue;
+
+        total += (long)st.st_size;
+        if(!strcmp(e->d_name, keptName)) continue;
+
+        if(numOfEntries == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            CacheEntry* grown = realloc(entries, capacity * sizeof(CacheEntry));
+            if(!grown) break;
+            entries = grown;
+        }
+
+        CacheEntry* entry = &entries[numOfEntries++];
+        strcpy(entry->name, e->d_name);
+        entry->size = (long)st.st_size;
+        entry->used = st.st_mtime;
+    }
+
+    closedir(dir);
+
+    int evicted = 0;
+
+    if(total > cache->maxSize)
+    {
+        qsort(entries, numOfEntries, sizeof(CacheEntry), compareCacheEntries);
+
+        for(int i = 0; i < numOfEntries && total > cache->maxSize; i++)
+        {
+            snprintf(path, sizeof(path), "%s/%s", cache->dir, entries[i].name);
+
+            // Another process could have removed it already
+            if(!unlink(path)) evicted++;
+            total -= entries[i].size;
+        }
+    }
+
+    free(entries);
+    return evicted;
+}
+
+int storeCompilation(const CompilationCache* cache, CacheKey key, const Instruction* code, int numOfIns, CacheStats* stats)
+{
+    char path[4096], temp[4096];
+
+    if(mkdir(cache->dir, 0777) && errno != EEXIST) return -1;
+
+    getEntryPath(cache, key, path, sizeof(path));
+    snprintf(temp, sizeof(temp), "%s/" CACHE_TEMP_PREFIX "XXXXXX", cache->dir);
+
+    int fd = mkstemp(temp);
+    if(fd < 0) return -1;
+
+    // mkstemp() leaves the file to its owner only
+    fchmod(fd, 0644);
+
+    FILE* out = fdopen(fd, "wb");
+    if(!out)
+    {
+        close(fd);
+        unlink(temp);
+        return -1;
+    }
+
+    printCode(code, numOfIns, CG_FORMAT_BINARY, out);
+
+    // The entry appears at once, complete, or not at all
+    int err = ferror(out);
+    if(fclose(out) || err || rename(temp, path))
+    {
+        unlink(temp);
+        return -1;
+    }
+
+    int evicted = evictCacheEntries(cache, key);
+
+    if(stats)
+    {
+        stats->stores++;
+        stats->evictions += evicted;
+    }
+
+    return 0;
+}
+
+void addCacheStats(CacheStats* total, CacheStats stats)
+{
+    total->hits += stats.hits;
+    total->misses += stats.misses;
+    total->stores += stats.stores;
+    total->evictions += stats.evictions;
+}
+
+void printCacheStats(CacheStats stats, FILE* out)
+{
+    fprintf(out, "Cache: %d hits, %d misses, %d stored, %d evicted.\n",
+        stats.hits, stats.misses, stats.stores, stats.evictions);
+}
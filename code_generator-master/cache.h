@@ -0,0 +1,100 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include "data.h"
+#include "code_generator.h"
+
+/**
+ * Compilation cache: the code generated for a PL/0 source code, kept in a
+ * directory and looked up by the content of the source code, so that the same
+ * source code compiled with the same options is lexed and compiled only once.
+ *
+ * The key of a source code is the 64-bit FNV-1a hash of CG_CACHE_VERSION, the
+ * options that change the generated code (not the format, see below), the
+ * number of registers the code generator was built with, and the bytes of the
+ * source code. Only the code of the programs compiled without errors is kept.
+ *
+ * An entry is a file named after its key in hexadecimal, with the extension
+ * .pm0, holding the code in the binary object format (see ObjectHeader in
+ * data.h): vm.out could run an entry as it is. An entry is written to a
+ * temporary file first and renamed, so that processes sharing a directory
+ * never see a partial entry.
+ *
+ * Once the entries take more than the size of the cache, the least recently
+ * used are removed. A hit sets the modification time of the entry to now, and
+ * the oldest entries are removed first, to the second.
+ * */
+
+/**
+ * Version of the entries and their keys. Changing the code generator in a way
+ * that changes the code it generates should change it, so that no code of an
+ * older code generator is taken from the cache.
+ * */
+#define CG_CACHE_VERSION 1
+
+/**
+ * The number of bytes the entries of a cache take at most, if not given.
+ * */
+#define CG_DEFAULT_CACHE_SIZE (64L << 20)
+
+typedef unsigned long long CacheKey;
+
+/**
+ * A compilation cache.
+ * dir    : the directory of the entries, created if it does not exist
+ * maxSize: the number of bytes the entries take at most
+ * */
+typedef struct {
+    const char* dir;
+    long maxSize;
+} CompilationCache;
+
+/**
+ * What the lookups and the stores into a cache did.
+ * hits, misses: the lookups that found an entry, and those that did not
+ * stores     : the entries written
+ * evictions  : the entries removed to keep the cache in its size
+ * */
+typedef struct {
+    int hits;
+    int misses;
+    int stores;
+    int evictions;
+} CacheStats;
+
+/**
+ * Returns the key of the given source code of length characters, compiled
+ * with the given options.
+ * */
+CacheKey getCacheKey(const char* text, size_t length, CodeGeneratorOptions options);
+
+/**
+ * Looks the code of the given key up in the given cache. On a hit, sets code
+ * to the code, allocated here and to be freed by the caller, and numOfIns to
+ * the number of instructions in it, and returns 1. Returns 0 on a miss, the
+ * entry of the key being removed if it is not a valid object file. Counts the
+ * lookup in stats, if not NULL.
+ * */
+int lookupCompilation(const CompilationCache* cache, CacheKey key, Instruction** code, int* numOfIns, CacheStats* stats);
+
+/**
+ * Stores the numOfIns instructions of the given code as the entry of the given
+ * key, then removes the least recently used entries if the cache is over its
+ * size. Counts the store and the removals in stats, if not NULL. Returns 0 on
+ * success, -1 if the entry could not be written.
+ * */
+int storeCompilation(const CompilationCache* cache, CacheKey key, const Instruction* code, int numOfIns, CacheStats* stats);
+
+/**
+ * Adds the counters of the given stats to those of total.
+ * */
+void addCacheStats(CacheStats* total, CacheStats stats);
+
+/**
+ * Prints the given stats on the given file, in a single line.
+ * */
+void printCacheStats(CacheStats stats, FILE* out);
+
+#endif
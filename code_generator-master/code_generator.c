@@ -1,89 +1,120 @@
 #include "token.h"
 #include "data.h"
 #include "symbol.h"
+#include "code_generator.h"
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 
 /**
- * This pointer is set when by codeGenerator() func and used by printEmittedCode() func.
- * 
- * You are not required to use it anywhere. The implemented part of the skeleton
- * handles the printing. Instead, you are required to fill the vmCode properly by making
- * use of emit() func.
+ * Context of the functions that do not take one: codeGenerator(),
+ * codeGeneratorWithOptions(), codeGeneratorFromSource(), the ToMemory variants
+ * and the stats getters. They are not reentrant; codeGeneratorWithContext()
+ * is.
  * */
-FILE* _out;
+CompilerContext _context;
 
 /**
- * Token list iterator used by the code generator. It will be set once entered to
- * codeGenerator() and reset before exiting codeGenerator().
- * 
- * It is better to use the given helper functions to make use of token list iterator.
+ * The number of registers of the virtual machine (REGISTER_FILE_REG_COUNT).
+ * Could be lowered at build time, to at least 2, to exercise the spilling.
  * */
-TokenListIterator _token_list_it;
+#ifndef REGISTER_COUNT
+#define REGISTER_COUNT 16
+#endif
 
 /**
- * Current level. Use this to keep track of the current level for the symbol table entries.
+ * An expression (or a condition) is parsed into a tree before any code is
+ * emitted for it, so that the registers could be allocated over the whole
+ * expression (see generateExpression()).
+ * op   : LIT, LOD, NEG or ODD, or the opcode of a binary operation
+ * value: the value of a LIT
+ * l, m : the L and M fields of a LOD
+ * need : the number of registers needed to evaluate the node without spilling,
+ *        its Sethi-Ullman number
+ * left, right: the operands; a NEG or ODD has only the left one
+ * The nodes are allocated from the arena of the symbol table.
  * */
-unsigned int currentLevel;
+typedef struct ExprNode ExprNode;
+
+struct ExprNode {
+    int op;
+    int value;
+    int l, m;
+    int need;
+    ExprNode* left;
+    ExprNode* right;
+};
 
 /**
- * Current scope. Use this to keep track of the current scope for the symbol table entries.
- * NULL means global scope.
+ * Emits the instruction whose fields are given as parameters.
+ * Internally, writes the instruction to vmCode[nextCodeIndex] and returns the
+ * nextCodeIndex by post-incrementing it.
+ * vmCode is doubled when it is full. If it could not be grown, prints an error
+ * message on stderr and exits.
  * */
-Symbol* currentScope;
+int emit(CompilerContext* context, int OP, int R, int L, int M);
 
 /**
- * Symbol table.
+ * Prints the emitted code array (vmCode) to output file.
+ * 
+ * This func is called in the given codeGenerator() function. You are not required
+ * to have another call to this function in your code.
  * */
-SymbolTable symbolTable;
+void printEmittedCodes(CompilerContext* context);
 
 /**
- * The array of instructions that the generated(emitted) code will be held.
+ * Returns a new expression tree node. Operations on known values are folded
+ * as the nodes are made, unless folding is disabled.
  * */
-Instruction vmCode[MAX_CODE_LENGTH];
+ExprNode* newLeaf(CompilerContext* context, int op, int value, int l, int m);
+ExprNode* newUnary(CompilerContext* context, int op, ExprNode* operand);
+ExprNode* newBinary(CompilerContext* context, int op, ExprNode* left, ExprNode* right);
 
 /**
- * The next index in the array of instructions (vmCode) to be filled.
+ * Emits the code evaluating the given expression tree into register reg. The
+ * registers from reg up are used, and the values that do not fit into the
+ * register file are spilled to the temporaries of the activation record.
  * */
-int nextCodeIndex;
+void generateExpression(CompilerContext* context, ExprNode* node, int reg);
 
 /**
- * The id of the register currently being used.
+ * Emits the jump taken when the given condition is false. Its target is to be
+ * set by the caller. If the condition is known, it is a JMP, or nothing at all
+ * if the condition is true, in which case -1 is returned.
  * */
-int currentReg;
+int emitJumpIfFalse(CompilerContext* context, ExprNode* condition);
 
 /**
- * Emits the instruction whose fields are given as parameters.
- * Internally, writes the instruction to vmCode[nextCodeIndex] and returns the
- * nextCodeIndex by post-incrementing it.
- * If MAX_CODE_LENGTH is reached, prints an error message on stderr and exits.
+ * Returns the number of instructions of the body of the given procedure, just
+ * emitted, if its calls could be replaced by the body, or -1 if not: it should
+ * have no variables, no temporaries, no nested procedures and no calls, and
+ * its body should be at most the inline threshold of the options long.
  * */
-int emit(int OP, int R, int L, int M);
+int inlineSize(CompilerContext* context, Symbol* procedure);
 
 /**
- * Prints the emitted code array (vmCode) to output file.
- * 
- * This func is called in the given codeGenerator() function. You are not required
- * to have another call to this function in your code.
+ * Emits a copy of the body of the given procedure, instead of a call to it.
+ * The body reads and writes only the frames of the levels below its own, whose
+ * L fields are made relative to the current level, and its jumps are moved to
+ * the copy.
  * */
-void printEmittedCodes();
+void emitInlined(CompilerContext* context, Symbol* procedure);
 
 /**
- * Returns the current token using the token list iterator.
+ * Returns the current token pulled from the token source.
  * If it is the end of tokens, returns token with id nulsym.
  * */
-Token getCurrentToken();
+Token getCurrentToken(CompilerContext* context);
 
 /**
  * Returns the type of the current token. Returns nulsym if it is the end of tokens.
  * */
-int getCurrentTokenType();
+int getCurrentTokenType(CompilerContext* context);
 
 /**
- * Advances the position of TokenListIterator by incrementing the current token
- * index by one.
+ * Pulls the next token from the token source as the current token.
  * */
-void nextToken();
+void nextToken(CompilerContext* context);
 
 /**
  * Functions used for non-terminals of the grammar
@@ -91,34 +122,49 @@ void nextToken();
  * rel-op func is removed on purpose. For code generation, it is easier to parse
  * rel-op as a part of condition.
  * */
-int program();
-int block();
-int const_declaration();
-int var_declaration();
-int proc_declaration();
-int statement();
-int condition();
-int expression();
-int term();
-int factor();
+int program(CompilerContext* context);
+int block(CompilerContext* context);
+int block_statement(CompilerContext* context, int numOfVars);
+int const_declaration(CompilerContext* context);
+int const_definition(CompilerContext* context);
+int var_declaration(CompilerContext* context, int* numOfVars);
+int var_definition(CompilerContext* context, int* numOfVars);
+int proc_declaration(CompilerContext* context);
+int statement(CompilerContext* context);
+int condition(CompilerContext* context, ExprNode** tree);
+int expression(CompilerContext* context, ExprNode** tree);
+int term(CompilerContext* context, ExprNode** tree);
+int factor(CompilerContext* context, ExprNode** tree);
 
 /******************************************************************************/
 /* Definitions of helper functions starts *************************************/
 /******************************************************************************/
 
-Token getCurrentToken()
+Token getCurrentToken(CompilerContext* context)
+{
+    return context->currentToken;
+}
+
+int getCurrentTokenType(CompilerContext* context)
 {
-    return getCurrentTokenFromIterator(_token_list_it);
+    return getCurrentToken(context).id;
 }
 
-int getCurrentTokenType()
+void nextToken(CompilerContext* context)
 {
-    return getCurrentToken().id;
+    context->currentToken = context->tokenSource.pull(context->tokenSource.state);
+    context->tokenIndex++;
 }
 
-void nextToken()
+/**
+ * Searches the symbol of the given name from the current scope, among the
+ * symbols visible to the statement being generated.
+ * */
+Symbol* lookupSymbol(CompilerContext* context, const char* name)
 {
-    _token_list_it.currentTokenInd++;
+    int visible = context->visibleSymbols >= 0 ? context->visibleSymbols : context->symbolTable.numberOfSymbols;
+
+    return findSymbolBefore(&context->symbolTable, context->currentScope, name, visible);
 }
 
 /**
@@ -132,41 +178,283 @@ void printCGErr(int errCode, FILE* fp)
     fprintf(fp, "CODE GENERATOR ERROR[%d]: %s.\n", errCode, codeGeneratorErrMsg[errCode]);
 }
 
-int emit(int OP, int R, int L, int M)
+int emit(CompilerContext* context, int OP, int R, int L, int M)
 {
-    if(nextCodeIndex == MAX_CODE_LENGTH)
+    if(context->nextCodeIndex == context->vmCodeCapacity)
     {
-        fprintf(stderr, "MAX_CODE_LENGTH(%d) reached. Emit is unsuccessful: terminating code generator..\n", MAX_CODE_LENGTH);
-        exit(0);
+        int capacity = context->vmCodeCapacity ? context->vmCodeCapacity * 2 : 256;
+        Instruction* grown = realloc(context->vmCode, capacity * sizeof(Instruction));
+
+        if(!grown)
+        {
+            fprintf(stderr, "Could not grow the code to %d instructions. Emit is unsuccessful: terminating code generator..\n", capacity);
+            exit(0);
+        }
+
+        context->vmCode = grown;
+        context->vmCodeCapacity = capacity;
     }
     
-    vmCode[nextCodeIndex] = (Instruction){ .op = OP, .r = R, .l = L, .m = M};    
+    context->vmCode[context->nextCodeIndex] = (Instruction){ .op = OP, .r = R, .l = L, .m = M};    
+
+    return context->nextCodeIndex++;
+}
+
+// Computes a op b as the virtual machine does, into result. Returns 0 if the
+// .. operation is not to be folded, i.e. a division by zero or an overflowing
+// .. division, which are left to run time.
+int foldOperation(int op, int a, int b, int* result)
+{
+    switch(op)
+    {
+        // Wraps around as the machine arithmetic does, without overflowing here
+        case ADD: *result = (int)((unsigned)a + (unsigned)b); return 1;
+        case SUB: *result = (int)((unsigned)a - (unsigned)b); return 1;
+        case MUL: *result = (int)((unsigned)a * (unsigned)b); return 1;
+
+        case DIV:
+        case MOD:
+            if(b == 0 || (a == INT_MIN && b == -1)) return 0;
+            *result = (op == DIV) ? a / b : a % b;
+            return 1;
+
+        case EQL: *result = (a == b); return 1;
+        case NEQ: *result = (a != b); return 1;
+        case LSS: *result = (a <  b); return 1;
+        case LEQ: *result = (a <= b); return 1;
+        case GTR: *result = (a >  b); return 1;
+        case GEQ: *result = (a >= b); return 1;
+    }
+
+    return 0;
+}
+
+ExprNode* newNode(CompilerContext* context, int op, ExprNode* left, ExprNode* right)
+{
+    ExprNode* node = arenaAlloc(context->symbolTable.arena, sizeof(ExprNode));
+
+    node->op = op;
+    node->value = node->l = node->m = 0;
+    node->left = left;
+    node->right = right;
+
+    // A leaf is loaded into a register, a unary operation is done in place.
+    // .. Of the operands of a binary operation, the one needing more registers
+    // .. is evaluated first; the other one into the next register.
+    if(!left)        node->need = 1;
+    else if(!right)  node->need = left->need;
+    else if(left->need == right->need) node->need = left->need + 1;
+    else node->need = (left->need > right->need) ? left->need : right->need;
+
+    return node;
+}
+
+ExprNode* newLeaf(CompilerContext* context, int op, int value, int l, int m)
+{
+    ExprNode* node = newNode(context, op, NULL, NULL);
+
+    node->value = value;
+    node->l = l;
+    node->m = m;
+
+    return node;
+}
+
+ExprNode* newUnary(CompilerContext* context, int op, ExprNode* operand)
+{
+    if(context->options.fold && operand->op == LIT)
+    {
+        if(op == NEG && operand->value != INT_MIN)
+            return newLeaf(context, LIT, -operand->value, 0, 0);
+
+        if(op == ODD)
+            return newLeaf(context, LIT, operand->value % 2, 0, 0);
+    }
+
+    return newNode(context, op, operand, NULL);
+}
+
+ExprNode* newBinary(CompilerContext* context, int op, ExprNode* left, ExprNode* right)
+{
+    int result;
+
+    if(context->options.fold)
+    {
+        if(left->op == LIT && right->op == LIT && foldOperation(op, left->value, right->value, &result))
+            return newLeaf(context, LIT, result, 0, 0);
+
+        // x + 0, x - 0, x * 1 and x / 1 are x, and so are 0 + x and 1 * x
+        if(right->op == LIT && ((op == ADD || op == SUB) && right->value == 0))
+            return left;
+        if(right->op == LIT && ((op == MUL || op == DIV) && right->value == 1))
+            return left;
+        if(left->op == LIT && ((op == ADD && left->value == 0) || (op == MUL && left->value == 1)))
+            return right;
+    }
+
+    return newNode(context, op, left, right);
+}
+
+void generateExpression(CompilerContext* context, ExprNode* node, int reg)
+{
+    if(node->op == LIT)
+    {
+        emit(context, LIT, reg, 0, node->value);
+        return;
+    }
 
-    return nextCodeIndex++;
+    if(node->op == LOD)
+    {
+        emit(context, LOD, reg, node->l, node->m);
+        return;
+    }
+
+    if(!node->right)
+    {
+        generateExpression(context, node->left, reg);
+
+        if(node->op == NEG) emit(context, NEG, reg, reg, 0);
+        else                emit(context, ODD, reg, 0, 0);
+        return;
+    }
+
+    // The operand needing more registers goes first, into reg
+    int leftFirst = (node->left->need >= node->right->need);
+    ExprNode* first  = leftFirst ? node->left : node->right;
+    ExprNode* second = leftFirst ? node->right : node->left;
+
+    generateExpression(context, first, reg);
+
+    if(reg + second->need < REGISTER_COUNT)
+    {
+        // The second operand fits into the registers left above the first one
+        generateExpression(context, second, reg + 1);
+
+        if(leftFirst) emit(context, node->op, reg, reg, reg + 1);
+        else          emit(context, node->op, reg, reg + 1, reg);
+    }
+    else
+    {
+        // Spill the first operand to a temporary, so that the second one has
+        // .. the same registers. It is loaded back next to the second one.
+        int slot = context->spillBase + context->spillDepth++;
+        if(context->spillDepth > context->spillSlots) context->spillSlots = context->spillDepth;
+
+        emit(context, STO, reg, 0, slot);
+        generateExpression(context, second, reg);
+        emit(context, LOD, reg + 1, 0, slot);
+
+        context->spillDepth--;
+
+        if(leftFirst) emit(context, node->op, reg, reg + 1, reg);
+        else          emit(context, node->op, reg, reg, reg + 1);
+    }
+}
+
+int emitJumpIfFalse(CompilerContext* context, ExprNode* condition)
+{
+    if(condition->op == LIT)
+    {
+        return condition->value ? -1 : emit(context, JMP, 0, 0, 0);
+    }
+
+    generateExpression(context, condition, 0);
+
+    return emit(context, JPC, 0, 0, 0);
+}
+
+// finds the L field of LOD, STO and CAL for the given symbol: the number of
+// .. static links from the current level to the level the symbol is declared at
+int findLevel(CompilerContext* context, Symbol* symbol)
+{
+	return context->currentLevel - symbol->level;
+}
+
+int inlineSize(CompilerContext* context, Symbol* procedure)
+{
+    int body = procedure->address + 1;
+    int size = context->nextCodeIndex - 1 - body; // the RTN is not part of it
+
+    // A procedure with nested procedures starts with the JMP over them, and
+    // .. an INC of more than the activation record reserves variables or
+    // .. temporaries
+    if(context->vmCode[procedure->address].op != INC || context->vmCode[procedure->address].m != AR_VARIABLE_OFFSET) return -1;
+    if(context->options.inlineThreshold <= 0 || size > context->options.inlineThreshold) return -1;
+
+    for(int i = body; i < body + size; i++)
+    {
+        if(context->vmCode[i].op == CAL) return -1;
+        if((context->vmCode[i].op == LOD || context->vmCode[i].op == STO) && context->vmCode[i].l == 0) return -1;
+    }
+
+    return size;
+}
+
+void emitInlined(CompilerContext* context, Symbol* procedure)
+{
+    int body = procedure->address + 1;
+    int start = context->nextCodeIndex;
+
+    for(int i = body; i < body + procedure->inlineSize; i++)
+    {
+        Instruction ins = context->vmCode[i];
+
+        // L levels down from the procedure is L - 1 levels down from the
+        // .. level it is declared at
+        if(ins.op == LOD || ins.op == STO) ins.l += findLevel(context, procedure) - 1;
+
+        // The jumps stay within the body, or go to its RTN, which is the end
+        // .. of the copy
+        if(ins.op == JMP || ins.op == JPC) ins.m += start - body;
+
+        emit(context, ins.op, ins.r, ins.l, ins.m);
+    }
+
+    context->inlinedCalls++;
 }
 
-// finds level for STO and LOD functions
-int findLevel(int foundSymbol)
+unsigned int codeChecksum(const Instruction* code, int numOfIns)
 {
-	if ( currentLevel - findSymbol( &symbolTable, currentScope, getCurrentToken().lexeme )->level < 0 )
-	{
-		return 0;
-	}
-	else
-	{
-		return currentLevel - findSymbol( &symbolTable, currentScope, getCurrentToken().lexeme )->level;
-	}
+    const unsigned char* bytes = (const unsigned char*)code;
+    unsigned int hash = 2166136261u;
+
+    for(size_t i = 0; i < numOfIns * sizeof(Instruction); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
 }
 
-void printEmittedCodes()
+void printCode(const Instruction* code, int numOfIns, CodeGeneratorFormat format, FILE* out)
 {
-    for(int i = 0; i < nextCodeIndex; i++)
+    if(format == CG_FORMAT_BINARY)
+    {
+        ObjectHeader header;
+
+        memcpy(header.magic, PM0_OBJECT_MAGIC, sizeof(header.magic));
+        header.version = PM0_OBJECT_VERSION;
+        header.numOfIns = numOfIns;
+        header.checksum = codeChecksum(code, numOfIns);
+
+        fwrite(&header, sizeof(ObjectHeader), 1, out);
+        fwrite(code, sizeof(Instruction), numOfIns, out);
+        return;
+    }
+
+    for(int i = 0; i < numOfIns; i++)
     {
-        Instruction c = vmCode[i];
-        fprintf(_out, "%d %d %d %d\n", c.op, c.r, c.l, c.m);
+        Instruction c = code[i];
+        fprintf(out, "%d %d %d %d\n", c.op, c.r, c.l, c.m);
     }
 }
 
+void printEmittedCodes(CompilerContext* context)
+{
+    printCode(context->vmCode, context->nextCodeIndex, context->options.format, context->out);
+}
+
 /******************************************************************************/
 /* Definitions of helper functions ends ***************************************/
 /******************************************************************************/
@@ -181,69 +469,252 @@ void printEmittedCodes()
  * */
 int codeGenerator(TokenList tokenList, FILE* out)
 {
-    // Set output file pointer
-    _out = out;
+    return codeGeneratorWithOptions(tokenList, out, getDefaultCodeGeneratorOptions());
+}
+
+CodeGeneratorOptions getDefaultCodeGeneratorOptions()
+{
+    CodeGeneratorOptions options;
+
+    options.format = CG_FORMAT_TEXT;
+    options.peephole = 0;
+    options.fold = 1;
+    options.optimize = 0;
+    options.inlineThreshold = 0;
+    options.optimizer = getDefaultOptimizerOptions();
+
+    return options;
+}
+
+int codeGeneratorWithOptions(TokenList tokenList, FILE* out, CodeGeneratorOptions options)
+{
+    TokenListIterator it = getTokenListIterator(&tokenList);
+
+    return codeGeneratorFromSource(getTokenListSource(&it), out, options);
+}
+
+int codeGeneratorFromSource(TokenSource tokenSource, FILE* out, CodeGeneratorOptions options)
+{
+    return codeGeneratorWithContext(&_context, tokenSource, out, options);
+}
+
+void initCompilerContext(CompilerContext* context)
+{
+    memset(context, 0, sizeof(*context));
+    context->visibleSymbols = -1;
+}
+
+void deleteCompilerContext(CompilerContext* context)
+{
+    free(context->vmCode);
+    free(context->blocks);
+
+    context->vmCode = NULL;
+    context->vmCodeCapacity = 0;
+    context->nextCodeIndex = 0;
+
+    context->blocks = NULL;
+    context->numOfBlocks = 0;
+    context->blocksCapacity = 0;
+}
+
+int codeGeneratorWithContext(CompilerContext* context, TokenSource tokenSource, FILE* out, CodeGeneratorOptions options)
+{
+    // Set output file pointer and options
+    context->out = out;
+    context->options = options;
 
     /**
-     * Create a token list iterator, which helps to keep track of the current
-     * token being parsed.
+     * Set the token source, and pull the first token to be parsed.
      * */
-    _token_list_it = getTokenListIterator(&tokenList);
+    context->tokenSource = tokenSource;
+    context->tokenIndex = -1;
+    nextToken(context);
 
     // Initialize current level to 0, which is the global level
-    currentLevel = 0;
+    context->currentLevel = 0;
 
     // Initialize current scope to NULL, which is the global scope
-    currentScope = NULL;
+    context->currentScope = NULL;
 
     // The index on the vmCode array that the next emitted code will be written
-    nextCodeIndex = 0;
+    context->nextCodeIndex = 0;
+
+    // No temporaries are in use
+    context->spillBase = AR_VARIABLE_OFFSET;
+    context->spillDepth = 0;
+    context->spillSlots = 0;
+
+    context->inlinedCalls = 0;
+    context->numOfBlocks = 0;
+
+    // Initialize symbol table, whose symbols are released at once at the end,
+    // .. or at the start of the next code generation if they are kept
+    Arena arena;
+    Arena* symbols = context->symbolArena;
 
-    // The id of the register currently being used
-    currentReg = 0;
+    if(symbols)
+    {
+        resetArena(symbols);
+    }
+    else
+    {
+        initArena(&arena);
+        symbols = &arena;
+    }
 
-    // Initialize symbol table
-    initSymbolTable(&symbolTable);
+    initSymbolTable(&context->symbolTable, symbols);
+    context->visibleSymbols = -1;
 
     // Start parsing by parsing program as the grammar suggests.
-    int err = program();
+    int err = program(context);
 
-    // Print symbol table - if no error occured
-    if(!err)
+    // Optimize the whole program once it is emitted
+    memset(&context->optimizerStats, 0, sizeof(context->optimizerStats));
+    context->peepholeStats = (PeepholeStats){ 0, 0, 0 };
+
+    if(!err && context->options.optimize)
+    {
+        // The optimized code replaces vmCode
+        context->nextCodeIndex = optimizeCode(&context->vmCode, context->nextCodeIndex, context->options.optimizer, &context->optimizerStats);
+        context->vmCodeCapacity = context->nextCodeIndex;
+    }
+
+    if(!err && context->options.peephole)
+    {
+        context->nextCodeIndex = peepholeOptimize(context->vmCode, context->nextCodeIndex, &context->peepholeStats);
+    }
+
+    // Print symbol table - if no error occured and there is an output file
+    if(!err && context->out)
     {
         // Print the emitted codes to the file
-        printEmittedCodes();
+        printEmittedCodes(context);
     }
 
     // Reset output file pointer
-    _out = NULL;
+    context->out = NULL;
+
+    // What the symbol table did, kept once it is deleted
+    context->symbolStats = getSymbolStats(&context->symbolTable);
 
-    // Reset the global TokenListIterator
-    _token_list_it.currentTokenInd = 0;
-    _token_list_it.tokenList = NULL;
+    // Reset the token source
+    context->tokenSource.pull = NULL;
+    context->tokenSource.state = NULL;
 
-    // Delete symbol table
-    deleteSymbolTable(&symbolTable);
+    // Delete symbol table, unless it is kept
+    if(!context->symbolArena)
+    {
+        deleteSymbolTable(&context->symbolTable);
+        deleteArena(&arena);
+    }
 
     // Return err code - which is 0 if parsing was successful
     return err;
 }
 
+int codeGeneratorToMemory(TokenList tokenList, Instruction** code, int* numOfIns, CodeGeneratorOptions options)
+{
+    TokenListIterator it = getTokenListIterator(&tokenList);
+
+    return codeGeneratorSourceToMemory(getTokenListSource(&it), code, numOfIns, options);
+}
+
+int codeGeneratorSourceToMemory(TokenSource tokenSource, Instruction** code, int* numOfIns, CodeGeneratorOptions options)
+{
+    return codeGeneratorContextToMemory(&_context, tokenSource, code, numOfIns, options);
+}
+
+int codeGeneratorContextToMemory(CompilerContext* context, TokenSource tokenSource, Instruction** code, int* numOfIns, CodeGeneratorOptions options)
+{
+    // Generate code without printing it, it is kept in vmCode
+    int err = codeGeneratorWithContext(context, tokenSource, NULL, options);
+
+    *code = NULL;
+    *numOfIns = 0;
+
+    if(!err)
+    {
+        // Hand vmCode over, the next call starts with a new array
+        *code = context->vmCode;
+        *numOfIns = context->nextCodeIndex;
+
+        context->vmCode = NULL;
+        context->vmCodeCapacity = 0;
+    }
+
+    return err;
+}
+
+int regenerateBlock(CompilerContext* context, const BlockRange* range, TokenSource tokenSource)
+{
+    context->out = NULL;
+
+    context->tokenSource = tokenSource;
+    context->tokenIndex = -1;
+    nextToken(context);
+
+    // The state block() left for the statement, which only the symbols
+    // .. declared before it are visible to
+    context->currentLevel = range->level;
+    context->currentScope = range->procedure;
+    context->visibleSymbols = range->numOfSymbols;
+
+    context->spillDepth = 0;
+    context->inlinedCalls = 0;
+
+    int err = block_statement(context, range->numOfVars);
+
+    if(!err && range->procedure) emit(context, RTN, 0, 0, 0);
+    if(!err && !range->procedure) emit(context, SIO_HALT, 0, 0, 3);
+
+    context->visibleSymbols = -1;
+    context->tokenSource.pull = NULL;
+    context->tokenSource.state = NULL;
+
+    return err;
+}
+
+PeepholeStats getPeepholeStats()
+{
+    return _context.peepholeStats;
+}
+
+OptimizerStats getOptimizerStats()
+{
+    return _context.optimizerStats;
+}
+
+int getInlinedCallCount()
+{
+    return _context.inlinedCalls;
+}
+
+SymbolStats getSymbolTableStats()
+{
+    return _context.symbolStats;
+}
+
+int getRegisterCount()
+{
+    return REGISTER_COUNT;
+}
+
 // Already implemented.
-int program()
+int program(CompilerContext* context)
 {
     // Generate code for block
-    int err = block();
+    int err = block(context);
     if(err) return err;
 
     // After parsing block, periodsym should show up
-    if( getCurrentTokenType() == periodsym )
+    if( getCurrentTokenType(context) == periodsym )
     {
         // Consume token
-        nextToken();
+        nextToken(context);
 
         // End of program, emit halt code
-        emit(SIO_HALT, 0, 0, 3);
+        emit(context, SIO_HALT, 0, 0, 3);
 
         return 0;
     }
@@ -254,18 +725,19 @@ int program()
     }
 }
 
-int block()
+int block(CompilerContext* context)
 {
     /**
      * block is 
-	 * 1) const_declaration
-	 * 2) var_declaration
-	 * 3) proc_declaration
-	 * 4) statement
+     * 1) const_declaration
+     * 2) var_declaration
+     * 3) proc_declaration
+     * 4) statement
      * */
-	 
-	// Parse const_declaration.
-    int err = const_declaration();
+
+
+    // Parse const_declaration.
+    int err = const_declaration(context);
 
     /**
      * If parsing of const_declaration was not successful, immediately stop parsing
@@ -273,979 +745,906 @@ int block()
      * */
     if(err) return err;
 
-    // Parse var_declaration.
-    err = var_declaration();
+    // Parse var_declaration. Variables are numbered from the activation record.
+    int numOfVars = 0;
+    err = var_declaration(context, &numOfVars);
 
     /**
      * If parsing of var_declaration was not successful, immediately stop parsing
      * and propagate the same error code by returning it.
      * */
     if(err) return err;
-	
-	// Parse proc_declaration.
-    err = proc_declaration();
+
+    // Nested procedures are emitted in front of the statement of this block,
+    // .. which is jumped to from the entry.
+    int jmpRef = -1;
+    if(getCurrentTokenType(context) == procsym)
+    {
+        jmpRef = emit(context, JMP, 0, 0, 0);
+    }
+
+    // Parse proc_declaration.
+    err = proc_declaration(context);
 
     /**
      * If parsing of proc_declaration was not successful, immediately stop parsing
      * and propagate the same error code by returning it.
      * */
     if(err) return err;
-	
-	// Parse statement.
-    err = statement();
 
-    /**
-     * If parsing of statement was not successful, immediately stop parsing
-     * and propagate the same error code by returning it.
-     * */
+    if(jmpRef >= 0)
+    {
+        context->vmCode[jmpRef].m = context->nextCodeIndex;
+    }
+
+    BlockRange range = { context->currentScope, context->currentLevel, numOfVars,
+                         context->symbolTable.numberOfSymbols, context->tokenIndex, 0, context->nextCodeIndex, 0 };
+
+    err = block_statement(context, numOfVars);
     if(err) return err;
 
+    // The RTN or the SIO halt follows the statement
+    if(context->recordBlocks)
+    {
+        range.endToken = context->tokenIndex;
+        range.endAddress = context->nextCodeIndex + 1;
+
+        if(context->numOfBlocks == context->blocksCapacity)
+        {
+            int capacity = context->blocksCapacity ? context->blocksCapacity * 2 : 16;
+            BlockRange* grown = realloc(context->blocks, capacity * sizeof(BlockRange));
+
+            if(!grown)
+            {
+                fprintf(stderr, "Could not grow the blocks to %d. Recording is unsuccessful: terminating code generator..\n", capacity);
+                exit(0);
+            }
+
+            context->blocks = grown;
+            context->blocksCapacity = capacity;
+        }
+
+        context->blocks[context->numOfBlocks++] = range;
+    }
+
     return 0;
 }
 
-int const_declaration()
+/**
+ * Emits the INC of a block of numOfVars variables, and parses the statement of
+ * the block.
+ * */
+int block_statement(CompilerContext* context, int numOfVars)
 {
+    // Make space for the activation record (FV, SL, DL, RA) and the variables.
+    // .. The temporaries the statement spills to follow the variables; they
+    // .. are added once the statement is generated.
+    int incRef = emit(context, INC, 0, 0, AR_VARIABLE_OFFSET + numOfVars);
+
+    context->spillBase = AR_VARIABLE_OFFSET + numOfVars;
+    context->spillSlots = 0;
+
+    // Parse statement.
+    int err = statement(context);
+
     /**
-     * const_declaration is the following
-	 * 1) "const"
-	 * 2) ident
-	 * 3) "="
-	 * 4) number
-	 *		repeat this 0 or more times
-	 *		a) ","
-	 *		b) ident
-	 *		c) "="
-	 *		d) number 
-	 * 5) ";"
+     * If parsing of statement was not successful, immediately stop parsing
+     * and propagate the same error code by returning it.
      * */
-	
-	// Is the current token a constsym?
-    if (getCurrentTokenType() == constsym)
-	{
-		nextToken(); // Go to the next token..
-		
-		// create symbol
-		Symbol const_symbol;
-			
-		// store symbol type and level
-		const_symbol.type = CONST;
-		const_symbol.level = currentLevel;
-		
-		// Is the current token a identsym?
-		if (getCurrentTokenType() == identsym)
-		{	
-			// store const_symbol name
-			strcpy(const_symbol.name, getCurrentToken().lexeme);
-			
-			// Consume identsym
-			//
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
-             * Error code 3: 'const', 'var', 'procedure', 'read', 'write' must be followed by identifier.
-             * Stop parsing and return error code 3.
-             * */
-            return 3;
-		}
-		
-		// Is the current token a eqsym? 
-		if (getCurrentTokenType() == eqsym)
-		{
-			// Consume eqsym
-			//
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
-             * Error code 2: Identifier must be followed by '='.
-             * Stop parsing and return error code 2.
-             * */
-            return 2;
-		}
-		
-		// Is the current token a numbersym? 
-		if (getCurrentTokenType() == numbersym)
-		{
-			// store value for const_symbol
-			const_symbol.value = atoi(getCurrentTokenFromIterator(_token_list_it).lexeme);
-			
-			// Consume numbersym
-			//
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
-             * Error code 1: '=' must be followed by a number.
-             * Stop parsing and return error code 1.
-             * */
-            return 1;
-		}
-		
-		// add const symbol to symbol table
-		addSymbol(&symbolTable, const_symbol);
-		
-		// Create new const symbol in case of more consts
-		Symbol *new_const_symbol;
-		
-		while (getCurrentTokenType() == commasym)
-		{
-			// Consume commasym
-			//
-			nextToken(); // Go to the next token..
-			
-			// allocate space for new const symbol
-			new_const_symbol = malloc(sizeof(Symbol));
-			
-			// initialize level and type
-			new_const_symbol->level = currentLevel;
-			new_const_symbol->type = CONST; 
-			
-			// Is the current token a identsym?
-			if (getCurrentTokenType() == identsym)
-			{
-				// store const_symbol name
-				strcpy(new_const_symbol->name, getCurrentTokenFromIterator(_token_list_it).lexeme);
-				
-				// Consume identsym
-				//
-				nextToken(); // Go to the next token..
-			}
-			else
-			{
-				/**
-				 * Error code 3: 'const', 'var', 'procedure', 'read', 'write' must be followed by identifier.
-				 * Stop parsing and return error code 3.
-				 * */
-				return 3;
-			}
-			
-			// Is the current token a eqsym? 
-			if (getCurrentTokenType() == eqsym)
-			{
-				// Consume eqsym
-				//
-				nextToken(); // Go to the next token..
-			}
-			else
-			{
-				/**
-				 * Error code 2: Identifier must be followed by '='.
-				 * Stop parsing and return error code 2.
-				 * */
-				return 2;
-			}
-			
-			// Is the current token a numbersym? 
-			if (getCurrentTokenType() == numbersym)
-			{
-				// store value for const_symbol
-				new_const_symbol->value = atoi(getCurrentTokenFromIterator(_token_list_it).lexeme);
-				
-				// Consume numbersym
-				nextToken(); // Go to the next token..
-			}
-			else
-			{
-				/**
-				 * Error code 1: '=' must be followed by a number.
-				 * Stop parsing and return error code 1.
-				 * */
-				return 1;
-			}
-			
-			// add const symbol to symbol table
-			addSymbol(&symbolTable, *new_const_symbol);
-		}
-		
-		/* deallocate memory
-		 * -----------------
-		 * This is an important step right?
-		 * Well, it is causing some serious segfaults.
-		 * Why? ¯\_(ツ)_/¯
-		 * So we'll just... pretend I'm doing it.
-		 */
-		//free(new_const_symbol);
-		
-		// Is the current token a semicolonsym? 
-		if (getCurrentTokenType() == semicolonsym)
-		{
-			// Consume semicolonsym
-			//
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
-             * Error code 4: Semicolon or comma missing.
-             * Stop parsing and return error code 4.
-             * */
-            return 4;
-		}
-	}
-	
-    // Successful parsing.
+    if(err) return err;
+
+    context->vmCode[incRef].m += context->spillSlots;
+
     return 0;
 }
 
-int var_declaration()
+/**
+ * Parses a single "ident = number" of const_declaration and adds the constant
+ * to the symbol table.
+ * */
+int const_definition(CompilerContext* context)
 {
-    // Is the current token a varsym?
-    if (getCurrentTokenType() == varsym)
-	{
-		// Consume varsym
-		nextToken(); // Go to the next token..
-		
-		// create symbol
-		Symbol var_symbol;
-			
-		// store symbol type and level
-		var_symbol.type = VAR;
-		var_symbol.level = currentLevel;
-		
-		// Is the current token a identsym?
-		if (getCurrentTokenType() == identsym)
-		{
-			// store var_symbol name
-			strcpy(var_symbol.name, getCurrentTokenFromIterator(_token_list_it).lexeme);
-			
-			// Consume identsym
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
-             * Error code 3: 'const', 'var', 'procedure', 'read', 'write' must be followed by identifier.
-             * Stop parsing and return error code 3.
+    Symbol symbol;
+
+    symbol.type = CONST;
+    symbol.level = context->currentLevel;
+    symbol.address = 0;
+    symbol.scope = context->currentScope;
+    symbol.inlineSize = -1;
+
+    // Is the current token a identsym?
+    if(getCurrentTokenType(context) != identsym)
+    {
+        /**
+         * Error code 3: 'const', 'var', 'procedure', 'read', 'write' must be followed by identifier.
+         * Stop parsing and return error code 3.
+         * */
+        return 3;
+    }
+
+    strcpy(symbol.name, getCurrentToken(context).lexeme);
+
+    // Consume identsym
+    nextToken(context); // Go to the next token..
+
+    // Is the current token a eqsym?
+    if(getCurrentTokenType(context) != eqsym)
+    {
+        /**
+         * Error code 2: Identifier must be followed by '='.
+         * Stop parsing and return error code 2.
+         * */
+        return 2;
+    }
+
+    // Consume eqsym
+    nextToken(context); // Go to the next token..
+
+    // Is the current token a numbersym?
+    if(getCurrentTokenType(context) != numbersym)
+    {
+        /**
+         * Error code 1: '=' must be followed by a number.
+         * Stop parsing and return error code 1.
+         * */
+        return 1;
+    }
+
+    symbol.value = atoi(getCurrentToken(context).lexeme);
+
+    // Consume numbersym
+    nextToken(context); // Go to the next token..
+
+    // add const symbol to symbol table
+    addSymbol(&context->symbolTable, symbol);
+
+    return 0;
+}
+
+int const_declaration(CompilerContext* context)
+{
+    /**
+     * const_declaration is the following
+     * 1) "const"
+     * 2) ident
+     * 3) "="
+     * 4) number
+     *		repeat this 0 or more times
+     *		a) ","
+     *		b) ident
+     *		c) "="
+     *		d) number 
+     * 5) ";"
+     * */
+
+    // Is the current token a constsym?
+    if (getCurrentTokenType(context) == constsym)
+    {
+        nextToken(context); // Go to the next token..
+
+        int err = const_definition(context);
+        if(err) return err;
+
+        while (getCurrentTokenType(context) == commasym)
+        {
+            // Consume commasym
+            nextToken(context); // Go to the next token..
+
+            err = const_definition(context);
+            if(err) return err;
+        }
+
+        // Is the current token a semicolonsym? 
+        if (getCurrentTokenType(context) == semicolonsym)
+        {
+            // Consume semicolonsym
+            nextToken(context); // Go to the next token..
+        }
+        else
+        {
+            /**
+             * Error code 4: Semicolon or comma missing.
+             * Stop parsing and return error code 4.
              * */
-            return 3;
-		}
-		
-		// allocate space for var
-		emit(INC, 0, 0, 2);
-		
-		// add var symbol to symbol table
-		addSymbol(&symbolTable, var_symbol);
-		
-		// Create new var symbol in case of more vars
-		Symbol *new_var_symbol;
-		
-		while (getCurrentTokenType() == commasym)
-		{
-			// Consume commasym
-			nextToken(); // Go to the next token..
-			
-			// allocate space for new var symbol
-			new_var_symbol = malloc(sizeof(Symbol));
-			
-			// initialize level and type
-			new_var_symbol->level = currentLevel;
-			new_var_symbol->type = VAR; 
-			
-			// Is the current token a identsym?
-			if (getCurrentTokenType() == identsym)
-			{
-				// store const_symbol name
-				strcpy(new_var_symbol->name, getCurrentTokenFromIterator(_token_list_it).lexeme);
-				
-				// Consume identsym
-				nextToken(); // Go to the next token..
-			}
-			else
-			{
-				/**
-				 * Error code 3: 'const', 'var', 'procedure', 'read', 'write' must be followed by identifier.
-				 * Stop parsing and return error code 3.
-				 * */
-				return 3;
-			}
-			
-			// allocate space for var
-			emit(INC, 0, 0, 2);
-			
-			// add var symbol to symbol table
-			addSymbol(&symbolTable, *new_var_symbol);
-		}
-		
-		/* deallocate memory
-		 * -----------------
-		 * This is an important step right?
-		 * Well, it is causing some serious segfaults.
-		 * Why? ¯\_(ツ)_/¯
-		 * So we'll just... pretend I'm doing it.
-		 */
-		//free(new_var_symbol);
-		
-		// Is the current token a semicolonsym? 
-		if (getCurrentTokenType() == semicolonsym)
-		{
-			// Consume semicolonsym
-			//
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
+            return 4;
+        }
+    }
+
+    // Successful parsing.
+    return 0;
+}
+
+/**
+ * Parses a single ident of var_declaration and adds the variable to the symbol
+ * table. The variable is given the next offset in the activation record.
+ * */
+int var_definition(CompilerContext* context, int* numOfVars)
+{
+    Symbol symbol;
+
+    symbol.type = VAR;
+    symbol.level = context->currentLevel;
+    symbol.value = 0;
+    symbol.scope = context->currentScope;
+    symbol.inlineSize = -1;
+
+    // Is the current token a identsym?
+    if(getCurrentTokenType(context) != identsym)
+    {
+        /**
+         * Error code 3: 'const', 'var', 'procedure', 'read', 'write' must be followed by identifier.
+         * Stop parsing and return error code 3.
+         * */
+        return 3;
+    }
+
+    strcpy(symbol.name, getCurrentToken(context).lexeme);
+    symbol.address = AR_VARIABLE_OFFSET + (*numOfVars)++;
+
+    // Consume identsym
+    nextToken(context); // Go to the next token..
+
+    // add var symbol to symbol table
+    addSymbol(&context->symbolTable, symbol);
+
+    return 0;
+}
+
+int var_declaration(CompilerContext* context, int* numOfVars)
+{
+    // Is the current token a varsym?
+    if (getCurrentTokenType(context) == varsym)
+    {
+        // Consume varsym
+        nextToken(context); // Go to the next token..
+
+        int err = var_definition(context, numOfVars);
+        if(err) return err;
+
+        while (getCurrentTokenType(context) == commasym)
+        {
+            // Consume commasym
+            nextToken(context); // Go to the next token..
+
+            err = var_definition(context, numOfVars);
+            if(err) return err;
+        }
+
+        // Is the current token a semicolonsym? 
+        if (getCurrentTokenType(context) == semicolonsym)
+        {
+            // Consume semicolonsym
+            nextToken(context); // Go to the next token..
+        }
+        else
+        {
+            /**
              * Error code 4: Semicolon or comma missing.
              * Stop parsing and return error code 4.
              * */
             return 4;
-		}
-	}
+        }
+    }
 
     return 0;
 }
 
-int proc_declaration()
+int proc_declaration(CompilerContext* context)
 {
-    while (getCurrentTokenType() == procsym)
-	{
-		int jumpRef;
-		
-		// Consume procsym
-		nextToken(); // Go to the next token..
-			
-		// create symbol
-		Symbol proc_symbol;
-		
-		// set currentScope to new procedure
-		currentScope = &proc_symbol;
-		
-		// store symbol type and level
-		proc_symbol.type = PROC;
-		proc_symbol.level = currentLevel;	
-			
-		// Is the current token a identsym?
-		if (getCurrentTokenType() == identsym)
-		{
-			// store const_symbol name
-			strcpy(proc_symbol.name, getCurrentTokenFromIterator(_token_list_it).lexeme);
-			
-			// Consume identsym
-			//
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
-			 * Error code 3: 'const', 'var', 'procedure', 'read', 'write' must be followed by identifier.
-			 * Stop parsing and return error code 3.
-			 * */
-			return 3;
-		}
-		
-		// add proc symbol to symbol table
-		addSymbol(&symbolTable, proc_symbol);
-		
-		// Is the current token a semicolonsym? 
-		if (getCurrentTokenType() == semicolonsym)
-		{
-			// Consume semicolonsym
-			//
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
+    while (getCurrentTokenType(context) == procsym)
+    {
+        // Consume procsym
+        nextToken(context); // Go to the next token..
+
+        // create symbol
+        Symbol proc_symbol;
+
+        // store symbol type, level and scope. The procedure enters at the next code.
+        proc_symbol.type = PROC;
+        proc_symbol.level = context->currentLevel;
+        proc_symbol.value = 0;
+        proc_symbol.address = context->nextCodeIndex;
+        proc_symbol.scope = context->currentScope;
+        proc_symbol.inlineSize = -1;
+
+        // Is the current token a identsym?
+        if (getCurrentTokenType(context) == identsym)
+        {
+            strcpy(proc_symbol.name, getCurrentToken(context).lexeme);
+
+            // Consume identsym
+            nextToken(context); // Go to the next token..
+        }
+        else
+        {
+            /**
+             * Error code 3: 'const', 'var', 'procedure', 'read', 'write' must be followed by identifier.
+             * Stop parsing and return error code 3.
+             * */
+            return 3;
+        }
+
+        // add proc symbol to symbol table. The table keeps the symbol at the
+        // .. same address, so it is used as the scope of the procedure body.
+        Symbol* procedure = addSymbol(&context->symbolTable, proc_symbol);
+
+        // Is the current token a semicolonsym? 
+        if (getCurrentTokenType(context) == semicolonsym)
+        {
+            // Consume semicolonsym
+            nextToken(context); // Go to the next token..
+        }
+        else
+        {
+            /**
              * Error code 5: Semicolon missing.
              * Stop parsing and return error code 5.
              * */
             return 5;
-		}
-		
-		// increment level before block
-		currentLevel++;
-		
-		// store reference to jmp emit so we can go back after block and update
-		jumpRef= nextCodeIndex;
-		emit(JMP, 0, 0, 0);
-		
-		// make space for SL, DL, etc.
-		emit(INC, 0, 0, 4);
-		
-		// Parse block.
-		int err = block();
-
-		/**
-		* If parsing of block was not successful, immediately stop parsing
-		* and propagate the same error code by returning it.
-		* */
-		if(err) return err;
-		
-		// decrement level after block
-		currentLevel--;
-		
-		// fix jump emit from before to skip over block
-		vmCode[jumpRef].m = nextCodeIndex;
-		
-		// Is the current token a semicolonsym? 
-		if (getCurrentTokenType() == semicolonsym)
-		{
-			// Consume semicolonsym
-			//
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
+        }
+
+        // enter the procedure: one level deeper, in its own scope
+        Symbol* outerScope = context->currentScope;
+
+        context->currentLevel++;
+        context->currentScope = procedure;
+
+        // Parse block.
+        int err = block(context);
+
+        /**
+        * If parsing of block was not successful, immediately stop parsing
+        * and propagate the same error code by returning it.
+        * */
+        if(err) return err;
+
+        // return to the caller
+        emit(context, RTN, 0, 0, 0);
+
+        procedure->inlineSize = inlineSize(context, procedure);
+
+        // leave the procedure
+        context->currentLevel--;
+        context->currentScope = outerScope;
+
+        // Is the current token a semicolonsym? 
+        if (getCurrentTokenType(context) == semicolonsym)
+        {
+            // Consume semicolonsym
+            nextToken(context); // Go to the next token..
+        }
+        else
+        {
+            /**
              * Error code 5: Semicolon missing.
              * Stop parsing and return error code 5.
              * */
             return 5;
-		}
-	}
+        }
+    }
 
     return 0;
 }
 
-int statement()
+int statement(CompilerContext* context)
 {
-	int jpcRef;
-	
-    if (getCurrentTokenType() == identsym)
-	{
-		// type != var
-		if (findSymbol( &symbolTable, currentScope, getCurrentToken().lexeme )->type != VAR)
-		{
-			/**
+    if (getCurrentTokenType(context) == identsym)
+    {
+        // resolve the identifier once
+        Symbol* symbol = lookupSymbol( context, getCurrentToken(context).lexeme );
+
+        if (!symbol)
+        {
+            /**
+             * Error code 15: Identifier is undeclared or out of scope.
+             * Stop parsing and return error code 15.
+             * */
+            return 15;
+        }
+
+        if (symbol->type != VAR)
+        {
+            /**
              * Error code 16: Assignment to constant or procedure is not allowed.
              * Stop parsing and return error code 16.
              * */
             return 16;
-		}
-		
-		// Consume identsym
-		nextToken(); // Go to the next token..
-		
-		// Is the current token a becomessym?
-		if (getCurrentTokenType() == becomessym)
-		{
-			// Consume becomessym
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
+        }
+
+        // Consume identsym
+        nextToken(context); // Go to the next token..
+
+        // Is the current token a becomessym?
+        if (getCurrentTokenType(context) == becomessym)
+        {
+            // Consume becomessym
+            nextToken(context); // Go to the next token..
+        }
+        else
+        {
+            /**
              * Error code 7: Assignment operator expected.
              * Stop parsing and return error code 7.
              * */
             return 7;
-		}
-		
-		// Parse expression.
-		int err = expression();
-
-		/**
-		* If parsing of expression was not successful, immediately stop parsing
-		* and propagate the same error code by returning it.
-		* */
-		if(err) return err;
-		
-		// store result of expression
-		emit(STO, currentReg, findLevel(findSymbol( &symbolTable, currentScope, getCurrentToken().lexeme )->level),
-		findSymbol( &symbolTable, currentScope, getCurrentToken().lexeme )->address);
-		currentReg--;
-	}
-	else if (getCurrentTokenType() == callsym)
-	{
-		// Consume callsym
-		nextToken(); // Go to the next token..
-		
-		// Is the current token a identsym?
-		if (getCurrentTokenType() == identsym)
-		{
-			if (findSymbol( &symbolTable, currentScope, getCurrentToken().lexeme )->type == PROC)
-			{
-				// emit call
-				emit(CAL, 0, findSymbol( &symbolTable, currentScope, getCurrentToken().lexeme )->address, 4);
-			}
-			else
-			{
-				/**
-				 * Error code 17: Call of a constant or variable is not allowed.
-				 * Stop parsing and return error code 17.
-				 * */
-				return 7;
-			}
-			// Consume identsym
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
-			 * Error code 8: 'call' must be followed by an identifier.
-			 * Stop parsing and return error code 8.
-			 * */
-			return 8;
-		}
-	}
-	else if (getCurrentTokenType() == beginsym)
-	{
-		// Consume beginsym
-		nextToken(); // Go to the next token..
-		
-		// Parse statement.
-		int err = statement();
-
-		/**
-		* If parsing of statement was not successful, immediately stop parsing
-		* and propagate the same error code by returning it.
-		* */
-		if(err) return err;
-		
-		while (getCurrentTokenType() == semicolonsym)
-		{
-			// Consume semicolonsym
-			nextToken(); // Go to the next token..
-			
-			// Parse statement.
-			err = statement();
-
-			/**
-			* If parsing of statement was not successful, immediately stop parsing
-			* and propagate the same error code by returning it.
-			* */
-			if(err) return err;
-		}
-		
-		// Is the current token a endsym?
-		if (getCurrentTokenType() == endsym)
-		{
-			// Consume endsym
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
-			 * Error code 10: Semicolon or 'end' expected.
-			 * Stop parsing and return error code 10.
-			 * */
-			return 10;
-		}
-	}
-	else if (getCurrentTokenType() == ifsym)
-	{
-		// Consume ifsym
-		nextToken(); // Go to the next token..
-		
-		// Parse condition.
-		int err = condition();
-
-		/**
-		* If parsing of condition was not successful, immediately stop parsing
-		* and propagate the same error code by returning it.
-		* */
-		if(err) return err;
-		
-		// Is the current token a thensym?
-		if (getCurrentTokenType() == thensym)
-		{
-			// Consume thensym
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
-			 * Error code 9: 'then' expected.
-			 * Stop parsing and return error code 9.
-			 * */
-			return 9;
-		}
-		
-		// JPC
-		jpcRef= nextCodeIndex;
-		emit(JPC, currentReg, 0, 0); 
-		
-		// Parse statement.
-		err = statement();
-
-		/**
-		* If parsing of statement was not successful, immediately stop parsing
-		* and propagate the same error code by returning it.
-		* */
-		if(err) return err;
-		
-		if (getCurrentTokenType() == elsesym)
-		{
-			// Consume elsesym
-			nextToken(); // Go to the next token..
-			
-			// Parse statement.
-			err = statement();
-
-			/**
-			* If parsing of statement was not successful, immediately stop parsing
-			* and propagate the same error code by returning it.
-			* */
-			if(err) return err;
-		}
-		// update JPC
-		vmCode[jpcRef].m = nextCodeIndex;
-	}
-	else if (getCurrentTokenType() == whilesym)
-	{
-		// Consume whilesym
-		nextToken(); // Go to the next token..
-		
-		// Parse condition.
-		int err = condition();
-
-		/**
-		* If parsing of condition was not successful, immediately stop parsing
-		* and propagate the same error code by returning it.
-		* */
-		if(err) return err;
-		
-		// JPC
-		jpcRef = nextCodeIndex;
-		emit(JPC, currentReg, 0, 0); 
-		
-		// Is the current token a dosym?
-		if (getCurrentTokenType() == dosym)
-		{
-			// Consume dosym
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
-			 * Error code 11: 'do' expected.
-			 * Stop parsing and return error code 11.
-			 * */
-			return 11;
-		}
-		
-		// Parse statement.
-		err = statement();
-
-		/**
-		* If parsing of condition was not successful, immediately stop parsing
-		* and propagate the same error code by returning it.
-		* */
-		if(err) return err;
-		
-		// update JPC
-		vmCode[jpcRef].m = nextCodeIndex;
-	}
-	else if (getCurrentTokenType() == readsym)
-	{
-		// Consume readsym
-		nextToken(); // Go to the next token..
-		
-		// SIO_READ
-		emit(SIO_READ, currentReg, 0, 2);
-		
-		// Is the current token a identsym?
-		if (getCurrentTokenType() == identsym)
-		{
-			// emit STO
-			emit(STO, currentReg, findLevel(findSymbol( &symbolTable, currentScope, getCurrentToken().lexeme )->level),
-			findSymbol( &symbolTable, currentScope, getCurrentToken().lexeme )->address);
-			currentReg--;
-			
-			// Consume identsym
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
-			 * Error code 3: 'const', 'var', 'procedure', 'read', 'write' must be followed by identifier.
-			 * Stop parsing and return error code 3.
-			 * */
-			return 3;
-		}
-	}
-	else if (getCurrentTokenType() == writesym)
-	{
-		// Consume writesym
-		nextToken(); // Go to the next token..
-		
-		// Is the current token a identsym?
-		if (getCurrentTokenType() == identsym)
-		{
-			// SIO_WRITE
-			emit(SIO_WRITE, currentReg, 0, 1);
-			
-			// Consume identsym
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			/**
-			 * Error code 3: 'const', 'var', 'procedure', 'read', 'write' must be followed by identifier.
-			 * Stop parsing and return error code 3.
-			 * */
-			return 3;
-		}
-	}
+        }
+
+        // Parse expression.
+        ExprNode* tree;
+        int err = expression(context, &tree);
+
+        /**
+        * If parsing of expression was not successful, immediately stop parsing
+        * and propagate the same error code by returning it.
+        * */
+        if(err) return err;
+
+        // evaluate the expression into the first register, and store it
+        generateExpression(context, tree, 0);
+        emit(context, STO, 0, findLevel(context, symbol), symbol->address);
+    }
+    else if (getCurrentTokenType(context) == callsym)
+    {
+        // Consume callsym
+        nextToken(context); // Go to the next token..
+
+        // Is the current token a identsym?
+        if (getCurrentTokenType(context) == identsym)
+        {
+            Symbol* symbol = lookupSymbol( context, getCurrentToken(context).lexeme );
+
+            if (!symbol)
+            {
+                /**
+                 * Error code 15: Identifier is undeclared or out of scope.
+                 * Stop parsing and return error code 15.
+                 * */
+                return 15;
+            }
+
+            if (symbol->type != PROC)
+            {
+                /**
+                 * Error code 17: Call of a constant or variable is not allowed.
+                 * Stop parsing and return error code 17.
+                 * */
+                return 17;
+            }
+
+            // emit call, the static link is the frame the procedure is declared in
+            if(symbol->inlineSize >= 0) emitInlined(context, symbol);
+            else emit(context, CAL, 0, findLevel(context, symbol), symbol->address);
+
+            // Consume identsym
+            nextToken(context); // Go to the next token..
+        }
+        else
+        {
+            /**
+             * Error code 8: 'call' must be followed by an identifier.
+             * Stop parsing and return error code 8.
+             * */
+            return 8;
+        }
+    }
+    else if (getCurrentTokenType(context) == beginsym)
+    {
+        // Consume beginsym
+        nextToken(context); // Go to the next token..
+
+        // Parse statement.
+        int err = statement(context);
+
+        /**
+        * If parsing of statement was not successful, immediately stop parsing
+        * and propagate the same error code by returning it.
+        * */
+        if(err) return err;
+
+        while (getCurrentTokenType(context) == semicolonsym)
+        {
+            // Consume semicolonsym
+            nextToken(context); // Go to the next token..
+
+            // Parse statement.
+            err = statement(context);
+
+            /**
+            * If parsing of statement was not successful, immediately stop parsing
+            * and propagate the same error code by returning it.
+            * */
+            if(err) return err;
+        }
+
+        // Is the current token a endsym?
+        if (getCurrentTokenType(context) == endsym)
+        {
+            // Consume endsym
+            nextToken(context); // Go to the next token..
+        }
+        else
+        {
+            /**
+             * Error code 10: Semicolon or 'end' expected.
+             * Stop parsing and return error code 10.
+             * */
+            return 10;
+        }
+    }
+    else if (getCurrentTokenType(context) == ifsym)
+    {
+        // Consume ifsym
+        nextToken(context); // Go to the next token..
+
+        // Parse condition.
+        ExprNode* tree;
+        int err = condition(context, &tree);
+
+        /**
+        * If parsing of condition was not successful, immediately stop parsing
+        * and propagate the same error code by returning it.
+        * */
+        if(err) return err;
+
+        // Is the current token a thensym?
+        if (getCurrentTokenType(context) == thensym)
+        {
+            // Consume thensym
+            nextToken(context); // Go to the next token..
+        }
+        else
+        {
+            /**
+             * Error code 9: 'then' expected.
+             * Stop parsing and return error code 9.
+             * */
+            return 9;
+        }
+
+        // JPC on the result of the condition, to be set once the target is known
+        int jpcRef = emitJumpIfFalse(context, tree);
+
+        // Parse statement.
+        err = statement(context);
+
+        /**
+        * If parsing of statement was not successful, immediately stop parsing
+        * and propagate the same error code by returning it.
+        * */
+        if(err) return err;
+
+        if (getCurrentTokenType(context) == elsesym)
+        {
+            // Consume elsesym
+            nextToken(context); // Go to the next token..
+
+            // then-statement jumps over the else-statement
+            int jmpRef = emit(context, JMP, 0, 0, 0);
+            if (jpcRef >= 0) context->vmCode[jpcRef].m = context->nextCodeIndex;
+
+            // Parse statement.
+            err = statement(context);
+
+            /**
+            * If parsing of statement was not successful, immediately stop parsing
+            * and propagate the same error code by returning it.
+            * */
+            if(err) return err;
+
+            context->vmCode[jmpRef].m = context->nextCodeIndex;
+        }
+        else if (jpcRef >= 0)
+        {
+            // update JPC
+            context->vmCode[jpcRef].m = context->nextCodeIndex;
+        }
+    }
+    else if (getCurrentTokenType(context) == whilesym)
+    {
+        // Consume whilesym
+        nextToken(context); // Go to the next token..
+
+        // the condition is evaluated again after each iteration
+        int loopRef = context->nextCodeIndex;
+
+        // Parse condition.
+        ExprNode* tree;
+        int err = condition(context, &tree);
+
+        /**
+        * If parsing of condition was not successful, immediately stop parsing
+        * and propagate the same error code by returning it.
+        * */
+        if(err) return err;
+
+        // JPC on the result of the condition, to be set once the target is known
+        int jpcRef = emitJumpIfFalse(context, tree);
+
+        // Is the current token a dosym?
+        if (getCurrentTokenType(context) == dosym)
+        {
+            // Consume dosym
+            nextToken(context); // Go to the next token..
+        }
+        else
+        {
+            /**
+             * Error code 11: 'do' expected.
+             * Stop parsing and return error code 11.
+             * */
+            return 11;
+        }
+
+        // Parse statement.
+        err = statement(context);
+
+        /**
+        * If parsing of condition was not successful, immediately stop parsing
+        * and propagate the same error code by returning it.
+        * */
+        if(err) return err;
+
+        // back to the condition
+        emit(context, JMP, 0, 0, loopRef);
+
+        // update JPC
+        if (jpcRef >= 0) context->vmCode[jpcRef].m = context->nextCodeIndex;
+    }
+    else if (getCurrentTokenType(context) == readsym)
+    {
+        // Consume readsym
+        nextToken(context); // Go to the next token..
+
+        // Is the current token a identsym?
+        if (getCurrentTokenType(context) == identsym)
+        {
+            Symbol* symbol = lookupSymbol( context, getCurrentToken(context).lexeme );
+
+            if (!symbol)
+            {
+                /**
+                 * Error code 15: Identifier is undeclared or out of scope.
+                 * Stop parsing and return error code 15.
+                 * */
+                return 15;
+            }
+
+            if (symbol->type != VAR)
+            {
+                /**
+                 * Error code 19: Read to a constant or prodecure is not allowed.
+                 * Stop parsing and return error code 19.
+                 * */
+                return 19;
+            }
+
+            // SIO_READ into a free register, then STO
+            emit(context, SIO_READ, 0, 0, 2);
+            emit(context, STO, 0, findLevel(context, symbol), symbol->address);
+
+            // Consume identsym
+            nextToken(context); // Go to the next token..
+        }
+        else
+        {
+            /**
+             * Error code 3: 'const', 'var', 'procedure', 'read', 'write' must be followed by identifier.
+             * Stop parsing and return error code 3.
+             * */
+            return 3;
+        }
+    }
+    else if (getCurrentTokenType(context) == writesym)
+    {
+        // Consume writesym
+        nextToken(context); // Go to the next token..
+
+        // Is the current token a identsym?
+        if (getCurrentTokenType(context) == identsym)
+        {
+            Symbol* symbol = lookupSymbol( context, getCurrentToken(context).lexeme );
+
+            if (!symbol)
+            {
+                /**
+                 * Error code 15: Identifier is undeclared or out of scope.
+                 * Stop parsing and return error code 15.
+                 * */
+                return 15;
+            }
+
+            if (symbol->type == PROC)
+            {
+                /**
+                 * Error code 18: Write of a prodecure is not allowed.
+                 * Stop parsing and return error code 18.
+                 * */
+                return 18;
+            }
+
+            // load the value into a free register
+            if (symbol->type == VAR)
+                emit(context, LOD, 0, findLevel(context, symbol), symbol->address);
+            else
+                emit(context, LIT, 0, 0, symbol->value);
+
+            // SIO_WRITE
+            emit(context, SIO_WRITE, 0, 0, 1);
+
+            // Consume identsym
+            nextToken(context); // Go to the next token..
+        }
+        else
+        {
+            /**
+             * Error code 3: 'const', 'var', 'procedure', 'read', 'write' must be followed by identifier.
+             * Stop parsing and return error code 3.
+             * */
+            return 3;
+        }
+    }
 
     return 0;
 }
 
-int condition()
+int condition(CompilerContext* context, ExprNode** tree)
 {
     // Is the current token a oddsym?
-	if (getCurrentTokenType() == oddsym)
-	{
-		// Consume oddsym
-		nextToken(); // Go to the next token..
-	
-		// Parse expression.
-		int err = expression();
-
-		/**
-		* If parsing of expression was not successful, immediately stop parsing
-		* and propagate the same error code by returning it.
-		* */
-		if(err) return err;
-
-		// ODD
-		emit(ODD, currentReg-1, currentReg-1, currentReg);
-		currentReg--;
-	}
-	else
-	{
-		// Parse expression.
-		int err = expression();
-
-		/**
-		* If parsing of expression was not successful, immediately stop parsing
-		* and propagate the same error code by returning it.
-		* */
-		if(err) return err;
-		
-		if (getCurrentTokenType() == eqsym)
-		{
-			// emit EQL
-			emit(EQL, currentReg-1, currentReg-1, currentReg);
-			currentReg--;
-			
-			nextToken(); // Go to the next token..	
-		}
-		else if (getCurrentTokenType() == neqsym)
-		{
-			// emit NEQ
-			emit(NEQ, currentReg-1, currentReg-1, currentReg);
-			currentReg--;
-			
-			nextToken(); // Go to the next token..
-		}
-		else if (getCurrentTokenType() == lessym)
-		{
-			// emit LSS
-			emit(LSS, currentReg-1, currentReg-1, currentReg);
-			currentReg--;
-			
-			nextToken(); // Go to the next token..
-		}
-		else if (getCurrentTokenType() == leqsym)
-		{
-			// emit LEQ
-			emit(LEQ, currentReg-1, currentReg-1, currentReg);
-			currentReg--;
-			
-			nextToken(); // Go to the next token..
-		}
-		else if (getCurrentTokenType() == gtrsym)
-		{
-			// emit GTR
-			emit(GTR, currentReg-1, currentReg-1, currentReg);
-			currentReg--;
-			
-			nextToken(); // Go to the next token..
-		}
-		else if (getCurrentTokenType() == geqsym)
-		{
-			// emit GEQ
-			emit(GEQ, currentReg-1, currentReg-1, currentReg);
-			currentReg--;
-			
-			nextToken(); // Go to the next token..
-		}
-		else
-		{
-			// Relational operator expected
-			return (12);
-		}
-		
-		// Parse expression.
-		err = expression();
-
-		/**
-		* If parsing of expression was not successful, immediately stop parsing
-		* and propagate the same error code by returning it.
-		* */
-		if(err) return err;
-	}
+    if (getCurrentTokenType(context) == oddsym)
+    {
+        // Consume oddsym
+        nextToken(context); // Go to the next token..
+
+        // Parse expression.
+        ExprNode* operand;
+        int err = expression(context, &operand);
+
+        /**
+        * If parsing of expression was not successful, immediately stop parsing
+        * and propagate the same error code by returning it.
+        * */
+        if(err) return err;
+
+        // ODD of the expression
+        *tree = newUnary(context, ODD, operand);
+    }
+    else
+    {
+        // Parse expression.
+        ExprNode* left;
+        int err = expression(context, &left);
+
+        /**
+        * If parsing of expression was not successful, immediately stop parsing
+        * and propagate the same error code by returning it.
+        * */
+        if(err) return err;
+
+        // The opcode of the relational operator
+        int op;
+
+        switch (getCurrentTokenType(context))
+        {
+            case eqsym:  op = EQL; break;
+            case neqsym: op = NEQ; break;
+            case lessym: op = LSS; break;
+            case leqsym: op = LEQ; break;
+            case gtrsym: op = GTR; break;
+            case geqsym: op = GEQ; break;
+            default:
+                /**
+                 * Error code 12: Relational operator expected.
+                 * Stop parsing and return error code 12.
+                 * */
+                return 12;
+        }
+
+        // Consume the relational operator
+        nextToken(context); // Go to the next token..
+
+        // Parse expression.
+        ExprNode* right;
+        err = expression(context, &right);
+
+        /**
+        * If parsing of expression was not successful, immediately stop parsing
+        * and propagate the same error code by returning it.
+        * */
+        if(err) return err;
+
+        // compare the two expressions
+        *tree = newBinary(context, op, left, right);
+    }
     return 0;
 }
 
-int expression()
+int expression(CompilerContext* context, ExprNode** tree)
 {
-	// plus or minus
-	int plus = 0;
-	int minus = 0;
-	
-	if (getCurrentTokenType() == plussym || getCurrentTokenType() == minussym)
-	{
-		if (getCurrentTokenType() == plussym)
-		{
-			// Consume plussym
-			nextToken();
-		}
-		else if (getCurrentTokenType() == minussym)
-		{
-			// Consume minussym
-			nextToken();
-		
-			// set minus to true 
-			minus = 1;
-		}
-		
-		// Parse term.
-		int err = term();
-		
-		
-		/**
-		* If parsing of term was not successful, immediately stop parsing
-		* and propagate the same error code by returning it.
-		* */
-		if(err) return err;
-		
-		if (minus)
-		{
-			// emit NEG
-			emit(NEG, currentReg - 1, currentReg - 1, currentReg);
-			currentReg--;
-			
-			// reset minus indicator
-			minus = 0;
-		}
-	} 
-	else
-	{
-		// Parse term.
-		int err = term();
-		
-		/**
-		* If parsing of term was not successful, immediately stop parsing
-		* and propagate the same error code by returning it.
-		* */
-		if(err) return err;
-	}
-	
-	while (getCurrentTokenType() == plussym || getCurrentTokenType() == minussym)
-	{
-		if (getCurrentTokenType() == plussym)
-		{
-			// set plus to true 
-			plus = 1;
-		}
-		else if (getCurrentTokenType() == minussym)
-		{
-			// set minus to true 
-			minus = 1;
-		}
-		
-		// Consume plussym or minussym
-		nextToken();
-		
-		// Parse term.
-		int err = term();
-		
-		/**
-		* If parsing of term was not successful, immediately stop parsing
-		* and propagate the same error code by returning it.
-		* */
-		if(err) return err;
-	
-		if (minus)
-		{
-			// reset minus
-			minus = 0;
-		
-			// SUB
-			emit(SUB, currentReg - 1, currentReg - 1, currentReg);
-			currentReg--;
-		}
-		else if (plus)
-		{
-			// reset plus
-			plus = 0;
-			
-			// ADD
-			emit(ADD, currentReg - 1, currentReg - 1, currentReg);
-			currentReg--;
-		}
-	}
+    // Is there a sign in front of the first term?
+    int minus = 0;
+
+    if (getCurrentTokenType(context) == plussym || getCurrentTokenType(context) == minussym)
+    {
+        minus = (getCurrentTokenType(context) == minussym);
+
+        // Consume plussym or minussym
+        nextToken(context);
+    } 
+
+    // Parse term.
+    int err = term(context, tree);
+
+    /**
+    * If parsing of term was not successful, immediately stop parsing
+    * and propagate the same error code by returning it.
+    * */
+    if(err) return err;
+
+    if (minus)
+    {
+        // NEG of the first term
+        *tree = newUnary(context, NEG, *tree);
+    }
+
+    while (getCurrentTokenType(context) == plussym || getCurrentTokenType(context) == minussym)
+    {
+        int op = (getCurrentTokenType(context) == plussym) ? ADD : SUB;
+
+        // Consume plussym or minussym
+        nextToken(context);
+
+        // Parse term.
+        ExprNode* right;
+        err = term(context, &right);
+
+        /**
+        * If parsing of term was not successful, immediately stop parsing
+        * and propagate the same error code by returning it.
+        * */
+        if(err) return err;
+
+        // ADD or SUB the terms so far and the new one
+        *tree = newBinary(context, op, *tree, right);
+    }
     return 0;
 }
 
-int term()
+int term(CompilerContext* context, ExprNode** tree)
 {
-	int divide = 0, multiply = 0;
-	
     // Parse factor.
-	int err = factor();
-
-	/**
-	* If parsing of factor was not successful, immediately stop parsing
-	* and propagate the same error code by returning it.
-	* */
-	if(err) return err;
-	
-	while (getCurrentTokenType() == multsym || getCurrentTokenType() == slashsym)
-	{
-		if (getCurrentTokenType() == multsym)
-		{
-			// set plus to true 
-			multiply = 1;
-		}
-		else if (getCurrentTokenType() == slashsym)
-		{
-			// set minus to true 
-			divide = 1;
-		}
-		
-		// Consume multsym or slashsym
-		nextToken();
-		
-		// Parse factor.
-		err = factor();
-
-		/**
-		* If parsing of factor was not successful, immediately stop parsing
-		* and propagate the same error code by returning it.
-		* */
-		if(err) return err;
-		
-		if (multiply)
-		{
-			// reset multiply
-			multiply = 0;
-		
-			// multiply
-			emit(MUL, currentReg - 1, currentReg - 1, currentReg);
-			currentReg--;
-		}
-		else if (divide)
-		{
-			// reset plus
-			divide = 0;
-			
-			// divide
-			emit(DIV, currentReg - 1, currentReg - 1, currentReg);
-			currentReg--;
-		}
-	}
-	
+    int err = factor(context, tree);
+
+    /**
+    * If parsing of factor was not successful, immediately stop parsing
+    * and propagate the same error code by returning it.
+    * */
+    if(err) return err;
+
+    while (getCurrentTokenType(context) == multsym || getCurrentTokenType(context) == slashsym)
+    {
+        int op = (getCurrentTokenType(context) == multsym) ? MUL : DIV;
+
+        // Consume multsym or slashsym
+        nextToken(context);
+
+        // Parse factor.
+        ExprNode* right;
+        err = factor(context, &right);
+
+        /**
+        * If parsing of factor was not successful, immediately stop parsing
+        * and propagate the same error code by returning it.
+        * */
+        if(err) return err;
+
+        // MUL or DIV the factors so far and the new one
+        *tree = newBinary(context, op, *tree, right);
+    }
+
     return 0;
 }
 
-int factor()
+int factor(CompilerContext* context, ExprNode** tree)
 {
     /**
      * There are three possibilities for factor:
@@ -1255,50 +1654,74 @@ int factor()
      * */
 
     // Is the current token a identsym?
-    if(getCurrentTokenType() == identsym)
+    if(getCurrentTokenType(context) == identsym)
     {
-		// load ident and increment current reg
-		emit(LOD, currentReg, findLevel(findSymbol( &symbolTable, currentScope, getCurrentToken().lexeme )->level),
-		findSymbol( &symbolTable, currentScope, getCurrentToken().lexeme )->address);
-		currentReg++;
-		
-		// Consume identsym
-        nextToken(); // Go to the next token..
-		
+        // resolve the identifier once
+        Symbol* symbol = lookupSymbol( context, getCurrentToken(context).lexeme );
+
+        if (!symbol)
+        {
+            /**
+             * Error code 15: Identifier is undeclared or out of scope.
+             * Stop parsing and return error code 15.
+             * */
+            return 15;
+        }
+
+        // a variable is loaded, the value of a constant is known
+        if (symbol->type == VAR)
+        {
+            *tree = newLeaf(context, LOD, 0, findLevel(context, symbol), symbol->address);
+        }
+        else if (symbol->type == CONST)
+        {
+            *tree = newLeaf(context, LIT, symbol->value, 0, 0);
+        }
+        else
+        {
+            /**
+             * Error code 14: The preceding factor cannot begin with this symbol.
+             * A procedure has no value. Stop parsing and return error code 14.
+             * */
+            return 14;
+        }
+
+        // Consume identsym
+        nextToken(context); // Go to the next token..
+
         // Success
         return 0;
     }
     // Is that a numbersym?
-    else if(getCurrentTokenType() == numbersym)
+    else if(getCurrentTokenType(context) == numbersym)
     {
-		// load literal and increment current reg 
-		emit(LIT, currentReg, 0, atoi( getCurrentToken().lexeme ) );
-		currentReg++;
-		
-		// Consume numbersym
-        nextToken(); // Go to the next token..
-		
+        // literal
+        *tree = newLeaf(context, LIT, atoi( getCurrentToken(context).lexeme ), 0, 0);
+
+        // Consume numbersym
+        nextToken(context); // Go to the next token..
+
         // Success
         return 0;
     }
     // Is that a lparentsym?
-    else if(getCurrentTokenType() == lparentsym)
+    else if(getCurrentTokenType(context) == lparentsym)
     {
         // Consume lparentsym
-        nextToken(); // Go to the next token..
+        nextToken(context); // Go to the next token..
 
         // Continue by parsing expression.
-        int err = expression();
+        int err = expression(context, tree);
 
         /**
          * If parsing of expression was not successful, immediately stop parsing
          * and propagate the same error code by returning it.
          * */
-        
+
         if(err) return err;
 
         // After expression, right-parenthesis should come
-        if(getCurrentTokenType() != rparentsym)
+        if(getCurrentTokenType(context) != rparentsym)
         {
             /**
              * Error code 13: Right parenthesis missing.
@@ -1309,16 +1732,16 @@ int factor()
 
         // It was a rparentsym. Consume rparentsym.
         //
-        nextToken(); // Go to the next token..
+        nextToken(context); // Go to the next token..
     }
     else
     {
         /**
-          * Error code 24: The preceding factor cannot begin with this symbol.
-          * Stop parsing and return error code 24.
+          * Error code 14: The preceding factor cannot begin with this symbol.
+          * Stop parsing and return error code 14.
           * */
         return 14;
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -2,9 +2,252 @@
 #define __CODE_GENERATOR_H__
 
 #include "token.h"
+#include "data.h"
+#include "symbol.h"
+#include "peephole.h"
+#include "optimizer.h"
+
+/**
+ * Formats of the emitted code.
+ *  CG_FORMAT_TEXT  : one "op r l m" line per instruction.
+ *  CG_FORMAT_BINARY: a PM/0 object file, an ObjectHeader followed by the
+ *                    instructions (see data.h). The file should be opened
+ *                    in binary mode.
+ * On error, the error message is printed as text in both formats.
+ * */
+typedef enum {
+    CG_FORMAT_TEXT,
+    CG_FORMAT_BINARY
+} CodeGeneratorFormat;
+
+/**
+ * The inline threshold of the --inline option.
+ * */
+#define CG_DEFAULT_INLINE_THRESHOLD 16
+
+/**
+ * Options that change what codeGeneratorWithOptions() emits.
+ * A call to a procedure with no variables, no nested procedures and no calls,
+ * whose body is at most inlineThreshold instructions, is replaced by a copy of
+ * the body, which saves the CAL, INC and RTN, and the frame they set up.
+ * */
+typedef struct {
+    CodeGeneratorFormat format;
+    int peephole; // run peepholeOptimize() over the emitted code
+    int fold;     // fold the operations on values known at compile time
+    int optimize; // run optimizeCode() over the emitted code, before the peephole optimizer
+    int inlineThreshold; // inline the leaf procedures of at most that many instructions, 0 for none
+    OptimizerOptions optimizer;
+} CodeGeneratorOptions;
+
+/**
+ * Returns the options codeGenerator() runs with.
+ * */
+CodeGeneratorOptions getDefaultCodeGeneratorOptions();
+
+/**
+ * Where the statement of a block is, among the tokens and in the code, as a
+ * code generation records it for the statement to be generated again alone
+ * (see regenerateBlock()).
+ * procedure   : the procedure of the block, NULL for the main program
+ * level       : the level of the block
+ * numOfVars   : the number of variables the block declares
+ * numOfSymbols: the number of symbols declared before the statement, the only
+ *               ones the statement could refer to
+ * firstToken  : the index of the first token of the statement, and endToken
+ *               the index of the token following it, ";" or "."
+ * incAddress  : the address of the INC of the block, which the code of the
+ *               statement follows, and endAddress the address following its
+ *               RTN, or SIO halt for the main program
+ * */
+typedef struct {
+    Symbol* procedure;
+    unsigned int level;
+    int numOfVars;
+    int numOfSymbols;
+    int firstToken;
+    int endToken;
+    int incAddress;
+    int endAddress;
+} BlockRange;
+
+/**
+ * State of a code generation. The functions below that do not take one share
+ * a single context, so only one of them could run at a time. Each thread could
+ * run codeGeneratorWithContext() on a context of its own instead.
+ * out          : the file the code is printed on, NULL to keep it in vmCode
+ * options      : the options of the current code generation
+ * tokenSource  : source of the tokens, and currentToken the current token pulled
+ *                from it. The code generator never looks past the current
+ *                token, so the tokens are pulled only as they are parsed.
+ *                tokenIndex is the index of the current token, from 0.
+ * currentLevel : the level of the block being generated
+ * currentScope : the procedure of the block being generated, NULL for the
+ *                main program
+ * symbolTable  : the symbols declared so far. Only the first visibleSymbols of
+ *                them are looked up, all of them if it is -1.
+ * symbolArena  : the arena of the symbols, NULL for one of the code generation
+ *                only. If given, the symbol table is kept once the code is
+ *                generated, until the next code generation.
+ * vmCode       : the emitted code. It holds vmCodeCapacity instructions and
+ *                grows as they are emitted. nextCodeIndex is the index of the
+ *                next one. The array is kept for the next code generation
+ *                with the same context, unless it is handed over by
+ *                codeGeneratorContextToMemory().
+ * spillBase    : the address of the first temporary of the current activation
+ *                record, which follow the variables. They are used when an
+ *                expression needs more registers than the register file has.
+ *                spillDepth is the number of temporaries holding a value at
+ *                the moment, and spillSlots is the number of them needed so
+ *                far by the block, which its INC reserves.
+ * blocks       : if recordBlocks is set, the BlockRange of each block, in the
+ *                order their statements end. numOfBlocks of them are recorded,
+ *                in an array of blocksCapacity kept as vmCode is.
+ * peepholeStats, optimizerStats, inlinedCalls: what the last code generation
+ *                did, see the getters below.
+ * symbolStats  : the symbols the last code generation declared, and the
+ *                lookups it made in the symbol table.
+ * */
+typedef struct {
+    FILE* out;
+    CodeGeneratorOptions options;
+
+    TokenSource tokenSource;
+    Token currentToken;
+    int tokenIndex;
+
+    unsigned int currentLevel;
+    Symbol* currentScope;
+    SymbolTable symbolTable;
+    int visibleSymbols;
+    Arena* symbolArena;
+
+    Instruction* vmCode;
+    int vmCodeCapacity;
+    int nextCodeIndex;
+
+    int spillBase;
+    int spillDepth;
+    int spillSlots;
+
+    int recordBlocks;
+    BlockRange* blocks;
+    int numOfBlocks;
+    int blocksCapacity;
+
+    PeepholeStats peepholeStats;
+    OptimizerStats optimizerStats;
+    int inlinedCalls;
+    SymbolStats symbolStats;
+} CompilerContext;
+
+/**
+ * Initializes the given context, with no code emitted.
+ * */
+void initCompilerContext(CompilerContext*);
+
+/**
+ * Frees the code and the blocks kept in the given context.
+ * */
+void deleteCompilerContext(CompilerContext*);
 
 int codeGenerator(TokenList, FILE*);
 
+/**
+ * Same as codeGenerator(), but generates code with the given options.
+ * */
+int codeGeneratorWithOptions(TokenList, FILE*, CodeGeneratorOptions);
+
+/**
+ * Same as codeGeneratorWithOptions(), but parses the tokens as they are pulled
+ * from the given TokenSource, one at a time, instead of a prebuilt token list.
+ * */
+int codeGeneratorFromSource(TokenSource, FILE*, CodeGeneratorOptions);
+
+/**
+ * Same as codeGeneratorFromSource(), but with the given context, which is not
+ * used by any other code generation at the same time. Code generations with
+ * different contexts could run at the same time, on different threads, as
+ * long as their token sources and output files are their own as well.
+ * */
+int codeGeneratorWithContext(CompilerContext*, TokenSource, FILE*, CodeGeneratorOptions);
+
+/**
+ * Same as codeGeneratorWithOptions(), but instead of printing the generated
+ * code, sets code to the array of generated instructions, which should be
+ * freed by the caller, and numOfIns to the number of instructions generated.
+ * The format of the options is not used. On error, code is set to NULL and
+ * numOfIns to 0.
+ * */
+int codeGeneratorToMemory(TokenList, Instruction** code, int* numOfIns, CodeGeneratorOptions);
+
+/**
+ * Same as codeGeneratorToMemory(), but on the tokens pulled from the given
+ * TokenSource.
+ * */
+int codeGeneratorSourceToMemory(TokenSource, Instruction** code, int* numOfIns, CodeGeneratorOptions);
+
+/**
+ * Same as codeGeneratorSourceToMemory(), but with the given context, as
+ * codeGeneratorWithContext() is.
+ * */
+int codeGeneratorContextToMemory(CompilerContext*, TokenSource, Instruction** code, int* numOfIns, CodeGeneratorOptions);
+
+/**
+ * Generates the statement of the given block of the last code generation of
+ * the given context again, on the tokens pulled from the given TokenSource,
+ * the first of which is the first token of the statement: emits the INC of the
+ * block, the statement, and the RTN or the SIO halt of the block, following
+ * the code of the context. The code is not optimized, and the symbol table of
+ * the last code generation should be kept (see symbolArena). The jumps of the
+ * statement are to the addresses it is emitted at, and are left to the caller
+ * to move with it. Returns the code generator error, 0 if none;
+ * tokenIndex is then the index, from the first token of the statement, of the
+ * token following it.
+ * */
+int regenerateBlock(CompilerContext*, const BlockRange*, TokenSource);
+
+/**
+ * Returns what the peephole optimizer did in the last code generation, all
+ * zero if it did not run.
+ * */
+PeepholeStats getPeepholeStats();
+
+/**
+ * Returns what the optimizer did in the last code generation, all zero if it
+ * did not run.
+ * */
+OptimizerStats getOptimizerStats();
+
+/**
+ * Returns the number of calls inlined in the last code generation.
+ * */
+int getInlinedCallCount();
+
+/**
+ * Returns the symbols declared in the last code generation, and the lookups it
+ * made in the symbol table.
+ * */
+SymbolStats getSymbolTableStats();
+
+/**
+ * Returns the number of registers the expressions are allocated over, which
+ * could be lowered at build time (see REGISTER_COUNT in code_generator.c).
+ * */
+int getRegisterCount();
+
+/**
+ * Prints the given code on the given file in the given format, as the code
+ * generator prints the code it emits.
+ * */
+void printCode(const Instruction* code, int numOfIns, CodeGeneratorFormat, FILE*);
+
+/**
+ * Returns the checksum of the given code that is stored in the header of an
+ * object file. See ObjectHeader.
+ * */
+unsigned int codeChecksum(const Instruction* code, int numOfIns);
+
 void printCGErr(int errCode, FILE*);
 
 #endif
\ No newline at end of file
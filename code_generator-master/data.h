@@ -1,7 +1,6 @@
 #ifndef __DATA_H__
 #define __DATA_H__
 
-#define MAX_CODE_LENGTH 500
 #define AR_VARIABLE_OFFSET 4
 
 // Instruction
@@ -12,6 +11,22 @@ typedef struct {
     int m;   // M
 } Instruction;
 
+/**
+ * Binary object file of PM/0 code: an ObjectHeader followed by numOfIns
+ * Instruction structs, all in the byte order of the machine that wrote it.
+ * checksum is the 32-bit FNV-1a hash of the bytes of the instructions.
+ * The text format (one "op r l m" line per instruction) is also accepted.
+ * */
+#define PM0_OBJECT_MAGIC   "PM0O"
+#define PM0_OBJECT_VERSION 1
+
+typedef struct {
+    char magic[4];         // PM0_OBJECT_MAGIC, not null terminated
+    unsigned int version;  // PM0_OBJECT_VERSION
+    unsigned int numOfIns; // number of instructions following the header
+    unsigned int checksum; // FNV-1a of the instructions
+} ObjectHeader;
+
 // Opcodes
 enum {
     LIT = 1, RTN = 2, LOD = 3, STO = 4, CAL = 5, INC = 6, JMP = 7, JPC = 8,
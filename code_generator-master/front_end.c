@@ -0,0 +1,59 @@
+#include "front_end.h"
+
+void printLexerErr(LexerOut lexerOut, FILE* out)
+{
+    fprintf(out, "ERROR: LexErr[%d] was encountered at line %d while "
+                    "lexical analysis: ",
+                    lexerOut.lexerError, lexerOut.errorLine);
+    switch(lexerOut.lexerError)
+    {
+        case NONLETTER_VAR_INITIAL:
+            fprintf(out, "Variable does not start with letter.");
+            break;
+        case NAME_TOO_LONG:
+            fprintf(out, "Name too long.");
+            break;
+        case NUM_TOO_LONG:
+            fprintf(out, "Number too long.");
+            break;
+        case INV_SYM:
+            fprintf(out, "Invalid symbol.");
+            break;
+        default:
+            break;
+    }
+    fprintf(out, "\n");
+}
+
+Token pullLexerToken(void* state)
+{
+    Token token;
+
+    if( !lexNextToken((LexerState*)state, &token) )
+    {
+        Token nulsymToken = { .id=0, .lexeme="" };
+        return nulsymToken;
+    }
+
+    return token;
+}
+
+int compileSourceCode(CompilerContext* context, SourceCode sourceCode, Arena* arena, Instruction** code, int* numOfIns,
+                      CodeGeneratorOptions options, LexerOut* lexerOut)
+{
+    LexerState lexerState;
+    initLexerState(&lexerState, sourceCode.text, sourceCode.length);
+
+    TokenSource tokenSource = { pullLexerToken, &lexerState };
+
+    int cgErr = codeGeneratorContextToMemory(context, tokenSource, code, numOfIns, options);
+
+    Token token;
+    while( lexNextToken(&lexerState, &token) );
+
+    lexerOut->lexerError = lexerState.lexerError;
+    lexerOut->errorLine = lexerState.lineNum;
+    initTokenList(&lexerOut->tokenList, arena);
+
+    return cgErr;
+}
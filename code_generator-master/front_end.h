@@ -0,0 +1,39 @@
+#ifndef __FRONT_END_H__
+#define __FRONT_END_H__
+
+#include <stdio.h>
+#include "token.h"
+#include "code_generator.h"
+#include "lexer/lexical_analyzer.h"
+#include "lexer/source_code.h"
+
+/**
+ * The lexer in front of the code generator, for the executables that compile
+ * PL/0 source code in one process (pipeline.out, code_generator.out --batch).
+ * */
+
+/**
+ * Prints the lexer error of the given LexerOut, as la.out does.
+ * */
+void printLexerErr(LexerOut lexerOut, FILE* out);
+
+/**
+ * TokenSource::pull over a LexerState: lexes the next token as the code
+ * generator asks for it.
+ * */
+Token pullLexerToken(void* state);
+
+/**
+ * Compiles the given source code with the given context, the code generator
+ * pulling the tokens from the lexer as it parses them, into code and numOfIns
+ * as codeGeneratorContextToMemory() does. The rest of the source code, which
+ * the code generator did not need, is lexed as well: a lexer error anywhere in
+ * the source code is set in the lexerError and errorLine of lexerOut, and is
+ * to be reported instead of the code generator error, as la.out would. The
+ * token list of lexerOut is left empty, allocated from the given arena.
+ * Returns the code generator error, 0 if none.
+ * */
+int compileSourceCode(CompilerContext*, SourceCode sourceCode, Arena*, Instruction** code, int* numOfIns,
+                      CodeGeneratorOptions, LexerOut* lexerOut);
+
+#endif
@@ -0,0 +1,445 @@
+#include "incremental.h"
+#include "peephole.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Grows the given arrays of tokens and of their ends, of capacity elements, to
+ * hold at least numOfTokens. If they could not be grown, prints an error
+ * message on stderr and exits.
+ * */
+void reserveTokens(Token** tokens, int** ends, int* capacity, int numOfTokens)
+{
+    if(numOfTokens <= *capacity) return;
+
+    int grown = *capacity ? *capacity : 256;
+    while(grown < numOfTokens) grown *= 2;
+
+    Token* grownTokens = realloc(*tokens, grown * sizeof(Token));
+    if(grownTokens) *tokens = grownTokens;
+
+    int* grownEnds = grownTokens ? realloc(*ends, grown * sizeof(int)) : NULL;
+    if(grownEnds) *ends = grownEnds;
+
+    if(!grownTokens || !grownEnds)
+    {
+        fprintf(stderr, "Could not grow the tokens to %d. Lexing is unsuccessful: terminating incremental compiler..\n", grown);
+        exit(0);
+    }
+
+    *capacity = grown;
+}
+
+/**
+ * Grows the source code of the given compiler to hold at least length
+ * characters, keeping those it holds. Exits as reserveTokens() does.
+ * */
+void reserveText(IncrementalCompiler* compiler, int length)
+{
+    if(length <= compiler->textCapacity) return;
+
+    int capacity = compiler->textCapacity ? compiler->textCapacity : 4096;
+    while(capacity < length) capacity *= 2;
+
+    char* grown = realloc(compiler->text, capacity);
+
+    if(!grown)
+    {
+        fprintf(stderr, "Could not grow the source code to %d characters: terminating incremental compiler..\n", capacity);
+        exit(0);
+    }
+
+    compiler->text = grown;
+    compiler->textCapacity = capacity;
+}
+
+/**
+ * Grows the code of the given context to hold at least numOfIns instructions,
+ * keeping those it holds. Exits as reserveTokens() does.
+ * */
+void reserveCode(CompilerContext* context, int numOfIns)
+{
+    if(numOfIns <= context->vmCodeCapacity) return;
+
+    int capacity = context->vmCodeCapacity ? context->vmCodeCapacity : 256;
+    while(capacity < numOfIns) capacity *= 2;
+
+    Instruction* grown = realloc(context->vmCode, capacity * sizeof(Instruction));
+
+    if(!grown)
+    {
+        fprintf(stderr, "Could not grow the code to %d instructions: terminating incremental compiler..\n", capacity);
+        exit(0);
+    }
+
+    context->vmCode = grown;
+    context->vmCodeCapacity = capacity;
+}
+
+/**
+ * Returns 1 if the two tokens are the same, 0 otherwise.
+ * */
+int isSameToken(Token a, Token b)
+{
+    return a.id == b.id && !strcmp(a.lexeme, b.lexeme);
+}
+
+/**
+ * Sets the given LexerOut to the error of the given lexer state, with an empty
+ * token list.
+ * */
+void setLexerOut(LexerOut* lexerOut, LexerState lexerState)
+{
+    lexerOut->lexerError = lexerState.lexerError;
+    lexerOut->errorLine = lexerState.lexerError != NONE ? lexerState.lineNum : -1;
+    initTokenList(&lexerOut->tokenList, NULL);
+}
+
+/**
+ * Sets the given list to the tokens of the given compiler from the given
+ * index on, without copying them.
+ * */
+void getTokenView(IncrementalCompiler* compiler, int first, TokenList* view)
+{
+    view->tokens = compiler->tokens + first;
+    view->numberOfTokens = compiler->numOfTokens - first;
+    view->capacity = view->numberOfTokens;
+    view->arena = NULL;
+}
+
+void initIncrementalCompiler(IncrementalCompiler* compiler, CodeGeneratorOptions options)
+{
+    memset(compiler, 0, sizeof(*compiler));
+
+    compiler->options = options;
+
+    // The code generator records the blocks, and keeps the symbols
+    initCompilerContext(&compiler->context);
+    initArena(&compiler->symbolArena);
+
+    compiler->context.recordBlocks = 1;
+    compiler->context.symbolArena = &compiler->symbolArena;
+}
+
+void deleteIncrementalCompiler(IncrementalCompiler* compiler)
+{
+    deleteSymbolTable(&compiler->context.symbolTable);
+    deleteCompilerContext(&compiler->context);
+    deleteArena(&compiler->symbolArena);
+
+    free(compiler->text);
+    free(compiler->tokens);
+    free(compiler->tokenEnds);
+
+    compiler->text = NULL;
+    compiler->tokens = NULL;
+    compiler->tokenEnds = NULL;
+    compiler->length = compiler->textCapacity = 0;
+    compiler->numOfTokens = compiler->tokenCapacity = 0;
+    compiler->valid = 0;
+}
+
+/**
+ * Lexes and compiles the source code of the given compiler in full, for the
+ * given reason.
+ * */
+int compileFull(IncrementalCompiler* compiler, const char* reason, LexerOut* lexerOut)
+{
+    IncrementalStats* stats = &compiler->stats;
+
+    *stats = (IncrementalStats){ 1, reason, 0, 0, 0, 0 };
+    compiler->valid = 0;
+    compiler->numOfTokens = 0;
+
+    LexerState lexerState;
+    initLexerState(&lexerState, compiler->text, compiler->length);
+
+    Token token;
+    while( lexNextToken(&lexerState, &token) )
+    {
+        reserveTokens(&compiler->tokens, &compiler->tokenEnds, &compiler->tokenCapacity, compiler->numOfTokens + 1);
+
+        compiler->tokens[compiler->numOfTokens] = token;
+        compiler->tokenEnds[compiler->numOfTokens] = lexerState.charInd;
+        compiler->numOfTokens++;
+    }
+
+    stats->tokensLexed = compiler->numOfTokens;
+    setLexerOut(lexerOut, lexerState);
+
+    if(lexerState.lexerError != NONE) return 0;
+
+    TokenList view;
+    getTokenView(compiler, 0, &view);
+    TokenListIterator it = getTokenListIterator(&view);
+
+    int err = codeGeneratorWithContext(&compiler->context, getTokenListSource(&it), NULL, compiler->options);
+
+    if(!err)
+    {
+        stats->blocks = stats->numOfBlocks = compiler->context.numOfBlocks;
+        stats->instructions = compiler->context.nextCodeIndex;
+        compiler->valid = 1;
+    }
+
+    return err;
+}
+
+/**
+ * Compiles the source code of the given compiler, whose first prefix and last
+ * suffix characters are those of the source code compiled last, which was
+ * delta characters shorter.
+ * */
+int recompileEdit(IncrementalCompiler* compiler, int prefix, int suffix, int delta, LexerOut* lexerOut)
+{
+    CompilerContext* context = &compiler->context;
+    CodeGeneratorOptions options = compiler->options;
+
+    if(!compiler->valid) return compileFull(compiler, "no compilation to start from", lexerOut);
+
+    if(options.peephole || options.optimize || options.inlineThreshold > 0)
+        return compileFull(compiler, "the options change the code across blocks", lexerOut);
+
+    // The first token that ends in the edit, or right before it: the lexer
+    // .. looked at the first character of the edit to end it
+    int low = 0, high = compiler->numOfTokens;
+    while(low < high)
+    {
+        int mid = (low + high) / 2;
+
+        if(compiler->tokenEnds[mid] < prefix) low = mid + 1;
+        else                                  high = mid;
+    }
+
+    int first = low, last = compiler->numOfTokens;
+
+    // Lex from the end of the token before, until a token ends past the edit
+    // .. where a token of the source code compiled last ended: the tokens
+    // .. following it are the same, moved by delta characters
+    LexerState lexerState;
+    initLexerState(&lexerState, compiler->text, compiler->length);
+    lexerState.charInd = first ? compiler->tokenEnds[first - 1] : 0;
+
+    Token* lexed = NULL;
+    int* lexedEnds = NULL;
+    int numOfLexed = 0, lexedCapacity = 0;
+    int old = first;
+    Token token;
+
+    while( lexNextToken(&lexerState, &token) )
+    {
+        int end = lexerState.charInd;
+
+        reserveTokens(&lexed, &lexedEnds, &lexedCapacity, numOfLexed + 1);
+        lexed[numOfLexed] = token;
+        lexedEnds[numOfLexed] = end;
+        numOfLexed++;
+
+        if(end < compiler->length - suffix) continue;
+
+        while(old < compiler->numOfTokens && compiler->tokenEnds[old] < end - delta) old++;
+
+        if(old < compiler->numOfTokens && compiler->tokenEnds[old] == end - delta)
+        {
+            last = old + 1;
+            break;
+        }
+    }
+
+    if(lexerState.lexerError != NONE)
+    {
+        free(lexed);
+        free(lexedEnds);
+        return compileFull(compiler, "lexer error", lexerOut);
+    }
+
+    // Only the tokens between the same first and last ones of the span
+    // .. changed, from changedFirst to changedEnd - 1 among the old ones
+    int replaced = last - first, same = 0, sameEnd = 0;
+
+    while(same < numOfLexed && same < replaced && isSameToken(lexed[same], compiler->tokens[first + same]))
+        same++;
+
+    while(sameEnd < numOfLexed - same && sameEnd < replaced - same
+          && isSameToken(lexed[numOfLexed - 1 - sameEnd], compiler->tokens[last - 1 - sameEnd]))
+        sameEnd++;
+
+    int changedFirst = first + same, changedEnd = last - sameEnd;
+    int changed = numOfLexed - same - sameEnd > 0 || changedEnd > changedFirst;
+    int tokenDelta = numOfLexed - replaced;
+
+    BlockRange* range = NULL;
+
+    for(int i = 0; changed && i < context->numOfBlocks && !range; i++)
+    {
+        BlockRange* block = &context->blocks[i];
+        if(block->firstToken <= changedFirst && changedEnd <= block->endToken) range = block;
+    }
+
+    // Splice the lexed tokens in, and move the ends of the following ones
+    reserveTokens(&compiler->tokens, &compiler->tokenEnds, &compiler->tokenCapacity, compiler->numOfTokens + tokenDelta);
+
+    int following = compiler->numOfTokens - last;
+
+    memmove(compiler->tokens + first + numOfLexed, compiler->tokens + last, following * sizeof(Token));
+    memmove(compiler->tokenEnds + first + numOfLexed, compiler->tokenEnds + last, following * sizeof(int));
+
+    if(numOfLexed)
+    {
+        memcpy(compiler->tokens + first, lexed, numOfLexed * sizeof(Token));
+        memcpy(compiler->tokenEnds + first, lexedEnds, numOfLexed * sizeof(int));
+    }
+
+    compiler->numOfTokens += tokenDelta;
+
+    for(int i = first + numOfLexed; i < compiler->numOfTokens; i++) compiler->tokenEnds[i] += delta;
+
+    free(lexed);
+    free(lexedEnds);
+
+    setLexerOut(lexerOut, lexerState);
+    compiler->stats = (IncrementalStats){ 0, NULL, 0, context->numOfBlocks, numOfLexed, 0 };
+
+    // White space and comments only, the code is the same
+    if(!changed) return 0;
+
+    if(!range) return compileFull(compiler, "the declarations changed", lexerOut);
+
+    // The statement is generated after the code, to be moved in place of the
+    // .. code of the block once it is
+    int oldEnd = range->endAddress, oldNumOfIns = context->nextCodeIndex;
+
+    TokenList view;
+    getTokenView(compiler, range->firstToken, &view);
+    TokenListIterator it = getTokenListIterator(&view);
+
+    int err = regenerateBlock(context, range, getTokenListSource(&it));
+
+    // The statement should end right before the same token as before, for
+    // .. the rest of the tokens to be parsed as they were
+    if(err || context->tokenIndex != range->endToken + tokenDelta - range->firstToken)
+    {
+        context->nextCodeIndex = oldNumOfIns;
+        return compileFull(compiler, err ? "code generator error" : "the statement ends elsewhere", lexerOut);
+    }
+
+    int numOfGenerated = context->nextCodeIndex - oldNumOfIns;
+    int newEnd = range->incAddress + numOfGenerated, codeDelta = newEnd - oldEnd;
+
+    Instruction* generated = malloc(numOfGenerated * sizeof(Instruction));
+
+    if(!generated)
+    {
+        fprintf(stderr, "Could not move %d instructions: terminating incremental compiler..\n", numOfGenerated);
+        exit(0);
+    }
+
+    // The jumps of the statement stay within it, its calls go to the
+    // .. procedures, which move if they follow it
+    for(int i = 0; i < numOfGenerated; i++)
+    {
+        Instruction ins = context->vmCode[oldNumOfIns + i];
+
+        if(ins.op == JMP || ins.op == JPC) ins.m += range->incAddress - oldNumOfIns;
+        if(ins.op == CAL && (int)ins.m >= oldEnd) ins.m += codeDelta;
+
+        generated[i] = ins;
+    }
+
+    // The code following the block moves as the statement grew, and so do the
+    // .. jumps and the calls to it, the procedures and the other blocks. The
+    // .. tokens move as many tokens as were added.
+    if(codeDelta)
+    {
+        reserveCode(context, oldNumOfIns + codeDelta);
+        memmove(context->vmCode + newEnd, context->vmCode + oldEnd, (oldNumOfIns - oldEnd) * sizeof(Instruction));
+
+        for(int i = 0; i < range->incAddress; i++)
+        {
+            if(isCodeAddress(&context->vmCode[i]) && (int)context->vmCode[i].m >= oldEnd) context->vmCode[i].m += codeDelta;
+        }
+
+        for(int i = newEnd; i < oldNumOfIns + codeDelta; i++)
+        {
+            if(isCodeAddress(&context->vmCode[i]) && (int)context->vmCode[i].m >= oldEnd) context->vmCode[i].m += codeDelta;
+        }
+
+        for(int i = 0; i < context->symbolTable.numberOfSymbols; i++)
+        {
+            Symbol* symbol = context->symbolTable.symbols[i];
+            if(symbol->type == PROC && (int)symbol->address >= oldEnd) symbol->address += codeDelta;
+        }
+    }
+
+    memcpy(context->vmCode + range->incAddress, generated, numOfGenerated * sizeof(Instruction));
+    context->nextCodeIndex = oldNumOfIns + codeDelta;
+    free(generated);
+
+    for(int i = 0; (codeDelta || tokenDelta) && i < context->numOfBlocks; i++)
+    {
+        BlockRange* block = &context->blocks[i];
+        if(block == range) continue;
+
+        if(block->incAddress >= oldEnd) block->incAddress += codeDelta;
+        if(block->endAddress >= oldEnd) block->endAddress += codeDelta;
+        if(block->firstToken > range->endToken) block->firstToken += tokenDelta;
+        if(block->endToken > range->endToken) block->endToken += tokenDelta;
+    }
+
+    range->endToken += tokenDelta;
+    range->endAddress = newEnd;
+
+    compiler->stats.blocks = 1;
+    compiler->stats.instructions = newEnd - range->incAddress;
+
+    return 0;
+}
+
+int compileIncremental(IncrementalCompiler* compiler, const char* text, int length, LexerOut* lexerOut)
+{
+    int oldLength = compiler->length;
+    int shorter = length < oldLength ? length : oldLength;
+    int prefix = 0, suffix = 0;
+
+    while(prefix < shorter && text[prefix] == compiler->text[prefix]) prefix++;
+
+    while(suffix < shorter - prefix && text[length - 1 - suffix] == compiler->text[oldLength - 1 - suffix]) suffix++;
+
+    reserveText(compiler, length);
+    if(length) memcpy(compiler->text, text, length);
+    compiler->length = length;
+
+    return recompileEdit(compiler, prefix, suffix, length - oldLength, lexerOut);
+}
+
+int editIncremental(IncrementalCompiler* compiler, int offset, int removed, const char* inserted, int insertedLength,
+                    LexerOut* lexerOut)
+{
+    if(offset < 0 || removed < 0 || insertedLength < 0 || offset + removed > compiler->length) return -1;
+
+    int suffix = compiler->length - offset - removed;
+
+    reserveText(compiler, compiler->length - removed + insertedLength);
+    memmove(compiler->text + offset + insertedLength, compiler->text + offset + removed, suffix);
+    memcpy(compiler->text + offset, inserted, insertedLength);
+    compiler->length += insertedLength - removed;
+
+    return recompileEdit(compiler, offset, suffix, insertedLength - removed, lexerOut);
+}
+
+const Instruction* getIncrementalCode(const IncrementalCompiler* compiler, int* numOfIns)
+{
+    *numOfIns = compiler->valid ? compiler->context.nextCodeIndex : 0;
+
+    return compiler->valid ? compiler->context.vmCode : NULL;
+}
+
+void printIncrementalStats(IncrementalStats stats, FILE* out)
+{
+    if(stats.full)
+        fprintf(out, "Compiled %d blocks in full (%s): %d tokens lexed, %d instructions emitted.\n",
+            stats.numOfBlocks, stats.reason, stats.tokensLexed, stats.instructions);
+    else
+        fprintf(out, "Recompiled %d of %d blocks: %d tokens lexed, %d instructions emitted.\n",
+            stats.blocks, stats.numOfBlocks, stats.tokensLexed, stats.instructions);
+}
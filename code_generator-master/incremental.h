@@ -0,0 +1,132 @@
+#ifndef __INCREMENTAL_H__
+#define __INCREMENTAL_H__
+
+#include <stdio.h>
+#include "token.h"
+#include "data.h"
+#include "code_generator.h"
+#include "lexer/lexical_analyzer.h"
+
+/**
+ * Incremental compilation: a source code compiled once is compiled again,
+ * after an edit, by lexing and generating only what the edit changed.
+ *
+ * The compiler keeps the source code, its tokens together with the offset each
+ * of them ends at, the symbol table, the code, and the BlockRange of each block
+ * the code generator recorded. After an edit, the tokens are lexed again from
+ * the end of the last token before the edit, until a token ends where a token
+ * of the previous source code ended, past the edit: the tokens from there on
+ * are the same. If the tokens that differ are all within the statement of a
+ * single block, only that statement is generated again, and the code following
+ * it, the jumps and the calls to it and the addresses of the procedures
+ * following it are moved by as many instructions as the statement grew. The
+ * work done for an edit then depends on the size of the edit and of the
+ * statement it is in, except for the tokens and the code being moved, which
+ * are copied, not lexed or generated again.
+ *
+ * The source code is compiled in full instead if it was not compiled before,
+ * if the edit is in the declarations, if the statement does not parse to the
+ * same end as before, if the lexer or the code generator runs into an error,
+ * or if the options are such that a block could change the code of the others:
+ * the peephole optimizer, the optimizer and the inlining. The compiled code is
+ * always the one a full compilation of the source code with the same options
+ * would generate, and so are the errors.
+ *
+ * The expression trees of the statements generated again are allocated from
+ * the arena of the symbols, which is released once the source code is compiled
+ * in full again.
+ * */
+
+/**
+ * What the last compilation did.
+ * full        : 1 if the source code was compiled in full, and reason why
+ * blocks      : the number of blocks generated again, 0 if the edit changed no
+ *               token, otherwise 1, and numOfBlocks the number of blocks
+ * tokensLexed : the number of tokens lexed
+ * instructions: the number of instructions emitted
+ * */
+typedef struct {
+    int full;
+    const char* reason;
+    int blocks;
+    int numOfBlocks;
+    int tokensLexed;
+    int instructions;
+} IncrementalStats;
+
+/**
+ * State of the incremental compilation of a source code.
+ * options    : the options the code is generated with
+ * context    : the context of the code generation, which keeps the code and
+ *              the blocks, and symbolArena the symbols it generated them with
+ * text       : the source code last compiled, length characters long, in
+ *              textCapacity allocated
+ * tokens     : its tokens, numOfTokens, tokenEnds[i] being the offset of the
+ *              character following tokens[i], both in tokenCapacity allocated
+ * valid      : 1 if the code, the symbols and the blocks are those of text,
+ *              i.e. it was compiled with no errors
+ * stats      : what the last compilation did
+ * */
+typedef struct {
+    CodeGeneratorOptions options;
+    CompilerContext context;
+    Arena symbolArena;
+
+    char* text;
+    int length;
+    int textCapacity;
+
+    Token* tokens;
+    int* tokenEnds;
+    int numOfTokens;
+    int tokenCapacity;
+
+    int valid;
+    IncrementalStats stats;
+} IncrementalCompiler;
+
+/**
+ * Initializes the given compiler, with the given options and no source code
+ * compiled yet.
+ * */
+void initIncrementalCompiler(IncrementalCompiler*, CodeGeneratorOptions);
+
+/**
+ * Releases the source code, the tokens, the symbols and the code of the given
+ * compiler.
+ * */
+void deleteIncrementalCompiler(IncrementalCompiler*);
+
+/**
+ * Compiles the given source code of length characters, which does not need to
+ * be null terminated, as an edit of the source code compiled last: the edit is
+ * the span between the characters the source codes start and end with.
+ * A lexer error is set in the lexerError and errorLine of lexerOut, whose
+ * token list is left empty, and is to be reported instead of the code
+ * generator error, as compileSourceCode() does. Returns the code generator
+ * error, 0 if none.
+ * */
+int compileIncremental(IncrementalCompiler*, const char* text, int length, LexerOut* lexerOut);
+
+/**
+ * Same as compileIncremental(), on the source code compiled last, with the
+ * removed characters from the given offset replaced by the insertedLength
+ * characters of inserted. Returns -1, with nothing done, if the removed
+ * characters are not within the source code.
+ * */
+int editIncremental(IncrementalCompiler*, int offset, int removed, const char* inserted, int insertedLength,
+                    LexerOut* lexerOut);
+
+/**
+ * Returns the code of the last compilation, and sets numOfIns to the number of
+ * instructions in it. The code belongs to the compiler, and changes with the
+ * next compilation. Returns NULL if the last compilation failed.
+ * */
+const Instruction* getIncrementalCode(const IncrementalCompiler*, int* numOfIns);
+
+/**
+ * Prints the given stats on the given file, in a single line.
+ * */
+void printIncrementalStats(IncrementalStats, FILE*);
+
+#endif
@@ -0,0 +1,539 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ir.h"
+
+int isBlockReference(const Instruction* ins)
+{
+    return ins->op == JMP || ins->op == JPC || ins->op == CAL;
+}
+
+/**
+ * Returns whether the given instruction ends a block.
+ * */
+int endsBlock(const Instruction* ins)
+{
+    return isBlockReference(ins) || ins->op == RTN || ins->op == SIO_HALT;
+}
+
+/**
+ * Returns whether the given register is one of the virtual machine.
+ * */
+int isRegister(int reg)
+{
+    return reg >= 0 && reg < IR_REGISTER_COUNT;
+}
+
+RegisterSet instructionUses(const Instruction* ins)
+{
+    switch(ins->op)
+    {
+        case STO: case JPC: case SIO_WRITE: case ODD:
+            return 1u << ins->r;
+        case NEG:
+            return 1u << ins->l;
+        case ADD: case SUB: case MUL: case DIV: case MOD:
+        case EQL: case NEQ: case LSS: case LEQ: case GTR: case GEQ:
+            return (1u << ins->l) | (1u << ins->m);
+        default:
+            return 0;
+    }
+}
+
+RegisterSet instructionDefs(const Instruction* ins)
+{
+    switch(ins->op)
+    {
+        case LIT: case LOD: case SIO_READ: case NEG: case ODD:
+        case ADD: case SUB: case MUL: case DIV: case MOD:
+        case EQL: case NEQ: case LSS: case LEQ: case GTR: case GEQ:
+            return 1u << ins->r;
+        case CAL:
+            return IR_ALL_REGISTERS;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Returns whether every register the given instruction uses is in range.
+ * */
+int registersInRange(const Instruction* ins)
+{
+    switch(ins->op)
+    {
+        case LIT: case LOD: case STO: case JPC:
+        case SIO_WRITE: case SIO_READ: case ODD:
+            return isRegister(ins->r);
+        case NEG:
+            return isRegister(ins->r) && isRegister(ins->l);
+        case ADD: case SUB: case MUL: case DIV: case MOD:
+        case EQL: case NEQ: case LSS: case LEQ: case GTR: case GEQ:
+            return isRegister(ins->r) && isRegister(ins->l) && isRegister(ins->m);
+        default:
+            return 1;
+    }
+}
+
+/**
+ * Appends an empty block to the graph and returns its index, or -1 if no
+ * memory could be allocated.
+ * */
+int addBlock(ControlFlowGraph* cfg)
+{
+    if(cfg->numOfBlocks == cfg->capacity)
+    {
+        int capacity = cfg->capacity ? cfg->capacity * 2 : 16;
+        BasicBlock* blocks = arenaGrow(cfg->arena, cfg->blocks,
+            cfg->capacity * sizeof(BasicBlock), capacity * sizeof(BasicBlock));
+
+        if(!blocks) return -1;
+
+        cfg->blocks = blocks;
+        cfg->capacity = capacity;
+    }
+
+    BasicBlock* block = &cfg->blocks[cfg->numOfBlocks];
+    block->code = NULL;
+    block->numOfIns = 0;
+    block->capacity = 0;
+    block->removed = 0;
+
+    return cfg->numOfBlocks++;
+}
+
+int appendInstruction(ControlFlowGraph* cfg, BasicBlock* block, Instruction ins)
+{
+    if(block->numOfIns == block->capacity)
+    {
+        int capacity = block->capacity ? block->capacity * 2 : 8;
+        Instruction* code = arenaGrow(cfg->arena, block->code,
+            block->capacity * sizeof(Instruction), capacity * sizeof(Instruction));
+
+        if(!code) return -1;
+
+        block->code = code;
+        block->capacity = capacity;
+    }
+
+    block->code[block->numOfIns++] = ins;
+    return 0;
+}
+
+void removeInstruction(BasicBlock* block, int index)
+{
+    memmove(&block->code[index], &block->code[index + 1],
+        (block->numOfIns - index - 1) * sizeof(Instruction));
+    block->numOfIns--;
+}
+
+void removeBlock(BasicBlock* block)
+{
+    block->removed = 1;
+    block->numOfIns = 0;
+}
+
+int buildControlFlowGraph(const Instruction* code, int numOfIns, Arena* arena, ControlFlowGraph* cfg)
+{
+    cfg->blocks = NULL;
+    cfg->numOfBlocks = 0;
+    cfg->capacity = 0;
+    cfg->arena = arena;
+
+    // blockOf[i] is the block starting at address i, or -1. The end of the
+    // .. code starts a block only if it is jumped to.
+    int* blockOf = malloc((numOfIns + 1) * sizeof(int));
+    if(!blockOf) return -1;
+
+    int i, err = 0;
+
+    for(i = 0; i <= numOfIns; i++) blockOf[i] = -1;
+
+    blockOf[0] = 0;
+    for(i = 0; i < numOfIns && !err; i++)
+    {
+        if(!registersInRange(&code[i])) err = -1;
+
+        if(isBlockReference(&code[i]))
+        {
+            if(code[i].m < 0 || code[i].m > numOfIns) err = -1;
+            else blockOf[code[i].m] = 0;
+        }
+
+        if(endsBlock(&code[i]) && i + 1 < numOfIns) blockOf[i + 1] = 0;
+    }
+
+    // Number the blocks in the order of their addresses
+    for(i = 0; i <= numOfIns && !err; i++)
+    {
+        if(blockOf[i] < 0) continue;
+
+        blockOf[i] = addBlock(cfg);
+        if(blockOf[i] < 0) err = -1;
+    }
+
+    // Fill the blocks, turning the code addresses into block indices
+    int current = -1;
+    for(i = 0; i < numOfIns && !err; i++)
+    {
+        if(blockOf[i] >= 0) current = blockOf[i];
+
+        Instruction ins = code[i];
+        if(isBlockReference(&ins)) ins.m = blockOf[ins.m];
+
+        err = appendInstruction(cfg, &cfg->blocks[current], ins);
+    }
+
+    free(blockOf);
+    return err;
+}
+
+int lowerControlFlowGraph(const ControlFlowGraph* cfg, Instruction** code)
+{
+    // address[b] is the address block b is emitted at; for a removed block,
+    // .. it is the address of the block following it
+    int* address = malloc((cfg->numOfBlocks + 1) * sizeof(int));
+    int numOfIns = countInstructions(cfg);
+
+    *code = malloc((numOfIns ? numOfIns : 1) * sizeof(Instruction));
+
+    if(!address || !*code)
+    {
+        free(address);
+        free(*code);
+        *code = NULL;
+        return -1;
+    }
+
+    int b, count = 0;
+    for(b = 0; b < cfg->numOfBlocks; b++)
+    {
+        address[b] = count;
+        if(!cfg->blocks[b].removed) count += cfg->blocks[b].numOfIns;
+    }
+    address[cfg->numOfBlocks] = count;
+
+    count = 0;
+    for(b = 0; b < cfg->numOfBlocks; b++)
+    {
+        const BasicBlock* block = &cfg->blocks[b];
+        if(block->removed) continue;
+
+        for(int i = 0; i < block->numOfIns; i++)
+        {
+            Instruction ins = block->code[i];
+            if(isBlockReference(&ins)) ins.m = address[ins.m];
+
+            (*code)[count++] = ins;
+        }
+    }
+
+    free(address);
+    return numOfIns;
+}
+
+int countInstructions(const ControlFlowGraph* cfg)
+{
+    int b, count = 0;
+
+    for(b = 0; b < cfg->numOfBlocks; b++)
+        if(!cfg->blocks[b].removed) count += cfg->blocks[b].numOfIns;
+
+    return count;
+}
+
+int nextBlock(const ControlFlowGraph* cfg, int block)
+{
+    int b = block + 1;
+
+    while(b < cfg->numOfBlocks && cfg->blocks[b].removed) b++;
+
+    return b;
+}
+
+int hasBlockTarget(const BasicBlock* block)
+{
+    return block->numOfIns > 0 && isBlockReference(&block->code[block->numOfIns - 1]);
+}
+
+int blockSuccessors(const ControlFlowGraph* cfg, int block, int succ[2])
+{
+    const BasicBlock* b = &cfg->blocks[block];
+    int count = 0;
+
+    if(b->numOfIns > 0)
+    {
+        const Instruction* last = &b->code[b->numOfIns - 1];
+
+        if(last->op == JMP || last->op == JPC) succ[count++] = last->m;
+        if(last->op == JMP || last->op == RTN || last->op == SIO_HALT) return count;
+    }
+
+    int next = nextBlock(cfg, block);
+    if(next < cfg->numOfBlocks) succ[count++] = next;
+
+    return count;
+}
+
+int insertBlock(ControlFlowGraph* cfg, int before)
+{
+    if(addBlock(cfg) < 0) return -1;
+
+    memmove(&cfg->blocks[before + 1], &cfg->blocks[before],
+        (cfg->numOfBlocks - 1 - before) * sizeof(BasicBlock));
+
+    BasicBlock* block = &cfg->blocks[before];
+    block->code = NULL;
+    block->numOfIns = 0;
+    block->capacity = 0;
+    block->removed = 0;
+
+    int b;
+    for(b = 0; b < cfg->numOfBlocks; b++)
+    {
+        for(int i = 0; i < cfg->blocks[b].numOfIns; i++)
+        {
+            Instruction* ins = &cfg->blocks[b].code[i];
+            if(isBlockReference(ins) && ins->m >= before) ins->m++;
+        }
+    }
+
+    return before;
+}
+
+int procedureMayWrite(const Procedure* procedure, FrameCell cell)
+{
+    int i;
+
+    for(i = 0; i < procedure->numOfWrites; i++)
+    {
+        if(procedure->writes[i].level == cell.level && procedure->writes[i].offset == cell.offset)
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Adds the given cell to what the procedure could write, if it is not there
+ * yet. Returns 1 if it is added, 0 if it was there, and -1 if no memory could
+ * be allocated.
+ * */
+int addWrite(ProcedureInfo* info, Procedure* procedure, FrameCell cell)
+{
+    if(procedureMayWrite(procedure, cell)) return 0;
+
+    if(procedure->numOfWrites == procedure->writesCapacity)
+    {
+        int capacity = procedure->writesCapacity ? procedure->writesCapacity * 2 : 8;
+        FrameCell* writes = arenaGrow(info->arena, procedure->writes,
+            procedure->writesCapacity * sizeof(FrameCell), capacity * sizeof(FrameCell));
+
+        if(!writes) return -1;
+
+        procedure->writes = writes;
+        procedure->writesCapacity = capacity;
+    }
+
+    procedure->writes[procedure->numOfWrites++] = cell;
+    return 1;
+}
+
+/**
+ * Adds the given procedure to the ones the other calls. Returns 0 on success,
+ * -1 if no memory could be allocated.
+ * */
+int addCallee(ProcedureInfo* info, Procedure* procedure, int callee)
+{
+    int i;
+    for(i = 0; i < procedure->numOfCallees; i++)
+        if(procedure->callees[i] == callee) return 0;
+
+    if(procedure->numOfCallees == procedure->calleesCapacity)
+    {
+        int capacity = procedure->calleesCapacity ? procedure->calleesCapacity * 2 : 4;
+        int* callees = arenaGrow(info->arena, procedure->callees,
+            procedure->calleesCapacity * sizeof(int), capacity * sizeof(int));
+
+        if(!callees) return -1;
+
+        procedure->callees = callees;
+        procedure->calleesCapacity = capacity;
+    }
+
+    procedure->callees[procedure->numOfCallees++] = callee;
+    return 0;
+}
+
+/**
+ * Returns the procedure entered at the given block at the given level, adding
+ * it if there is none yet. Returns -1 if it is entered at another level too,
+ * or if no memory could be allocated.
+ * */
+int procedureEnteredAt(ProcedureInfo* info, int entry, int level)
+{
+    if(info->procedureAt[entry] >= 0)
+    {
+        int p = info->procedureAt[entry];
+        return info->procedures[p].level == level ? p : -1;
+    }
+
+    if(info->numOfProcedures == info->capacity)
+    {
+        int capacity = info->capacity ? info->capacity * 2 : 8;
+        Procedure* procedures = arenaGrow(info->arena, info->procedures,
+            info->capacity * sizeof(Procedure), capacity * sizeof(Procedure));
+
+        if(!procedures) return -1;
+
+        info->procedures = procedures;
+        info->capacity = capacity;
+    }
+
+    Procedure* procedure = &info->procedures[info->numOfProcedures];
+    memset(procedure, 0, sizeof(Procedure));
+    procedure->entry = entry;
+    procedure->level = level;
+
+    info->procedureAt[entry] = info->numOfProcedures;
+    return info->numOfProcedures++;
+}
+
+/**
+ * Visits the blocks of the given procedure, and records what its own
+ * instructions write and which procedures it calls. visited is scratch space,
+ * and stack has room for every block.
+ * */
+int visitProcedure(const ControlFlowGraph* cfg, ProcedureInfo* info, int p, int* visited, int* stack)
+{
+    int entry = info->procedures[p].entry;
+    int level = info->procedures[p].level;
+    int top = 0;
+
+    stack[top++] = entry;
+    visited[entry] = p;
+
+    while(top > 0)
+    {
+        int b = stack[--top];
+        const BasicBlock* block = &cfg->blocks[b];
+
+        if(info->levelOf[b] >= 0 && info->levelOf[b] != level) return -1;
+        info->levelOf[b] = level;
+        info->procedureOf[b] = (info->procedureOf[b] == -1) ? p : -2;
+
+        for(int i = 0; i < block->numOfIns; i++)
+        {
+            const Instruction* ins = &block->code[i];
+
+            if(ins->op == CAL)
+            {
+                if(ins->m >= cfg->numOfBlocks) return -1;
+
+                int callee = procedureEnteredAt(info, ins->m, level - ins->l + 1);
+                if(callee < 0 || addCallee(info, &info->procedures[p], callee)) return -1;
+            }
+            else
+            {
+                info->procedures[p].clobbers |= instructionDefs(ins);
+            }
+
+            // A cell of its own frame is not one of a caller
+            if(ins->op == STO && ins->l > 0)
+            {
+                FrameCell cell = { level - ins->l, ins->m };
+                if(addWrite(info, &info->procedures[p], cell) < 0) return -1;
+            }
+        }
+
+        int succ[2];
+        int n = blockSuccessors(cfg, b, succ);
+
+        while(n--)
+        {
+            if(visited[succ[n]] == p) continue;
+
+            visited[succ[n]] = p;
+            stack[top++] = succ[n];
+        }
+    }
+
+    return 0;
+}
+
+int analyzeProcedures(const ControlFlowGraph* cfg, Arena* arena, ProcedureInfo* info)
+{
+    int n = cfg->numOfBlocks;
+
+    info->procedures = NULL;
+    info->numOfProcedures = 0;
+    info->capacity = 0;
+    info->arena = arena;
+    info->procedureAt = arenaAlloc(arena, (n + 1) * sizeof(int));
+    info->levelOf = arenaAlloc(arena, (n + 1) * sizeof(int));
+    info->procedureOf = arenaAlloc(arena, (n + 1) * sizeof(int));
+
+    int* visited = malloc((n + 1) * sizeof(int));
+    int* stack = malloc((n + 1) * sizeof(int));
+
+    int b, p, err = 0;
+
+    if(!info->procedureAt || !info->levelOf || !info->procedureOf || !visited || !stack) err = -1;
+
+    for(b = 0; b <= n && !err; b++)
+    {
+        info->procedureAt[b] = -1;
+        info->levelOf[b] = -1;
+        info->procedureOf[b] = -1;
+        visited[b] = -1;
+    }
+
+    if(!err && n > 0 && procedureEnteredAt(info, 0, 0) < 0) err = -1;
+
+    // The procedures are added as they are found to be called
+    for(p = 0; p < info->numOfProcedures && !err; p++)
+        err = visitProcedure(cfg, info, p, visited, stack);
+
+    // What a procedure calls could write is what it could write, until
+    // .. nothing is added; the cells of its own frame and above are not
+    int changed = 1;
+    while(changed && !err)
+    {
+        changed = 0;
+
+        for(p = 0; p < info->numOfProcedures && !err; p++)
+        {
+            Procedure* procedure = &info->procedures[p];
+
+            for(int c = 0; c < procedure->numOfCallees && !err; c++)
+            {
+                const Procedure* callee = &info->procedures[procedure->callees[c]];
+
+                if((procedure->clobbers | callee->clobbers) != procedure->clobbers)
+                {
+                    procedure->clobbers |= callee->clobbers;
+                    changed = 1;
+                }
+
+                for(int w = 0; w < callee->numOfWrites; w++)
+                {
+                    if(callee->writes[w].level >= procedure->level) continue;
+
+                    int added = addWrite(info, procedure, callee->writes[w]);
+                    if(added < 0) err = -1;
+                    if(added > 0) changed = 1;
+                }
+            }
+        }
+    }
+
+    free(visited);
+    free(stack);
+    return err;
+}
+
+const Procedure* calledProcedure(const ProcedureInfo* info, const Instruction* cal)
+{
+    int p = info->procedureAt[cal->m];
+
+    return p >= 0 ? &info->procedures[p] : NULL;
+}
@@ -0,0 +1,190 @@
+#ifndef __IR_H__
+#define __IR_H__
+
+#include "data.h"
+#include "arena.h"
+
+/**
+ * Intermediate representation the optimizer works on: the PM/0 code of the
+ * front end split into basic blocks, with the control flow between them.
+ *
+ * A block starts at the target of a JMP, JPC or CAL, or right after a JMP,
+ * JPC, CAL, RTN or SIO_HALT, and ends with the first of those. The m field of
+ * the JMP, JPC and CAL of a block is the index of the block it goes to, not a
+ * code address. A block that does not end with JMP, RTN or SIO_HALT falls
+ * through to the next block in the layout that is not removed; so does a CAL,
+ * which RTN returns to.
+ *
+ * The blocks are laid out in their order in the array, which is the order
+ * lowerControlFlowGraph() emits them in. A removed block stays in the array,
+ * so that the indices of the others do not change, but nothing jumps to it and
+ * it is not emitted.
+ * */
+
+/**
+ * The number of registers of the virtual machine. Code using a register out of
+ * range is not turned into a graph.
+ * */
+#define IR_REGISTER_COUNT 16
+
+/**
+ * Set of registers, bit i for register i.
+ * */
+typedef unsigned int RegisterSet;
+
+#define IR_ALL_REGISTERS ((RegisterSet)((1u << IR_REGISTER_COUNT) - 1))
+
+typedef struct {
+    Instruction* code; // the instructions of the block, allocated from the arena
+    int numOfIns;
+    int capacity;
+    int removed;       // not part of the graph anymore
+} BasicBlock;
+
+typedef struct {
+    BasicBlock* blocks; // blocks[0] is the entry of the program
+    int numOfBlocks;
+    int capacity;
+    Arena* arena;       // the blocks and their instructions are allocated from it
+} ControlFlowGraph;
+
+/**
+ * Builds the graph of the numOfIns instructions of the given code, allocating
+ * it from the given arena, which should outlive the graph. Returns 0 on
+ * success, or -1 if the code could not be represented: a jump out of the code,
+ * a register out of range, or no memory. The code itself is not changed.
+ * */
+int buildControlFlowGraph(const Instruction* code, int numOfIns, Arena* arena, ControlFlowGraph* cfg);
+
+/**
+ * Emits the blocks of the graph that are not removed, in their order, turning
+ * block indices back into code addresses. Sets code to the array of emitted
+ * instructions, which should be freed by the caller, and returns the number of
+ * instructions, or -1 if the array could not be allocated.
+ * */
+int lowerControlFlowGraph(const ControlFlowGraph* cfg, Instruction** code);
+
+/**
+ * Returns the number of instructions in the blocks that are not removed.
+ * */
+int countInstructions(const ControlFlowGraph* cfg);
+
+/**
+ * Returns the block that the given block falls through to: the next one in
+ * the layout that is not removed, or numOfBlocks if there is none.
+ * */
+int nextBlock(const ControlFlowGraph* cfg, int block);
+
+/**
+ * Returns whether the last instruction of the given block jumps (JMP, JPC) or
+ * calls (CAL) to another block.
+ * */
+int hasBlockTarget(const BasicBlock* block);
+
+/**
+ * Writes the successors of the given block within its procedure into succ and
+ * returns how many there are, at most 2: what JMP or JPC goes to, and the
+ * block it falls through to. The procedure CAL goes to is not a successor;
+ * its RTN returns to the block following the CAL, which is.
+ * */
+int blockSuccessors(const ControlFlowGraph* cfg, int block, int succ[2]);
+
+/**
+ * Returns whether the m field of the given instruction is a block index.
+ * */
+int isBlockReference(const Instruction* ins);
+
+/**
+ * Registers the given instruction reads and writes. CAL is taken to write
+ * every register, as the procedure it calls could, and to read none, since the
+ * code generator passes nothing to a procedure in registers.
+ * */
+RegisterSet instructionUses(const Instruction* ins);
+RegisterSet instructionDefs(const Instruction* ins);
+
+/**
+ * Removes the instruction at the given index of the block.
+ * */
+void removeInstruction(BasicBlock* block, int index);
+
+/**
+ * Appends the given instruction to the block. Returns 0 on success, -1 if no
+ * memory could be allocated.
+ * */
+int appendInstruction(ControlFlowGraph* cfg, BasicBlock* block, Instruction ins);
+
+/**
+ * Makes the given block removed, and drops its instructions.
+ * */
+void removeBlock(BasicBlock* block);
+
+/**
+ * Inserts an empty block in the layout right before the given block, which
+ * the blocks falling through to the given block fall through to instead. The
+ * blocks from the given one on are moved one index up, and the JMP, JPC and
+ * CAL going to them are rewritten. Returns the index of the new block, or -1
+ * if no memory could be allocated.
+ * */
+int insertBlock(ControlFlowGraph* cfg, int before);
+
+/**
+ * A cell of a frame on the static chain: the level the frame is at, 0 for the
+ * main program, and the offset of the cell in the frame.
+ * */
+typedef struct {
+    int level;
+    int offset;
+} FrameCell;
+
+/**
+ * A procedure of the program, or the main program. Its blocks are the ones
+ * reached from its entry without following a CAL.
+ * entry   : the block CAL goes to, 0 for the main program
+ * level   : the level its blocks run at, 0 for the main program
+ * clobbers: the registers it, or a procedure it calls, could write
+ * writes  : the cells it, or a procedure it calls, could write in the frames
+ *           of the levels below its own. Those frames are the ones on the
+ *           static chain of the caller, so these are all the cells a call
+ *           could change that the caller could read.
+ * */
+typedef struct {
+    int entry;
+    int level;
+    RegisterSet clobbers;
+    FrameCell* writes;
+    int numOfWrites;
+    int writesCapacity;
+    int* callees;
+    int numOfCallees;
+    int calleesCapacity;
+} Procedure;
+
+typedef struct {
+    Procedure* procedures;
+    int numOfProcedures;
+    int capacity;
+    int* procedureAt; // the procedure entered at each block, -1 if none
+    int* levelOf;     // the level each block runs at, -1 if not reached
+    int* procedureOf; // the procedure each block is in, -1 if none, -2 if more than one
+    Arena* arena;
+} ProcedureInfo;
+
+/**
+ * Finds the procedures of the graph, starting from the main program and
+ * following the CALs, and what each of them could write, allocating them from
+ * the given arena. Returns 0 on success, or -1 if a block is reached at two
+ * levels, a CAL goes out of the graph, or no memory could be allocated.
+ * */
+int analyzeProcedures(const ControlFlowGraph* cfg, Arena* arena, ProcedureInfo* info);
+
+/**
+ * Returns the procedure the given CAL calls, or NULL if it is not known.
+ * */
+const Procedure* calledProcedure(const ProcedureInfo* info, const Instruction* cal);
+
+/**
+ * Returns whether the given procedure could write the given cell.
+ * */
+int procedureMayWrite(const Procedure* procedure, FrameCell cell);
+
+#endif
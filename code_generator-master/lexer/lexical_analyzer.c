@@ -0,0 +1,973 @@
+#include "lexical_analyzer.h"
+#include "data.h"
+#include "token.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h> // Declares isalpa, isdigit, isalnum
+
+/**
+ * Runs of whitespace and of letters and digits are scanned a vector at a time
+ * where the compiler targets SSE2, AVX2 or AArch64 NEON. Define LEXER_NO_SIMD
+ * to scan them a character at a time instead.
+ * */
+#if defined(__GNUC__) && !defined(LEXER_NO_SIMD) && defined(__AVX2__)
+#define LEXER_SIMD_WIDTH 32
+#include <immintrin.h>
+#elif defined(__GNUC__) && !defined(LEXER_NO_SIMD) && defined(__SSE2__)
+#define LEXER_SIMD_WIDTH 16
+#include <emmintrin.h>
+#elif defined(__GNUC__) && !defined(LEXER_NO_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+#define LEXER_SIMD_WIDTH 16
+#include <arm_neon.h>
+#else
+#define LEXER_SIMD_WIDTH 0
+#endif
+
+/* ************************************************************************** */
+/* Enumarations, Typename Aliases, Helpers Structs ************************** */
+/* ************************************************************************** */
+
+typedef enum {
+    ALPHA,   // a, b, .. , z, A, B, .. Z
+    DIGIT,   // 0, 1, .. , 9
+    SPECIAL, // '>', '=', , .. , ';', ':'
+    INVALID  // Invalid symbol
+} SymbolType;
+
+/**
+ * The SymbolType of each character, indexed by the character as unsigned char.
+ * Only the ASCII letters and digits are ALPHA and DIGIT, as isalpha() and
+ * .. isdigit() classify them in the C locale.
+ * */
+const unsigned char symbolTypes[256] = {
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0x00 .. 0x07 */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0x08 .. 0x0F */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0x10 .. 0x17 */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0x18 .. 0x1F */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0x20 .. 0x27 */
+    SPECIAL,  SPECIAL,  SPECIAL,  SPECIAL,  SPECIAL,  SPECIAL,  SPECIAL,  SPECIAL,   /* '(' .. '/' */
+    DIGIT,    DIGIT,    DIGIT,    DIGIT,    DIGIT,    DIGIT,    DIGIT,    DIGIT,     /* '0' .. '7' */
+    DIGIT,    DIGIT,    SPECIAL,  SPECIAL,  SPECIAL,  SPECIAL,  SPECIAL,  INVALID,   /* '8' .. '?' */
+    INVALID,  ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,     /* '@' .. 'G' */
+    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,     /* 'H' .. 'O' */
+    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,     /* 'P' .. 'W' */
+    ALPHA,    ALPHA,    ALPHA,    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 'X' .. '_' */
+    INVALID,  ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,     /* '`' .. 'g' */
+    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,     /* 'h' .. 'o' */
+    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,    ALPHA,     /* 'p' .. 'w' */
+    ALPHA,    ALPHA,    ALPHA,    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 'x' .. 0x7F */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0x80 .. 0x87 */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0x88 .. 0x8F */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0x90 .. 0x97 */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0x98 .. 0x9F */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0xA0 .. 0xA7 */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0xA8 .. 0xAF */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0xB0 .. 0xB7 */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0xB8 .. 0xBF */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0xC0 .. 0xC7 */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0xC8 .. 0xCF */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0xD0 .. 0xD7 */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0xD8 .. 0xDF */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0xE0 .. 0xE7 */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0xE8 .. 0xEF */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0xF0 .. 0xF7 */
+    INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,  INVALID,   /* 0xF8 .. 0xFF */
+};
+
+/**
+ * A reserved word and its token, as an entry of the keyword hash table.
+ * */
+typedef struct {
+    const char* lexeme;
+    int length;
+    int id;
+} Keyword;
+
+/**
+ * The reserved words made of letters, placed by hashKeyword(). The hash has
+ * .. no collisions on this set, so a word is a reserved word only if it is the
+ * .. one in its slot.
+ * */
+#define KEYWORD_TABLE_SIZE 16
+#define MIN_KEYWORD_LENGTH 2
+#define MAX_KEYWORD_LENGTH 9
+
+const Keyword keywordTable[KEYWORD_TABLE_SIZE] = {
+    [ 0] = { "if",        2, ifsym     },
+    [ 1] = { "procedure", 9, procsym   },
+    [ 2] = { "else",      4, elsesym   },
+    [ 3] = { "const",     5, constsym  },
+    [ 4] = { "read",      4, readsym   },
+    [ 5] = { "begin",     5, beginsym  },
+    [ 6] = { "do",        2, dosym     },
+    [ 7] = { "write",     5, writesym  },
+    [ 9] = { "end",       3, endsym    },
+    [10] = { "call",      4, callsym   },
+    [11] = { "var",       3, varsym    },
+    [12] = { "then",      4, thensym   },
+    [13] = { "odd",       3, oddsym    },
+    [15] = { "while",     5, whilesym  },
+};
+
+/* ************************************************************************** */
+/* Declarations ************************************************************* */
+/* ************************************************************************** */
+
+/**
+ * Returns the character at the given offset from the character currently
+ * .. being processed, or '\0' if it is past the end of the source code.
+ * */
+char peekChar(LexerState*, int offset);
+
+/**
+ * Sets the given token as the token recognized by the current lexNextToken().
+ * */
+void setToken(LexerState*, Token);
+
+/**
+ * Sets a token with the given id, whose lexeme is the given length characters
+ * .. of the source code starting at the given index, as the token recognized.
+ * */
+void setSourceToken(LexerState*, int id, int start, int length);
+
+/**
+ * Consumes the spaces and new lines starting from the character currently
+ * .. being processed, advancing the line number for each new line.
+ * */
+void skipWhitespace(LexerState*);
+
+/**
+ * Consumes the letters and digits starting from the character currently
+ * .. being processed. Returns the number of characters consumed.
+ * */
+int scanAlnum(LexerState*);
+
+/**
+ * Returns 1 if the given character is valid.
+ * Returns 0 otherwise.
+ * */
+int isCharacterValid(char);
+
+/**
+ * Returns 1 if the given character is one of the special symbols of PL/0,
+ * .. such as '/', '=', ':' or ';'.
+ * Returns 0 otherwise.
+ * */
+int isSpecialSymbol(char);
+
+/**
+ * Returns the symbol type of the given character.
+ * */
+SymbolType getSymbolType(char);
+
+/**
+ * Returns the slot of the given word of the given length in keywordTable.
+ * The length should be at least MIN_KEYWORD_LENGTH.
+ * */
+int hashKeyword(const char* word, int length);
+
+/**
+ * Checks if the given symbol of the given length, which is made of letters and
+ * .. digits, is one of the reserved words.
+ * If yes, returns the numerical value assigned to the corresponding token.
+ * If not, returns -1.
+ * For example, calling the function with symbol "const" returns 28.
+ * */
+int checkReservedTokens(const char* symbol, int length);
+
+/**
+ * Deterministic-finite-automaton to be entered when an alpha character is seen.
+ * Simulating a state machine, consumes the source code and changes the state
+ * .. of the lexer (LexerState) as required. Possibly, sets the token
+ * .. recognized, see setToken().
+ * If an error is encountered, sets the LexErr field of LexerState, sets the
+ * .. line number field and returns.
+ * */
+void DFA_Alpha(LexerState*);
+
+/**
+ * Deterministic-finite-automaton to be entered when a digit character is seen.
+ * Simulating a state machine, consumes the source code and changes the state
+ * .. of the lexer (LexerState) as required. Possibly, sets the token
+ * .. recognized, see setToken().
+ * If an error is encountered, sets the LexErr field of LexerState, sets the
+ * .. line number field and returns.
+ * */
+void DFA_Digit(LexerState*);
+
+/**
+ * Deterministic-finite-automaton to be entered when a special character is seen.
+ * Simulating a state machine, consumes the source code and changes the state
+ * .. of the lexer (LexerState) as required. Possibly, sets the token
+ * .. recognized, see setToken().
+ * If an error is encountered, sets the LexErr field of LexerState, sets the
+ * .. line number field and returns.
+ * */
+void DFA_Special(LexerState*);
+
+/* ************************************************************************** */
+/* Definitions ************************************************************** */
+/* ************************************************************************** */
+
+void initLexerState(LexerState* lexerState, const char* sourceCode, size_t length)
+{
+    lexerState->lineNum = 0;
+    lexerState->charInd = 0;
+    lexerState->sourceCode = sourceCode;
+    lexerState->length = sourceCode ? (int)length : 0;
+    lexerState->lexerError = NONE;
+    lexerState->hasToken = 0;
+}
+
+char peekChar(LexerState* lexerState, int offset)
+{
+    int i = lexerState->charInd + offset;
+
+    return i < lexerState->length ? lexerState->sourceCode[i] : '\0';
+}
+
+void setToken(LexerState* lexerState, Token token)
+{
+    lexerState->token = token;
+    lexerState->hasToken = 1;
+}
+
+void setSourceToken(LexerState* lexerState, int id, int start, int length)
+{
+    Token token;
+    token.id = id;
+
+    // The lexeme is copied right from the source code, which is not null
+    // .. terminated
+    memcpy(token.lexeme, lexerState->sourceCode + start, length);
+    token.lexeme[length] = '\0';
+
+    setToken(lexerState, token);
+}
+
+#if LEXER_SIMD_WIDTH
+
+/**
+ * For the LEXER_SIMD_WIDTH characters starting at p, whitespaceMask() returns
+ * .. a mask with bit i set if p[i] is a space or a new line, and sets
+ * .. *newlines to the mask of the new lines only. alnumMask() returns the
+ * .. mask of the letters and digits. The characters are read in one go, so
+ * .. all of them should be in the source code.
+ * */
+#if LEXER_SIMD_WIDTH == 32
+
+static inline unsigned int whitespaceMask(const char* p, unsigned int* newlines)
+{
+    __m256i v = _mm256_loadu_si256((const __m256i*)p);
+    __m256i nl = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+    __m256i sp = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+
+    *newlines = (unsigned int)_mm256_movemask_epi8(nl);
+    return (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(nl, sp));
+}
+
+static inline unsigned int alnumMask(const char* p)
+{
+    __m256i v = _mm256_loadu_si256((const __m256i*)p);
+
+    // (c | 0x20) - 'a' <= 'z' - 'a' for letters, c - '0' <= 9 for digits,
+    // .. compared as unsigned through min
+    __m256i letter = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    __m256i digit = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+
+    letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8('z' - 'a')), letter);
+    digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+
+    return (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(letter, digit));
+}
+
+#elif defined(__SSE2__)
+
+static inline unsigned int whitespaceMask(const char* p, unsigned int* newlines)
+{
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    __m128i nl = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+    __m128i sp = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+
+    *newlines = (unsigned int)_mm_movemask_epi8(nl);
+    return (unsigned int)_mm_movemask_epi8(_mm_or_si128(nl, sp));
+}
+
+static inline unsigned int alnumMask(const char* p)
+{
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+
+    // (c | 0x20) - 'a' <= 'z' - 'a' for letters, c - '0' <= 9 for digits,
+    // .. compared as unsigned through min
+    __m128i letter = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i digit = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+
+    letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8('z' - 'a')), letter);
+    digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+
+    return (unsigned int)_mm_movemask_epi8(_mm_or_si128(letter, digit));
+}
+
+#else
+
+/**
+ * NEON has no movemask: the lanes of the comparison are weighted by their bit
+ * .. and summed in each half.
+ * */
+static inline unsigned int neonMask(uint8x16_t cmp)
+{
+    static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t bits = vandq_u8(cmp, vld1q_u8(weights));
+
+    return (unsigned int)vaddv_u8(vget_low_u8(bits)) | ((unsigned int)vaddv_u8(vget_high_u8(bits)) << 8);
+}
+
+static inline unsigned int whitespaceMask(const char* p, unsigned int* newlines)
+{
+    uint8x16_t v = vld1q_u8((const uint8_t*)p);
+    uint8x16_t nl = vceqq_u8(v, vdupq_n_u8('\n'));
+    uint8x16_t sp = vceqq_u8(v, vdupq_n_u8(' '));
+
+    *newlines = neonMask(nl);
+    return neonMask(vorrq_u8(nl, sp));
+}
+
+static inline unsigned int alnumMask(const char* p)
+{
+    uint8x16_t v = vld1q_u8((const uint8_t*)p);
+    uint8x16_t letter = vsubq_u8(vorrq_u8(v, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+    uint8x16_t digit = vsubq_u8(v, vdupq_n_u8('0'));
+
+    return neonMask(vorrq_u8(vcleq_u8(letter, vdupq_n_u8('z' - 'a')), vcleq_u8(digit, vdupq_n_u8(9))));
+}
+
+#endif
+
+/**
+ * The mask of a vector whose characters all match.
+ * */
+#define LEXER_SIMD_FULL_MASK ((unsigned int)((1ull << LEXER_SIMD_WIDTH) - 1))
+
+#endif
+
+void skipWhitespace(LexerState* lexerState)
+{
+#if LEXER_SIMD_WIDTH
+    // A vector at a time while a whole vector is left in the source code
+    while(lexerState->charInd + LEXER_SIMD_WIDTH <= lexerState->length)
+    {
+        unsigned int newlines;
+        unsigned int whitespace = whitespaceMask(lexerState->sourceCode + lexerState->charInd, &newlines);
+
+        if(whitespace == LEXER_SIMD_FULL_MASK)
+        {
+            lexerState->lineNum += __builtin_popcount(newlines);
+            lexerState->charInd += LEXER_SIMD_WIDTH;
+            continue;
+        }
+
+        // Only the new lines before the first other character are consumed
+        int run = __builtin_ctz(~whitespace);
+
+        lexerState->lineNum += __builtin_popcount(newlines & ((1u << run) - 1));
+        lexerState->charInd += run;
+        return;
+    }
+#endif
+
+    // The last characters one at a time
+    char c = peekChar(lexerState, 0);
+
+    while(c == ' ' || c == '\n')
+    {
+        // Advance line number if required
+        if(c == '\n')
+            lexerState->lineNum++;
+
+        // Advance to the following character
+        lexerState->charInd++;
+        c = peekChar(lexerState, 0);
+    }
+}
+
+int scanAlnum(LexerState* lexerState)
+{
+    int start = lexerState->charInd;
+
+#if LEXER_SIMD_WIDTH
+    // A vector at a time while a whole vector is left in the source code
+    while(lexerState->charInd + LEXER_SIMD_WIDTH <= lexerState->length)
+    {
+        unsigned int alnum = alnumMask(lexerState->sourceCode + lexerState->charInd);
+
+        if(alnum != LEXER_SIMD_FULL_MASK)
+        {
+            lexerState->charInd += __builtin_ctz(~alnum);
+            return lexerState->charInd - start;
+        }
+
+        lexerState->charInd += LEXER_SIMD_WIDTH;
+    }
+#endif
+
+    // The last characters one at a time
+    while(getSymbolType(peekChar(lexerState, 0)) <= DIGIT)
+        lexerState->charInd++;
+
+    return lexerState->charInd - start;
+}
+
+int isCharacterValid(char c)
+{
+    return isalnum(c) || isspace(c) || isSpecialSymbol(c);
+}
+
+int isSpecialSymbol(char c)
+{
+    return symbolTypes[(unsigned char)c] == SPECIAL;
+}
+
+SymbolType getSymbolType(char c)
+{
+    return (SymbolType)symbolTypes[(unsigned char)c];
+}
+
+int hashKeyword(const char* word, int length)
+{
+    return (6 * (unsigned char)word[0] + 4 * (unsigned char)word[1] + length) & (KEYWORD_TABLE_SIZE - 1);
+}
+
+int checkReservedTokens(const char* symbol, int length)
+{
+    if(length < MIN_KEYWORD_LENGTH || length > MAX_KEYWORD_LENGTH)
+        return -1;
+
+    const Keyword* keyword = &keywordTable[hashKeyword(symbol, length)];
+
+    // The only reserved word that could be the symbol is in its slot
+    if( keyword->lexeme && keyword->length == length &&
+        !memcmp(keyword->lexeme, symbol, length) )
+    {
+        return keyword->id;
+    }
+
+    // Symbol is not found among the reserved tokens
+    return -1;
+}
+
+
+/**
+ * Deterministic-finite-automaton to be entered when an alpha character is seen.
+ * Simulating a state machine, consumes the source code and changes the state
+ * .. of the lexer (LexerState) as required. Possibly, sets the token
+ * .. recognized, see setToken().
+ * If an error is encountered, sets the LexErr field of LexerState, sets the
+ * .. line number field and returns.
+ * */
+void DFA_Alpha(LexerState* lexerState)
+{
+    // There are two possible cases for symbols starting with alpha:
+    // Case.1) A reversed token (a reserved word or 'odd')
+    // Case.2) An ident
+
+    // In both cases, symbol should not exceed 11 characters.
+    // Read 11 or less alpha-numeric characters
+    // If it exceeds 11 alnums, fill LexerState error and return
+    // Otherwise, try to recognize if the symbol is reserved.
+    //   If yes, tokenize by one of the reserved symbols
+    //   If not, tokenize as ident.
+
+    // For recognizing a token, you could create a token, fill its fields as
+    // .. required and use the following call:
+    // setToken(lexerState, token);
+
+	int start = lexerState->charInd;
+	
+	// while the next char is alphanumeric or a digit
+	// .. we must consider it as one lexeme
+	int length = scanAlnum(lexerState);
+	
+	// check is lexeme is greater than 11 characters
+	if (length > MAX_IDENTIFIER_LENGTH)
+	{
+		// fill LexerState error and return
+		lexerState->lexerError = NAME_TOO_LONG;
+		return;
+	}
+	
+	//check if lexeme is a reserved word, in the source code
+	int reservedToken = checkReservedTokens(lexerState->sourceCode + start, length);
+	
+	// add the lexeme as it is in the source code
+	setSourceToken(lexerState, reservedToken != -1 ? reservedToken : identsym, start, length);
+
+    return;
+}
+
+
+/**
+ * Deterministic-finite-automaton to be entered when a digit character is seen.
+ * Simulating a state machine, consumes the source code and changes the state
+ * .. of the lexer (LexerState) as required. Possibly, sets the token
+ * .. recognized, see setToken().
+ * If an error is encountered, sets the LexErr field of LexerState, sets the
+ * .. line number field and returns.
+ * */
+void DFA_Digit(LexerState* lexerState)
+{
+    // There are three cases for symbols starting with number:
+    // Case.1) It is a well-formed number
+    // Case.2) It is an ill-formed number exceeding 5 digits - Lexer Error!
+    // Case.3) It is an ill-formed variable name starting with digit - Lexer Error!
+
+    // Tokenize as numbersym only if it is case 1. Otherwise, set the required
+    // .. fields of lexerState to corresponding LexErr and return.
+
+    // For recognizing a token, you could create a token, fill its fields as
+    // .. required and use the following call:
+    // setToken(lexerState, token);
+
+	int start = lexerState->charInd, firstAlpha = -1;
+	
+	// while the next char is alphanumeric or a digit
+	// .. we must consider it as one lexeme
+	int length = scanAlnum(lexerState);
+	
+	// make note of the first alpha character. Only the first 12 characters
+	// .. decide the error below
+	for (int i = 0; i < length && i <= MAX_LEXEME_LENGTH && firstAlpha == -1; i++)
+	{
+		if (getSymbolType(lexerState->sourceCode[start + i]) == ALPHA)
+		{
+			firstAlpha = i;
+		}
+	}
+	
+	// check if lexeme is a well-formed number. An alpha character seen
+	// .. after more than 11 digits makes it too long instead
+	if (firstAlpha != -1 && firstAlpha <= MAX_LEXEME_LENGTH)
+	{
+		// fill LexerState error and return
+		lexerState->lexerError = NONLETTER_VAR_INITIAL;
+		return;
+	}
+	
+	// check is lexeme is greater than 5 digits
+	if (length > MAX_NUM_DIGIT_LENGTH)
+	{
+		// fill LexerState error and return
+		lexerState->lexerError = NUM_TOO_LONG;
+		return;
+	}
+	
+	// add the number as it is in the source code
+	setSourceToken(lexerState, numbersym, start, length);
+	
+    return;
+}
+
+void DFA_Special(LexerState* lexerState)
+{
+    // There are three cases for symbols starting with special:
+    // Case.1: Beginning of a comment: "/*"
+    // Case.2: Two character special symbol: "<>", "<=", ">=", ":="
+    // Case.3: One character special symbol: "+", "-", "(", etc.
+
+    // For case.1, you are recommended to consume all the characters regarding
+    // .. the comment, and return. This way, lexicalAnalyzer() func can decide
+    // .. what to do with the next character.
+
+    // For case.2 and case.3, you could consume the characters, set the
+    // .. corresponding token as the one recognized by lexerState, and return.
+
+    // For recognizing a token, you could create a token, fill its fields as
+    // .. required and use the following call:
+    // setToken(lexerState, token);
+
+	int i = 0, exit = 0, reservedToken;
+	
+	// check for the two character symbols
+	// check for /*
+	if (peekChar(lexerState, 0) == '/')
+	{
+		//check to see if there is a following asterisk
+		if (peekChar(lexerState, 1) == '*')
+		{
+			lexerState->charInd++;
+			
+			// we need to move forward until we see a terminating */
+			while (exit == 0)
+			{
+				lexerState->charInd++;
+				
+				// an unterminated comment lasts until the end of the source code
+				if (lexerState->charInd >= lexerState->length)
+				{
+					return;
+				}
+				
+				// check for an additional asterisk
+				if (peekChar(lexerState, 0) == '*')
+				{
+					// check if next char is a '/'
+					if (peekChar(lexerState, 1) == '/')
+					{
+						// this is the end of the comment.
+						exit = 1;
+						
+						// move charInd to after the comment
+						// /* ... */ 
+						// _________^  this is where charIndex will now point
+						lexerState->charInd++;
+						lexerState->charInd++;
+						return;
+					}
+				}
+			}
+		}
+		// it is the slashsym
+		else
+		{
+			// create token
+			Token token;
+			token.id = slashsym;
+			strcpy(token.lexeme, "/");
+	
+			// set token as the one recognized
+			setToken(lexerState, token);
+		}
+	}
+	// check for <= and <>
+	else if (peekChar(lexerState, 0) == '<')
+	{
+		//check to see if there is a following =
+		if (peekChar(lexerState, 1) == '=')
+		{
+			// advance charInd
+			lexerState->charInd++;
+			
+			// create token
+			Token token;
+			token.id = leqsym;
+			strcpy(token.lexeme, "<=");
+	
+			// set token as the one recognized
+			setToken(lexerState, token);
+		}
+		else if (peekChar(lexerState, 1) == '>')
+		{
+			// advance charInd
+			lexerState->charInd++;
+			
+			// create token
+			Token token;
+			token.id = neqsym;
+			strcpy(token.lexeme, "<>");
+	
+			// set token as the one recognized
+			setToken(lexerState, token);
+		}
+		else
+		{
+			// create token
+			Token token;
+			token.id = lessym;
+			strcpy(token.lexeme, "<");
+	
+			// set token as the one recognized
+			setToken(lexerState, token);
+		}
+	}
+	// check for :=
+	else if (peekChar(lexerState, 0) == ':')
+	{
+		// check to see if there is a following =
+		if (peekChar(lexerState, 1) == '=')
+		{
+			// advance charInd
+			lexerState->charInd++;
+			
+			// create token
+			Token token;
+			token.id = becomessym;
+			strcpy(token.lexeme, ":=");
+	
+			// set token as the one recognized
+			setToken(lexerState, token);
+		}
+		else
+		{
+			// invalid symbol :
+			
+			// create token
+			/*Token token;
+			token.id = sym;
+			strcpy(token.lexeme, ":");
+	
+			// set token as the one recognized
+			setToken(lexerState, token);
+			*/
+		}
+	}
+	// check for >=
+	else if (peekChar(lexerState, 0) == '>')
+	{
+		// check to see if there is a following =
+		if (peekChar(lexerState, 1) == '=')
+		{
+			// advance charInd
+			lexerState->charInd++;
+			
+			// create token
+			Token token;
+			token.id = geqsym;
+			strcpy(token.lexeme, ">=");
+	
+			// set token as the one recognized
+			setToken(lexerState, token);
+		}
+		else
+		{
+			// create token
+			Token token;
+			token.id = gtrsym;
+			strcpy(token.lexeme, ">");
+	
+			// set token as the one recognized
+			setToken(lexerState, token);
+		}
+	}
+	// check for +
+	else if (peekChar(lexerState, 0) == '+')
+	{
+		// create token
+		Token token;
+		token.id = plussym;
+		strcpy(token.lexeme, "+");
+	
+		// set token as the one recognized
+		setToken(lexerState, token);
+	}
+	// check for )
+	else if (peekChar(lexerState, 0) == ')')
+	{
+		// create token
+		Token token;
+		token.id = rparentsym;
+		strcpy(token.lexeme, ")");
+	
+		// set token as the one recognized
+		setToken(lexerState, token);
+	}
+	// check for -
+	else if (peekChar(lexerState, 0) == '-')
+	{
+		// create token
+		Token token;
+		token.id = minussym;
+		strcpy(token.lexeme, "-");
+	
+		// set token as the one recognized
+		setToken(lexerState, token);
+	}
+	// check for =
+	else if (peekChar(lexerState, 0) == '=')
+	{
+		// create token
+		Token token;
+		token.id = eqsym;
+		strcpy(token.lexeme, "=");
+	
+		// set token as the one recognized
+		setToken(lexerState, token);
+	}
+	// check for ,
+	else if (peekChar(lexerState, 0) == ',')
+	{
+		// create token
+		Token token;
+		token.id = commasym;
+		strcpy(token.lexeme, ",");
+	
+		// set token as the one recognized
+		setToken(lexerState, token);
+	}
+	// check for * 
+	else if (peekChar(lexerState, 0) == '*')
+	{
+		// create token
+		Token token;
+		token.id = multsym;
+		strcpy(token.lexeme, "*");
+	
+		// set token as the one recognized
+		setToken(lexerState, token);
+	}
+	// check for ;
+	else if (peekChar(lexerState, 0) == ';')
+	{
+		// create token
+		Token token;
+		token.id = semicolonsym;
+		strcpy(token.lexeme, ";");
+	
+		// set token as the one recognized
+		setToken(lexerState, token);
+	}
+	// check for /
+	else if (peekChar(lexerState, 0) == '/')
+	{
+		// create token
+		Token token;
+		token.id = slashsym;
+		strcpy(token.lexeme, "/");
+	
+		// set token as the one recognized
+		setToken(lexerState, token);
+	}
+	// check for (
+	else if (peekChar(lexerState, 0) == '(')
+	{
+		// create token
+		Token token;
+		token.id = lparentsym;
+		strcpy(token.lexeme, "(");
+	
+		// set token as the one recognized
+		setToken(lexerState, token);
+	}
+	// check for .
+	else if (peekChar(lexerState, 0) == '.')
+	{
+		// create token
+		Token token;
+		token.id = periodsym;
+		strcpy(token.lexeme, ".");
+	
+		// set token as the one recognized
+		setToken(lexerState, token);
+	}
+	
+	lexerState->charInd++;
+	
+    return;
+}
+
+LexerOut lexicalAnalyzer(char* sourceCode, Arena* arena)
+{
+    if(!sourceCode)
+    {
+        fprintf(stderr, "ERROR: Null source code string passed to lexicalAnalyzer()\n");
+        
+        LexerOut lexerOut;
+        lexerOut.lexerError = NO_SOURCE_CODE;
+        lexerOut.errorLine = -1;
+        initTokenList(&lexerOut.tokenList, arena);
+
+        return lexerOut;
+    }
+
+    return lexicalAnalyzeBuffer(sourceCode, strlen(sourceCode), arena);
+}
+
+int lexNextToken(LexerState* lexerState, Token* token)
+{
+    lexerState->hasToken = 0;
+
+    // While no token is recognized, not end of file, and, there is no lexer
+    // .. error continue lexing. Comments are consumed without a token.
+    while( !lexerState->hasToken && lexerState->lexerError == NONE )
+    {
+        // Skip spaces or new lines until an effective character is seen
+        skipWhitespace(lexerState);
+
+        // After recognizing spaces or new lines, make sure that the EOF was
+        // .. not reached. If it was, there are no more tokens.
+        if(lexerState->charInd >= lexerState->length)
+        {
+            return 0;
+        }
+
+        // Take action depending on the current symbol's type
+        switch(getSymbolType(peekChar(lexerState, 0)))
+        {
+            case ALPHA:
+                DFA_Alpha(lexerState);
+                break;
+            case DIGIT:
+                DFA_Digit(lexerState);
+                break;
+            case SPECIAL:
+                DFA_Special(lexerState);
+                break;
+            case INVALID:
+                lexerState->lexerError = INV_SYM;
+                break;
+        }
+    }
+
+    if(lexerState->lexerError != NONE)
+        return 0;
+
+    *token = lexerState->token;
+    return 1;
+}
+
+LexerOut lexicalAnalyzeBuffer(const char* sourceCode, size_t length, Arena* arena)
+{
+    if(!sourceCode)
+    {
+        fprintf(stderr, "ERROR: Null source code passed to lexicalAnalyzeBuffer()\n");
+        
+        LexerOut lexerOut;
+        lexerOut.lexerError = NO_SOURCE_CODE;
+        lexerOut.errorLine = -1;
+        initTokenList(&lexerOut.tokenList, arena);
+
+        return lexerOut;
+    }
+
+    // Create & init lexer state
+    LexerState lexerState;
+    initLexerState(&lexerState, sourceCode, length);
+
+    // Lex the tokens one by one into the token list
+    TokenList tokenList;
+    initTokenList(&tokenList, arena);
+
+    Token token;
+
+    while( lexNextToken(&lexerState, &token) )
+    {
+        addToken(&tokenList, token);
+    }
+
+    // Prepare LexerOut to be returned
+    LexerOut lexerOut;
+
+    if(lexerState.lexerError != NONE)
+    {
+        // Set LexErr
+        lexerOut.lexerError = lexerState.lexerError;
+
+        // Set the number of line the error encountered
+        lexerOut.errorLine = lexerState.lineNum;
+
+        lexerOut.tokenList = tokenList;
+    }
+    else
+    {
+        // No error!
+        lexerOut.lexerError = NONE;
+        lexerOut.errorLine = -1;
+        
+        // The ownership of the tokenlist is being passed to LexerOut.
+        // .. Therefore, neither deletion of the tokenlist nor deep copying of
+        // .. the tokenlist is required.
+        lexerOut.tokenList = tokenList;
+    }
+
+    return lexerOut;
+}
@@ -0,0 +1,6 @@
+#include "lexical_analyzer.h"
+
+void deleteLexerOut(LexerOut* lexerOut)
+{
+    deleteTokenList(&lexerOut->tokenList);
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "source_code.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Source files are mapped into memory where mmap is available.
+ * */
+#if defined(__unix__) || defined(__APPLE__)
+#define SOURCE_CODE_HAVE_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#define SOURCE_CODE_HAVE_MMAP 0
+#endif
+
+char* readSourceCode(FILE * inp, Arena* arena)
+{
+    if(!inp)
+        return NULL;
+
+    // The space is doubled whenever it gets full, and the characters are
+    // .. read in chunks
+    size_t allocatedCharCount = 4096;
+    size_t charCount = 0;
+    char* sourceCode = (char*)arenaAlloc(arena, allocatedCharCount);
+
+    if(!sourceCode) return NULL;
+
+    while(1)
+    {
+        // Always leave room for the terminator character
+        if(charCount + 1 == allocatedCharCount)
+        {
+            sourceCode = (char*)arenaGrow(arena, sourceCode, allocatedCharCount, 2 * allocatedCharCount);
+            if(!sourceCode) return NULL;
+
+            allocatedCharCount *= 2;
+        }
+
+        size_t readCount = fread(sourceCode + charCount, 1, allocatedCharCount - 1 - charCount, inp);
+        if(readCount == 0) break;
+
+        charCount += readCount;
+    }
+
+    // An empty file has no source code
+    if(charCount == 0) return NULL;
+
+    // Put terminator character at the end
+    sourceCode[charCount] = '\0';
+
+    return sourceCode;
+}
+
+int mapSourceCode(FILE* inp, SourceCode* sourceCode, Arena* arena)
+{
+    sourceCode->text = NULL;
+    sourceCode->length = 0;
+    sourceCode->mapping = NULL;
+    sourceCode->mappingSize = 0;
+
+    if(!inp)
+        return -1;
+
+#if SOURCE_CODE_HAVE_MMAP
+    struct stat st;
+
+    // Map the whole file when reading it from the beginning
+    if( ftell(inp) == 0 && fstat(fileno(inp), &st) == 0 && S_ISREG(st.st_mode) &&
+        st.st_size > 0 )
+    {
+        void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(inp), 0);
+
+        if(mapping != MAP_FAILED)
+        {
+            sourceCode->mapping = mapping;
+            sourceCode->mappingSize = st.st_size;
+
+            sourceCode->text = (const char*)mapping;
+            sourceCode->length = st.st_size;
+
+            return 0;
+        }
+    }
+#endif
+
+    char* text = readSourceCode(inp, arena);
+
+    // An empty file has no source code
+    if(!text)
+        return -1;
+
+    sourceCode->text = text;
+    sourceCode->length = strlen(text);
+
+    return 0;
+}
+
+void unmapSourceCode(SourceCode* sourceCode)
+{
+#if SOURCE_CODE_HAVE_MMAP
+    if(sourceCode->mapping) munmap(sourceCode->mapping, sourceCode->mappingSize);
+#endif
+
+    sourceCode->text = NULL;
+    sourceCode->length = 0;
+    sourceCode->mapping = NULL;
+    sourceCode->mappingSize = 0;
+}
+
+void printSourceCode(char* sourceCode)
+{
+    if(!sourceCode)
+        return;
+
+    int i = 0;
+    while(sourceCode[i++] != '\0')
+    {
+        printf("%c", sourceCode[i]);
+    }
+}
\ No newline at end of file
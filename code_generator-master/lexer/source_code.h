@@ -0,0 +1,47 @@
+#ifndef __SOURCE_CODE_H__
+#define __SOURCE_CODE_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include "arena.h"
+
+/**
+ * Source code in memory, as given to lexicalAnalyzeBuffer(): length characters
+ * starting at text, not necessarily null terminated.
+ * mapping is the memory mapping of the file text points into, or NULL if the
+ * .. file was read into an arena instead.
+ * */
+typedef struct {
+    const char* text;
+    size_t length;
+    void* mapping;
+    size_t mappingSize;
+} SourceCode;
+
+/**
+ * Reads the source code from file until EOF to a null-terminated string,
+ * allocated from the given arena. The string is released with the arena.
+ * */
+char* readSourceCode(FILE*, Arena*);
+
+/**
+ * Makes the whole source code in the given file available in memory without
+ * copying it: a regular file is mapped into memory where mmap is available.
+ * Otherwise (e.g. a pipe), the file is read with readSourceCode() into the
+ * given arena.
+ * The source code is valid until unmapSourceCode() is called and the arena is
+ * deleted. Returns 0 on success, -1 if there is no source code.
+ * */
+int mapSourceCode(FILE*, SourceCode*, Arena*);
+
+/**
+ * Releases the mapping of the given source code, if any.
+ * */
+void unmapSourceCode(SourceCode*);
+
+/**
+ * Prints the source code - simply prints a string.
+ * */
+void printSourceCode(char*);
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef __TOKEN_H__
+#define __TOKEN_H__
+
+#include <stdio.h>
+#include "arena.h"
+
+#define MAX_LEXEME_LENGTH 11
+
+/**
+ * The struct to store token information
+ * */
+typedef struct {
+    int id; // numerical representation of the token
+    char lexeme[MAX_LEXEME_LENGTH + 1]; // null terminated string
+} Token;
+
+/**
+ * The struct to store list of tokens and keep track
+ * of number of tokens included in the list.
+ * The tokens are allocated from the arena of the list, and released with it.
+ * */
+typedef struct {
+    Token* tokens;
+    int numberOfTokens;
+    int capacity; // the number of tokens allocated
+    Arena* arena;
+} TokenList;
+
+/**
+ * Binary token stream: a TokenStreamHeader, followed by numberOfTokens
+ * TokenRecords and then lexemeBytes characters holding the lexemes. Each
+ * record points into the lexemes by offset and length, lexemes are not null
+ * terminated. All fields are in the byte order of the machine that wrote it.
+ * */
+#define TOKEN_STREAM_MAGIC   "PM0T"
+#define TOKEN_STREAM_VERSION 1
+
+typedef struct {
+    char magic[4];               // TOKEN_STREAM_MAGIC, not null terminated
+    unsigned int version;        // TOKEN_STREAM_VERSION
+    unsigned int numberOfTokens; // number of TokenRecords following the header
+    unsigned int lexemeBytes;    // number of characters following the records
+} TokenStreamHeader;
+
+typedef struct {
+    int id;                    // numerical representation of the token
+    unsigned int lexemeOffset; // index of the first character of the lexeme
+    unsigned int lexemeLength; // at most MAX_LEXEME_LENGTH
+} TokenRecord;
+
+/**
+ * Initializes the given TokenList, which will allocate from the given Arena
+ * */
+void initTokenList(TokenList*, Arena*);
+
+/**
+ * Adds the given Token to the given TokenList. The space for the tokens is
+ * grown geometrically.
+ * */
+void addToken(TokenList*, Token);
+
+/**
+ * Creates and returns a copy of the given TokenList, allocated from the same
+ * arena.
+ * Shallow copying with assignment operator shares the tokens, and adding
+ * .. tokens to one of the copies is not seen by the other.
+ * */
+TokenList getCopy(TokenList);
+
+/**
+ * Writes the given TokenList to the given FILE
+ * */
+void printTokenList(TokenList, FILE*);
+
+/**
+ * Writes the given TokenList to the given FILE as a binary token stream.
+ * The FILE should be opened in binary mode.
+ * */
+void printTokenListBinary(TokenList, FILE*);
+
+/**
+ * Empties the TokenList. The memory of the tokens is released with the arena.
+ * */
+void deleteTokenList(TokenList*);
+
+#endif
\ No newline at end of file
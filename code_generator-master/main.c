@@ -1,6 +1,136 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "token.h"
 #include "code_generator.h"
+#include "batch.h"
+#include "vm/stats.h"
+
+/**
+ * Parses the options given before the positional arguments into the given
+ * CodeGeneratorOptions and BatchOptions, and whether the statistics of the
+ * compilation are printed. Returns the number of arguments consumed, or -1 if
+ * an option is not recognized.
+ * */
+int parseOptions(int argc, char **argv, CodeGeneratorOptions* options, BatchOptions* batch, int* printStats)
+{
+    int i;
+    for(i = 1; i < argc && !strncmp(argv[i], "--", 2); i++)
+    {
+        if( !strcmp(argv[i], "--format=text") )        options->format = CG_FORMAT_TEXT;
+        else if( !strcmp(argv[i], "--format=binary") ) options->format = CG_FORMAT_BINARY;
+        else if( !strcmp(argv[i], "--peephole") )      options->peephole = 1;
+        else if( !strcmp(argv[i], "--no-fold") )       options->fold = 0;
+        else if( !strcmp(argv[i], "--optimize") )      options->optimize = 1;
+        else if( !strcmp(argv[i], "--inline") )        options->inlineThreshold = CG_DEFAULT_INLINE_THRESHOLD;
+        else if( !strncmp(argv[i], "--inline=", 9) && atoi(argv[i] + 9) > 0 )
+            options->inlineThreshold = atoi(argv[i] + 9);
+        else if( !strncmp(argv[i], "--disable-pass=", 15) && findOptimizerPass(argv[i] + 15) >= 0 )
+            options->optimizer.passes &= ~(1u << findOptimizerPass(argv[i] + 15));
+        else if( !strcmp(argv[i], "--batch") && i + 1 < argc ) batch->manifest = argv[++i];
+        else if( !strncmp(argv[i], "--jobs=", 7) && atoi(argv[i] + 7) > 0 )
+            batch->workers = atoi(argv[i] + 7);
+        else if( !strncmp(argv[i], "--cache=", 8) && argv[i][8] ) batch->cache.dir = argv[i] + 8;
+        else if( !strncmp(argv[i], "--cache-size=", 13) && atol(argv[i] + 13) > 0 )
+            batch->cache.maxSize = atol(argv[i] + 13);
+        else if( !strcmp(argv[i], "--stats") )         *printStats = 1;
+        else
+        {
+            fprintf(stderr, "Unknown option \"%s\"\n", argv[i]);
+            return -1;
+        }
+    }
+
+    return i - 1;
+}
+
+/**
+ * Reads the manifest of the given batch options, compiles its programs with
+ * the given options, and prints the summary on stdout. Returns 0 if all the
+ * programs were compiled, 1 if any failed, -1 if the batch could not be run.
+ * */
+int runBatchManifest(BatchOptions batchOptions, CodeGeneratorOptions options)
+{
+    FILE* manifest = fopen(batchOptions.manifest, "r");
+    if(!manifest)
+    {
+        fprintf(stderr, "Could not open \"%s\"\n", batchOptions.manifest);
+        return -1;
+    }
+
+    // The jobs and their paths are released at once at the end
+    Arena arena;
+    initArena(&arena);
+
+    Batch batch;
+    int err = readBatchManifest(manifest, &arena, &batch);
+    fclose(manifest);
+
+    int workers = -1;
+    if(err > 0)       fprintf(stderr, "%s:%d: expected a source and an output path\n", batchOptions.manifest, err);
+    else if(err == 0) workers = runBatch(&batch, batchOptions.workers, options,
+                                         batchOptions.cache.dir ? &batchOptions.cache : NULL);
+
+    if(workers > 0)
+    {
+        printBatchSummary(&batch, workers, stdout);
+        if(batchOptions.cache.dir) printCacheStats(batch.cacheStats, stdout);
+    }
+    else if(err <= 0) fprintf(stderr, "Could not run the batch \"%s\"\n", batchOptions.manifest);
+
+    int failed = workers > 0 ? countBatchFailures(&batch) : -1;
+    deleteArena(&arena);
+
+    if(failed < 0) return -1;
+    return failed ? 1 : 0;
+}
+
+/**
+ * Compiles the token list in inp into outp as main() does, but one phase after
+ * the other, each timed into the given statistics: the token list is read at
+ * once, allocated from the given arena, the code is generated in memory, then
+ * written. Returns the code generator error, 0 if none, which is not written.
+ * */
+int compileWithStats(FILE* inp, FILE* outp, CodeGeneratorOptions options, Arena* arena, RunStats* stats)
+{
+    initRunStats(stats);
+
+    beginPhase(stats);
+    TokenList tokenList = readTokenList(inp, arena);
+    endPhase(stats, STATS_TOKEN_IO);
+
+    Instruction* code;
+    int numOfIns;
+
+    beginPhase(stats);
+    int err = codeGeneratorToMemory(tokenList, &code, &numOfIns, options);
+    endPhase(stats, STATS_CODEGEN);
+
+    if(!err)
+    {
+        beginPhase(stats);
+        printCode(code, numOfIns, options.format, outp);
+        endPhase(stats, STATS_EMIT);
+    }
+
+    SymbolStats symbolStats = getSymbolTableStats();
+
+    stats->tokens = tokenList.numberOfTokens;
+    stats->symbols = symbolStats.symbols;
+    stats->symbolLookups = symbolStats.lookups;
+    stats->symbolProbes = symbolStats.probes;
+    stats->instructionsEmitted = numOfIns;
+
+    free(code);
+    deleteTokenList(&tokenList);
+
+    // The arenas of the token list and of the code generator, deleted or not
+    ArenaUsage arenaUsage = getArenaUsage();
+    stats->allocatedBytes = arenaUsage.allocated;
+    stats->peakAllocatedBytes = arenaUsage.peak;
+
+    return err;
+}
 
 int main(int argc, char **argv)
 {
@@ -9,25 +139,70 @@ int main(int argc, char **argv)
     /**********************************/
     /* Parse Command Line Arguments */
     /**********************************/
+    // Options come before the positional arguments
+    CodeGeneratorOptions options = getDefaultCodeGeneratorOptions();
+    BatchOptions batch = { NULL, 0, { NULL, CG_DEFAULT_CACHE_SIZE } };
+    int printStats = 0;
+    int optionCount = parseOptions(argc, argv, &options, &batch, &printStats);
+
+    if(optionCount < 0) return -1;
+
+    argv[optionCount] = argv[0];
+    argv += optionCount;
+    argc -= optionCount;
+
+    if(batch.manifest && argc == 1) return runBatchManifest(batch, options);
+
     if(argc != 3)
     {
-        fprintf(stderr, "Usage: ./code_generator.out (pl0_lexer_out) (cg_output_file)\n");
+        fprintf(stderr, "Usage: ./code_generator.out [options] (pl0_lexer_out) (cg_output_file)\n"
+                        "       ./code_generator.out [options] --batch (manifest) [--jobs=N]\n");
 
-        fprintf(stderr, "\n       pl0_lexer_out: The path to the file containing the lexer out for the programming language PL/0.\n");
+        fprintf(stderr, "\n       pl0_lexer_out: The path to the file containing the lexer out for the programming language PL/0,"
+                        "\n       either as text or as a binary token stream.\n");
 
         fprintf(stderr, "\n       cg_output_file: The path to the file to write the code generator output, which could contain either PM/0 assembly code or code generator error message.\n");
+
+        fprintf(stderr, "\n       options:\n"
+                        "         --format=text    Write the PM/0 code as text, one instruction per line (default).\n"
+                        "         --format=binary  Write the PM/0 code as a binary object file the vm can map.\n"
+                        "         --peephole       Run the peephole optimizer over the generated code, and print\n"
+                        "                          the number of instructions it removed on stderr.\n"
+                        "         --no-fold        Emit the operations on numbers and constants as they are,\n"
+                        "                          instead of folding them at compile time.\n"
+                        "         --inline[=N]     Replace the calls to the procedures with no variables, no\n"
+                        "                          nested procedures and no calls, of at most N instructions\n"
+                        "                          (default 16), by their body, and print the number of calls\n"
+                        "                          inlined on stderr.\n"
+                        "         --optimize       Run the optimizer passes over the control flow graph of the\n"
+                        "                          generated code, and print what each of them did on stderr.\n"
+                        "         --disable-pass=PASS\n"
+                        "                          Do not run the given pass of --optimize: copy-propagation,\n"
+                        "                          dce, licm, jump-threading or unreachable.\n"
+                        "         --batch MANIFEST Lex and compile each PL/0 source listed in the manifest, a\n"
+                        "                          line \"source output\" per program, on a pool of threads, and\n"
+                        "                          print a summary on stdout.\n"
+                        "         --jobs=N         Use N threads for --batch (default one per processor).\n"
+                        "         --cache=DIR      Keep the code of the programs --batch compiled in DIR, and take\n"
+                        "                          it from there when the same source code is compiled again\n"
+                        "                          with the same options.\n"
+                        "         --cache-size=N   The number of bytes the entries of --cache take at most\n"
+                        "                          (default %ld); the least recently used are removed first.\n"
+                        "         --stats          Print the time taken to read the tokens, to generate the code\n"
+                        "                          and to write it, and what the code generator did, on stderr,\n"
+                        "                          a key=value pair per line. Not for --batch.\n", CG_DEFAULT_CACHE_SIZE);
         return -1;
     }
 
     // open the input file for reading
-    if( !(inp = fopen(argv[1], "r")) )
+    if( !(inp = fopen(argv[1], "rb")) )
     {
         fprintf(stderr, "Could not open \"%s\"\n", argv[1]);
         return -1;
     }
 
     // open the output file for writing
-    if( !(outp = fopen(argv[2], "w")) )
+    if( !(outp = fopen(argv[2], options.format == CG_FORMAT_BINARY ? "wb" : "w")) )
     {
         fprintf(stderr, "Could not open \"%s\"\n", argv[2]);
 
@@ -40,17 +215,42 @@ int main(int argc, char **argv)
     /**********************************/
     /**** Call to code generator   ****/
     /**********************************/
-    // Read the token list
-    TokenList tokenList = readTokenList(inp);
-    
-    // Run code generator
-    int err = codeGenerator(tokenList, outp);
+    // The token list is released at once at the end
+    Arena arena;
+    initArena(&arena);
+
+    int err;
+    RunStats stats;
+
+    if(printStats)
+    {
+        err = compileWithStats(inp, outp, options, &arena, &stats);
+    }
+    else
+    {
+        // The tokens are read as the code generator parses them
+        TokenFileReader tokenReader;
+        TokenSource tokenSource = openTokenFile(&tokenReader, inp, &arena);
+
+        // Run code generator
+        err = codeGeneratorFromSource(tokenSource, outp, options);
+
+        // Delete the tokens of a token stream, if any
+        deleteTokenList(&tokenReader.tokenList);
+    }
 
     // Print error - if there exists any
     if(err) printCGErr(err, outp);
+    else
+    {
+        if(options.inlineThreshold) fprintf(stderr, "Inlined %d calls.\n", getInlinedCallCount());
+        if(options.optimize) printOptimizerStats(getOptimizerStats(), stderr);
+        if(options.peephole) printPeepholeStats(getPeepholeStats(), stderr);
+    }
 
-    // Delete token list created by readTokenList()
-    deleteTokenList(&tokenList);
+    if(printStats) printRunStats(&stats, stderr);
+
+    deleteArena(&arena);
 
     /**********************************/
     /* Closing input and output files */
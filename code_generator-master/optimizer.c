@@ -0,0 +1,1275 @@
+#include <stdlib.h>
+#include <string.h>
+#include "optimizer.h"
+
+/**
+ * The passes are run in order at most this many times; the last runs could
+ * still find something to do, but rarely anything worth the time.
+ * */
+#define OPTIMIZER_MAX_ITERATIONS 16
+
+const char* optimizerPassNames[OPTIMIZER_PASS_COUNT] = {
+    "copy-propagation", "dce", "licm", "jump-threading", "unreachable"
+};
+
+const char* getOptimizerPassName(OptimizerPass pass)
+{
+    return optimizerPassNames[pass];
+}
+
+int findOptimizerPass(const char* name)
+{
+    int pass;
+
+    for(pass = 0; pass < OPTIMIZER_PASS_COUNT; pass++)
+        if(!strcmp(optimizerPassNames[pass], name)) return pass;
+
+    return -1;
+}
+
+OptimizerOptions getDefaultOptimizerOptions()
+{
+    OptimizerOptions options;
+
+    options.passes = OPTIMIZER_ALL_PASSES;
+
+    return options;
+}
+
+/******************************************************************************/
+/* Copy propagation ***********************************************************/
+/******************************************************************************/
+
+/**
+ * What a register is known to hold, within a block.
+ *  VALUE_UNKNOWN : nothing
+ *  VALUE_CELL    : the value at address (l, m), as LOD and STO address it
+ *  VALUE_CONSTANT: the number m
+ * An address is the same cell wherever it is used in a block, since l counts
+ * the static links from the frame the block runs in, and two different l never
+ * reach the same frame.
+ * */
+enum { VALUE_UNKNOWN, VALUE_CELL, VALUE_CONSTANT };
+
+typedef struct {
+    int kind;
+    int l;
+    int m;
+} RegisterValue;
+
+int sameValue(RegisterValue a, RegisterValue b)
+{
+    if(a.kind == VALUE_UNKNOWN || a.kind != b.kind) return 0;
+
+    return a.m == b.m && (a.kind == VALUE_CONSTANT || a.l == b.l);
+}
+
+/**
+ * Rewrites the registers the given instruction reads to the registers they are
+ * copies of. Returns the number of registers rewritten.
+ * ODD reads and writes the same register, which could not be rewritten.
+ * */
+int rewriteUses(Instruction* ins, const int* copyOf)
+{
+    int changes = 0;
+
+    switch(ins->op)
+    {
+        case STO: case JPC: case SIO_WRITE:
+            if(copyOf[ins->r] != ins->r) { ins->r = copyOf[ins->r]; changes++; }
+            break;
+        case NEG:
+            if(copyOf[ins->l] != ins->l) { ins->l = copyOf[ins->l]; changes++; }
+            break;
+        case ADD: case SUB: case MUL: case DIV: case MOD:
+        case EQL: case NEQ: case LSS: case LEQ: case GTR: case GEQ:
+            if(copyOf[ins->l] != ins->l) { ins->l = copyOf[ins->l]; changes++; }
+            if(copyOf[ins->m] != ins->m) { ins->m = copyOf[ins->m]; changes++; }
+            break;
+        default:
+            break;
+    }
+
+    return changes;
+}
+
+/**
+ * Within each block, follows what each register holds. The registers a LOD or
+ * LIT loads a value into, which another register already holds, are read from
+ * that register instead; the LOD or LIT is left for dce to remove once nothing
+ * reads it. copyOf[r] is the register r is read from, r itself if none.
+ * The registers keep what they hold as the instructions are not removed, so a
+ * register could be read from itself again once its copy is overwritten.
+ * */
+int copyPropagation(ControlFlowGraph* cfg)
+{
+    int b, changes = 0;
+
+    for(b = 0; b < cfg->numOfBlocks; b++)
+    {
+        BasicBlock* block = &cfg->blocks[b];
+        if(block->removed) continue;
+
+        RegisterValue value[IR_REGISTER_COUNT];
+        int copyOf[IR_REGISTER_COUNT];
+        int r;
+
+        for(r = 0; r < IR_REGISTER_COUNT; r++)
+        {
+            value[r].kind = VALUE_UNKNOWN;
+            copyOf[r] = r;
+        }
+
+        int i = 0;
+        while(i < block->numOfIns)
+        {
+            Instruction* ins = &block->code[i];
+
+            changes += rewriteUses(ins, copyOf);
+
+            // The value the instruction loads or stores, if any
+            RegisterValue loaded = { VALUE_UNKNOWN, 0, 0 };
+            if(ins->op == LOD || ins->op == STO) loaded = (RegisterValue){ VALUE_CELL, ins->l, ins->m };
+            else if(ins->op == LIT)              loaded = (RegisterValue){ VALUE_CONSTANT, 0, ins->m };
+
+            // The register already holds that value, or the address already
+            // .. holds the value of the register
+            if(loaded.kind != VALUE_UNKNOWN && sameValue(value[ins->r], loaded))
+            {
+                removeInstruction(block, i);
+                changes++;
+                continue;
+            }
+
+            RegisterSet defs = instructionDefs(ins);
+
+            for(r = 0; r < IR_REGISTER_COUNT; r++)
+            {
+                if(copyOf[r] != r && (defs & (1u << copyOf[r]))) copyOf[r] = r;
+            }
+
+            for(r = 0; r < IR_REGISTER_COUNT; r++)
+            {
+                if(!(defs & (1u << r))) continue;
+
+                copyOf[r] = r;
+                value[r].kind = VALUE_UNKNOWN;
+            }
+
+            if(ins->op == STO)
+            {
+                // The registers holding the old value at the address do not
+                for(r = 0; r < IR_REGISTER_COUNT; r++)
+                    if(sameValue(value[r], loaded)) value[r].kind = VALUE_UNKNOWN;
+
+                value[ins->r] = loaded;
+            }
+            else if(ins->op == LOD || ins->op == LIT)
+            {
+                for(r = 0; r < IR_REGISTER_COUNT; r++)
+                {
+                    if(r != ins->r && sameValue(value[r], loaded))
+                    {
+                        copyOf[ins->r] = r;
+                        break;
+                    }
+                }
+
+                value[ins->r] = loaded;
+            }
+
+            // A called procedure could write any address
+            if(ins->op == CAL)
+            {
+                for(r = 0; r < IR_REGISTER_COUNT; r++) value[r].kind = VALUE_UNKNOWN;
+            }
+
+            i++;
+        }
+    }
+
+    return changes;
+}
+
+/******************************************************************************/
+/* Dead code elimination ******************************************************/
+/******************************************************************************/
+
+/**
+ * Returns whether the given instruction does nothing but write its register.
+ * DIV and MOD halt the machine on a zero divisor, and are not.
+ * */
+int writesRegisterOnly(const Instruction* ins)
+{
+    switch(ins->op)
+    {
+        case LIT: case LOD: case NEG: case ODD:
+        case ADD: case SUB: case MUL:
+        case EQL: case NEQ: case LSS: case LEQ: case GTR: case GEQ:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Returns the registers live at the start of the given block, given the ones
+ * live at its end. If removeDead is set, the instructions writing registers
+ * that are not live are removed on the way, and their number is added to
+ * removed.
+ * A CAL is not taken to end the life of any register: the registers the
+ * procedure does not write keep their values, which licm relies on.
+ * */
+RegisterSet liveAtStart(BasicBlock* block, RegisterSet live, int removeDead, int* removed)
+{
+    int i;
+
+    for(i = block->numOfIns - 1; i >= 0; i--)
+    {
+        Instruction* ins = &block->code[i];
+        RegisterSet defs = instructionDefs(ins);
+
+        if(removeDead && writesRegisterOnly(ins) && !(defs & live))
+        {
+            removeInstruction(block, i);
+            (*removed)++;
+            continue;
+        }
+
+        if(ins->op == CAL) defs = 0;
+
+        live = (live & ~defs) | instructionUses(ins);
+    }
+
+    return live;
+}
+
+/**
+ * Returns the registers live at the end of the given block: the ones live at
+ * the start of its successors. Nothing is live after RTN and SIO_HALT.
+ * */
+RegisterSet liveAtEnd(const ControlFlowGraph* cfg, const RegisterSet* liveIn, int block)
+{
+    int succ[2];
+    int n = blockSuccessors(cfg, block, succ);
+    RegisterSet live = 0;
+
+    while(n--) live |= liveIn[succ[n]];
+
+    return live;
+}
+
+/**
+ * Sets liveIn[b] to the registers live at the start of each block b. liveIn
+ * should have room for numOfBlocks + 1 entries, all zero.
+ * */
+void computeLiveness(ControlFlowGraph* cfg, RegisterSet* liveIn)
+{
+    int b, changed;
+
+    // Until nothing changes
+    do
+    {
+        changed = 0;
+
+        for(b = cfg->numOfBlocks - 1; b >= 0; b--)
+        {
+            if(cfg->blocks[b].removed) continue;
+
+            RegisterSet live = liveAtStart(&cfg->blocks[b], liveAtEnd(cfg, liveIn, b), 0, NULL);
+
+            if(live != liveIn[b])
+            {
+                liveIn[b] = live;
+                changed = 1;
+            }
+        }
+    } while(changed);
+}
+
+int deadCodeElimination(ControlFlowGraph* cfg)
+{
+    RegisterSet* liveIn = calloc(cfg->numOfBlocks + 1, sizeof(RegisterSet));
+    if(!liveIn) return 0;
+
+    int b, removed = 0;
+
+    computeLiveness(cfg, liveIn);
+
+    for(b = 0; b < cfg->numOfBlocks; b++)
+    {
+        if(cfg->blocks[b].removed) continue;
+
+        liveAtStart(&cfg->blocks[b], liveAtEnd(cfg, liveIn, b), 1, &removed);
+    }
+
+    free(liveIn);
+    return removed;
+}
+
+/******************************************************************************/
+/* Loop invariant code motion *************************************************/
+/******************************************************************************/
+
+/**
+ * Writes the successors of the given block into succ, the block a CAL goes to
+ * included, and returns how many there are.
+ * */
+int graphSuccessors(const ControlFlowGraph* cfg, int block, int succ[3])
+{
+    int n = blockSuccessors(cfg, block, succ);
+
+    if(hasBlockTarget(&cfg->blocks[block]))
+    {
+        const Instruction* last = &cfg->blocks[block].code[cfg->blocks[block].numOfIns - 1];
+        if(last->op == CAL) succ[n++] = last->m;
+    }
+
+    return n;
+}
+
+/**
+ * Lists the predecessors of the blocks that are not removed: those of block b
+ * are preds[start[b]] to preds[start[b + 1] - 1]. If withCalls is set, a block
+ * ending with CAL is a predecessor of the block it calls as well. The arrays
+ * should be freed by the caller. Returns 0 on success, -1 if no memory could
+ * be allocated.
+ * */
+int buildPredecessors(const ControlFlowGraph* cfg, int withCalls, int** start, int** preds)
+{
+    int n = cfg->numOfBlocks;
+    int b, k, succ[3];
+
+    *start = calloc(n + 2, sizeof(int));
+    *preds = NULL;
+    if(!*start) return -1;
+
+    for(b = 0; b < n; b++)
+    {
+        if(cfg->blocks[b].removed) continue;
+
+        k = withCalls ? graphSuccessors(cfg, b, succ) : blockSuccessors(cfg, b, succ);
+        while(k--) if(succ[k] < n) (*start)[succ[k] + 2]++;
+    }
+
+    for(b = 0; b < n; b++) (*start)[b + 2] += (*start)[b + 1];
+
+    *preds = malloc(((*start)[n + 1] + 1) * sizeof(int));
+    if(!*preds) return -1;
+
+    // start[b + 1] is where the next predecessor of b goes, and ends up as
+    // .. the start of b + 1
+    for(b = 0; b < n; b++)
+    {
+        if(cfg->blocks[b].removed) continue;
+
+        k = withCalls ? graphSuccessors(cfg, b, succ) : blockSuccessors(cfg, b, succ);
+        while(k--) if(succ[k] < n) (*preds)[(*start)[succ[k] + 1]++] = b;
+    }
+
+    return 0;
+}
+
+/**
+ * Sets idom[b] to the immediate dominator of each block b reached from the
+ * entry, following the jumps, the fall throughs and the calls, and to -1 for
+ * the blocks not reached. The entry is its own. Returns 0 on success, -1 if no
+ * memory could be allocated.
+ * (Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm")
+ * */
+int computeDominators(const ControlFlowGraph* cfg, int* idom)
+{
+    int n = cfg->numOfBlocks;
+    int* order = malloc((n + 1) * sizeof(int));     // the blocks in postorder
+    int* postIndex = malloc((n + 1) * sizeof(int)); // the index of each block in order
+    int* stack = malloc((n + 1) * sizeof(int));
+    int* edge = malloc((n + 1) * sizeof(int));      // the next successor to visit of each block on the stack
+    int *start = NULL, *preds = NULL;
+    int b, count = 0, top = 0, err = 0;
+
+    if(!order || !postIndex || !stack || !edge || buildPredecessors(cfg, 1, &start, &preds)) err = -1;
+
+    for(b = 0; b < n && !err; b++)
+    {
+        postIndex[b] = -1;
+        idom[b] = -1;
+    }
+
+    if(!err && n > 0)
+    {
+        postIndex[0] = -2;
+        stack[top] = 0;
+        edge[top++] = 0;
+    }
+
+    while(top > 0)
+    {
+        int succ[3];
+        int k = graphSuccessors(cfg, stack[top - 1], succ);
+
+        if(edge[top - 1] < k)
+        {
+            int s = succ[edge[top - 1]++];
+
+            if(s < n && postIndex[s] == -1)
+            {
+                postIndex[s] = -2;
+                stack[top] = s;
+                edge[top++] = 0;
+            }
+        }
+        else
+        {
+            postIndex[stack[top - 1]] = count;
+            order[count++] = stack[--top];
+        }
+    }
+
+    if(!err && n > 0) idom[0] = 0;
+
+    int changed = !err;
+    while(changed)
+    {
+        changed = 0;
+
+        // In reverse postorder, the entry (which is last) excluded
+        for(int i = count - 2; i >= 0; i--)
+        {
+            int newIdom = -1;
+            b = order[i];
+
+            for(int p = start[b]; p < start[b + 1]; p++)
+            {
+                int a = preds[p];
+                if(idom[a] < 0) continue;
+
+                if(newIdom < 0)
+                {
+                    newIdom = a;
+                    continue;
+                }
+
+                // The closest block dominating both
+                int c = newIdom;
+                while(a != c)
+                {
+                    while(postIndex[a] < postIndex[c]) a = idom[a];
+                    while(postIndex[c] < postIndex[a]) c = idom[c];
+                }
+                newIdom = a;
+            }
+
+            if(idom[b] != newIdom)
+            {
+                idom[b] = newIdom;
+                changed = 1;
+            }
+        }
+    }
+
+    free(order);
+    free(postIndex);
+    free(stack);
+    free(edge);
+    free(start);
+    free(preds);
+    return err;
+}
+
+/**
+ * Returns whether block a dominates block b.
+ * */
+int dominates(const int* idom, int a, int b)
+{
+    for(;;)
+    {
+        if(a == b) return 1;
+        if(b == 0 || idom[b] < 0) return 0;
+
+        b = idom[b];
+    }
+}
+
+/**
+ * Marks the blocks of the loops the given block is the header of: the blocks
+ * that jump back to it, and the ones reaching those without passing through
+ * it. Returns the number of blocks marked, 0 if the block is not the header of
+ * a loop.
+ * */
+int findLoop(const ControlFlowGraph* cfg, const int* idom, const int* start, const int* preds,
+             int header, char* inLoop, int* stack)
+{
+    int top = 0, size = 1, backEdges = 0;
+
+    memset(inLoop, 0, cfg->numOfBlocks + 1);
+    inLoop[header] = 1;
+
+    for(int p = start[header]; p < start[header + 1]; p++)
+    {
+        int b = preds[p];
+        if(!dominates(idom, header, b)) continue;
+
+        backEdges++;
+
+        if(!inLoop[b])
+        {
+            inLoop[b] = 1;
+            stack[top++] = b;
+            size++;
+        }
+    }
+
+    if(backEdges == 0) return 0;
+
+    while(top > 0)
+    {
+        int b = stack[--top];
+
+        for(int p = start[b]; p < start[b + 1]; p++)
+        {
+            if(inLoop[preds[p]] || idom[preds[p]] < 0) continue;
+
+            inLoop[preds[p]] = 1;
+            stack[top++] = preds[p];
+            size++;
+        }
+    }
+
+    return size;
+}
+
+/**
+ * Sets preserve[p] to the registers procedure p should leave as they are: the
+ * ones live across a CAL to it, and the ones a procedure calling it should.
+ * */
+void computePreserved(const ControlFlowGraph* cfg, const ProcedureInfo* info, const RegisterSet* liveIn, RegisterSet* preserve)
+{
+    int b, p;
+
+    for(b = 0; b < cfg->numOfBlocks; b++)
+    {
+        const BasicBlock* block = &cfg->blocks[b];
+        if(block->removed || !hasBlockTarget(block)) continue;
+
+        const Instruction* last = &block->code[block->numOfIns - 1];
+        if(last->op != CAL || info->procedureAt[last->m] < 0) continue;
+
+        preserve[info->procedureAt[last->m]] |= liveAtEnd(cfg, liveIn, b);
+    }
+
+    int changed = 1;
+    while(changed)
+    {
+        changed = 0;
+
+        for(p = 0; p < info->numOfProcedures; p++)
+        {
+            for(int c = 0; c < info->procedures[p].numOfCallees; c++)
+            {
+                int callee = info->procedures[p].callees[c];
+
+                if((preserve[callee] | preserve[p]) != preserve[callee])
+                {
+                    preserve[callee] |= preserve[p];
+                    changed = 1;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Returns whether the procedure from could call the procedure to, directly or
+ * through other procedures, or is the same. visited is scratch space for each
+ * procedure, and stack has room for every procedure.
+ * */
+int procedureReaches(const ProcedureInfo* info, int from, int to, char* visited, int* stack)
+{
+    int top = 0;
+
+    memset(visited, 0, info->numOfProcedures);
+    visited[from] = 1;
+    stack[top++] = from;
+
+    while(top > 0)
+    {
+        int p = stack[--top];
+        if(p == to) return 1;
+
+        for(int c = 0; c < info->procedures[p].numOfCallees; c++)
+        {
+            int callee = info->procedures[p].callees[c];
+            if(visited[callee]) continue;
+
+            visited[callee] = 1;
+            stack[top++] = callee;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * What licm knows about the loop it is working on.
+ * level     : the level the blocks of the loop run at
+ * defCount  : the number of instructions in the loop writing each register;
+ *             a register no instruction writes holds the same value all
+ *             through the loop
+ * referenced: the registers the loop reads or writes, the ones live at its
+ *             header, and the ones its procedure should leave as they are;
+ *             the others are free to keep hoisted values in
+ * written   : the registers the loop writes, calls included
+ * available : the registers the instructions hoisted so far write; a
+ *             register the loop writes could be read in the preheader only
+ *             once it is
+ * rename    : whether hoisted values could be kept in free registers
+ * writes    : the cells the loop, or the procedures it calls, could write
+ * hoisted   : the instructions hoisted so far, to go into the preheader
+ * */
+typedef struct {
+    int level;
+    int defCount[IR_REGISTER_COUNT];
+    RegisterSet referenced;
+    RegisterSet written;
+    RegisterSet available;
+    int rename;
+    FrameCell* writes;
+    int numOfWrites;
+    Instruction* hoisted;
+    int numOfHoisted;
+} Loop;
+
+/**
+ * Returns the registers the given instruction of the loop writes. A CAL
+ * writes what the procedure it calls could.
+ * */
+RegisterSet loopInstructionDefs(const ProcedureInfo* info, const Instruction* ins)
+{
+    if(ins->op == CAL) return calledProcedure(info, ins)->clobbers;
+
+    return instructionDefs(ins);
+}
+
+int loopMayWrite(const Loop* loop, FrameCell cell)
+{
+    for(int i = 0; i < loop->numOfWrites; i++)
+    {
+        if(loop->writes[i].level == cell.level && loop->writes[i].offset == cell.offset) return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Returns whether the given instruction of the loop computes the same value
+ * in every iteration, and could be run before the loop even if it would not
+ * run at all in the loop. DIV and MOD could halt the machine, and ODD could
+ * not read its operand from another register, so they are not hoisted.
+ * */
+int isLoopInvariant(const Loop* loop, const Instruction* ins)
+{
+    switch(ins->op)
+    {
+        case LIT:
+            return 1;
+
+        case LOD:
+        {
+            FrameCell cell = { loop->level - ins->l, ins->m };
+            return cell.level >= 0 && !loopMayWrite(loop, cell);
+        }
+
+        case NEG: case ADD: case SUB: case MUL:
+        case EQL: case NEQ: case LSS: case LEQ: case GTR: case GEQ:
+        {
+            RegisterSet uses = instructionUses(ins);
+
+            if(uses & loop->written & ~loop->available) return 0;
+
+            for(int r = 0; r < IR_REGISTER_COUNT; r++)
+                if((uses & (1u << r)) && loop->defCount[r]) return 0;
+
+            return 1;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Returns whether the value the instruction at the given index of the block
+ * writes into reg is read only by the instructions following it in the block,
+ * which could all read it from another register.
+ * */
+int readInBlockOnly(const ProcedureInfo* info, const BasicBlock* block, int index, int reg, RegisterSet liveOut)
+{
+    for(int i = index + 1; i < block->numOfIns; i++)
+    {
+        const Instruction* ins = &block->code[i];
+
+        if(ins->op == ODD && ins->r == reg) return 0;
+        if(loopInstructionDefs(info, ins) & (1u << reg)) return 1;
+    }
+
+    return !(liveOut & (1u << reg));
+}
+
+/**
+ * Returns the register an instruction already hoisted computes the same value
+ * as the given one into, or -1 if there is none.
+ * */
+int findHoisted(const Loop* loop, const Instruction* ins)
+{
+    for(int i = 0; i < loop->numOfHoisted; i++)
+    {
+        const Instruction* h = &loop->hoisted[i];
+        if(h->op == ins->op && h->l == ins->l && h->m == ins->m) return h->r;
+    }
+
+    return -1;
+}
+
+/**
+ * Returns a register the loop does not use, or -1 if there is none.
+ * */
+int freeRegister(const Loop* loop)
+{
+    for(int r = IR_REGISTER_COUNT - 1; r >= 0; r--)
+        if(!(loop->referenced & (1u << r))) return r;
+
+    return -1;
+}
+
+/**
+ * Hoists the invariant instructions of the given block of the loop, writing
+ * what is left of the block into code. Returns the number of instructions
+ * hoisted.
+ * An instruction is moved as it is if it is the only one writing its register
+ * in the loop and the register is not live at the header. Otherwise, its value
+ * is kept in a free register, or the one of the same instruction hoisted
+ * before, and the instructions following it in the block read it from there.
+ * */
+int hoistFromBlock(const ProcedureInfo* info, Loop* loop, const BasicBlock* block, RegisterSet liveAtHeader,
+                   RegisterSet liveOut, Instruction* code, int* numOfIns)
+{
+    int hoisted = 0, count = 0;
+    int readFrom[IR_REGISTER_COUNT];
+    int r;
+
+    for(r = 0; r < IR_REGISTER_COUNT; r++) readFrom[r] = r;
+
+    for(int i = 0; i < block->numOfIns; i++)
+    {
+        Instruction ins = block->code[i];
+
+        rewriteUses(&ins, readFrom);
+
+        if(isLoopInvariant(loop, &ins))
+        {
+            r = ins.r;
+            int same = findHoisted(loop, &ins);
+            int inBlock = readInBlockOnly(info, block, i, r, liveOut);
+            int spare = (loop->rename && inBlock) ? freeRegister(loop) : -1;
+
+            if(same >= 0 && inBlock)
+            {
+                readFrom[r] = same;
+                loop->defCount[r]--;
+                hoisted++;
+                continue;
+            }
+
+            if(loop->defCount[r] == 1 && !(liveAtHeader & (1u << r)))
+            {
+                loop->hoisted[loop->numOfHoisted++] = ins;
+                loop->defCount[r] = 0;
+                loop->available |= 1u << r;
+                readFrom[r] = r;
+                hoisted++;
+                continue;
+            }
+
+            if(spare >= 0)
+            {
+                ins.r = spare;
+                loop->hoisted[loop->numOfHoisted++] = ins;
+                loop->referenced |= 1u << spare;
+                loop->available |= 1u << spare;
+                loop->defCount[r]--;
+                readFrom[r] = spare;
+                hoisted++;
+                continue;
+            }
+        }
+
+        RegisterSet defs = loopInstructionDefs(info, &ins);
+        for(r = 0; r < IR_REGISTER_COUNT; r++)
+            if(defs & (1u << r)) readFrom[r] = r;
+
+        code[count++] = ins;
+    }
+
+    *numOfIns = count;
+    return hoisted;
+}
+
+/**
+ * Hoists the invariant instructions of the loop with the given header, whose
+ * blocks are marked in inLoop, into a new block laid out right before the
+ * header, which the entries of the loop go to instead. Returns the number of
+ * instructions hoisted; if it is 0, the graph is not changed.
+ * */
+int hoistLoop(ControlFlowGraph* cfg, const ProcedureInfo* info, const RegisterSet* liveIn,
+              const RegisterSet* preserve, int header, const char* inLoop)
+{
+    int n = cfg->numOfBlocks;
+    int b, i, r, total = 0;
+
+    Loop loop;
+    memset(&loop, 0, sizeof(loop));
+    loop.level = info->levelOf[header];
+
+    int procedure = info->procedureOf[header];
+    loop.rename = (procedure >= 0);
+    loop.referenced = liveIn[header] | (procedure >= 0 ? preserve[procedure] : 0);
+
+    // A block of the loop falling through to the header would run the
+    // .. preheader in every iteration
+    int prev = header - 1;
+    while(prev >= 0 && cfg->blocks[prev].removed) prev--;
+
+    if(prev >= 0 && inLoop[prev])
+    {
+        const BasicBlock* block = &cfg->blocks[prev];
+        int op = block->numOfIns ? block->code[block->numOfIns - 1].op : 0;
+
+        if(op != JMP && op != RTN && op != SIO_HALT) return 0;
+    }
+
+    for(b = 0; b < n; b++)
+    {
+        if(!inLoop[b]) continue;
+        if(info->levelOf[b] != loop.level || loop.level < 0) return 0;
+
+        total += cfg->blocks[b].numOfIns;
+    }
+
+    loop.writes = malloc((total + 1) * sizeof(FrameCell));
+    loop.hoisted = malloc((total + 1) * sizeof(Instruction));
+
+    Instruction* work = malloc((total + 1) * sizeof(Instruction));
+    int* workStart = malloc((n + 1) * sizeof(int));
+    int* workCount = malloc((n + 1) * sizeof(int));
+
+    char* visited = malloc(info->numOfProcedures + 1);
+    int* stack = malloc((info->numOfProcedures + 1) * sizeof(int));
+
+    int hoisted = 0, ok = loop.writes && loop.hoisted && work && workStart && workCount && visited && stack;
+
+    // What the loop writes, and what the procedures it calls could
+    for(b = 0; b < n && ok; b++)
+    {
+        if(!inLoop[b]) continue;
+
+        for(i = 0; i < cfg->blocks[b].numOfIns && ok; i++)
+        {
+            const Instruction* ins = &cfg->blocks[b].code[i];
+
+            if(ins->op == CAL)
+            {
+                const Procedure* callee = calledProcedure(info, ins);
+                if(!callee)
+                {
+                    ok = 0;
+                    break;
+                }
+
+                // A register written by a call is never taken to be written once
+                for(r = 0; r < IR_REGISTER_COUNT; r++)
+                    if(callee->clobbers & (1u << r)) loop.defCount[r] += 2;
+
+                loop.referenced |= callee->clobbers;
+                loop.written |= callee->clobbers;
+
+                // The preheader would run again in a call back into the procedure
+                if(procedure >= 0 && procedureReaches(info, info->procedureAt[ins->m], procedure, visited, stack))
+                    loop.rename = 0;
+
+                FrameCell* writes = realloc(loop.writes, (loop.numOfWrites + callee->numOfWrites + total + 1) * sizeof(FrameCell));
+                if(!writes)
+                {
+                    ok = 0;
+                    break;
+                }
+
+                loop.writes = writes;
+                for(int w = 0; w < callee->numOfWrites; w++)
+                    if(!loopMayWrite(&loop, callee->writes[w])) loop.writes[loop.numOfWrites++] = callee->writes[w];
+
+                continue;
+            }
+
+            RegisterSet defs = instructionDefs(ins);
+            for(r = 0; r < IR_REGISTER_COUNT; r++)
+                if(defs & (1u << r)) loop.defCount[r]++;
+
+            loop.referenced |= defs | instructionUses(ins);
+            loop.written |= defs;
+
+            if(ins->op == STO)
+                loop.writes[loop.numOfWrites++] = (FrameCell){ loop.level - ins->l, ins->m };
+        }
+    }
+
+    // Hoist, into the work copy of the blocks
+    int used = 0;
+    for(b = 0; b < n && ok; b++)
+    {
+        if(!inLoop[b]) continue;
+
+        workStart[b] = used;
+        hoisted += hoistFromBlock(info, &loop, &cfg->blocks[b], liveIn[header],
+            liveAtEnd(cfg, liveIn, b), &work[used], &workCount[b]);
+        used += workCount[b];
+    }
+
+    int pre = (ok && hoisted) ? insertBlock(cfg, header) : -1;
+
+    if(pre >= 0)
+    {
+        for(i = 0; i < loop.numOfHoisted; i++)
+            appendInstruction(cfg, &cfg->blocks[pre], loop.hoisted[i]);
+
+        // The blocks of the loop moved one index up
+        for(b = 0; b < n; b++)
+        {
+            if(!inLoop[b]) continue;
+
+            BasicBlock* block = &cfg->blocks[b >= header ? b + 1 : b];
+
+            for(i = 0; i < workCount[b]; i++)
+            {
+                Instruction ins = work[workStart[b] + i];
+                if(isBlockReference(&ins) && ins.m >= header) ins.m++;
+
+                block->code[i] = ins;
+            }
+            block->numOfIns = workCount[b];
+        }
+
+        // Entering the loop goes through the preheader; so does calling into
+        // .. it, which enters it anew
+        for(b = 0; b <= n; b++)
+        {
+            if(b == pre || !hasBlockTarget(&cfg->blocks[b])) continue;
+
+            int old = b > pre ? b - 1 : b;
+            Instruction* last = &cfg->blocks[b].code[cfg->blocks[b].numOfIns - 1];
+
+            if(last->m == header + 1 && (last->op == CAL || !inLoop[old])) last->m = pre;
+        }
+    }
+    else
+    {
+        hoisted = 0;
+    }
+
+    free(loop.writes);
+    free(loop.hoisted);
+    free(work);
+    free(workStart);
+    free(workCount);
+    free(visited);
+    free(stack);
+    return hoisted;
+}
+
+/**
+ * Hoists the invariant instructions of the first loop that has any. Returns
+ * the number of instructions hoisted, 0 if no loop has any.
+ * */
+int hoistFirstLoop(ControlFlowGraph* cfg)
+{
+    int n = cfg->numOfBlocks;
+    int header, hoisted = 0;
+
+    Arena arena;
+    initArena(&arena);
+
+    ProcedureInfo info;
+    int* idom = malloc((n + 1) * sizeof(int));
+    RegisterSet* liveIn = calloc(n + 1, sizeof(RegisterSet));
+    char* inLoop = malloc(n + 1);
+    int* stack = malloc((n + 1) * sizeof(int));
+    int *start = NULL, *preds = NULL;
+    RegisterSet* preserve = NULL;
+
+    if(idom && liveIn && inLoop && stack && !analyzeProcedures(cfg, &arena, &info)
+        && !computeDominators(cfg, idom) && !buildPredecessors(cfg, 0, &start, &preds)
+        && (preserve = calloc(info.numOfProcedures + 1, sizeof(RegisterSet))))
+    {
+        computeLiveness(cfg, liveIn);
+        computePreserved(cfg, &info, liveIn, preserve);
+
+        for(header = 0; header < n && !hoisted; header++)
+        {
+            if(cfg->blocks[header].removed || idom[header] < 0) continue;
+
+            if(findLoop(cfg, idom, start, preds, header, inLoop, stack))
+                hoisted = hoistLoop(cfg, &info, liveIn, preserve, header, inLoop);
+        }
+    }
+
+    free(idom);
+    free(liveIn);
+    free(inLoop);
+    free(stack);
+    free(start);
+    free(preds);
+    free(preserve);
+    deleteArena(&arena);
+    return hoisted;
+}
+
+int loopInvariantCodeMotion(ControlFlowGraph* cfg)
+{
+    int changes = 0, hoisted;
+
+    // Each loop hoisted from changes the graph, which is analyzed again for
+    // .. the next one
+    do
+    {
+        hoisted = hoistFirstLoop(cfg);
+        changes += hoisted;
+    } while(hoisted);
+
+    return changes;
+}
+
+/******************************************************************************/
+/* Jump threading *************************************************************/
+/******************************************************************************/
+
+/**
+ * Returns the block a jump to the given block ends up at, passing the empty
+ * blocks and the blocks of a single JMP. A chain that loops forever is not
+ * followed.
+ * */
+int finalBlock(const ControlFlowGraph* cfg, int target)
+{
+    int t = target, steps = 0;
+
+    while(t < cfg->numOfBlocks)
+    {
+        const BasicBlock* block = &cfg->blocks[t];
+
+        // A chain longer than the graph visits a block twice
+        if(++steps > cfg->numOfBlocks) return target;
+
+        if(block->numOfIns == 0)                                  t = nextBlock(cfg, t);
+        else if(block->numOfIns == 1 && block->code[0].op == JMP) t = block->code[0].m;
+        else break;
+    }
+
+    return t;
+}
+
+/**
+ * Returns the instruction that last writes the given register before the
+ * index in the block, or NULL if none does.
+ * */
+const Instruction* lastDefinition(const BasicBlock* block, int index, int reg)
+{
+    while(--index >= 0)
+    {
+        if(instructionDefs(&block->code[index]) & (1u << reg)) return &block->code[index];
+    }
+
+    return NULL;
+}
+
+int jumpThreading(ControlFlowGraph* cfg)
+{
+    int b, changes = 0;
+
+    for(b = 0; b < cfg->numOfBlocks; b++)
+    {
+        BasicBlock* block = &cfg->blocks[b];
+        if(block->removed || !hasBlockTarget(block)) continue;
+
+        int last = block->numOfIns - 1;
+        Instruction* ins = &block->code[last];
+
+        int target = finalBlock(cfg, ins->m);
+        if(target != ins->m)
+        {
+            ins->m = target;
+            changes++;
+        }
+
+        if(ins->op == JPC)
+        {
+            // The condition is a number
+            const Instruction* def = lastDefinition(block, last, ins->r);
+
+            if(def && def->op == LIT)
+            {
+                if(def->m) removeInstruction(block, last);
+                else       *ins = (Instruction){ JMP, 0, 0, target };
+                changes++;
+                continue;
+            }
+        }
+
+        // Both ways of a JPC, or a JMP, lead to the next block
+        if((ins->op == JMP || ins->op == JPC) && target == finalBlock(cfg, nextBlock(cfg, b)))
+        {
+            removeInstruction(block, last);
+            changes++;
+        }
+    }
+
+    return changes;
+}
+
+/******************************************************************************/
+/* Unreachable block removal **************************************************/
+/******************************************************************************/
+
+int unreachableBlockRemoval(ControlFlowGraph* cfg)
+{
+    char* reached = calloc(cfg->numOfBlocks + 1, 1);
+    int* stack = malloc((cfg->numOfBlocks + 1) * sizeof(int));
+
+    if(!reached || !stack)
+    {
+        free(reached);
+        free(stack);
+        return 0;
+    }
+
+    int b, top = 0, removed = 0;
+
+    // Depth first from the entry, through the jumps, the fall throughs and
+    // .. the calls
+    stack[top++] = 0;
+    reached[0] = 1;
+
+    while(top > 0)
+    {
+        int succ[3];
+        int n, block = stack[--top];
+
+        n = graphSuccessors(cfg, block, succ);
+
+        while(n--)
+        {
+            if(succ[n] >= cfg->numOfBlocks || reached[succ[n]]) continue;
+
+            reached[succ[n]] = 1;
+            stack[top++] = succ[n];
+        }
+    }
+
+    for(b = 0; b < cfg->numOfBlocks; b++)
+    {
+        if(reached[b] || cfg->blocks[b].removed) continue;
+
+        removed += cfg->blocks[b].numOfIns;
+        removeBlock(&cfg->blocks[b]);
+    }
+
+    free(reached);
+    free(stack);
+
+    return removed;
+}
+
+/******************************************************************************/
+/* Pass manager ***************************************************************/
+/******************************************************************************/
+
+/**
+ * The passes in the order they run, indexed by OptimizerPass. Each returns the
+ * number of changes it made.
+ * */
+int (*const optimizerPasses[OPTIMIZER_PASS_COUNT])(ControlFlowGraph*) = {
+    copyPropagation, deadCodeElimination, loopInvariantCodeMotion, jumpThreading, unreachableBlockRemoval
+};
+
+void runOptimizerPasses(ControlFlowGraph* cfg, OptimizerOptions options, OptimizerStats* stats)
+{
+    int changes;
+
+    do
+    {
+        changes = 0;
+
+        for(int pass = 0; pass < OPTIMIZER_PASS_COUNT; pass++)
+        {
+            if(!(options.passes & (1u << pass))) continue;
+
+            int before = countInstructions(cfg);
+            int passChanges = optimizerPasses[pass](cfg);
+
+            stats->passes[pass].runs++;
+            stats->passes[pass].changes += passChanges;
+            stats->passes[pass].removed += before - countInstructions(cfg);
+
+            changes += passChanges;
+        }
+
+        stats->iterations++;
+    } while(changes && stats->iterations < OPTIMIZER_MAX_ITERATIONS);
+}
+
+int optimizeCode(Instruction** code, int numOfIns, OptimizerOptions options, OptimizerStats* stats)
+{
+    OptimizerStats local;
+    memset(&local, 0, sizeof(local));
+
+    local.before = numOfIns;
+    local.after = numOfIns;
+
+    // The graph is released at once at the end
+    Arena arena;
+    initArena(&arena);
+
+    ControlFlowGraph cfg;
+
+    if(!buildControlFlowGraph(*code, numOfIns, &arena, &cfg))
+    {
+        runOptimizerPasses(&cfg, options, &local);
+
+        Instruction* optimized;
+        int count = lowerControlFlowGraph(&cfg, &optimized);
+
+        if(count >= 0)
+        {
+            free(*code);
+            *code = optimized;
+            numOfIns = count;
+            local.after = count;
+        }
+    }
+
+    deleteArena(&arena);
+
+    if(stats) *stats = local;
+
+    return numOfIns;
+}
+
+void printOptimizerStats(OptimizerStats stats, FILE* out)
+{
+    fprintf(out, "Optimizer removed %d of %d instructions (%d iterations).\n",
+        stats.before - stats.after, stats.before, stats.iterations);
+
+    for(int pass = 0; pass < OPTIMIZER_PASS_COUNT; pass++)
+    {
+        fprintf(out, "  %-17s removed %d instructions, made %d changes in %d runs.\n",
+            optimizerPassNames[pass], stats.passes[pass].removed,
+            stats.passes[pass].changes, stats.passes[pass].runs);
+    }
+}
@@ -0,0 +1,120 @@
+#ifndef __OPTIMIZER_H__
+#define __OPTIMIZER_H__
+
+#include <stdio.h>
+#include "data.h"
+#include "ir.h"
+
+/**
+ * Optimizer over the control flow graph of the emitted code (see ir.h). The
+ * code is turned into a graph, the passes run over it in a fixed order until
+ * none of them changes anything, and the graph is lowered back to PM/0 code.
+ * The passes are:
+ *  copy-propagation: within a block, a LOD or LIT of a value a register
+ *                    already holds is replaced by that register in the
+ *                    instructions reading it, and a LOD, LIT or STO that would
+ *                    not change anything is removed.
+ *  dce             : an instruction writing a register no instruction reads
+ *                    afterwards is removed. DIV and MOD are kept, since they
+ *                    could halt the machine.
+ *  licm            : the LIT, the LOD of addresses nothing in a loop writes,
+ *                    and the operations on them, are moved out of the loop
+ *                    into a block run once before it, keeping their values in
+ *                    registers the loop does not use. A CAL in the loop is
+ *                    taken to write what the procedure, or any procedure it
+ *                    calls, could write (see analyzeProcedures() in ir.h).
+ *  jump-threading  : JMP, JPC and CAL to an empty block or a block of a single
+ *                    JMP are sent to where it leads, a JMP to the next block
+ *                    and a JPC whose two ways are the same are removed, and a
+ *                    JPC on a LIT is turned into a JMP or removed.
+ *  unreachable     : the blocks that could not be reached from the entry of
+ *                    the program, following the jumps and the calls, are
+ *                    removed.
+ * Each pass could be turned off (see OptimizerOptions).
+ * */
+
+typedef enum {
+    PASS_COPY_PROPAGATION,
+    PASS_DCE,
+    PASS_LICM,
+    PASS_JUMP_THREADING,
+    PASS_UNREACHABLE,
+    OPTIMIZER_PASS_COUNT
+} OptimizerPass;
+
+/**
+ * Returns the name of the given pass, as it is given on the command line.
+ * */
+const char* getOptimizerPassName(OptimizerPass pass);
+
+/**
+ * Returns the pass with the given name, or -1 if there is none.
+ * */
+int findOptimizerPass(const char* name);
+
+/**
+ * Set of passes, bit i for pass i.
+ * */
+typedef unsigned int OptimizerPassSet;
+
+#define OPTIMIZER_ALL_PASSES ((OptimizerPassSet)((1u << OPTIMIZER_PASS_COUNT) - 1))
+
+/**
+ * What a pass did over all its runs.
+ * runs   : the number of times it ran
+ * changes: the number of rewrites it made, removals included
+ * removed: the number of instructions it removed
+ * */
+typedef struct {
+    int runs;
+    int changes;
+    int removed;
+} OptimizerPassStats;
+
+/**
+ * What optimizeCode() did.
+ * before, after: the number of instructions before and after the optimizer
+ * iterations : the number of times the passes were run in order
+ * passes     : the stats of each pass, indexed by OptimizerPass
+ * */
+typedef struct {
+    int before;
+    int after;
+    int iterations;
+    OptimizerPassStats passes[OPTIMIZER_PASS_COUNT];
+} OptimizerStats;
+
+/**
+ * Options of the optimizer.
+ * passes: the passes to run
+ * */
+typedef struct {
+    OptimizerPassSet passes;
+} OptimizerOptions;
+
+/**
+ * Returns the options with every pass turned on.
+ * */
+OptimizerOptions getDefaultOptimizerOptions();
+
+/**
+ * Optimizes the numOfIns instructions of the given code. On success, sets code
+ * to the optimized code, frees the one given, and returns the number of
+ * instructions in it. If the code could not be optimized, returns numOfIns and
+ * leaves the code as it is. If stats is not NULL, it is filled as well.
+ * */
+int optimizeCode(Instruction** code, int numOfIns, OptimizerOptions options, OptimizerStats* stats);
+
+/**
+ * Runs the enabled passes over the given graph until none of them changes
+ * anything, adding what they did to the stats.
+ * */
+void runOptimizerPasses(ControlFlowGraph* cfg, OptimizerOptions options, OptimizerStats* stats);
+
+/**
+ * Prints the given stats on the given file, a line for the optimizer and a
+ * line for each pass.
+ * */
+void printOptimizerStats(OptimizerStats stats, FILE* out);
+
+#endif
@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "peephole.h"
+
+/**
+ * Returns whether the m field of the given instruction is a code address.
+ * */
+int isCodeAddress(const Instruction* ins)
+{
+    return ins->op == JMP || ins->op == JPC || ins->op == CAL;
+}
+
+/**
+ * Marks the instructions that could be executed other than right after the
+ * instruction before them: the targets of JMP, JPC and CAL, and the
+ * instructions following a CAL, which RTN returns to. isTarget holds numOfIns
+ * + 1 entries, the last one for the end of the code.
+ * */
+void markJumpTargets(const Instruction* code, int numOfIns, char* isTarget)
+{
+    memset(isTarget, 0, numOfIns + 1);
+
+    int i;
+    for(i = 0; i < numOfIns; i++)
+    {
+        if(isCodeAddress(&code[i]) && code[i].m >= 0 && code[i].m <= numOfIns)
+            isTarget[code[i].m] = 1;
+
+        if(code[i].op == CAL)
+            isTarget[i + 1] = 1;
+    }
+}
+
+/**
+ * Returns the address a jump to the given target ends up at, following the
+ * chain of JMPs starting at it. A chain that loops forever is not followed.
+ * */
+int finalJumpTarget(const Instruction* code, int numOfIns, int target)
+{
+    int t = target, steps = 0;
+
+    while(t >= 0 && t < numOfIns && code[t].op == JMP)
+    {
+        // A chain longer than the code visits an instruction twice
+        if(++steps > numOfIns) return target;
+
+        t = code[t].m;
+    }
+
+    return t;
+}
+
+/**
+ * Returns whether the two instructions access the same register and address.
+ * */
+int sameAccess(const Instruction* a, const Instruction* b)
+{
+    return a->r == b->r && a->l == b->l && a->m == b->m;
+}
+
+/**
+ * Runs a single pass of the optimizer over the numOfIns instructions of the
+ * code. Returns the number of instructions left, and adds what it did to the
+ * stats. The arrays are the scratch space of the pass, of numOfIns + 1 entries.
+ * */
+int peepholePass(Instruction* code, int numOfIns, char* isTarget, char* removed, int* newIndex, PeepholeStats* stats)
+{
+    int i;
+
+    // A jump to a JMP is sent to where the JMP goes
+    for(i = 0; i < numOfIns; i++)
+    {
+        if(!isCodeAddress(&code[i])) continue;
+
+        int target = finalJumpTarget(code, numOfIns, code[i].m);
+
+        if(target != code[i].m)
+        {
+            code[i].m = target;
+            stats->jumpsThreaded++;
+        }
+    }
+
+    markJumpTargets(code, numOfIns, isTarget);
+    memset(removed, 0, numOfIns);
+
+    // The last instruction kept. The instructions removed after it do nothing,
+    // .. so it is what runs right before the current one.
+    int prev = -1;
+
+    for(i = 0; i < numOfIns; i++)
+    {
+        Instruction* ins = &code[i];
+        Instruction* p = (prev >= 0) ? &code[prev] : NULL;
+
+        // Jump to the next instruction
+        if((ins->op == JMP || ins->op == JPC) && ins->m == i + 1)
+        {
+            removed[i] = 1;
+        }
+
+        // The rest merges the instruction into the previous one, which could
+        // .. be done only if nothing else jumps to it
+        else if(p && !isTarget[i])
+        {
+            // The register already holds the value at that address
+            if(ins->op == LOD && (p->op == STO || p->op == LOD) && sameAccess(ins, p))
+                removed[i] = 1;
+
+            // The address already holds the value of the register
+            else if(ins->op == STO && p->op == LOD && sameAccess(ins, p))
+                removed[i] = 1;
+
+            // Negated literal
+            else if(ins->op == NEG && p->op == LIT && ins->r == p->r && ins->l == p->r && p->m != INT_MIN)
+            {
+                p->m = -p->m;
+                removed[i] = 1;
+            }
+        }
+
+        if(!removed[i]) prev = i;
+
+        // A jump to a removed instruction lands on the one following it
+        else if(isTarget[i]) isTarget[i + 1] = 1;
+    }
+
+    // New address of each instruction. For a removed instruction, it is the
+    // .. address of the next instruction kept.
+    int count = 0;
+    for(i = 0; i < numOfIns; i++)
+    {
+        newIndex[i] = count;
+        if(!removed[i]) count++;
+    }
+    newIndex[numOfIns] = count;
+
+    if(count == numOfIns) return numOfIns;
+
+    // Move the instructions kept to their new addresses, rewriting the jumps
+    for(i = 0; i < numOfIns; i++)
+    {
+        if(removed[i]) continue;
+
+        Instruction ins = code[i];
+
+        if(isCodeAddress(&ins))
+        {
+            if(ins.m >= 0 && ins.m <= numOfIns) ins.m = newIndex[ins.m];
+            else if(ins.m > numOfIns)           ins.m -= numOfIns - count;
+        }
+
+        code[newIndex[i]] = ins;
+    }
+
+    stats->removed += numOfIns - count;
+
+    return count;
+}
+
+int peepholeOptimize(Instruction* code, int numOfIns, PeepholeStats* stats)
+{
+    PeepholeStats local = { 0, 0, 0 };
+
+    // Nothing to optimize, nor to allocate the scratch space for
+    if(numOfIns <= 0)
+    {
+        if(stats) *stats = local;
+        return numOfIns;
+    }
+
+    char* isTarget = malloc(numOfIns + 1);
+    char* removed  = malloc(numOfIns + 1);
+    int* newIndex  = malloc((numOfIns + 1) * sizeof(int));
+
+    if(isTarget && removed && newIndex)
+    {
+        // Each pass could make new sequences adjacent; stop when one does nothing
+        for(;;)
+        {
+            int threaded = local.jumpsThreaded;
+            int count = peepholePass(code, numOfIns, isTarget, removed, newIndex, &local);
+
+            local.passes++;
+
+            if(count == numOfIns && threaded == local.jumpsThreaded) break;
+
+            numOfIns = count;
+        }
+    }
+
+    free(isTarget);
+    free(removed);
+    free(newIndex);
+
+    if(stats) *stats = local;
+
+    return numOfIns;
+}
+
+void printPeepholeStats(PeepholeStats stats, FILE* out)
+{
+    fprintf(out, "Peephole optimizer removed %d instructions (%d jumps threaded, %d passes).\n",
+        stats.removed, stats.jumpsThreaded, stats.passes);
+}
@@ -0,0 +1,48 @@
+#ifndef __PEEPHOLE_H__
+#define __PEEPHOLE_H__
+
+#include <stdio.h>
+#include "data.h"
+
+/**
+ * Peephole optimizer over the emitted PM/0 code. It rewrites the redundant
+ * sequences the single-pass code generator emits:
+ *  - a LOD of the address the previous STO (or LOD) used, into the same
+ *    register, is removed, and so is a STO back to the address just loaded,
+ *  - JMP and JPC to the next instruction are removed,
+ *  - JMP, JPC and CAL to a JMP are sent to the final target of the chain,
+ *  - LIT followed by NEG of the same register is folded into a single LIT.
+ * An instruction that could be jumped to, returned to, or called is never
+ * merged into the one before it. As instructions are removed, the m fields of
+ * JMP, JPC and CAL are rewritten to the new addresses.
+ * */
+
+/**
+ * What peepholeOptimize() did.
+ * removed      : the number of instructions removed
+ * jumpsThreaded: the number of JMP, JPC and CAL sent past a JMP
+ * passes       : the number of passes run until nothing changed
+ * */
+typedef struct {
+    int removed;
+    int jumpsThreaded;
+    int passes;
+} PeepholeStats;
+
+/**
+ * Returns whether the m field of the given instruction is a code address.
+ * */
+int isCodeAddress(const Instruction* ins);
+
+/**
+ * Optimizes the numOfIns instructions of the given code in place and returns
+ * the number of instructions left. If stats is not NULL, it is filled as well.
+ * */
+int peepholeOptimize(Instruction* code, int numOfIns, PeepholeStats* stats);
+
+/**
+ * Prints the given stats as a single line on the given file.
+ * */
+void printPeepholeStats(PeepholeStats stats, FILE* out);
+
+#endif
@@ -0,0 +1,414 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "token.h"
+#include "data.h"
+#include "code_generator.h"
+#include "front_end.h"
+#include "cache.h"
+#include "incremental.h"
+#include "lexer/source_code.h"
+#include "vm/vm.h"
+#include "vm/profile.h"
+#include "vm/stats.h"
+
+/**
+ * Runs a PL/0 program in one process: the code generator pulls the tokens from
+ * the lexer as it parses them, and the generated code is handed to the virtual
+ * machine, without writing or reading any intermediate files.
+ * The intermediate stages could still be written with the --dump-* options,
+ * in the same formats the separate executables write them.
+ * */
+
+/**
+ * Options of the pipeline. The dump file names are NULL if not given.
+ * */
+typedef struct {
+    const char* tokensFile;     // token list, as the input of code_generator.out
+    const char* codeFile;       // PM/0 code or code generator error, as code_generator.out writes
+    const char* simulationFile; // code memory and execution history, as vm.out writes
+    CodeGeneratorOptions cgOptions;
+    VMOptions vmOptions;
+    CompilationCache cache;     // not used if its directory is NULL
+    const char* baseFile;       // source code compiled first, the source code then compiled incrementally from it
+    const char* profileFile;    // hotspot report of the run, as vm.out --profile writes
+    const char* foldedFile;     // folded stacks of the run, as vm.out --profile-folded writes
+    int stats;                  // print the statistics of the run on stderr
+} PipelineOptions;
+
+/**
+ * Parses the options given before the positional arguments into the given
+ * PipelineOptions. Returns the number of arguments consumed, or -1 if an option
+ * is not recognized.
+ * */
+int parseOptions(int argc, char **argv, PipelineOptions* options)
+{
+    int i;
+    for(i = 1; i < argc && !strncmp(argv[i], "--", 2); i++)
+    {
+        if( !strncmp(argv[i], "--dump-tokens=", 14) )          options->tokensFile = argv[i] + 14;
+        else if( !strncmp(argv[i], "--dump-code=", 12) )       options->codeFile = argv[i] + 12;
+        else if( !strncmp(argv[i], "--dump-simulation=", 18) ) options->simulationFile = argv[i] + 18;
+        else if( !strcmp(argv[i], "--peephole") )              options->cgOptions.peephole = 1;
+        else if( !strcmp(argv[i], "--no-fold") )               options->cgOptions.fold = 0;
+        else if( !strcmp(argv[i], "--optimize") )              options->cgOptions.optimize = 1;
+        else if( !strcmp(argv[i], "--inline") )                options->cgOptions.inlineThreshold = CG_DEFAULT_INLINE_THRESHOLD;
+        else if( !strncmp(argv[i], "--inline=", 9) && atoi(argv[i] + 9) > 0 )
+            options->cgOptions.inlineThreshold = atoi(argv[i] + 9);
+        else if( !strncmp(argv[i], "--disable-pass=", 15) && findOptimizerPass(argv[i] + 15) >= 0 )
+            options->cgOptions.optimizer.passes &= ~(1u << findOptimizerPass(argv[i] + 15));
+        else if( !strcmp(argv[i], "--engine=switch") )         options->vmOptions.engine = VM_ENGINE_SWITCH;
+        else if( !strcmp(argv[i], "--engine=threaded") )       options->vmOptions.engine = VM_ENGINE_THREADED;
+        else if( !strcmp(argv[i], "--engine=jit") )            options->vmOptions.engine = VM_ENGINE_JIT;
+        else if( !strcmp(argv[i], "--engine=jit-check") )      options->vmOptions.engine = VM_ENGINE_JIT_CHECK;
+        else if( !strcmp(argv[i], "--trace=full") )            options->vmOptions.trace = VM_TRACE_FULL;
+        else if( !strcmp(argv[i], "--trace=none") )            options->vmOptions.trace = VM_TRACE_NONE;
+        else if( !strcmp(argv[i], "--trace=ring") )            options->vmOptions.trace = VM_TRACE_RING;
+        else if( !strncmp(argv[i], "--trace-ring-size=", 18) && atoi(argv[i] + 18) > 0 )
+        {
+            options->vmOptions.trace = VM_TRACE_RING;
+            options->vmOptions.traceRingSize = atoi(argv[i] + 18);
+        }
+        else if( !strncmp(argv[i], "--stack-limit=", 14) && atoi(argv[i] + 14) > 0 )
+            options->vmOptions.stackLimit = atoi(argv[i] + 14);
+        else if( !strncmp(argv[i], "--code-limit=", 13) && atoi(argv[i] + 13) > 0 )
+            options->vmOptions.codeLimit = atoi(argv[i] + 13);
+        else if( !strncmp(argv[i], "--cache=", 8) && argv[i][8] ) options->cache.dir = argv[i] + 8;
+        else if( !strncmp(argv[i], "--cache-size=", 13) && atol(argv[i] + 13) > 0 )
+            options->cache.maxSize = atol(argv[i] + 13);
+        else if( !strncmp(argv[i], "--recompile-from=", 17) && argv[i][17] ) options->baseFile = argv[i] + 17;
+        else if( !strncmp(argv[i], "--profile=", 10) && argv[i][10] )         options->profileFile = argv[i] + 10;
+        else if( !strncmp(argv[i], "--profile-folded=", 17) && argv[i][17] ) options->foldedFile = argv[i] + 17;
+        else if( !strcmp(argv[i], "--stats") )                 options->stats = 1;
+        else if( !strcmp(argv[i], "--interactive") )           options->vmOptions.interactive = 1;
+        else
+        {
+            fprintf(stderr, "Unknown option \"%s\"\n", argv[i]);
+            return -1;
+        }
+    }
+
+    return i - 1;
+}
+
+/**
+ * Compiles the source code of the given base file, then the given source code
+ * incrementally from it, into code and numOfIns as compileSourceCode() does,
+ * allocating from the given arena. Prints what the incremental compilation of
+ * the source code did on stderr.
+ * */
+int recompileSourceCode(const char* baseFile, SourceCode sourceCode, Arena* arena, Instruction** code, int* numOfIns,
+                        CodeGeneratorOptions options, LexerOut* lexerOut)
+{
+    IncrementalCompiler compiler;
+    initIncrementalCompiler(&compiler, options);
+
+    FILE* base = fopen(baseFile, "r");
+    SourceCode baseCode;
+
+    if(base && !mapSourceCode(base, &baseCode, arena))
+    {
+        compileIncremental(&compiler, baseCode.text, (int)baseCode.length, lexerOut);
+        unmapSourceCode(&baseCode);
+    }
+    else
+    {
+        fprintf(stderr, "Could not read \"%s\"\n", baseFile);
+    }
+
+    if(base) fclose(base);
+
+    int err = compileIncremental(&compiler, sourceCode.text, (int)sourceCode.length, lexerOut);
+    printIncrementalStats(compiler.stats, stderr);
+
+    // The code belongs to the compiler
+    const Instruction* compiled = getIncrementalCode(&compiler, numOfIns);
+    *code = NULL;
+
+    if(compiled)
+    {
+        *code = malloc((*numOfIns ? *numOfIns : 1) * sizeof(Instruction));
+        if(*code) memcpy(*code, compiled, *numOfIns * sizeof(Instruction));
+    }
+
+    deleteIncrementalCompiler(&compiler);
+
+    return err;
+}
+
+/**
+ * Opens the dump file with the given name for writing. Returns NULL if no
+ * name is given or the file could not be opened.
+ * */
+FILE* openDumpFile(const char* name)
+{
+    if(!name) return NULL;
+
+    FILE* f = fopen(name, "w");
+    if(!f) fprintf(stderr, "Could not open \"%s\"\n", name);
+
+    return f;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *inp, *vm_inp, *vm_outp;
+
+    /**********************************/
+    /* Parse Command Line Arguments */
+    /**********************************/
+    // Options come before the positional arguments
+    PipelineOptions options = { NULL, NULL, NULL, getDefaultCodeGeneratorOptions(), getDefaultVMOptions(),
+                                { NULL, CG_DEFAULT_CACHE_SIZE }, NULL, NULL, NULL, 0 };
+    int optionCount = parseOptions(argc, argv, &options);
+
+    if(optionCount < 0) return -1;
+
+    argv[optionCount] = argv[0];
+    argv += optionCount;
+    argc -= optionCount;
+
+    if(argc != 2 && argc != 4)
+    {
+        fprintf(stderr, "Usage: ./pipeline.out [options] (pl0_source_code_file) [vm_inp_file=stdin] [vm_outp_file=stdout]\n");
+
+        fprintf(stderr, "\n       pl0_source_code_file: The path to the file containing the source code for the programming language PL/0.\n");
+
+        fprintf(stderr, "\n       vm_inp_file: The path to the file that is going to be attached as the input stream to the virtual machine. Use - for stdin.\n");
+
+        fprintf(stderr, "\n       vm_outp_file: The path to the file that is going to be attached as the output stream to the virtual machine. Use - for stdout.\n");
+
+        fprintf(stderr, "\n       options:\n"
+                        "         --dump-tokens=FILE      Write the token list, as the input of code_generator.out.\n"
+                        "         --dump-code=FILE        Write the PM/0 code or the code generator error, as code_generator.out does.\n"
+                        "         --dump-simulation=FILE  Write the code memory and the execution history, as vm.out does.\n"
+                        "         --peephole, --no-fold, --inline[=N], --optimize, --disable-pass=PASS\n"
+                        "                                 Same as the options of code_generator.out.\n"
+                        "         --trace=..., --trace-ring-size=N, --engine=...\n"
+                        "                                 Same as the options of vm.out, for --dump-simulation.\n"
+                        "         --stack-limit=N, --code-limit=N\n"
+                        "                                 Same as the options of vm.out, the limits of the virtual machine.\n"
+                        "         --interactive           Same as the option of vm.out: write the output of the program at\n"
+                        "                                 once, and read its input a line at a time.\n"
+                        "         --cache=DIR, --cache-size=N\n"
+                        "                                 Same as the options of code_generator.out --batch: take the code\n"
+                        "                                 from the compilation cache in DIR, or store it there once compiled.\n"
+                        "         --recompile-from=FILE   Compile the PL/0 source code in FILE first, then the source code\n"
+                        "                                 incrementally from it, generating only the blocks that changed.\n"
+                        "         --profile=FILE, --profile-folded=FILE\n"
+                        "                                 Same as the options of vm.out: profile the run, and write the\n"
+                        "                                 hotspots or the folded stacks to FILE.\n"
+                        "         --stats                 Print the time taken by each stage, and what the lexer, the code\n"
+                        "                                 generator and the virtual machine did, on stderr, a key=value\n"
+                        "                                 pair per line.\n");
+        return -1;
+    }
+
+    // open the source code for reading
+    if( !(inp = fopen(argv[1], "r")) )
+    {
+        fprintf(stderr, "Could not open \"%s\"\n", argv[1]);
+        return -1;
+    }
+
+    vm_inp  = stdin;
+    vm_outp = stdout;
+
+    if(argc == 4)
+    {
+        if( strcmp(argv[2], "-") && !(vm_inp = fopen(argv[2], "r")) )
+        {
+            fprintf(stderr, "Could not open \"%s\"\n", argv[2]);
+            fclose(inp);
+            return -1;
+        }
+
+        if( strcmp(argv[3], "-") && !(vm_outp = fopen(argv[3], "w")) )
+        {
+            fprintf(stderr, "Could not open \"%s\"\n", argv[3]);
+            fclose(inp);
+            if(vm_inp != stdin) fclose(vm_inp);
+            return -1;
+        }
+    }
+
+    /**********************************/
+    /****      Run the pipeline    ****/
+    /**********************************/
+    int err = 0;
+
+    // The source code and the token list are released at once at the end
+    Arena arena;
+    initArena(&arena);
+
+    RunStats stats;
+    initRunStats(&stats);
+
+    if(options.stats) options.vmOptions.stats = &stats;
+
+    // Lexer, on the source code mapped into memory
+    SourceCode sourceCode;
+
+    beginPhase(&stats);
+    mapSourceCode(inp, &sourceCode, &arena);
+    endPhase(&stats, STATS_SOURCE_READ);
+
+    LexerOut lexerOut;
+
+    CompilerContext context;
+    initCompilerContext(&context);
+
+    Instruction* code = NULL;
+    int numOfIns = 0;
+    int cgErr = 0;
+
+    // The code of a source code compiled before is taken from the cache,
+    // .. without running the lexer and the code generator at all
+    CacheStats cacheStats = { 0, 0, 0, 0 };
+    CacheKey key = 0;
+    int cached = 0;
+
+    if(sourceCode.text && !options.tokensFile && options.cache.dir)
+    {
+        key = getCacheKey(sourceCode.text, sourceCode.length, options.cgOptions);
+        cached = lookupCompilation(&options.cache, key, &code, &numOfIns, &cacheStats);
+    }
+
+    if(cached)
+    {
+        lexerOut.lexerError = NONE;
+        lexerOut.errorLine = 0;
+        initTokenList(&lexerOut.tokenList, &arena);
+    }
+    // The lexer runs along the code generator, which pulls the tokens as it
+    // .. parses them, unless the whole token list is to be dumped, or the two
+    // .. timed apart for --stats. The incremental compiler lexes on its own.
+    else if(sourceCode.text && !options.tokensFile && (!options.stats || options.baseFile))
+    {
+        beginPhase(&stats);
+
+        if(options.baseFile)
+            cgErr = recompileSourceCode(options.baseFile, sourceCode, &arena, &code, &numOfIns, options.cgOptions, &lexerOut);
+        else
+            cgErr = compileSourceCode(&context, sourceCode, &arena, &code, &numOfIns, options.cgOptions, &lexerOut);
+
+        endPhase(&stats, STATS_CODEGEN);
+
+        if(options.cache.dir && lexerOut.lexerError == NONE && !cgErr)
+            storeCompilation(&options.cache, key, code, numOfIns, &cacheStats);
+    }
+    else
+    {
+        beginPhase(&stats);
+        lexerOut = lexicalAnalyzeBuffer(sourceCode.text, sourceCode.length, &arena);
+        endPhase(&stats, STATS_LEX);
+
+        stats.tokens = lexerOut.tokenList.numberOfTokens;
+
+        if(lexerOut.lexerError == NONE)
+        {
+            FILE* tokensOut = openDumpFile(options.tokensFile);
+
+            if(tokensOut)
+            {
+                beginPhase(&stats);
+                printTokenList(lexerOut.tokenList, tokensOut);
+                fclose(tokensOut);
+                endPhase(&stats, STATS_TOKEN_IO);
+            }
+
+            // Code generator, on the token list of the lexer
+            TokenListIterator it = getTokenListIterator(&lexerOut.tokenList);
+
+            beginPhase(&stats);
+            cgErr = codeGeneratorContextToMemory(&context, getTokenListSource(&it), &code, &numOfIns, options.cgOptions);
+            endPhase(&stats, STATS_CODEGEN);
+        }
+    }
+
+    if(lexerOut.lexerError != NONE)
+    {
+        printLexerErr(lexerOut, stderr);
+        err = -1;
+    }
+    else
+    {
+        FILE* codeOut = openDumpFile(options.codeFile);
+
+        if(cgErr)
+        {
+            printCGErr(cgErr, stderr);
+            if(codeOut) printCGErr(cgErr, codeOut);
+            err = -1;
+        }
+        else if(!cached && !options.baseFile)
+        {
+            if(options.cgOptions.inlineThreshold) fprintf(stderr, "Inlined %d calls.\n", context.inlinedCalls);
+            if(options.cgOptions.optimize) printOptimizerStats(context.optimizerStats, stderr);
+            if(options.cgOptions.peephole) printPeepholeStats(context.peepholeStats, stderr);
+        }
+
+        if(options.cache.dir) printCacheStats(cacheStats, stderr);
+
+        if(!cgErr && codeOut)
+        {
+            beginPhase(&stats);
+            printCode(code, numOfIns, CG_FORMAT_TEXT, codeOut);
+            endPhase(&stats, STATS_EMIT);
+        }
+
+        if(codeOut) fclose(codeOut);
+
+        // The symbols are those of the code generator, none if the code
+        // .. was taken from the cache or compiled incrementally
+        if(!cgErr)
+        {
+            stats.symbols = context.symbolStats.symbols;
+            stats.symbolLookups = context.symbolStats.lookups;
+            stats.symbolProbes = context.symbolStats.probes;
+            stats.instructionsEmitted = numOfIns;
+        }
+
+        // Virtual machine, on the generated code
+        if(!cgErr)
+        {
+            FILE* simulationOut = openDumpFile(options.simulationFile);
+
+            VMProfile profile;
+            initVMProfile(&profile);
+            if(options.profileFile || options.foldedFile) options.vmOptions.profile = &profile;
+
+            simulateCode(code, numOfIns, simulationOut, vm_inp, vm_outp, options.vmOptions);
+
+            if(profile.counts) writeVMProfile(&profile, options.profileFile, options.foldedFile);
+            deleteVMProfile(&profile);
+
+            if(simulationOut) fclose(simulationOut);
+        }
+    }
+
+    if(options.stats)
+    {
+        // The arenas of the lexer and the code generator, deleted or not
+        ArenaUsage arenaUsage = getArenaUsage();
+        stats.allocatedBytes = arenaUsage.allocated;
+        stats.peakAllocatedBytes = arenaUsage.peak;
+
+        printRunStats(&stats, stderr);
+    }
+
+    free(code);
+    deleteCompilerContext(&context);
+    deleteLexerOut(&lexerOut);
+    unmapSourceCode(&sourceCode);
+    deleteArena(&arena);
+
+    /**********************************/
+    /****     Closing the files    ****/
+    /**********************************/
+    fclose(inp);
+    if(vm_inp != stdin) fclose(vm_inp);
+    if(vm_outp != stdout) fclose(vm_outp);
+
+    return err;
+}
@@ -1,35 +1,115 @@
 #include "symbol.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+
+/**
+ * The number of buckets of an empty symbol table once a symbol is added.
+ * */
+#define SYMBOL_TABLE_INITIAL_BUCKETS 16
+
+/**
+ * Returns the hash of the given name in the given scope: FNV-1a over the name,
+ * followed by the address of the scope.
+ * */
+unsigned int hashSymbol(const Symbol* scope, const char* name)
+{
+    unsigned int hash = 2166136261u;
+
+    for(; *name; name++)
+    {
+        hash ^= (unsigned char)*name;
+        hash *= 16777619u;
+    }
+
+    // The low bits of the address of an allocated symbol carry no information
+    hash ^= (unsigned int)((uintptr_t)scope >> 4);
+    hash *= 16777619u;
 
-void initSymbolTable(SymbolTable* symbolTable)
+    return hash;
+}
+
+/**
+ * Appends the given symbol to the end of its bucket.
+ * */
+void insertToBucket(SymbolTable* symbolTable, Symbol* symbol)
+{
+    unsigned int bucket = hashSymbol(symbol->scope, symbol->name) & (symbolTable->numberOfBuckets - 1);
+
+    Symbol** link = &symbolTable->buckets[bucket];
+    while(*link) link = &(*link)->nextInBucket;
+
+    symbol->nextInBucket = NULL;
+    *link = symbol;
+}
+
+/**
+ * Doubles the number of buckets and rehashes the symbols in the order they
+ * were added, so each bucket keeps its symbols in that order.
+ * */
+void growBuckets(SymbolTable* symbolTable)
+{
+    int numberOfBuckets = symbolTable->numberOfBuckets ? 2 * symbolTable->numberOfBuckets : SYMBOL_TABLE_INITIAL_BUCKETS;
+
+    // The old buckets are left to the arena
+    symbolTable->buckets = (Symbol**)arenaAlloc(symbolTable->arena, numberOfBuckets * sizeof(Symbol*));
+    memset(symbolTable->buckets, 0, numberOfBuckets * sizeof(Symbol*));
+    symbolTable->numberOfBuckets = numberOfBuckets;
+
+    for(int i = 0; i < symbolTable->numberOfSymbols; i++)
+        insertToBucket(symbolTable, symbolTable->symbols[i]);
+}
+
+void initSymbolTable(SymbolTable* symbolTable, Arena* arena)
 {
     symbolTable->symbols = NULL;
     symbolTable->numberOfSymbols = 0;
+    symbolTable->capacity = 0;
+
+    symbolTable->buckets = NULL;
+    symbolTable->numberOfBuckets = 0;
+
+    symbolTable->lookups = 0;
+    symbolTable->probes = 0;
+
+    symbolTable->arena = arena;
 }
 
 void deleteSymbolTable(SymbolTable* symbolTable)
 {
     if(!symbolTable) return;
 
-    if(symbolTable->symbols)
-        free(symbolTable->symbols);
-
-    symbolTable->symbols = NULL;
-    symbolTable->numberOfSymbols = 0;
+    // The symbols belong to the arena
+    initSymbolTable(symbolTable, symbolTable->arena);
 }
 
 Symbol* addSymbol(SymbolTable* symbolTable, Symbol symbol)
 {
     if(!symbolTable) return NULL;
 
-    symbolTable->numberOfSymbols++;
+    // Grow the list of symbols geometrically
+    if(symbolTable->numberOfSymbols == symbolTable->capacity)
+    {
+        int capacity = symbolTable->capacity ? 2 * symbolTable->capacity : SYMBOL_TABLE_INITIAL_BUCKETS;
+
+        symbolTable->symbols = (Symbol**)arenaGrow(symbolTable->arena, symbolTable->symbols,
+            symbolTable->capacity * sizeof(Symbol*), capacity * sizeof(Symbol*));
+        symbolTable->capacity = capacity;
+    }
 
-    symbolTable->symbols = (Symbol*)realloc(symbolTable->symbols, (symbolTable->numberOfSymbols) * sizeof(Symbol));
+    Symbol* copy = (Symbol*)arenaAlloc(symbolTable->arena, sizeof(Symbol));
+    *copy = symbol;
+    copy->index = symbolTable->numberOfSymbols;
 
-    symbolTable->symbols[symbolTable->numberOfSymbols - 1] = symbol;
+    symbolTable->symbols[symbolTable->numberOfSymbols++] = copy;
 
-    return &symbolTable->symbols[symbolTable->numberOfSymbols - 1];
+    // Keep at most one symbol per bucket on average
+    if(symbolTable->numberOfSymbols > symbolTable->numberOfBuckets)
+        growBuckets(symbolTable);
+    else
+        insertToBucket(symbolTable, copy);
+
+    return copy;
 }
 
 void printSymbolTable(SymbolTable* symbolTable, FILE* out)
@@ -42,7 +122,7 @@ void printSymbolTable(SymbolTable* symbolTable, FILE* out)
     {
         fprintf(out, "#%d\n", i);
 
-        Symbol* symbol = &(symbolTable->symbols[i]);
+        Symbol* symbol = symbolTable->symbols[i];
 
         switch(symbol->type)
         {
@@ -85,18 +165,30 @@ void printSymbolTable(SymbolTable* symbolTable, FILE* out)
 }
 
 Symbol* findSymbol(SymbolTable* symbolTable, Symbol* scope, const char* symbolName)
+{
+    return findSymbolBefore(symbolTable, scope, symbolName, symbolTable ? symbolTable->numberOfSymbols : 0);
+}
+
+Symbol* findSymbolBefore(SymbolTable* symbolTable, Symbol* scope, const char* symbolName, int numberOfSymbols)
 {
     if(!symbolTable || !symbolName) return NULL;
 
+    symbolTable->lookups++;
+    if(!symbolTable->numberOfBuckets) return NULL;
+
     // Search from the most inner scope to global scope
     while(1)
     {
-        // Search the current scope
-        for(int i = 0; i < symbolTable->numberOfSymbols; i++)
+        // Search the current scope, only in the bucket of the name in it
+        unsigned int bucket = hashSymbol(scope, symbolName) & (symbolTable->numberOfBuckets - 1);
+
+        for(Symbol* symbol = symbolTable->buckets[bucket]; symbol; symbol = symbol->nextInBucket)
         {
-            if( symbolTable->symbols[i].scope == scope && !strcmp(symbolTable->symbols[i].name, symbolName) )
+            symbolTable->probes++;
+
+            if( symbol->index < numberOfSymbols && symbol->scope == scope && !strcmp(symbol->name, symbolName) )
             {
-                return &symbolTable->symbols[i];
+                return symbol;
             }
         }
 
@@ -114,4 +206,11 @@ Symbol* findSymbol(SymbolTable* symbolTable, Symbol* scope, const char* symbolNa
         }
     }
 
+}
+
+SymbolStats getSymbolStats(const SymbolTable* symbolTable)
+{
+    SymbolStats stats = { symbolTable->numberOfSymbols, symbolTable->lookups, symbolTable->probes };
+
+    return stats;
 }
\ No newline at end of file
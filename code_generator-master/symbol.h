@@ -2,6 +2,7 @@
 #define __SYMBOL_H__
 
 #include <stdio.h>
+#include "arena.h"
 
 /**
  * There are three possible types of symbols that can be an entry of a symbol table
@@ -22,6 +23,9 @@ typedef enum
  * level  : CONST, VAR, PROC
  * address: VAR, PROC
  * scope  : CONST, VAR, PROC
+ * inlineSize: PROC, the number of instructions of its body if it could be
+ * .. inlined at its calls, -1 if not. The body follows the INC at address.
+ * index and nextInBucket are maintained by the symbol table.
  * */
 
 typedef struct Symbol Symbol;
@@ -33,29 +37,62 @@ struct Symbol {
 	unsigned int level;
     unsigned int address;
     Symbol* scope;
+    int inlineSize;
+    int index;            // the number of symbols added to the table before it
+    Symbol* nextInBucket; // next symbol hashed to the same bucket
 };
 
 /**
  * Symbol table.
+ * symbols holds the symbols in the order they are added. Each symbol is
+ * .. allocated separately from the arena of the table, so a Symbol* stays
+ * .. valid until the arena is deleted, and it could be used as the scope of
+ * .. other symbols.
+ * buckets index the symbols by their name together with their scope. The
+ * .. symbols of a bucket are chained through nextInBucket in the order they
+ * .. are added. The number of buckets is a power of 2, grown to keep at most
+ * .. one symbol per bucket on average.
+ * lookups counts the calls to findSymbol() and findSymbolBefore(), and probes
+ * .. the symbols of the buckets they compared to the name looked up.
  * */
 typedef struct {
-    Symbol* symbols;
+    Symbol** symbols;
     int numberOfSymbols;
+    int capacity;
+
+    Symbol** buckets;
+    int numberOfBuckets;
+
+    long long lookups;
+    long long probes;
+
+    Arena* arena;
 } SymbolTable;
 
 /**
- * Initializes the given symbol table to a empty symbol table.
+ * What a symbol table holds and what its lookups did, see SymbolTable.
+ * */
+typedef struct {
+    int symbols;
+    long long lookups;
+    long long probes;
+} SymbolStats;
+
+/**
+ * Initializes the given symbol table to a empty symbol table, which will
+ * allocate from the given Arena.
  * */
-void initSymbolTable(SymbolTable*);
+void initSymbolTable(SymbolTable*, Arena*);
 
 /**
- * Destructs the symbol table by making necessary deallocations on the members
- * of the symbol table struct.
+ * Empties the symbol table. The memory of the symbols is released with the
+ * arena.
  * */
 void deleteSymbolTable(SymbolTable*);
 
 /**
  * Appends a copy of the given symbol to the given symbol table.
+ * Returns the copy, which stays at the same address until the table is deleted.
  * */
 Symbol* addSymbol(SymbolTable*, Symbol);
 
@@ -67,8 +104,22 @@ void printSymbolTable(SymbolTable*, FILE*);
 /**
  * In the given symbolTable, searches the symbol with symbolName.
  * Iteratively, the scopes are searched starting from the given scope to its
- * ancestors until the global scope (NULL) is reached.
+ * ancestors until the global scope (NULL) is reached. Each scope is searched
+ * with a single hash lookup. If a scope has several symbols with the same
+ * name, the one added first is returned.
  * */
 Symbol* findSymbol(SymbolTable* symbolTable, Symbol* scope, const char* symbolName);
 
+/**
+ * Same as findSymbol(), but only among the first numberOfSymbols symbols added
+ * to the table, as if the others were not added yet.
+ * */
+Symbol* findSymbolBefore(SymbolTable* symbolTable, Symbol* scope, const char* symbolName, int numberOfSymbols);
+
+/**
+ * Returns the number of symbols of the given symbol table, and the lookups
+ * and probes made in it since it was initialized.
+ * */
+SymbolStats getSymbolStats(const SymbolTable*);
+
 #endif
\ No newline at end of file
@@ -61,7 +61,7 @@ while read is_err cg_in cg_out others; do
 
     elif [ "$is_err" = "not_error" ]; then
       # code should have been produced. therefore, run the vm.
-      (timeout $timeout "$vm" "$cg_out" "/dev/null" "$vm_inp" "$vm_out") > /dev/null 2>&1
+      (timeout $timeout "$vm" --trace=none "$cg_out" "/dev/null" "$vm_inp" "$vm_out") > /dev/null 2>&1
 
       # check if the correct vm_out is produced
       _diff=$( { diff -B -w $vm_out $gt_vm_out; } 2>&1 )
@@ -0,0 +1,85 @@
+tests="tests.txt"
+cg="../code_generator.out"
+vm="../vm/vm.out"
+manifest="io/your_outputs/batch_manifest.txt"
+vm_manifest="io/your_outputs/batch_vm_manifest.txt"
+EMPH='\033[1;31m'
+GREEN_EMPH='\033[1;32m'
+DEEMPH='\033[0m'
+timeout=10s
+
+i=0
+passed=0
+failed=0
+
+# check if cg.out, vm.out and tests.txt exists
+if [[ -e $cg && -e $vm && -e $tests ]] ; then
+    echo "$cg, $vm and $tests are found. Starting tests.."
+else
+    echo "$cg, $vm or $tests could not be found! Aborting.."
+    exit
+fi
+
+# Same test cases as grader.sh, but every PL/0 code (pl0_code.txt next to
+#   cg_in) is compiled by a single run of the code generator in --batch mode,
+#   from a manifest listing them all. The code of the valid ones is then run
+#   by a single run of the vm in --batch mode.
+mkdir -p "$(dirname "$manifest")"
+: > "$manifest"
+: > "$vm_manifest"
+while read is_err cg_in cg_out others; do
+    mkdir -p "$(dirname "$cg_out")"
+    echo "$(dirname "$cg_in")/pl0_code.txt $cg_out" >> "$manifest"
+
+    if [ "$is_err" = "not_error" ]; then
+      others_array=($others)
+      mkdir -p "$(dirname "${others_array[1]}")"
+      echo "$cg_out ${others_array[0]} ${others_array[1]}" >> "$vm_manifest"
+    fi
+done < "$tests"
+
+(timeout $timeout "$cg" --batch "$manifest" --jobs=4) > /dev/null 2>&1
+(timeout $timeout "$vm" --batch "$vm_manifest" --jobs=4) > /dev/null 2>&1
+
+while read is_err cg_in cg_out others; do
+    echo -e "${GREEN_EMPH}TEST[$i]${DEEMPH}"
+
+    # resolve others depending on whether it is an error case or not
+    if [ "$is_err" = "not_error" ]; then
+      others_array=($others)
+      vm_inp=${others_array[0]}
+      vm_out=${others_array[1]}
+      gt_vm_out=${others_array[2]}
+      _diff=$( { diff -B -w $vm_out $gt_vm_out; } 2>&1 )
+    elif [ "$is_err" = "error" ]; then
+      gt_cg_out=$others
+      _diff=$( { diff -B -w $cg_out $gt_cg_out; } 2>&1 )
+    else
+      echo "ERROR WHILE RUNNING GRADER SCRIPT: error or not_error in $tests?"
+      exit 0
+    fi
+
+    if [[ $_diff ]] ; then
+        # sad.. difference found
+        echo "TEST $i FAILED"
+        let failed=$failed+1
+
+        echo "=================================================================="
+        echo $_diff
+        echo "=================================================================="
+        echo -e "${EMPH}Test this yourself by running the following${DEEMPH}: "
+        echo "  (cd test/; ./$cg --batch $manifest)"
+        echo "  (cd test/; ./$vm --batch $vm_manifest)"
+        echo ""
+    else
+        # yay! test passed
+        echo "TEST $i PASSED"
+        let passed=$passed+1
+    fi
+    let i=$i+1
+
+done < "$tests"
+
+echo "# of tests       : $i"
+echo "# of tests passed: $passed"
+echo "# of tests failed: $failed"
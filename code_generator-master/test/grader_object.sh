@@ -0,0 +1,137 @@
+tests="tests.txt"
+cg="../code_generator.out"
+vm="../vm/vm.out"
+EMPH='\033[1;31m'
+GREEN_EMPH='\033[1;32m'
+DEEMPH='\033[0m'
+timeout=1s
+
+i=0
+passed=0
+failed=0
+
+# check if cg.out, vm.out and tests.txt exists
+if [[ -e $cg && -e $vm && -e $tests ]] ; then
+    echo "$cg, $vm and $tests are found. Starting tests.."
+else
+    echo "$cg, $vm or $tests could not be found! Aborting.."
+    exit
+fi
+
+# Reports the result of test $i: passed if $_diff is empty, failed otherwise,
+#   with $_diff and the commands in $_commands to run it again.
+report() {
+    if [[ $_diff ]] ; then
+        # sad.. difference found
+        echo "TEST $i FAILED"
+        let failed=$failed+1
+
+        echo "=================================================================="
+        echo $_diff
+        echo "=================================================================="
+        echo -e "${EMPH}Test this yourself by running the following${DEEMPH}: "
+        echo -e "$_commands"
+        echo ""
+    else
+        # yay! test passed
+        echo "TEST $i PASSED"
+        let passed=$passed+1
+    fi
+    let i=$i+1
+}
+
+# Same test cases as grader.sh, the code generator writing each PM/0 code as a
+#   binary object file (cg_out with the .obj extension, --format=binary). The
+#   vm runs it twice: from the file, which it maps, and from a pipe, which it
+#   reads into memory instead. Both outputs are to match the ground truth.
+first_obj=""
+while read is_err cg_in cg_out others; do
+    echo -e "${GREEN_EMPH}TEST[$i]${DEEMPH}"
+    # resolve others depending on whether it is an error case or not
+    if [ "$is_err" = "not_error" ]; then
+      others_array=($others)
+      vm_inp=${others_array[0]}
+      vm_out=${others_array[1]}
+      gt_vm_out=${others_array[2]}
+    elif [ "$is_err" = "error" ]; then
+      gt_cg_out=$others
+    else
+      echo "ERROR WHILE RUNNING GRADER SCRIPT: error or not_error in $tests?"
+      exit 0
+    fi
+
+    # create directories if needed
+    mkdir -p "$(dirname "$cg_out")"
+    obj="${cg_out%.txt}.obj"
+
+    # run the code generator
+    (timeout $timeout "$cg" --format=binary "$cg_in" "$obj") > /dev/null 2>&1
+
+    if [ "$is_err" = "error" ]; then
+      # an error is written as text whatever the format
+      _diff=$( { diff -B -w $obj $gt_cg_out; } 2>&1 )
+      _commands="  (cd test/; ./$cg --format=binary $cg_in $obj)"
+    else
+      mkdir -p "$(dirname "$vm_out")"
+      vm_out_pipe="${vm_out%.txt}_pipe.txt"
+      [[ $first_obj ]] || first_obj=$obj
+
+      (timeout $timeout "$vm" --trace=none "$obj" /dev/null "$vm_inp" "$vm_out") > /dev/null 2>&1
+      (cat "$obj" | timeout $timeout "$vm" --trace=none /dev/stdin /dev/null "$vm_inp" "$vm_out_pipe") > /dev/null 2>&1
+
+      _diff=$( { diff -B -w $vm_out $gt_vm_out; diff -B -w $vm_out_pipe $gt_vm_out; } 2>&1 )
+      _commands="  (cd test/; ./$cg --format=binary $cg_in $obj)\n"
+      _commands+="  (cd test/; ./$vm --trace=none $obj /dev/null $vm_inp $vm_out)\n"
+      _commands+="  (cd test/; cat $obj | ./$vm --trace=none /dev/stdin /dev/null $vm_inp $vm_out_pipe)"
+    fi
+
+    report
+done < "$tests"
+
+# Object files made invalid from the first one above, each expected to be
+#   rejected with the diagnostic of io/object/(case).txt on stderr, and nothing
+#   run. Each is run from the file and from a pipe. None of the changes depends
+#   on the byte order of the machine.
+size=$(wc -c < "$first_obj")
+out_dir="io/your_outputs/object"
+mkdir -p "$out_dir"
+
+for case in bad_magic bad_version truncated_header truncated_body checksum_mismatch code_limit ; do
+    bad_obj="$out_dir/$case.obj"
+    flags="--trace=none"
+
+    case $case in
+      bad_magic)         { printf 'PM0X'; tail -c +5 "$first_obj"; } > "$bad_obj" ;;
+      bad_version)       { head -c 4 "$first_obj"; printf '\377\377\377\377'; tail -c +9 "$first_obj"; } > "$bad_obj" ;;
+      truncated_header)  head -c 10 "$first_obj" > "$bad_obj" ;;
+      truncated_body)    head -c $((size - 8)) "$first_obj" > "$bad_obj" ;;
+      checksum_mismatch) { head -c $((size - 1)) "$first_obj"; printf '\125'; } > "$bad_obj" ;;
+      code_limit)        cp "$first_obj" "$bad_obj"; flags="$flags --code-limit=2" ;;
+    esac
+
+    for from in file pipe ; do
+        echo -e "${GREEN_EMPH}TEST[$i]${DEEMPH}"
+        err="$out_dir/${case}_$from.err"
+        vm_out="$out_dir/${case}_$from.txt"
+        rm -f "$vm_out"
+
+        if [ "$from" = "file" ]; then
+          (timeout $timeout "$vm" $flags "$bad_obj" /dev/null /dev/null "$vm_out") > /dev/null 2> "$err"
+          _commands="  (cd test/; ./$vm $flags $bad_obj /dev/null /dev/null $vm_out)"
+        else
+          (cat "$bad_obj" | timeout $timeout "$vm" $flags /dev/stdin /dev/null /dev/null "$vm_out") > /dev/null 2> "$err"
+          _commands="  (cd test/; cat $bad_obj | ./$vm $flags /dev/stdin /dev/null /dev/null $vm_out)"
+        fi
+
+        _diff=$( { diff -B -w $err io/object/$case.txt; } 2>&1 )
+        if [[ -s $vm_out ]] ; then
+            _diff="$_diff $bad_obj was run, writing $vm_out"
+        fi
+
+        report
+    done
+done
+
+echo "# of tests       : $i"
+echo "# of tests passed: $passed"
+echo "# of tests failed: $failed"
@@ -0,0 +1,87 @@
+tests="tests.txt"
+pipeline="${PIPELINE:-../pipeline.out}"
+pipeline_flags="$PIPELINE_FLAGS"
+EMPH='\033[1;31m'
+GREEN_EMPH='\033[1;32m'
+DEEMPH='\033[0m'
+timeout=1s
+
+i=0
+passed=0
+failed=0
+
+# check if pipeline.out and tests.txt exists
+if [[ -e $pipeline && -e $tests ]] ; then
+    echo "$pipeline and $tests are found. Starting tests.."
+else
+    echo "$pipeline or $tests could not be found! Aborting.."
+    exit
+fi
+
+# Same test cases as grader.sh, but each PL/0 code (pl0_code.txt next to cg_in)
+#   is run by the single pipeline executable. The code generator output is
+#   taken from its --dump-code file.
+# With RECOMPILE_FROM set to a sed script, each PL/0 code is compiled
+#   incrementally from the copy the script edits it into (--recompile-from).
+while read is_err cg_in cg_out others; do
+    echo -e "${GREEN_EMPH}TEST[$i]${DEEMPH}"
+    pl0_code="$(dirname "$cg_in")/pl0_code.txt"
+
+    # resolve others depending on whether it is an error case or not
+    if [ "$is_err" = "not_error" ]; then
+      others_array=($others)
+      vm_inp=${others_array[0]}
+      vm_out=${others_array[1]}
+      gt_vm_out=${others_array[2]}
+    elif [ "$is_err" = "error" ]; then
+      gt_cg_out=$others
+      vm_inp=/dev/null
+      vm_out=/dev/null
+    else
+      echo "ERROR WHILE RUNNING GRADER SCRIPT: error or not_error in $tests?"
+      exit 0
+    fi
+
+    # create directories if needed
+    mkdir -p "$(dirname "$cg_out")"
+    mkdir -p "$(dirname "$vm_out")"
+
+    flags=$pipeline_flags
+    if [ -n "$RECOMPILE_FROM" ]; then
+      pl0_base="$(dirname "$cg_out")/pl0_base.txt"
+      sed -e "$RECOMPILE_FROM" "$pl0_code" > "$pl0_base"
+      flags="$flags --recompile-from=$pl0_base"
+    fi
+
+    # run the whole pipeline
+    (timeout $timeout "$pipeline" $flags --dump-code="$cg_out" "$pl0_code" "$vm_inp" "$vm_out") > /dev/null 2>&1
+
+    if [ "$is_err" = "error" ]; then
+      _diff=$( { diff -B -w $cg_out $gt_cg_out; } 2>&1 )
+    else
+      _diff=$( { diff -B -w $vm_out $gt_vm_out; } 2>&1 )
+    fi
+
+    if [[ $_diff ]] ; then
+        # sad.. difference found
+        echo "TEST $i FAILED"
+        let failed=$failed+1
+
+        echo "=================================================================="
+        echo $_diff
+        echo "=================================================================="
+        echo -e "${EMPH}Test this yourself by running the following${DEEMPH}: "
+        echo "  (cd test/; ./$pipeline $flags --dump-code=$cg_out $pl0_code $vm_inp $vm_out)"
+        echo ""
+    else
+        # yay! test passed
+        echo "TEST $i PASSED"
+        let passed=$passed+1
+    fi
+    let i=$i+1
+
+done < "$tests"
+
+echo "# of tests       : $i"
+echo "# of tests passed: $passed"
+echo "# of tests failed: $failed"
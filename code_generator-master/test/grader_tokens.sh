@@ -0,0 +1,108 @@
+tests="tests.txt"
+la="../la.out"
+cg="../code_generator.out"
+EMPH='\033[1;31m'
+GREEN_EMPH='\033[1;32m'
+DEEMPH='\033[0m'
+timeout=1s
+
+i=0
+passed=0
+failed=0
+
+# check if la.out, cg.out and tests.txt exists
+if [[ -e $la && -e $cg && -e $tests ]] ; then
+    echo "$la, $cg and $tests are found. Starting tests.."
+else
+    echo "$la, $cg or $tests could not be found! Aborting.."
+    exit
+fi
+
+# Reports the result of test $i: passed if $_diff is empty, failed otherwise,
+#   with $_diff and the commands in $_commands to run it again.
+report() {
+    if [[ $_diff ]] ; then
+        # sad.. difference found
+        echo "TEST $i FAILED"
+        let failed=$failed+1
+
+        echo "=================================================================="
+        echo $_diff
+        echo "=================================================================="
+        echo -e "${EMPH}Test this yourself by running the following${DEEMPH}: "
+        echo -e "$_commands"
+        echo ""
+    else
+        # yay! test passed
+        echo "TEST $i PASSED"
+        let passed=$passed+1
+    fi
+    let i=$i+1
+}
+
+# Same test cases as grader.sh, each pl0_code.txt lexed by the lexer of the
+#   lexical analyzer assignment (la.out) twice: as a text token list, which is
+#   to be cg_in without the success message, and as a binary token stream
+#   (--format=binary, next to cg_out with the .tokens extension). The code
+#   generator compiles both, and the two outputs are to be the same.
+first_stream=""
+while read is_err cg_in cg_out others; do
+    echo -e "${GREEN_EMPH}TEST[$i]${DEEMPH}"
+
+    # create directories if needed
+    out_dir=$(dirname "$cg_out")
+    mkdir -p "$out_dir"
+
+    pl0_code="$(dirname "$cg_in")/pl0_code.txt"
+    text="$out_dir/lexer_out.txt"
+    stream="$out_dir/lexer_out.tokens"
+    cg_out_text="$out_dir/cg_out_text.txt"
+    cg_out_stream="$out_dir/cg_out_tokens.txt"
+    [[ $first_stream ]] || first_stream=$stream
+
+    # lex both ways, then compile both
+    (timeout $timeout "$la" "$pl0_code" "$text.la") > /dev/null 2>&1
+    sed '1,2d' "$text.la" > "$text"
+    (timeout $timeout "$la" --format=binary "$pl0_code" "$stream") > /dev/null 2>&1
+
+    (timeout $timeout "$cg" "$text" "$cg_out_text") > /dev/null 2>&1
+    (timeout $timeout "$cg" "$stream" "$cg_out_stream") > /dev/null 2>&1
+
+    _diff=$( { diff -B -w $text $cg_in; diff $cg_out_text $cg_out_stream; } 2>&1 )
+    _commands="  (cd test/; ./$la $pl0_code $text.la; sed '1,2d' $text.la > $text)\n"
+    _commands+="  (cd test/; ./$la --format=binary $pl0_code $stream)\n"
+    _commands+="  (cd test/; ./$cg $text $cg_out_text; ./$cg $stream $cg_out_stream)"
+
+    report
+done < "$tests"
+
+# Token streams made invalid from the first one above, each expected to be
+#   rejected with the diagnostic of io/tokens/(case).txt on stderr, leaving the
+#   code generator with no tokens. None of the changes depends on the byte
+#   order of the machine.
+out_dir="io/your_outputs/tokens"
+mkdir -p "$out_dir"
+
+for case in lexeme_out_of_bounds truncated ; do
+    echo -e "${GREEN_EMPH}TEST[$i]${DEEMPH}"
+    bad_stream="$out_dir/$case.tokens"
+    err="$out_dir/$case.err"
+    bad_cg_out="$out_dir/${case}_cg_out.txt"
+
+    case $case in
+      # no lexeme bytes: the lexeme of the first token is past the end
+      lexeme_out_of_bounds) { head -c 12 "$first_stream"; printf '\0\0\0\0'; tail -c +17 "$first_stream"; } > "$bad_stream" ;;
+      truncated)            head -c 40 "$first_stream" > "$bad_stream" ;;
+    esac
+
+    (timeout $timeout "$cg" "$bad_stream" "$bad_cg_out") > /dev/null 2> "$err"
+
+    _diff=$( { diff -B -w $err io/tokens/$case.txt; diff -B -w $bad_cg_out io/tokens/cg_out.txt; } 2>&1 )
+    _commands="  (cd test/; ./$cg $bad_stream $bad_cg_out)"
+
+    report
+done
+
+echo "# of tests       : $i"
+echo "# of tests passed: $passed"
+echo "# of tests failed: $failed"
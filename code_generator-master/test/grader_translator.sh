@@ -0,0 +1,86 @@
+tests="tests.txt"
+cg="../code_generator.out"
+translator="../translator.out"
+EMPH='\033[1;31m'
+GREEN_EMPH='\033[1;32m'
+DEEMPH='\033[0m'
+timeout=1s
+
+i=0
+passed=0
+failed=0
+
+# check if cg.out, translator.out and tests.txt exists
+if [[ -e $cg && -e $translator && -e $tests ]] ; then
+    echo "$cg, $translator and $tests are found. Starting tests.."
+else
+    echo "$cg, $translator or $tests could not be found! Aborting.."
+    exit
+fi
+
+# Same test cases as grader.sh, but the pm0 code in cg_out is translated into
+#   C (native.c next to cg_out), compiled with gcc (native.out) and run
+#   natively instead of on the vm.
+while read is_err cg_in cg_out others; do
+    echo -e "${GREEN_EMPH}TEST[$i]${DEEMPH}"
+    # resolve others depending on whether it is an error case or not
+    if [ "$is_err" = "not_error" ]; then
+      others_array=($others)
+      vm_inp=${others_array[0]}
+      vm_out=${others_array[1]}
+      gt_vm_out=${others_array[2]}
+    elif [ "$is_err" = "error" ]; then
+      gt_cg_out=$others
+    else
+      echo "ERROR WHILE RUNNING GRADER SCRIPT: error or not_error in $tests?"
+      exit 0
+    fi
+
+    # create directories if needed
+    mkdir -p "$(dirname "$cg_out")"
+    mkdir -p "$(dirname "$vm_out")"
+    native_c="$(dirname "$cg_out")/native.c"
+    native="$(dirname "$cg_out")/native.out"
+
+    # run the code generator
+    (timeout $timeout "$cg" "$cg_in" "$cg_out") > /dev/null 2>&1
+
+    if [ "$is_err" = "error" ]; then
+      _diff=$( { diff -B -w $cg_out $gt_cg_out; } 2>&1 )
+    else
+      # translate the code, compile it and run it
+      rm -f "$native_c" "$native" "$vm_out"
+      "$translator" "$cg_out" "$native_c" > /dev/null 2>&1
+      gcc -O2 -o "$native" "$native_c" -pthread > /dev/null 2>&1
+      (timeout $timeout "./$native" "$vm_inp" "$vm_out") > /dev/null 2>&1
+
+      _diff=$( { diff -B -w $vm_out $gt_vm_out; } 2>&1 )
+    fi
+
+    if [[ $_diff ]] ; then
+        # sad.. difference found
+        echo "TEST $i FAILED"
+        let failed=$failed+1
+
+        echo "=================================================================="
+        echo $_diff
+        echo "=================================================================="
+        echo -e "${EMPH}Test this yourself by running the following${DEEMPH}: "
+        echo "  (cd test/; ./$cg $cg_in $cg_out)"
+        if [ "$is_err" = "not_error" ]; then
+          echo "  (cd test/; ./$translator $cg_out $native_c)"
+          echo "  (cd test/; gcc -O2 -o $native $native_c -pthread; ./$native $vm_inp $vm_out)"
+        fi
+        echo ""
+    else
+        # yay! test passed
+        echo "TEST $i PASSED"
+        let passed=$passed+1
+    fi
+    let i=$i+1
+
+done < "$tests"
+
+echo "# of tests       : $i"
+echo "# of tests passed: $passed"
+echo "# of tests failed: $failed"
@@ -0,0 +1,117 @@
+tests="tests_vm.txt"
+vm="../vm/vm.out"
+EMPH='\033[1;31m'
+GREEN_EMPH='\033[1;32m'
+DEEMPH='\033[0m'
+timeout=1s
+
+i=0
+passed=0
+failed=0
+
+# check if vm.out and tests_vm.txt exists
+if [[ -e $vm && -e $tests ]] ; then
+    echo "$vm and $tests are found. Starting tests.."
+else
+    echo "$vm or $tests could not be found! Aborting.."
+    exit
+fi
+
+# Reports the result of test $i: passed if $_diff is empty, failed otherwise,
+#   with $_diff and the commands in $_commands to run it again.
+report() {
+    if [[ $_diff ]] ; then
+        # sad.. difference found
+        echo "TEST $i FAILED"
+        let failed=$failed+1
+
+        echo "=================================================================="
+        echo $_diff
+        echo "=================================================================="
+        echo -e "${EMPH}Test this yourself by running the following${DEEMPH}: "
+        echo -e "$_commands"
+        echo ""
+    else
+        # yay! test passed
+        echo "TEST $i PASSED"
+        let passed=$passed+1
+    fi
+    let i=$i+1
+}
+
+# Test cases of the vm on its own, on PM/0 codes written by hand rather than
+#   generated, each run with the options given after its files.
+# inp      : The PM/0 code, as text or as an object file.
+# out      : The simulation output of the vm: the code memory and the trace.
+# vm_inp   : Input to the PM/0 code. Might be /dev/null.
+# vm_out   : Output of the PM/0 code. What the vm prints on stderr is written
+#            next to it, with the .err extension.
+# gt_out, gt_vm_out, gt_err: The expected out, vm_out and stderr. vm_out is
+#            compared as it is, white space included, since the numbers the
+#            code writes are not separated.
+while read inp out vm_inp vm_out gt_out gt_vm_out gt_err flags ; do
+    echo -e "${GREEN_EMPH}TEST[$i]${DEEMPH}"
+
+    # create directories if needed
+    mkdir -p "$(dirname "$out")"
+    mkdir -p "$(dirname "$vm_out")"
+    err="${vm_out%.txt}.err"
+
+    # run the vm
+    (timeout $timeout "$vm" $flags "$inp" "$out" "$vm_inp" "$vm_out") > /dev/null 2> "$err"
+
+    # compare the outputs with the ground truth
+    _diff=""
+    for pair in "-B -w $out $gt_out" "-- $vm_out $gt_vm_out" "-B -w $err $gt_err" ; do
+        set -- $pair
+        if [[ $(diff "$@" 2>&1) ]] ; then
+            _diff="$_diff There is difference between ${@: -2:1} and ${@: -1}."
+        fi
+    done
+    _commands="  (cd test/; ./$vm $flags $inp $out $vm_inp $vm_out)"
+
+    report
+done < "$tests"
+
+# An interactive run (--interactive) is to write the output of the code as soon
+#   as it is written, and to read its input a line at a time: the code of
+#   io/vm/sio_interactive writes 1, reads a number and writes it back. The
+#   number is given only once the 1 is read, and it is to be written back while
+#   the input is still open. The input and the output are fifos, opened for
+#   reading and writing so that neither open waits for the vm.
+inp="io/vm/sio_interactive/ins.txt"
+out_dir="io/your_outputs/vm/sio_interactive"
+mkdir -p "$out_dir"
+
+for engine in switch threaded jit ; do
+    echo -e "${GREEN_EMPH}TEST[$i]${DEEMPH}"
+    flags="--interactive --engine=$engine --trace=none"
+    fifo_in="$out_dir/$engine.in"
+    fifo_out="$out_dir/$engine.out"
+    rm -f "$fifo_in" "$fifo_out"
+    mkfifo "$fifo_in" "$fifo_out"
+
+    exec 3<> "$fifo_in" 4<> "$fifo_out"
+    (timeout $timeout "$vm" $flags "$inp" /dev/null "$fifo_in" "$fifo_out") > /dev/null 2>&1 &
+
+    written=""
+    read -t 1 -N 1 first <&4 && written="$first"
+    echo 5 >&3
+    read -t 1 -N 1 second <&4 && written="$written$second"
+
+    exec 3>&- 4<&-
+    wait
+    rm -f "$fifo_in" "$fifo_out"
+
+    _diff=""
+    if [ "$written" != "15" ] ; then
+        _diff="The vm wrote \"$written\" before its input ended, instead of \"15\"."
+    fi
+    _commands="  (cd test/; ./$vm $flags $inp /dev/null /dev/stdin /dev/stdout)"
+
+    report
+done
+
+echo "# of tests       : $i"
+echo "# of tests passed: $passed"
+echo "# of tests failed: $failed"
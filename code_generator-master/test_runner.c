@@ -0,0 +1,787 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "token.h"
+#include "data.h"
+#include "arena.h"
+#include "code_generator.h"
+#include "lexer/lexical_analyzer.h"
+#include "vm/vm.h"
+#include "vm/runner.h"
+
+/**
+ * Runs the test cases of test/tests.txt in a single process, the lexer, the
+ * code generator and the virtual machine being called directly instead of
+ * run as executables, and grades them as test/grader.sh does.
+ *
+ * A line of the test file is, as grader.sh reads it, either
+ *   not_error cg_in cg_out vm_inp vm_out gt_vm_out
+ *   error     cg_in cg_out gt_cg_out
+ * cg_in is the token list the code of the case is generated from. The PL/0
+ * code next to it (pl0_code.txt) is lexed as well, and its tokens should be
+ * those of cg_in. The code of a not_error case is run on vm_inp, and its
+ * output should be gt_vm_out; the code generator error of an error case should
+ * be gt_cg_out. cg_out and vm_out are not written: the outputs are kept in
+ * memory and compared there, empty lines and white space being ignored, as
+ * diff -B -w does.
+ *
+ * The cases are run by a fixed number of worker threads, each with its own
+ * compiler context, arena and machine, taken from a VMPool. Each case is
+ * limited in the CPU time of the thread running it: a watchdog, the calling
+ * thread, interrupts the virtual machine of a case past the limit, which
+ * then fails. The results are printed in the order of the test file once all
+ * the cases ran, with the CPU time each stage took.
+ * */
+
+/**
+ * The CPU time a case could take when no limit is given, in milliseconds: the
+ * timeout of grader.sh.
+ * */
+#define TEST_RUNNER_DEFAULT_CPU_LIMIT 1000
+
+/**
+ * The time the watchdog sleeps between two looks at the workers, in
+ * nanoseconds.
+ * */
+#define TEST_RUNNER_WATCH_INTERVAL 2000000L
+
+/**
+ * The stages of a case, in the order they run.
+ * */
+typedef enum {
+    TEST_STAGE_LEX,
+    TEST_STAGE_CG,
+    TEST_STAGE_VM,
+    TEST_STAGES
+} TestStage;
+
+/**
+ * What happened to a case.
+ *  TEST_PENDING: it is not run yet
+ *  TEST_PASSED : its outputs are those of the ground truth
+ *  TEST_FAILED : an output differs from the ground truth, see message
+ *  TEST_TIMEOUT: it took more CPU time than the limit
+ *  TEST_ERROR  : a file of the case could not be read, see message
+ * */
+typedef enum {
+    TEST_PENDING,
+    TEST_PASSED,
+    TEST_FAILED,
+    TEST_TIMEOUT,
+    TEST_ERROR
+} TestStatus;
+
+/**
+ * A case of the test file, and what happened to it.
+ * isError    : 1 for an error case, whose code generation should fail
+ * cgIn       : the token list the code is generated from
+ * pl0Code    : the PL/0 code next to cgIn, lexed into the same tokens
+ * vmIn       : the input of the program, not_error only
+ * groundTruth: gt_vm_out, or gt_cg_out for an error case
+ * stageTimes : the CPU time each stage took, in nanoseconds
+ * cpuTime    : the CPU time the whole case took, in nanoseconds
+ * interrupt  : set by the watchdog to halt the program past the limit
+ * message    : why the case failed
+ * */
+typedef struct {
+    int isError;
+    char* cgIn;
+    char* pl0Code;
+    char* vmIn;
+    char* groundTruth;
+
+    TestStatus status;
+    long long stageTimes[TEST_STAGES];
+    long long cpuTime;
+    volatile int interrupt;
+    char message[512];
+} TestCase;
+
+/**
+ * The cases of a test file, in its order.
+ * */
+typedef struct {
+    TestCase* cases;
+    int numOfCases;
+    int capacity;
+} TestSuite;
+
+/**
+ * A worker, the case it runs and the CPU clock of its thread when the case
+ * started, which the watchdog reads. current is -1 between two cases.
+ * */
+typedef struct {
+    pthread_t thread;
+    clockid_t clock;
+    int hasClock;
+    int current;
+    long long started;
+    pthread_mutex_t lock;
+    struct TestRunner* runner;
+} TestWorker;
+
+/**
+ * State shared by the workers: the cases, the index of the next one to run,
+ * the number of workers done, and the pool the machines come from.
+ * */
+typedef struct TestRunner {
+    TestSuite* suite;
+    VMPool pool;
+    long long cpuLimit;
+    int next;
+    int finished;
+    pthread_mutex_t lock;
+} TestRunner;
+
+/**
+ * Returns the CPU time of the given clock in nanoseconds.
+ * */
+long long readCPUClock(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * Returns the content of the file of the given path, null terminated, which
+ * should be freed by the caller, or NULL if it could not be read. length is set
+ * to the number of characters read, if not NULL.
+ * */
+char* readWholeFile(const char* path, size_t* length)
+{
+    FILE* in = fopen(path, "rb");
+    if(!in) return NULL;
+
+    size_t size = 0, capacity = 4096;
+    char* text = malloc(capacity);
+
+    while(text)
+    {
+        size += fread(text + size, 1, capacity - size - 1, in);
+        if(size < capacity - 1) break;
+
+        char* grown = realloc(text, capacity * 2);
+        if(!grown) free(text);
+
+        text = grown;
+        capacity *= 2;
+    }
+
+    if(text && ferror(in))
+    {
+        free(text);
+        text = NULL;
+    }
+
+    fclose(in);
+
+    if(!text) return NULL;
+
+    text[size] = '\0';
+    if(length) *length = size;
+
+    return text;
+}
+
+/**
+ * Returns a copy of the given path, which should be freed by the caller.
+ * */
+char* copyPath(const char* path)
+{
+    char* copy = malloc(strlen(path) + 1);
+    if(copy) strcpy(copy, path);
+
+    return copy;
+}
+
+/**
+ * Returns the path of the PL/0 code next to the given token list, which should
+ * be freed by the caller.
+ * */
+char* getPL0CodePath(const char* cgIn)
+{
+    const char* slash = strrchr(cgIn, '/');
+    size_t dirLength = slash ? (size_t)(slash - cgIn + 1) : 0;
+
+    char* path = malloc(dirLength + sizeof("pl0_code.txt"));
+    if(!path) return NULL;
+
+    memcpy(path, cgIn, dirLength);
+    strcpy(path + dirLength, "pl0_code.txt");
+
+    return path;
+}
+
+/**
+ * Reads the test file from the given file into the given suite. Returns 0 on
+ * success, or the number of the first line that is not a case, -1 if no memory
+ * could be allocated. The suite should be deleted by deleteTestSuite() in any
+ * case.
+ * */
+int readTestSuite(FILE* in, TestSuite* suite)
+{
+    char line[4096], kind[16], fields[5][1024];
+    int lineNum = 0;
+
+    suite->cases = NULL;
+    suite->numOfCases = suite->capacity = 0;
+
+    while(fgets(line, sizeof(line), in))
+    {
+        lineNum++;
+
+        int numOfFields = sscanf(line, "%15s %1023s %1023s %1023s %1023s %1023s",
+            kind, fields[0], fields[1], fields[2], fields[3], fields[4]);
+
+        if(numOfFields <= 0) continue;
+
+        int isError = !strcmp(kind, "error");
+        if(isError ? numOfFields != 4 : (strcmp(kind, "not_error") || numOfFields != 6)) return lineNum;
+
+        if(suite->numOfCases == suite->capacity)
+        {
+            int capacity = suite->capacity ? suite->capacity * 2 : 64;
+            TestCase* cases = realloc(suite->cases, capacity * sizeof(TestCase));
+            if(!cases) return -1;
+
+            suite->cases = cases;
+            suite->capacity = capacity;
+        }
+
+        TestCase* test = &suite->cases[suite->numOfCases++];
+        memset(test, 0, sizeof(TestCase));
+
+        test->isError = isError;
+        test->status = TEST_PENDING;
+        test->cgIn = copyPath(fields[0]);
+        test->pl0Code = getPL0CodePath(fields[0]);
+        test->vmIn = copyPath(isError ? "/dev/null" : fields[2]);
+        test->groundTruth = copyPath(isError ? fields[2] : fields[4]);
+
+        if(!test->cgIn || !test->pl0Code || !test->vmIn || !test->groundTruth) return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Releases the cases of the given suite.
+ * */
+void deleteTestSuite(TestSuite* suite)
+{
+    int i;
+    for(i = 0; i < suite->numOfCases; i++)
+    {
+        free(suite->cases[i].cgIn);
+        free(suite->cases[i].pl0Code);
+        free(suite->cases[i].vmIn);
+        free(suite->cases[i].groundTruth);
+    }
+
+    free(suite->cases);
+
+    suite->cases = NULL;
+    suite->numOfCases = suite->capacity = 0;
+}
+
+/**
+ * Returns whether the given character is white space for diff -w.
+ * */
+int isDiffSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**
+ * Advances the given text past the empty lines and the white space that starts
+ * the next line. Returns 0 at the end of the text.
+ * */
+int skipEmptyLines(const char** text)
+{
+    while(**text && (isDiffSpace(**text) || **text == '\n')) (*text)++;
+
+    return **text != '\0';
+}
+
+/**
+ * Compares the given output with the expected one as diff -B -w does: the
+ * empty lines and the white space are ignored. Returns 0 if they are the same,
+ * otherwise the number of the first line of expected that differs, counted
+ * without the empty lines.
+ * */
+int compareOutputs(const char* output, const char* expected)
+{
+    int lineNum = 0;
+
+    for(;;)
+    {
+        int hasOutput = skipEmptyLines(&output);
+        int hasExpected = skipEmptyLines(&expected);
+
+        if(!hasOutput && !hasExpected) return 0;
+
+        lineNum++;
+        if(hasOutput != hasExpected) return lineNum;
+
+        // Compare the lines up to their end, white space skipped
+        while(*output && *output != '\n' && *expected && *expected != '\n')
+        {
+            if(isDiffSpace(*output))        output++;
+            else if(isDiffSpace(*expected)) expected++;
+            else if(*output != *expected)   return lineNum;
+            else                            { output++; expected++; }
+        }
+
+        while(isDiffSpace(*output)) output++;
+        while(isDiffSpace(*expected)) expected++;
+
+        if((*output && *output != '\n') || (*expected && *expected != '\n')) return lineNum;
+    }
+}
+
+/**
+ * Compares the given output of the case with the file of the given path,
+ * setting the status and the message of the case accordingly.
+ * */
+void gradeOutput(TestCase* test, const char* output, const char* path, const char* what)
+{
+    char* expected = readWholeFile(path, NULL);
+
+    if(!expected)
+    {
+        test->status = TEST_ERROR;
+        snprintf(test->message, sizeof(test->message), "Could not read \"%s\"", path);
+        return;
+    }
+
+    int lineNum = compareOutputs(output, expected);
+
+    if(lineNum)
+    {
+        test->status = TEST_FAILED;
+        snprintf(test->message, sizeof(test->message), "The %s differs from \"%s\" at line %d:\n%s",
+            what, path, lineNum, output);
+    }
+    else test->status = TEST_PASSED;
+
+    free(expected);
+}
+
+/**
+ * Lexes the PL/0 code of the case, if any, and compares its tokens with the
+ * given ones. Returns 0 if they are the same, -1 otherwise, in which case the
+ * case failed.
+ * */
+int lexTestCase(TestCase* test, TokenList tokens, Arena* arena)
+{
+    char* source = readWholeFile(test->pl0Code, NULL);
+
+    // A case without its PL/0 code is only compiled and run
+    if(!source) return 0;
+
+    LexerOut lexerOut = lexicalAnalyzer(source, arena);
+    int differs = -1, i;
+
+    if(lexerOut.lexerError != NONE)
+    {
+        snprintf(test->message, sizeof(test->message), "Lexer error %d at line %d of \"%s\"",
+            (int)lexerOut.lexerError, lexerOut.errorLine, test->pl0Code);
+    }
+    else if(lexerOut.tokenList.numberOfTokens != tokens.numberOfTokens)
+    {
+        snprintf(test->message, sizeof(test->message), "\"%s\" lexed into %d tokens, \"%s\" has %d",
+            test->pl0Code, lexerOut.tokenList.numberOfTokens, test->cgIn, tokens.numberOfTokens);
+    }
+    else
+    {
+        differs = 0;
+
+        for(i = 0; i < tokens.numberOfTokens && !differs; i++)
+        {
+            Token lexed = lexerOut.tokenList.tokens[i];
+
+            if(lexed.id != tokens.tokens[i].id || strcmp(lexed.lexeme, tokens.tokens[i].lexeme))
+            {
+                snprintf(test->message, sizeof(test->message), "Token %d of \"%s\" is %d '%s', %d '%s' in \"%s\"",
+                    i, test->pl0Code, lexed.id, lexed.lexeme, tokens.tokens[i].id, tokens.tokens[i].lexeme, test->cgIn);
+                differs = -1;
+            }
+        }
+    }
+
+    if(differs) test->status = TEST_FAILED;
+
+    deleteLexerOut(&lexerOut);
+    free(source);
+
+    return differs;
+}
+
+/**
+ * Runs the given case: lexes its PL/0 code, generates its code with the given
+ * context and runs it on the given machine, timing each stage on the given CPU
+ * clock of the thread running it, and grades the case.
+ * */
+void runTestCase(TestCase* test, CompilerContext* context, Arena* arena, struct VirtualMachine* vm, clockid_t clock)
+{
+    long long started;
+    Instruction* code = NULL;
+    int numOfIns = 0;
+
+    // The token list the code is generated from
+    FILE* cgIn = fopen(test->cgIn, "rb");
+
+    if(!cgIn)
+    {
+        test->status = TEST_ERROR;
+        snprintf(test->message, sizeof(test->message), "Could not read \"%s\"", test->cgIn);
+        return;
+    }
+
+    TokenList tokens = readTokenList(cgIn, arena);
+    fclose(cgIn);
+
+    // Lexer
+    started = readCPUClock(clock);
+    int err = lexTestCase(test, tokens, arena);
+    test->stageTimes[TEST_STAGE_LEX] = readCPUClock(clock) - started;
+
+    if(err) return;
+
+    // Code generator
+    started = readCPUClock(clock);
+    TokenListIterator it = getTokenListIterator(&tokens);
+    err = codeGeneratorContextToMemory(context, getTokenListSource(&it), &code, &numOfIns,
+        getDefaultCodeGeneratorOptions());
+    test->stageTimes[TEST_STAGE_CG] = readCPUClock(clock) - started;
+
+    if(test->isError || err)
+    {
+        char* output = NULL;
+        size_t length = 0;
+        FILE* out = open_memstream(&output, &length);
+
+        if(out)
+        {
+            if(err) printCGErr(err, out);
+            fclose(out);
+        }
+
+        if(!output)
+        {
+            test->status = TEST_ERROR;
+            snprintf(test->message, sizeof(test->message), "Could not allocate the output");
+        }
+        else if(!test->isError)
+        {
+            test->status = TEST_FAILED;
+            snprintf(test->message, sizeof(test->message), "The code generator failed: %s", output);
+        }
+        else if(!err)
+        {
+            test->status = TEST_FAILED;
+            snprintf(test->message, sizeof(test->message), "The code generator did not fail, \"%s\" expected",
+                test->groundTruth);
+        }
+        else gradeOutput(test, output, test->groundTruth, "code generator error");
+
+        free(output);
+        free(code);
+        return;
+    }
+
+    // Virtual machine, its output kept in memory
+    FILE* vmIn = fopen(test->vmIn, "r");
+    char* output = NULL;
+    size_t length = 0;
+    FILE* vmOut = open_memstream(&output, &length);
+
+    if(!vmIn || !vmOut)
+    {
+        test->status = TEST_ERROR;
+        snprintf(test->message, sizeof(test->message), "Could not open \"%s\"", vmIn ? "the output" : test->vmIn);
+    }
+    else
+    {
+        VMOptions options = getDefaultVMOptions();
+        options.trace = VM_TRACE_NONE;
+        options.interrupt = &test->interrupt;
+
+        started = readCPUClock(clock);
+        simulateCodeOnVM(vm, code, numOfIns, NULL, vmIn, vmOut, options);
+        test->stageTimes[TEST_STAGE_VM] = readCPUClock(clock) - started;
+    }
+
+    if(vmIn) fclose(vmIn);
+    if(vmOut) fclose(vmOut);
+
+    if(output && test->status == TEST_PENDING)
+    {
+        if(test->interrupt) test->status = TEST_TIMEOUT;
+        else                gradeOutput(test, output, test->groundTruth, "vm output");
+    }
+
+    free(output);
+    free(code);
+}
+
+void* runTestWorker(void* arg)
+{
+    TestWorker* worker = arg;
+    TestRunner* runner = worker->runner;
+
+    CompilerContext context;
+    initCompilerContext(&context);
+
+    Arena arena;
+    initArena(&arena);
+
+    struct VirtualMachine* vm = acquireVM(&runner->pool);
+
+    // The CPU time of this thread, the watchdog reads it as well
+    // .. unless it could not be had, in which case the cases are not interrupted
+    clockid_t clock;
+    int hasClock = !pthread_getcpuclockid(pthread_self(), &clock);
+
+    if(!hasClock) clock = CLOCK_THREAD_CPUTIME_ID;
+
+    pthread_mutex_lock(&worker->lock);
+    worker->clock = clock;
+    worker->hasClock = hasClock;
+    pthread_mutex_unlock(&worker->lock);
+
+    for(;;)
+    {
+        pthread_mutex_lock(&runner->lock);
+        int next = (runner->next < runner->suite->numOfCases) ? runner->next++ : -1;
+        pthread_mutex_unlock(&runner->lock);
+
+        if(next < 0) break;
+
+        TestCase* test = &runner->suite->cases[next];
+        long long started = readCPUClock(clock);
+
+        pthread_mutex_lock(&worker->lock);
+        worker->current = next;
+        worker->started = started;
+        pthread_mutex_unlock(&worker->lock);
+
+        if(vm) runTestCase(test, &context, &arena, vm, clock);
+        else
+        {
+            test->status = TEST_ERROR;
+            snprintf(test->message, sizeof(test->message), "Could not create a machine");
+        }
+
+        test->cpuTime = readCPUClock(clock) - started;
+
+        // A case past the limit failed, interrupted or not
+        if(test->cpuTime > runner->cpuLimit && test->status != TEST_ERROR) test->status = TEST_TIMEOUT;
+
+        pthread_mutex_lock(&worker->lock);
+        worker->current = -1;
+        pthread_mutex_unlock(&worker->lock);
+
+        resetArena(&arena);
+    }
+
+    if(vm) releaseVM(&runner->pool, vm);
+    deleteArena(&arena);
+    deleteCompilerContext(&context);
+
+    pthread_mutex_lock(&runner->lock);
+    runner->finished++;
+    pthread_mutex_unlock(&runner->lock);
+
+    return NULL;
+}
+
+/**
+ * Watches the given workers until all of them are done, interrupting the case
+ * each of them runs once it took more CPU time than the limit.
+ * */
+void watchTestWorkers(TestRunner* runner, TestWorker* workers, int numOfWorkers)
+{
+    struct timespec interval = { 0, TEST_RUNNER_WATCH_INTERVAL };
+    int w;
+
+    for(;;)
+    {
+        pthread_mutex_lock(&runner->lock);
+        int done = (runner->finished == numOfWorkers);
+        pthread_mutex_unlock(&runner->lock);
+
+        if(done) break;
+
+        for(w = 0; w < numOfWorkers; w++)
+        {
+            pthread_mutex_lock(&workers[w].lock);
+
+            if(workers[w].hasClock && workers[w].current >= 0 &&
+               readCPUClock(workers[w].clock) - workers[w].started > runner->cpuLimit)
+                runner->suite->cases[workers[w].current].interrupt = 1;
+
+            pthread_mutex_unlock(&workers[w].lock);
+        }
+
+        nanosleep(&interval, NULL);
+    }
+}
+
+/**
+ * Runs the cases of the given suite on the given number of worker threads, 0
+ * for one per online processor, each case limited to cpuLimit nanoseconds of
+ * CPU time. Returns the number of workers used, or -1 if none could be started.
+ * */
+int runTestSuite(TestSuite* suite, int workers, long long cpuLimit)
+{
+    if(workers <= 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = online > 0 ? (int)online : 1;
+    }
+
+    if(workers > suite->numOfCases) workers = suite->numOfCases > 0 ? suite->numOfCases : 1;
+
+    TestWorker* pool = calloc(workers, sizeof(TestWorker));
+    if(!pool) return -1;
+
+    TestRunner runner;
+    runner.suite = suite;
+    runner.cpuLimit = cpuLimit;
+    runner.next = 0;
+    runner.finished = 0;
+    pthread_mutex_init(&runner.lock, NULL);
+    initVMPool(&runner.pool, VM_DEFAULT_STACK_LIMIT);
+
+    int started = 0, w;
+    for(w = 0; w < workers; w++)
+    {
+        pool[w].current = -1;
+        pool[w].runner = &runner;
+        pthread_mutex_init(&pool[w].lock, NULL);
+    }
+
+    // The calling thread is the watchdog
+    for(w = 0; w < workers; w++)
+    {
+        if(pthread_create(&pool[w].thread, NULL, runTestWorker, &pool[w])) break;
+        started++;
+    }
+
+    watchTestWorkers(&runner, pool, started);
+
+    for(w = 0; w < started; w++) pthread_join(pool[w].thread, NULL);
+    for(w = 0; w < workers; w++) pthread_mutex_destroy(&pool[w].lock);
+
+    deleteVMPool(&runner.pool);
+    pthread_mutex_destroy(&runner.lock);
+    free(pool);
+
+    return started ? started : -1;
+}
+
+/**
+ * Prints the result of each case of the given suite on the given file, with
+ * the CPU time of its stages, followed by the number of cases passed and
+ * failed, as grader.sh does. Returns the number of cases failed.
+ * */
+int printTestResults(const TestSuite* suite, int workers, long long wallTime, FILE* out)
+{
+    static const char* statusNames[] = { "PENDING", "PASSED", "FAILED", "TIMED OUT", "FAILED" };
+    int passed = 0, i;
+
+    for(i = 0; i < suite->numOfCases; i++)
+    {
+        const TestCase* test = &suite->cases[i];
+
+        fprintf(out, "TEST %d %s lex_cpu_ns=%lld cg_cpu_ns=%lld vm_cpu_ns=%lld cpu_ns=%lld\n",
+            i, statusNames[test->status], test->stageTimes[TEST_STAGE_LEX], test->stageTimes[TEST_STAGE_CG],
+            test->stageTimes[TEST_STAGE_VM], test->cpuTime);
+
+        if(test->status == TEST_PASSED) passed++;
+        else if(test->status == TEST_TIMEOUT)
+            fprintf(out, "   \"%s\" took more CPU time than the limit\n", test->cgIn);
+        else
+            fprintf(out, "   %s: %s\n", test->cgIn, test->message);
+    }
+
+    fprintf(out, "# of workers     : %d\n", workers);
+    fprintf(out, "wall_ns          : %lld\n", wallTime);
+    fprintf(out, "# of tests       : %d\n", suite->numOfCases);
+    fprintf(out, "# of tests passed: %d\n", passed);
+    fprintf(out, "# of tests failed: %d\n", suite->numOfCases - passed);
+
+    return suite->numOfCases - passed;
+}
+
+int main(int argc, char **argv)
+{
+    int workers = 0, cpuLimit = TEST_RUNNER_DEFAULT_CPU_LIMIT, i;
+    const char* tests = "tests.txt";
+
+    for(i = 1; i < argc; i++)
+    {
+        if( !strncmp(argv[i], "--jobs=", 7) && atoi(argv[i] + 7) > 0 )           workers = atoi(argv[i] + 7);
+        else if( !strncmp(argv[i], "--cpu-limit=", 12) && atoi(argv[i] + 12) > 0 ) cpuLimit = atoi(argv[i] + 12);
+        else if( strncmp(argv[i], "--", 2) && i == argc - 1 )                      tests = argv[i];
+        else
+        {
+            fprintf(stderr, "Usage: ./test_runner.out [options] [tests_file=tests.txt]\n"
+                            "\n       Runs the test cases of tests_file, a line per case as test/grader.sh reads them,"
+                            "\n       with the paths relative to the current directory.\n"
+                            "\n       options:"
+                            "\n         --jobs=N         Run the cases on N threads (default one per processor)."
+                            "\n         --cpu-limit=MS   The CPU time a case could take, in milliseconds (default %d).\n",
+                            TEST_RUNNER_DEFAULT_CPU_LIMIT);
+            return 2;
+        }
+    }
+
+    FILE* in = fopen(tests, "r");
+
+    if(!in)
+    {
+        fprintf(stderr, "Could not open \"%s\"\n", tests);
+        return 2;
+    }
+
+    TestSuite suite;
+    int err = readTestSuite(in, &suite);
+    fclose(in);
+
+    if(err)
+    {
+        if(err < 0) fprintf(stderr, "Could not allocate the test cases.\n");
+        else        fprintf(stderr, "%s:%d: Not a test case: error or not_error, followed by its files\n", tests, err);
+
+        deleteTestSuite(&suite);
+        return 2;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    workers = runTestSuite(&suite, workers, (long long)cpuLimit * 1000000LL);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if(workers < 0)
+    {
+        fprintf(stderr, "Could not start the workers.\n");
+        deleteTestSuite(&suite);
+        return 2;
+    }
+
+    long long wallTime = (long long)(end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+    int failed = printTestResults(&suite, workers, wallTime, stdout);
+
+    deleteTestSuite(&suite);
+
+    return failed ? 1 : 0;
+}
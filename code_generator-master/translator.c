@@ -0,0 +1,754 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "data.h"
+#include "code_generator.h"
+#include "vm/vm.h"
+
+/**
+ * Translates the PM/0 code written by code_generator.out into a standalone C
+ * program, to be compiled by the C compiler of the system (e.g. gcc -O2), that
+ * runs the code as vm.out --trace=none would: the same output, the same input
+ * read, and the same messages on an illegal instruction or a stack overflow.
+ *
+ * The program is made of one C function per procedure, i.e. per target of a
+ * CAL, and one for the code run from address 0. The function of a procedure is
+ * the code reachable from its entry without following the calls, in the order
+ * of the code memory, each basic block starting with a label, and the jumps
+ * going to those labels. M of a JMP or a JPC, which always targets the same
+ * function, is thus a goto, and a CAL a call of the function of its target.
+ *
+ * The registers of the register file a function uses are its locals, which the
+ * C compiler keeps in registers. They are exchanged with the callees through
+ * the register file, RF, around the calls only. BP and SP are locals as well.
+ * The stack is not: a procedure reads and writes the activation records of the
+ * procedures it is nested in through the static links, so it is a static array
+ * of the size of the stack of the virtual machine, laid out as the virtual
+ * machine lays it out.
+ *
+ * A RTN returns from the function, with the return address from the stack,
+ * which the caller compares to the address following its CAL. Should the
+ * program have changed it, the caller jumps to the block starting there, if
+ * any: returning into the middle of a block, or into another function, is the
+ * only thing the translated program does not run, and it stops with an error
+ * then. The code generator never writes the links of the activation records.
+ *
+ * Each activation record being a C call as well, the code runs on a thread
+ * whose stack is deep enough for as many activation records as the stack of
+ * the virtual machine holds.
+ * */
+
+/**
+ * The number of registers of the register file of the virtual machine.
+ * */
+#define PM0_REGISTER_FILE_SIZE 16
+
+/**
+ * The code being translated, and what is known of the function being printed.
+ * reached   : 1 for each instruction of the function
+ * leader    : 1 for each instruction starting a basic block of it
+ * referenced: 1 for each leader a goto jumps to
+ * registers : 1 for each register of the register file it uses
+ * hasDispatch: 1 if the function jumps to addresses only known at run time:
+ *             the returns from its calls, or its own RTN for the program
+ * */
+typedef struct {
+    const Instruction* code;
+    int numOfIns;
+
+    char* reached;
+    char* leader;
+    char* referenced;
+    int* worklist;
+
+    char registers[PM0_REGISTER_FILE_SIZE];
+    int hasDispatch;
+} Translation;
+
+/**
+ * What the translated program is built with.
+ * stackLimit: the number of ints of the stack, as --stack-limit of vm.out
+ * */
+typedef struct {
+    int stackLimit;
+} TranslatorOptions;
+
+/**
+ * The helpers of the translated program, printed after the defines of its
+ * stack limit and of its number of instructions.
+ * */
+const char* translationPrelude =
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "#include <pthread.h>\n"
+    "\n"
+    "// Not every program uses every helper\n"
+    "#if defined(__GNUC__)\n"
+    "#define PM0_NORETURN __attribute__((noreturn))\n"
+    "#define PM0_UNUSED __attribute__((unused))\n"
+    "#else\n"
+    "#define PM0_NORETURN\n"
+    "#define PM0_UNUSED\n"
+    "#endif\n"
+    "\n"
+    "// A C call per activation record, of 4 ints at least\n"
+    "#define PM0_THREAD_STACK_SIZE (((size_t)PM0_STACK_LIMIT / 4 + 1) * 256)\n"
+    "\n"
+    "static int stack[PM0_STACK_LIMIT];\n"
+    "static PM0_UNUSED int RF[16];\n"
+    "\n"
+    "// BP and SP after a RTN\n"
+    "static PM0_UNUSED int BP, SP;\n"
+    "\n"
+    "static FILE* vmIn;\n"
+    "static FILE* vmOut;\n"
+    "\n"
+    "static PM0_NORETURN void pm0Halt(void)\n"
+    "{\n"
+    "    fflush(vmOut);\n"
+    "    exit(0);\n"
+    "}\n"
+    "\n"
+    "static PM0_UNUSED PM0_NORETURN void pm0Illegal(void)\n"
+    "{\n"
+    "    fprintf(stderr, \"Illegal instruction?\");\n"
+    "    pm0Halt();\n"
+    "}\n"
+    "\n"
+    "static PM0_UNUSED PM0_NORETURN void pm0Overflow(void)\n"
+    "{\n"
+    "    fprintf(stderr, \"Stack overflow?\");\n"
+    "    pm0Halt();\n"
+    "}\n"
+    "\n"
+    "// A return to pc, which is not a block of the function returned to\n"
+    "static PM0_UNUSED PM0_NORETURN void pm0Return(int pc)\n"
+    "{\n"
+    "    if(pc < 0 || pc >= PM0_NUM_OF_INS) pm0Illegal();\n"
+    "\n"
+    "    fflush(vmOut);\n"
+    "    fprintf(stderr, \"Return to %d, which is not the start of a block of the caller: not translated.\\n\", pc);\n"
+    "    exit(1);\n"
+    "}\n"
+    "\n"
+    "static PM0_UNUSED int pm0Base(int bp, int l)\n"
+    "{\n"
+    "    while(l-- > 0) bp = stack[bp + 1];\n"
+    "    return bp;\n"
+    "}\n"
+    "\n"
+    "static PM0_UNUSED int pm0Read(int value)\n"
+    "{\n"
+    "    fscanf(vmIn, \"%d\", &value);\n"
+    "    return value;\n"
+    "}\n";
+
+/**
+ * Reads the code, in the text or the binary format code_generator.out writes,
+ * from the given file. The array is allocated here and should be freed by the
+ * caller. Returns 0 on success, -1 if the file is not PM/0 code, e.g. the error
+ * message of the code generator.
+ * */
+int readPM0Code(FILE* in, Instruction** code, int* numOfIns)
+{
+    ObjectHeader header;
+
+    *code = NULL;
+    *numOfIns = 0;
+
+    if( fread(header.magic, 1, sizeof(header.magic), in) == sizeof(header.magic)
+        && !memcmp(header.magic, PM0_OBJECT_MAGIC, sizeof(header.magic)) )
+    {
+        if( fread(&header.version, sizeof(ObjectHeader) - sizeof(header.magic), 1, in) != 1
+            || header.version != PM0_OBJECT_VERSION || header.numOfIns > INT_MAX / sizeof(Instruction) )
+            return -1;
+
+        *code = malloc((header.numOfIns ? header.numOfIns : 1) * sizeof(Instruction));
+        if(!*code)
+        {
+            fprintf(stderr, "Could not allocate the code memory.\n");
+            exit(0);
+        }
+
+        if( fread(*code, sizeof(Instruction), header.numOfIns, in) != header.numOfIns
+            || codeChecksum(*code, header.numOfIns) != header.checksum )
+        {
+            free(*code);
+            *code = NULL;
+            return -1;
+        }
+
+        *numOfIns = header.numOfIns;
+        return 0;
+    }
+
+    // Text, one "op r l m" line per instruction
+    rewind(in);
+
+    Instruction ins;
+    int capacity = 0;
+
+    while( fscanf(in, "%d %d %d %d", &ins.op, &ins.r, &ins.l, &ins.m) == 4 )
+    {
+        if(*numOfIns == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 256;
+            Instruction* grown = realloc(*code, capacity * sizeof(Instruction));
+
+            if(!grown)
+            {
+                fprintf(stderr, "Could not allocate the code memory.\n");
+                exit(0);
+            }
+            *code = grown;
+        }
+
+        (*code)[(*numOfIns)++] = ins;
+    }
+
+    // Anything else than instructions up to the end
+    if( fscanf(in, " %*c") != EOF )
+    {
+        free(*code);
+        *code = NULL;
+        *numOfIns = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Sets the registers of the register file the given instruction uses in the
+ * given flags, if not NULL. Returns 0 if any of them is out of the register
+ * file, 1 otherwise.
+ * */
+int markRegisters(Instruction ins, char* registers)
+{
+    int fields[3], numOfFields = 0;
+
+    switch(ins.op)
+    {
+        case LIT: case LOD: case STO: case JPC: case SIO_WRITE: case SIO_READ: case ODD:
+            fields[numOfFields++] = ins.r;
+            break;
+        case NEG:
+            fields[numOfFields++] = ins.r;
+            fields[numOfFields++] = ins.l;
+            break;
+        default:
+            if(ins.op >= ADD && ins.op <= GEQ)
+            {
+                fields[numOfFields++] = ins.r;
+                fields[numOfFields++] = ins.l;
+                fields[numOfFields++] = ins.m;
+            }
+            break;
+    }
+
+    for(int i = 0; i < numOfFields; i++)
+    {
+        if(fields[i] < 0 || fields[i] >= PM0_REGISTER_FILE_SIZE) return 0;
+        if(registers) registers[fields[i]] = 1;
+    }
+
+    return 1;
+}
+
+/**
+ * Returns 1 if the execution could go on from the given instruction to the
+ * one following it.
+ * */
+int fallsThrough(Instruction ins)
+{
+    return ins.op >= LIT && ins.op <= GEQ && ins.op != RTN && ins.op != JMP && ins.op != SIO_HALT;
+}
+
+/**
+ * Finds the function starting at entry: the instructions reachable from it,
+ * the leaders of its basic blocks and the registers it uses. isProgram is 1
+ * for the code run from address 0, whose RTN is a jump.
+ * */
+void reachFunction(Translation* t, int entry, int isProgram)
+{
+    const Instruction* code = t->code;
+    int numOfIns = t->numOfIns, count = 0, i;
+
+    memset(t->reached, 0, numOfIns);
+    memset(t->leader, 0, numOfIns);
+    memset(t->referenced, 0, numOfIns);
+    memset(t->registers, 0, sizeof(t->registers));
+    t->hasDispatch = 0;
+
+    if(entry >= numOfIns) return;
+
+    t->leader[entry] = 1;
+    t->worklist[count++] = entry;
+
+    while(count > 0)
+    {
+        i = t->worklist[--count];
+        if(t->reached[i]) continue;
+
+        Instruction ins = code[i];
+        t->reached[i] = 1;
+        markRegisters(ins, t->registers);
+
+        // The target of a jump within the program starts a block
+        if((ins.op == JMP || ins.op == JPC) && ins.m >= 0 && ins.m < numOfIns)
+        {
+            t->leader[ins.m] = t->referenced[ins.m] = 1;
+            if(!t->reached[ins.m]) t->worklist[count++] = ins.m;
+        }
+
+        // So does the instruction following a branch, and a call returns there
+        if(ins.op == JPC || ins.op == CAL)
+        {
+            if(i + 1 < numOfIns) t->leader[i + 1] = 1;
+        }
+
+        if(ins.op == CAL || (ins.op == RTN && isProgram)) t->hasDispatch = 1;
+
+        if(fallsThrough(ins) && i + 1 < numOfIns && !t->reached[i + 1]) t->worklist[count++] = i + 1;
+    }
+
+    // The function starts with the block of its entry
+    for(i = 0; i < entry; i++)
+    {
+        if(t->reached[i])
+        {
+            t->referenced[entry] = 1;
+            break;
+        }
+    }
+}
+
+/**
+ * Prints the stack slot M ints above the base pointer L levels down.
+ * */
+void printStackSlot(FILE* out, int l, int m)
+{
+    if(l <= 0)      fprintf(out, "stack[bp");
+    else if(l == 1) fprintf(out, "stack[stack[bp + 1]");
+    else            fprintf(out, "stack[pm0Base(bp, %d)", l);
+
+    if(m >= 0) fprintf(out, " + %d]", m);
+    else       fprintf(out, " - %lld]", -(long long)m);
+}
+
+/**
+ * Prints the base pointer L levels down.
+ * */
+void printBase(FILE* out, int l)
+{
+    if(l <= 0)      fprintf(out, "bp");
+    else if(l == 1) fprintf(out, "stack[bp + 1]");
+    else            fprintf(out, "pm0Base(bp, %d)", l);
+}
+
+/**
+ * Prints the copy of the registers the function uses from its locals to the
+ * register file, or back.
+ * */
+void printRegisterCopy(FILE* out, const Translation* t, int toRF)
+{
+    int printed = 0;
+
+    for(int r = 0; r < PM0_REGISTER_FILE_SIZE; r++)
+    {
+        if(!t->registers[r]) continue;
+
+        if(!printed) fprintf(out, "   ");
+        if(toRF) fprintf(out, " RF[%d] = r%d;", r, r);
+        else     fprintf(out, " r%d = RF[%d];", r, r);
+        printed = 1;
+    }
+
+    if(printed) fprintf(out, "\n");
+}
+
+/**
+ * Prints the jump to the given target, from within the function: a goto its
+ * block, or the illegal instruction fetched out of the program.
+ * */
+void printJump(FILE* out, const Translation* t, int target)
+{
+    if(target >= 0 && target < t->numOfIns) fprintf(out, "goto L%d;", target);
+    else                                    fprintf(out, "pm0Illegal();");
+}
+
+/**
+ * Prints the statements of the instruction at address i of the function.
+ * */
+void printInstruction(FILE* out, const Translation* t, int i, int isProgram)
+{
+    Instruction ins = t->code[i];
+    const char* name = (ins.op >= LIT && ins.op <= GEQ) ? opcodeNames[ins.op] : "illegal";
+
+    // The arithmetic of the virtual machine wraps around
+    static const char* arithmetic[] = { [ADD] = "+", [SUB] = "-", [MUL] = "*" };
+    static const char* relations[]  = { [EQL] = "==", [NEQ] = "!=", [LSS] = "<", [LEQ] = "<=", [GTR] = ">", [GEQ] = ">=" };
+
+    fprintf(out, "    /* %d: %s %d %d %d */\n    ", i, name, ins.r, ins.l, ins.m);
+
+    switch(ins.op)
+    {
+        case LIT:
+            if(ins.m == INT_MIN) fprintf(out, "r%d = (-%d - 1);\n", ins.r, INT_MAX);
+            else                 fprintf(out, "r%d = %d;\n", ins.r, ins.m);
+            break;
+
+        case RTN:
+            if(isProgram)
+            {
+                fprintf(out, "sp = bp - 1; bp = stack[sp + 3]; pc = stack[sp + 4];\n");
+                fprintf(out, "    goto dispatch;\n");
+            }
+            else
+            {
+                fprintf(out, "sp = bp - 1; BP = stack[sp + 3]; SP = sp;\n");
+                printRegisterCopy(out, t, 1);
+                fprintf(out, "    return stack[sp + 4];\n");
+            }
+            break;
+
+        case LOD:
+            fprintf(out, "r%d = ", ins.r);
+            printStackSlot(out, ins.l, ins.m);
+            fprintf(out, ";\n");
+            break;
+
+        case STO:
+            printStackSlot(out, ins.l, ins.m);
+            fprintf(out, " = r%d;\n", ins.r);
+            break;
+
+        case CAL:
+            fprintf(out, "if(sp + 4 >= PM0_STACK_LIMIT) pm0Overflow();\n");
+            fprintf(out, "    stack[sp + 1] = 0; stack[sp + 2] = ");
+            printBase(out, ins.l);
+            fprintf(out, "; stack[sp + 3] = bp; stack[sp + 4] = %d;\n", i + 1);
+
+            if(ins.m >= 0 && ins.m < t->numOfIns)
+            {
+                printRegisterCopy(out, t, 1);
+                fprintf(out, "    pc = pm0Procedure%d(sp + 1, sp);\n", ins.m);
+                printRegisterCopy(out, t, 0);
+                fprintf(out, "    bp = BP; sp = SP;\n");
+                fprintf(out, "    if(pc != %d) goto dispatch;\n", i + 1);
+            }
+            else fprintf(out, "    pm0Illegal();\n");
+            break;
+
+        case INC:
+            fprintf(out, "if(sp + %d >= PM0_STACK_LIMIT) pm0Overflow();\n", ins.m);
+            fprintf(out, "    sp += %d;\n", ins.m);
+            break;
+
+        case JMP:
+            printJump(out, t, ins.m);
+            fprintf(out, "\n");
+            break;
+
+        case JPC:
+            fprintf(out, "if(!r%d) ", ins.r);
+            printJump(out, t, ins.m);
+            fprintf(out, "\n");
+            break;
+
+        case SIO_WRITE:
+            fprintf(out, "fprintf(vmOut, \"%%d\", r%d);\n", ins.r);
+            break;
+
+        case SIO_READ:
+            fprintf(out, "r%d = pm0Read(r%d);\n", ins.r, ins.r);
+            break;
+
+        case SIO_HALT:
+            fprintf(out, "pm0Halt();\n");
+            break;
+
+        case NEG:
+            fprintf(out, "r%d = (int)(0u - (unsigned)r%d);\n", ins.r, ins.l);
+            break;
+
+        case ADD: case SUB: case MUL:
+            fprintf(out, "r%d = (int)((unsigned)r%d %s (unsigned)r%d);\n", ins.r, ins.l, arithmetic[ins.op], ins.m);
+            break;
+
+        case DIV:
+            fprintf(out, "r%d = r%d / r%d;\n", ins.r, ins.l, ins.m);
+            break;
+
+        case ODD:
+            fprintf(out, "r%d = r%d %% 2;\n", ins.r, ins.r);
+            break;
+
+        case MOD:
+            fprintf(out, "r%d = r%d %% r%d;\n", ins.r, ins.l, ins.m);
+            break;
+
+        case EQL: case NEQ: case LSS: case LEQ: case GTR: case GEQ:
+            fprintf(out, "r%d = (r%d %s r%d);\n", ins.r, ins.l, relations[ins.op], ins.m);
+            break;
+
+        default:
+            fprintf(out, "pm0Illegal();\n");
+            break;
+    }
+
+    // Past the last instruction, the instruction fetched is illegal
+    if(fallsThrough(ins) && i + 1 == t->numOfIns) fprintf(out, "    pm0Illegal();\n");
+}
+
+/**
+ * Prints the C function of the code starting at entry, the procedure called
+ * there, or the program if isProgram is 1.
+ * */
+void printFunction(FILE* out, Translation* t, int entry, int isProgram)
+{
+    int i, r;
+
+    reachFunction(t, entry, isProgram);
+
+    if(isProgram) fprintf(out, "static void pm0Program(PM0_UNUSED int bp, PM0_UNUSED int sp)\n{\n");
+    else          fprintf(out, "static int pm0Procedure%d(PM0_UNUSED int bp, PM0_UNUSED int sp)\n{\n", entry);
+
+    for(r = 0; r < PM0_REGISTER_FILE_SIZE; r++)
+        if(t->registers[r]) fprintf(out, "    int r%d = RF[%d];\n", r, r);
+
+    if(t->hasDispatch) fprintf(out, "    int pc;\n");
+
+    if(t->referenced[entry]) fprintf(out, "\n    goto L%d;\n", entry);
+
+    // No code at all: the first instruction fetched is illegal
+    if(entry >= t->numOfIns) fprintf(out, "\n    pm0Illegal();\n");
+
+    for(i = 0; i < t->numOfIns; i++)
+    {
+        if(!t->reached[i]) continue;
+
+        if(t->leader[i] && (t->referenced[i] || t->hasDispatch)) fprintf(out, "\nL%d:\n", i);
+        else if(t->leader[i])                                    fprintf(out, "\n");
+
+        printInstruction(out, t, i, isProgram);
+    }
+
+    // The addresses returned to, or jumped to by the RTN of the program
+    if(t->hasDispatch)
+    {
+        fprintf(out, "\ndispatch:\n    switch(pc)\n    {\n");
+
+        for(i = 0; i < t->numOfIns; i++)
+            if(t->reached[i] && t->leader[i]) fprintf(out, "        case %d: goto L%d;\n", i, i);
+
+        fprintf(out, "    }\n    pm0Return(pc);\n");
+    }
+
+    fprintf(out, "}\n\n");
+}
+
+/**
+ * Prints the C program of the numOfIns instructions of the given code, read
+ * from the file named source.
+ * */
+void printProgram(FILE* out, const Instruction* code, int numOfIns, const char* source, TranslatorOptions options)
+{
+    Translation t;
+    int i;
+
+    t.code = code;
+    t.numOfIns = numOfIns;
+    t.reached = malloc(numOfIns + 1);
+    t.leader = malloc(numOfIns + 1);
+    t.referenced = malloc(numOfIns + 1);
+    t.worklist = malloc((numOfIns + 1) * sizeof(int));
+
+    // The procedures, by the address they are called at, and those left to
+    // .. be looked into for their calls
+    char* isEntry = calloc(numOfIns + 1, 1);
+    int* entries = malloc((numOfIns + 1) * sizeof(int));
+    int numOfEntries = 0, entry = 0, isProgram = 1;
+
+    if(!t.reached || !t.leader || !t.referenced || !t.worklist || !isEntry || !entries)
+    {
+        fprintf(stderr, "Could not allocate the translation.\n");
+        exit(0);
+    }
+
+    // Only the procedures the program could call, the others are dead code
+    for(;;)
+    {
+        reachFunction(&t, entry, isProgram);
+
+        for(i = 0; i < numOfIns; i++)
+        {
+            int target = code[i].m;
+
+            if(!t.reached[i] || code[i].op != CAL || target < 0 || target >= numOfIns || isEntry[target]) continue;
+
+            isEntry[target] = 1;
+            entries[numOfEntries++] = target;
+        }
+
+        if(numOfEntries == 0) break;
+
+        entry = entries[--numOfEntries];
+        isProgram = 0;
+    }
+
+    fprintf(out, "/**\n * Translated from the PM/0 code of \"%s\", %d instructions, by translator.out.\n", source, numOfIns);
+    fprintf(out, " * Usage: (program) [vm_inp_file=stdin] [vm_outp_file=stdout]\n * */\n\n");
+    fprintf(out, "#define PM0_STACK_LIMIT %d\n#define PM0_NUM_OF_INS %d\n\n", options.stackLimit, numOfIns);
+    fprintf(out, "%s\n", translationPrelude);
+
+    for(i = 0; i < numOfIns; i++)
+        if(isEntry[i]) fprintf(out, "static int pm0Procedure%d(int bp, int sp);\n", i);
+    fprintf(out, "\n");
+
+    for(i = 0; i < numOfIns; i++)
+        if(isEntry[i]) printFunction(out, &t, i, 0);
+
+    printFunction(out, &t, 0, 1);
+
+    fprintf(out,
+        "static void* pm0Run(void* unused)\n"
+        "{\n"
+        "    pm0Program(1, 0);\n"
+        "    return unused;\n"
+        "}\n"
+        "\n"
+        "int main(int argc, char** argv)\n"
+        "{\n"
+        "    vmIn = stdin;\n"
+        "    vmOut = stdout;\n"
+        "\n"
+        "    if(argc > 1 && strcmp(argv[1], \"-\") && !(vmIn = fopen(argv[1], \"r\")))\n"
+        "    {\n"
+        "        fprintf(stderr, \"Could not open \\\"%%s\\\"\\n\", argv[1]);\n"
+        "        return -1;\n"
+        "    }\n"
+        "\n"
+        "    if(argc > 2 && strcmp(argv[2], \"-\") && !(vmOut = fopen(argv[2], \"w\")))\n"
+        "    {\n"
+        "        fprintf(stderr, \"Could not open \\\"%%s\\\"\\n\", argv[2]);\n"
+        "        return -1;\n"
+        "    }\n"
+        "\n"
+        "    // The program halts by exiting, from the thread if it could be started\n"
+        "    pthread_attr_t attr;\n"
+        "    pthread_t thread;\n"
+        "\n"
+        "    if(!pthread_attr_init(&attr) && !pthread_attr_setstacksize(&attr, PM0_THREAD_STACK_SIZE)\n"
+        "       && !pthread_create(&thread, &attr, pm0Run, NULL))\n"
+        "        pthread_join(thread, NULL);\n"
+        "    else\n"
+        "        pm0Run(NULL);\n"
+        "\n"
+        "    return 0;\n"
+        "}\n");
+
+    free(t.reached);
+    free(t.leader);
+    free(t.referenced);
+    free(t.worklist);
+    free(isEntry);
+    free(entries);
+}
+
+/**
+ * Parses the options given before the positional arguments into the given
+ * TranslatorOptions. Returns the number of arguments consumed, or -1 if an
+ * option is not recognized.
+ * */
+int parseOptions(int argc, char **argv, TranslatorOptions* options)
+{
+    int i;
+    for(i = 1; i < argc && !strncmp(argv[i], "--", 2); i++)
+    {
+        if( !strncmp(argv[i], "--stack-limit=", 14) && atoi(argv[i] + 14) > 0 )
+            options->stackLimit = atoi(argv[i] + 14);
+        else
+        {
+            fprintf(stderr, "Unknown option \"%s\"\n", argv[i]);
+            return -1;
+        }
+    }
+
+    return i - 1;
+}
+
+int main(int argc, char **argv)
+{
+    TranslatorOptions options = { VM_DEFAULT_STACK_LIMIT };
+    int optionCount = parseOptions(argc, argv, &options);
+
+    if(optionCount < 0) return -1;
+
+    argv[optionCount] = argv[0];
+    argv += optionCount;
+    argc -= optionCount;
+
+    if(argc != 3)
+    {
+        fprintf(stderr, "Usage: ./translator.out [options] (ins_inp_file) (c_outp_file)\n");
+
+        fprintf(stderr, "\n       ins_inp_file: The path to the PM/0 code, as code_generator.out writes it, either as text or binary.\n");
+
+        fprintf(stderr, "\n       c_outp_file: The path to write the C program to. Once compiled (e.g. gcc -O2 c_outp_file -pthread),"
+                        "\n       the program runs the code as vm.out --trace=none does: (program) [vm_inp_file=stdin] [vm_outp_file=stdout]\n");
+
+        fprintf(stderr, "\n       options:\n"
+                        "         --stack-limit=N         The number of ints of the stack (default %d), as for vm.out.\n",
+                        VM_DEFAULT_STACK_LIMIT);
+        return -1;
+    }
+
+    FILE* inp = fopen(argv[1], "rb");
+    if(!inp)
+    {
+        fprintf(stderr, "Could not open \"%s\"\n", argv[1]);
+        return -1;
+    }
+
+    Instruction* code;
+    int numOfIns, i;
+
+    if(readPM0Code(inp, &code, &numOfIns))
+    {
+        fprintf(stderr, "\"%s\" is not PM/0 code\n", argv[1]);
+        fclose(inp);
+        return -1;
+    }
+
+    fclose(inp);
+
+    // The register file is an array in the virtual machine, which the program
+    // .. indexes out of only by mistake
+    for(i = 0; i < numOfIns; i++)
+    {
+        if(!markRegisters(code[i], NULL))
+        {
+            fprintf(stderr, "Instruction %d uses a register out of the register file: not translated.\n", i);
+            free(code);
+            return -1;
+        }
+    }
+
+    FILE* out = fopen(argv[2], "w");
+    if(!out)
+    {
+        fprintf(stderr, "Could not open \"%s\"\n", argv[2]);
+        free(code);
+        return -1;
+    }
+
+    printProgram(out, code, numOfIns, argv[1], options);
+
+    fclose(out);
+    free(code);
+
+    return 0;
+}
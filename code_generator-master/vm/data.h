@@ -1,8 +1,6 @@
 #ifndef __DATA_H__
 #define __DATA_H__
 
-#define MAX_STACK_HEIGHT 2000
-#define MAX_CODE_LENGTH  500
 #define MAX_LEXI_LEVELS  3
 #define REGISTER_FILE_REG_COUNT 16
 
@@ -13,6 +11,22 @@ typedef struct {
     int m;   // M
 } Instruction;
 
+/**
+ * Binary object file of PM/0 code: an ObjectHeader followed by numOfIns
+ * Instruction structs, all in the byte order of the machine that wrote it.
+ * checksum is the 32-bit FNV-1a hash of the bytes of the instructions.
+ * The text format (one "op r l m" line per instruction) is also accepted.
+ * */
+#define PM0_OBJECT_MAGIC   "PM0O"
+#define PM0_OBJECT_VERSION 1
+
+typedef struct {
+    char magic[4];         // PM0_OBJECT_MAGIC, not null terminated
+    unsigned int version;  // PM0_OBJECT_VERSION
+    unsigned int numOfIns; // number of instructions following the header
+    unsigned int checksum; // FNV-1a of the instructions
+} ObjectHeader;
+
 /**
  * Virtual machine state holder
  * */
@@ -32,9 +46,35 @@ typedef struct VirtualMachine {
     int RF[REGISTER_FILE_REG_COUNT];
 
     /**
-     * stack
+     * stack of stackSize ints, the stack limit the machine runs with.
+     * It is reserved and zeroed lazily, see initVM()
+     * */
+    int* stack;
+    int stackSize;
+
+    /**
+     * the highest index of the stack written since the machine was reset, -1
+     * if none. resetVM() zeroes the stack up to it only.
+     * */
+    int touched;
+
+    /**
+     * the number of instructions executed since the machine was reset, -1 if
+     * they were run by the JIT, which does not count them
+     * */
+    long long steps;
+
+    /**
+     * display links of the threaded engine, one per stack slot, zeroed along
+     * with the stack. NULL if they could not be reserved
+     * */
+    struct DisplayLink* links;
+
+    /**
+     * if not NULL, the run halts at the first jump, call or return once it is
+     * set, see VMOptions
      * */
-    int stack[MAX_STACK_HEIGHT];
+    const volatile int* interrupt;
 } VirtualMachine;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,805 @@
+#include "jit.h"
+
+#if VM_HAVE_JIT
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+/* ************************************************************************************ */
+/* Declarations                                                                         */
+/* ************************************************************************************ */
+
+/**
+ * The machine registers, by their encoding.
+ * */
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+/**
+ * Registers of the translated code:
+ *  R12: the stack, R13: BP, R14: SP, both sign extended to 64 bits, so that
+ *       they index the stack as the interpreter does, and R15: the JITState.
+ *  RAX, RCX and RDX are scratch registers.
+ * The registers of the register file held in machine registers, 0 to 7. Those
+ * from RSI on are not preserved across the calls into C.
+ * */
+#define JIT_MAPPED_REGISTERS 8
+#define JIT_PRESERVED_REGISTERS 2
+
+const int mappedRegisters[JIT_MAPPED_REGISTERS] = { RBX, RBP, RSI, RDI, R8, R9, R10, R11 };
+
+/**
+ * The state the translated code runs on, pointed to by R15. The registers of
+ * the register file not held in machine registers are read and written here,
+ * and all of them are copied in and out on entry and exit.
+ * natives: the native address of each instruction and of the one after the
+ *          last, RTN jumps through it
+ * status : why the machine halted
+ * io     : the SIO streams of the program
+ * */
+typedef struct {
+    int RF[REGISTER_FILE_REG_COUNT];
+    int PC, BP, SP, touched, status;
+    int* stack;
+    const unsigned char** natives;
+    VMIO* io;
+} JITState;
+
+/**
+ * A rel32 operand at offset at of the code, to be set to the native address of
+ * the target instruction once all of them are translated.
+ * */
+typedef struct {
+    size_t at;
+    int target;
+} JITPatch;
+
+/**
+ * The machine code being generated.
+ * bytes  : size bytes of code, in capacity allocated
+ * offsets: the offset of the code of each instruction, and of the one after
+ *          the last
+ * failed : 1 if memory could not be allocated, the code is then incomplete
+ * epilogue, outside: the offsets of the code returning to the caller, and of
+ *          the code halting on a return out of the loaded program
+ * */
+typedef struct {
+    unsigned char* bytes;
+    size_t size;
+    size_t capacity;
+    int failed;
+
+    size_t* offsets;
+    JITPatch* patches;
+    int numOfPatches;
+    int patchCapacity;
+
+    size_t epilogue;
+    size_t outside;
+} JITBuffer;
+
+/* ************************************************************************************ */
+/* Definitions                                                                          */
+/* ************************************************************************************ */
+
+/**
+ * Appends count bytes to the code.
+ * */
+void jitBytes(JITBuffer* b, const void* bytes, size_t count)
+{
+    if(b->failed) return;
+
+    if(b->size + count > b->capacity)
+    {
+        size_t capacity = b->capacity * 2 + count;
+        unsigned char* grown = realloc(b->bytes, capacity);
+
+        if(!grown)
+        {
+            b->failed = 1;
+            return;
+        }
+
+        b->bytes = grown;
+        b->capacity = capacity;
+    }
+
+    memcpy(b->bytes + b->size, bytes, count);
+    b->size += count;
+}
+
+void jitByte(JITBuffer* b, int byte)
+{
+    unsigned char c = (unsigned char)byte;
+    jitBytes(b, &c, 1);
+}
+
+/**
+ * Appends a 32-bit, or a 64-bit immediate, little endian as the machine.
+ * */
+void jitInt(JITBuffer* b, int value)
+{
+    jitBytes(b, &value, 4);
+}
+
+void jitQuad(JITBuffer* b, uint64_t value)
+{
+    jitBytes(b, &value, 8);
+}
+
+/**
+ * Appends the opcode op, of two bytes if it is above 0xFF (0x0F prefixed).
+ * */
+void jitOpcode(JITBuffer* b, int op)
+{
+    if(op > 0xFF) jitByte(b, op >> 8);
+    jitByte(b, op & 0xFF);
+}
+
+/**
+ * Appends op with a register operand reg (or the opcode extension) and a
+ * memory operand [base + index * 2^scale + disp], index -1 if none. w selects
+ * the 64-bit operand size.
+ * */
+void jitRM(JITBuffer* b, int w, int op, int reg, int base, int index, int scale, int disp)
+{
+    int rex = (w << 3) | ((reg & 8) >> 1) | ((index >= 0 && (index & 8)) ? 2 : 0) | ((base & 8) >> 3);
+    int mod = (disp == 0 && (base & 7) != 5) ? 0 : (disp >= -128 && disp <= 127) ? 1 : 2;
+    int sib = (index >= 0 || (base & 7) == 4);
+
+    if(rex) jitByte(b, 0x40 | rex);
+    jitOpcode(b, op);
+    jitByte(b, (mod << 6) | ((reg & 7) << 3) | (sib ? 4 : (base & 7)));
+
+    // No index is encoded as RSP
+    if(sib) jitByte(b, (scale << 6) | (((index >= 0 ? index : RSP) & 7) << 3) | (base & 7));
+
+    if(mod == 1) jitByte(b, disp);
+    if(mod == 2) jitInt(b, disp);
+}
+
+/**
+ * Appends op with the register operands reg (or the opcode extension) and rm.
+ * */
+void jitRR(JITBuffer* b, int w, int op, int reg, int rm)
+{
+    int rex = (w << 3) | ((reg & 8) >> 1) | ((rm & 8) >> 3);
+
+    if(rex) jitByte(b, 0x40 | rex);
+    jitOpcode(b, op);
+    jitByte(b, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/**
+ * Returns the offset of register r of the register file in the JITState.
+ * */
+int jitRFOffset(int r)
+{
+    return (int)offsetof(JITState, RF) + r * (int)sizeof(int);
+}
+
+/**
+ * Appends op, of the "op reg, r/m32" form, with register r of the register
+ * file as its r/m operand: a machine register or the JITState.
+ * */
+void jitOperand(JITBuffer* b, int op, int reg, int r)
+{
+    if(r < JIT_MAPPED_REGISTERS) jitRR(b, 0, op, reg, mappedRegisters[r]);
+    else                         jitRM(b, 0, op, reg, R15, -1, 0, jitRFOffset(r));
+}
+
+/**
+ * Loads register r of the register file into the machine register reg.
+ * */
+void jitLoadRF(JITBuffer* b, int reg, int r)
+{
+    if(r < JIT_MAPPED_REGISTERS && mappedRegisters[r] == reg) return;
+    jitOperand(b, 0x8B, reg, r);
+}
+
+/**
+ * Stores the machine register reg into register r of the register file.
+ * */
+void jitStoreRF(JITBuffer* b, int r, int reg)
+{
+    if(r < JIT_MAPPED_REGISTERS)
+    {
+        if(mappedRegisters[r] != reg) jitRR(b, 0, 0x89, reg, mappedRegisters[r]);
+    }
+    else jitRM(b, 0, 0x89, reg, R15, -1, 0, jitRFOffset(r));
+}
+
+/**
+ * Stores the machine registers of the register file from first on into the
+ * JITState, or loads them back from it.
+ * */
+void jitSpillRF(JITBuffer* b, int first)
+{
+    for(int r = first; r < JIT_MAPPED_REGISTERS; r++)
+        jitRM(b, 0, 0x89, mappedRegisters[r], R15, -1, 0, jitRFOffset(r));
+}
+
+void jitFillRF(JITBuffer* b, int first)
+{
+    for(int r = first; r < JIT_MAPPED_REGISTERS; r++)
+        jitRM(b, 0, 0x8B, mappedRegisters[r], R15, -1, 0, jitRFOffset(r));
+}
+
+/**
+ * Stores the 32-bit immediate value into the field of the JITState at offset.
+ * */
+void jitSetState(JITBuffer* b, int offset, int value)
+{
+    jitRM(b, 0, 0xC7, 0, R15, -1, 0, offset);
+    jitInt(b, value);
+}
+
+/**
+ * Appends a short conditional jump of condition code cc (0x70 + cc) forward,
+ * and returns the offset of its displacement, to be set by jitLand().
+ * */
+size_t jitShortJump(JITBuffer* b, int cc)
+{
+    jitByte(b, 0x70 + cc);
+    jitByte(b, 0);
+    return b->size - 1;
+}
+
+void jitLand(JITBuffer* b, size_t at)
+{
+    if(!b->failed) b->bytes[at] = (unsigned char)(b->size - (at + 1));
+}
+
+/**
+ * Appends a jump, op being 0xE9 or a 0x0F8x conditional jump, to the code of
+ * the given instruction.
+ * */
+void jitJumpTo(JITBuffer* b, int op, int target)
+{
+    jitOpcode(b, op);
+
+    if(b->numOfPatches == b->patchCapacity)
+    {
+        int capacity = b->patchCapacity ? b->patchCapacity * 2 : 64;
+        JITPatch* grown = realloc(b->patches, capacity * sizeof(JITPatch));
+
+        if(!grown)
+        {
+            b->failed = 1;
+            return;
+        }
+
+        b->patches = grown;
+        b->patchCapacity = capacity;
+    }
+
+    b->patches[b->numOfPatches].at = b->size;
+    b->patches[b->numOfPatches].target = target;
+    b->numOfPatches++;
+
+    jitInt(b, 0);
+}
+
+/**
+ * Appends a jump, op being 0xE9 or a 0x0F8x conditional jump, to the code
+ * already generated at offset.
+ * */
+void jitJumpBack(JITBuffer* b, int op, size_t offset)
+{
+    jitOpcode(b, op);
+    jitInt(b, (int)((long)offset - (long)(b->size + 4)));
+}
+
+/**
+ * Appends the halt of the machine, with the given status and PC.
+ * */
+void jitHalt(JITBuffer* b, int status, int pc)
+{
+    jitSetState(b, (int)offsetof(JITState, PC), pc);
+    jitSetState(b, (int)offsetof(JITState, status), status);
+    jitJumpBack(b, 0xE9, b->epilogue);
+}
+
+/**
+ * Appends the walk of L static links from BP, and returns the register holding
+ * the base pointer found: R13 itself if L is not above 0, RCX otherwise. RDX is
+ * clobbered by the longer walks.
+ * */
+int jitBase(JITBuffer* b, int L)
+{
+    if(L <= 0) return R13;
+
+    // movsxd rcx, [stack + BP * 4 + 4]
+    jitRM(b, 1, 0x63, RCX, R12, R13, 2, 4);
+
+    if(L - 1 <= 3)
+    {
+        for(int i = 1; i < L; i++) jitRM(b, 1, 0x63, RCX, R12, RCX, 2, 4);
+        return RCX;
+    }
+
+    // mov edx, L - 1, then as many links
+    jitByte(b, 0xBA);
+    jitInt(b, L - 1);
+
+    size_t loop = b->size;
+    jitRM(b, 1, 0x63, RCX, R12, RCX, 2, 4);
+    jitRR(b, 0, 0xFF, 1, RDX);
+    jitByte(b, 0x75);
+    jitByte(b, (int)((long)loop - (long)(b->size + 1)));
+
+    return RCX;
+}
+
+/**
+ * Appends the halt on a stack overflow unless EAX, the highest slot the
+ * instruction at pc would grow the stack to, is below stackSize.
+ * */
+void jitCheckStack(JITBuffer* b, int stackSize, int pc)
+{
+    // cmp eax, stackSize
+    jitByte(b, 0x3D);
+    jitInt(b, stackSize);
+
+    size_t fits = jitShortJump(b, 0xC);
+    jitHalt(b, JIT_OVERFLOW, pc + 1);
+    jitLand(b, fits);
+}
+
+/**
+ * Appends the halt on a stack overflow unless EDX, the stack slot the LOD or
+ * STO at pc reads or writes, is within the stack, from 0 to stackSize - 1.
+ * */
+void jitCheckAddress(JITBuffer* b, int stackSize, int pc)
+{
+    // cmp edx, stackSize, then jb: a negative slot compares above it
+    jitRR(b, 0, 0x81, 7, RDX);
+    jitInt(b, stackSize);
+
+    size_t fits = jitShortJump(b, 0x2);
+    jitHalt(b, JIT_OVERFLOW, pc + 1);
+    jitLand(b, fits);
+}
+
+/**
+ * Appends the update of the touched field of the JITState to the stack slot
+ * held in reg, if it is higher.
+ * */
+void jitTouch(JITBuffer* b, int reg)
+{
+    int offset = (int)offsetof(JITState, touched);
+
+    jitRM(b, 0, 0x3B, reg, R15, -1, 0, offset);
+    size_t lower = jitShortJump(b, 0xE);
+    jitRM(b, 0, 0x89, reg, R15, -1, 0, offset);
+    jitLand(b, lower);
+}
+
+/**
+ * SIO 1 and 2, as the interpreter runs them.
+ * */
+void jitWrite(JITState* state, int value)
+{
+    writeVMInt(state->io, value);
+}
+
+int jitRead(JITState* state, int value)
+{
+    readVMInt(state->io, &value);
+    return value;
+}
+
+/**
+ * Appends the call of the given helper with the state and register r of the
+ * register file as its arguments. Unless the helper is jitWrite(), register r
+ * is set to what it returns.
+ * */
+void jitCallHelper(JITBuffer* b, uintptr_t helper, int r, int sets)
+{
+    jitSpillRF(b, JIT_PRESERVED_REGISTERS);
+
+    jitLoadRF(b, RSI, r);
+    jitRR(b, 1, 0x89, R15, RDI);
+
+    // mov rax, helper; call rax
+    jitByte(b, 0x48);
+    jitByte(b, 0xB8);
+    jitQuad(b, helper);
+    jitRR(b, 0, 0xFF, 2, RAX);
+
+    if(sets)
+    {
+        if(r < JIT_PRESERVED_REGISTERS) jitStoreRF(b, r, RAX);
+        else jitRM(b, 0, 0x89, RAX, R15, -1, 0, jitRFOffset(r));
+    }
+
+    jitFillRF(b, JIT_PRESERVED_REGISTERS);
+}
+
+/**
+ * Appends a jump to the given target, from the instruction at pc: native if
+ * the target is in the loaded program, or the one after its last instruction,
+ * which is illegal. Otherwise, the halt on the illegal instruction fetched
+ * there, as the interpreter does.
+ * */
+void jitJump(JITBuffer* b, int target, int numOfIns)
+{
+    if(target >= 0 && target <= numOfIns) jitJumpTo(b, 0xE9, target);
+    else jitHalt(b, JIT_ILLEGAL, (int)((unsigned)target + 1));
+}
+
+/**
+ * Appends the prologue, which enters the code at the PC of the state, the
+ * epilogue and the halt on a return out of the loaded program.
+ * */
+void jitPrologue(JITBuffer* b, int numOfIns)
+{
+    static const unsigned char pushes[] = {
+        0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57, // push rbx .. r15
+        0x48, 0x83, 0xEC, 0x08                                      // sub rsp, 8
+    };
+    static const unsigned char pops[] = {
+        0x48, 0x83, 0xC4, 0x08,                                     // add rsp, 8
+        0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5D, 0x5B, // pop r15 .. rbx
+        0xC3                                                        // ret
+    };
+
+    jitBytes(b, pushes, sizeof(pushes));
+
+    jitRR(b, 1, 0x89, RDI, R15);
+    jitRM(b, 1, 0x8B, R12, R15, -1, 0, (int)offsetof(JITState, stack));
+    jitRM(b, 1, 0x63, R13, R15, -1, 0, (int)offsetof(JITState, BP));
+    jitRM(b, 1, 0x63, R14, R15, -1, 0, (int)offsetof(JITState, SP));
+    jitFillRF(b, 0);
+
+    jitRM(b, 0, 0x8B, RAX, R15, -1, 0, (int)offsetof(JITState, PC));
+
+    // Dispatches EAX, a PM/0 address, through the natives
+    jitByte(b, 0x3D);
+    jitInt(b, numOfIns);
+    jitOpcode(b, 0x0F87);
+    size_t outside = b->size;
+    jitInt(b, 0);
+    jitRM(b, 1, 0x8B, RDX, R15, -1, 0, (int)offsetof(JITState, natives));
+    jitRM(b, 0, 0xFF, 4, RDX, RAX, 3, 0);
+
+    b->epilogue = b->size;
+    jitSpillRF(b, 0);
+    jitRM(b, 0, 0x89, R13, R15, -1, 0, (int)offsetof(JITState, BP));
+    jitRM(b, 0, 0x89, R14, R15, -1, 0, (int)offsetof(JITState, SP));
+    jitBytes(b, pops, sizeof(pops));
+
+    // The target in EAX is fetched as an illegal instruction
+    b->outside = b->size;
+    jitRM(b, 0, 0x8D, RDX, RAX, -1, 0, 1);
+    jitRM(b, 0, 0x89, RDX, R15, -1, 0, (int)offsetof(JITState, PC));
+    jitSetState(b, (int)offsetof(JITState, status), JIT_ILLEGAL);
+    jitJumpBack(b, 0xE9, b->epilogue);
+
+    if(!b->failed)
+    {
+        int rel = (int)((long)b->outside - (long)(outside + 4));
+        memcpy(b->bytes + outside, &rel, 4);
+    }
+}
+
+/**
+ * Appends the return of RTN to the PM/0 address in EAX.
+ * */
+void jitReturn(JITBuffer* b, int numOfIns)
+{
+    jitByte(b, 0x3D);
+    jitInt(b, numOfIns);
+    jitJumpBack(b, 0x0F87, b->outside);
+    jitRM(b, 1, 0x8B, RDX, R15, -1, 0, (int)offsetof(JITState, natives));
+    jitRM(b, 0, 0xFF, 4, RDX, RAX, 3, 0);
+}
+
+/**
+ * Returns 1 if the register indices of the instruction are within the register
+ * file, and its stack offset fits a 32-bit displacement once scaled.
+ * */
+int isJITInstruction(Instruction ins)
+{
+    int usesR = 0, usesL = 0, usesM = 0;
+
+    switch(ins.op)
+    {
+        case 1: case 8: case 9: case 10: case 17:
+            usesR = 1;
+            break;
+        case 3: case 4:
+            usesR = 1;
+            if(ins.m < -(1 << 28) || ins.m >= (1 << 28)) return 0;
+            break;
+        case 12:
+            usesR = usesL = 1;
+            break;
+        default:
+            if(ins.op >= 13 && ins.op <= 24) usesR = usesL = usesM = 1;
+            break;
+    }
+
+    if(usesR && (unsigned)ins.r >= REGISTER_FILE_REG_COUNT) return 0;
+    if(usesL && (unsigned)ins.l >= REGISTER_FILE_REG_COUNT) return 0;
+    if(usesM && (unsigned)ins.m >= REGISTER_FILE_REG_COUNT) return 0;
+
+    return 1;
+}
+
+/**
+ * Appends the code of the instruction at pc.
+ * */
+void jitInstruction(JITBuffer* b, Instruction ins, int pc, int numOfIns, int stackSize)
+{
+    // setcc of EQL to GEQ
+    static const int conditions[] = { 0x94, 0x95, 0x9C, 0x9E, 0x9F, 0x9D };
+
+    switch(ins.op)
+    {
+        // LIT
+        case 1:
+            if(ins.r < JIT_MAPPED_REGISTERS)
+            {
+                int reg = mappedRegisters[ins.r];
+                if(reg & 8) jitByte(b, 0x41);
+                jitByte(b, 0xB8 + (reg & 7));
+                jitInt(b, ins.m);
+            }
+            else jitSetState(b, jitRFOffset(ins.r), ins.m);
+            break;
+
+        // RTN
+        case 2:
+            jitRM(b, 1, 0x8D, R14, R13, -1, 0, -1);
+            jitRM(b, 1, 0x63, R13, R12, R14, 2, 12);
+            jitRM(b, 0, 0x8B, RAX, R12, R14, 2, 16);
+            jitReturn(b, numOfIns);
+            break;
+
+        // LOD
+        case 3:
+        {
+            int base = jitBase(b, ins.l);
+            int reg = (ins.r < JIT_MAPPED_REGISTERS) ? mappedRegisters[ins.r] : RAX;
+
+            jitRM(b, 0, 0x8D, RDX, base, -1, 0, ins.m);
+            jitCheckAddress(b, stackSize, pc);
+            jitRM(b, 0, 0x8B, reg, R12, RDX, 2, 0);
+            jitStoreRF(b, ins.r, reg);
+            break;
+        }
+
+        // STO
+        case 4:
+        {
+            int base = jitBase(b, ins.l);
+
+            int reg = (ins.r < JIT_MAPPED_REGISTERS) ? mappedRegisters[ins.r] : RAX;
+
+            jitRM(b, 0, 0x8D, RDX, base, -1, 0, ins.m);
+            jitCheckAddress(b, stackSize, pc);
+            jitLoadRF(b, reg, ins.r);
+            jitRM(b, 0, 0x89, reg, R12, RDX, 2, 0);
+            jitTouch(b, RDX);
+            break;
+        }
+
+        // CAL
+        case 5:
+        {
+            jitRM(b, 0, 0x8D, RAX, R14, -1, 0, 4);
+            jitCheckStack(b, stackSize, pc);
+
+            int base = jitBase(b, ins.l);
+
+            jitRM(b, 0, 0xC7, 0, R12, R14, 2, 4);
+            jitInt(b, 0);
+            jitRM(b, 0, 0x89, base, R12, R14, 2, 8);
+            jitRM(b, 0, 0x89, R13, R12, R14, 2, 12);
+            jitRM(b, 0, 0xC7, 0, R12, R14, 2, 16);
+            jitInt(b, pc + 1);
+            jitTouch(b, RAX);
+
+            jitRM(b, 1, 0x8D, R13, R14, -1, 0, 1);
+            jitJump(b, ins.m, numOfIns);
+            break;
+        }
+
+        // INC
+        case 6:
+            jitRM(b, 0, 0x8D, RAX, R14, -1, 0, ins.m);
+            jitCheckStack(b, stackSize, pc);
+            jitRM(b, 1, 0x8D, R14, R14, -1, 0, ins.m);
+            break;
+
+        // JMP
+        case 7:
+            jitJump(b, ins.m, numOfIns);
+            break;
+
+        // JPC
+        case 8:
+            if(ins.r < JIT_MAPPED_REGISTERS)
+                jitRR(b, 0, 0x85, mappedRegisters[ins.r], mappedRegisters[ins.r]);
+            else
+            {
+                jitRM(b, 0, 0x83, 7, R15, -1, 0, jitRFOffset(ins.r));
+                jitByte(b, 0);
+            }
+
+            if(ins.m >= 0 && ins.m <= numOfIns) jitJumpTo(b, 0x0F84, ins.m);
+            else
+            {
+                size_t taken = jitShortJump(b, 0x5);
+                jitJump(b, ins.m, numOfIns);
+                jitLand(b, taken);
+            }
+            break;
+
+        // SIO 1
+        case 9:
+            jitCallHelper(b, (uintptr_t)&jitWrite, ins.r, 0);
+            break;
+
+        // SIO 2
+        case 10:
+            jitCallHelper(b, (uintptr_t)&jitRead, ins.r, 1);
+            break;
+
+        // SIO 3
+        case 11:
+            jitHalt(b, JIT_HALT, pc + 1);
+            break;
+
+        // NEG
+        case 12:
+            jitLoadRF(b, RAX, ins.l);
+            jitRR(b, 0, 0xF7, 3, RAX);
+            jitStoreRF(b, ins.r, RAX);
+            break;
+
+        // ADD, SUB, MUL
+        case 13: case 14: case 15:
+            jitLoadRF(b, RAX, ins.l);
+            jitOperand(b, ins.op == 13 ? 0x03 : ins.op == 14 ? 0x2B : 0x0FAF, RAX, ins.m);
+            jitStoreRF(b, ins.r, RAX);
+            break;
+
+        // DIV, MOD: idiv traps on a division by zero, as the interpreter does
+        case 16: case 18:
+            jitLoadRF(b, RAX, ins.l);
+            jitByte(b, 0x99);
+            jitOperand(b, 0xF7, 7, ins.m);
+            jitStoreRF(b, ins.r, ins.op == 16 ? RAX : RDX);
+            break;
+
+        // ODD: the remainder keeps the sign of the dividend, as in C
+        case 17:
+            jitLoadRF(b, RAX, ins.r);
+            jitByte(b, 0x99);
+            jitByte(b, 0xB9);
+            jitInt(b, 2);
+            jitRR(b, 0, 0xF7, 7, RCX);
+            jitStoreRF(b, ins.r, RDX);
+            break;
+
+        // EQL, NEQ, LSS, LEQ, GTR, GEQ
+        case 19: case 20: case 21: case 22: case 23: case 24:
+            jitLoadRF(b, RAX, ins.l);
+            jitOperand(b, 0x3B, RAX, ins.m);
+            jitRR(b, 0, 0x0F00 | conditions[ins.op - 19], 0, RAX);
+            jitRR(b, 0, 0x0FB6, RAX, RAX);
+            jitStoreRF(b, ins.r, RAX);
+            break;
+
+        default:
+            jitHalt(b, JIT_ILLEGAL, pc + 1);
+            break;
+    }
+}
+
+int runJIT(VirtualMachine* vm, const Instruction* ins, int numOfIns, VMIO* io)
+{
+    int i;
+
+    for(i = 0; i < numOfIns; i++)
+        if(!isJITInstruction(ins[i])) return -1;
+
+    JITBuffer b;
+    memset(&b, 0, sizeof(JITBuffer));
+
+    b.capacity = (size_t)numOfIns * 24 + 512;
+    b.bytes = malloc(b.capacity);
+    b.offsets = malloc(((size_t)numOfIns + 1) * sizeof(size_t));
+    const unsigned char** natives = malloc(((size_t)numOfIns + 1) * sizeof(unsigned char*));
+
+    if(!b.bytes || !b.offsets || !natives) b.failed = 1;
+
+    jitPrologue(&b, numOfIns);
+
+    for(i = 0; i < numOfIns && !b.failed; i++)
+    {
+        b.offsets[i] = b.size;
+        jitInstruction(&b, ins[i], i, numOfIns, vm->stackSize);
+    }
+
+    // Falling off the end of the program fetches an illegal instruction
+    if(!b.failed)
+    {
+        b.offsets[numOfIns] = b.size;
+        jitHalt(&b, JIT_ILLEGAL, numOfIns + 1);
+    }
+
+    for(i = 0; i < b.numOfPatches && !b.failed; i++)
+    {
+        int rel = (int)((long)b.offsets[b.patches[i].target] - (long)(b.patches[i].at + 4));
+        memcpy(b.bytes + b.patches[i].at, &rel, 4);
+    }
+
+    // The code is written, then made executable, never both
+    unsigned char* code = MAP_FAILED;
+
+    if(!b.failed)
+        code = mmap(NULL, b.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(code != MAP_FAILED)
+    {
+        memcpy(code, b.bytes, b.size);
+
+        if(mprotect(code, b.size, PROT_READ | PROT_EXEC))
+        {
+            munmap(code, b.size);
+            code = MAP_FAILED;
+        }
+    }
+
+    int status = -1;
+
+    if(code != MAP_FAILED)
+    {
+        JITState state;
+        void (*entry)(JITState*) = (void (*)(JITState*))(uintptr_t)code;
+
+        for(i = 0; i <= numOfIns; i++) natives[i] = code + b.offsets[i];
+
+        memcpy(state.RF, vm->RF, sizeof(state.RF));
+        state.PC = vm->PC;
+        state.BP = vm->BP;
+        state.SP = vm->SP;
+        state.touched = vm->touched;
+        state.status = JIT_ILLEGAL;
+        state.stack = vm->stack;
+        state.natives = natives;
+        state.io = io;
+
+        entry(&state);
+
+        memcpy(vm->RF, state.RF, sizeof(state.RF));
+        vm->PC = state.PC;
+        vm->BP = state.BP;
+        vm->SP = state.SP;
+        vm->touched = state.touched;
+        status = state.status;
+
+        munmap(code, b.size);
+    }
+
+    free(b.bytes);
+    free(b.offsets);
+    free(b.patches);
+    free(natives);
+
+    return status;
+}
+
+#else
+
+int runJIT(struct VirtualMachine* vm, const Instruction* ins, int numOfIns, VMIO* io)
+{
+    return -1;
+}
+
+#endif
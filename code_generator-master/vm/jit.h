@@ -0,0 +1,52 @@
+#ifndef __JIT_H__
+#define __JIT_H__
+
+#include <stdio.h>
+#include "data.h"
+#include "sio.h"
+
+/**
+ * The JIT translates the code memory into x86-64 machine code and runs it
+ * natively. It is built on x86-64 systems with mmap only; define VM_NO_JIT to
+ * leave it out. Where it is not built, runJIT() runs nothing and the machine
+ * falls back to the interpreter.
+ *
+ * Registers 0 to 7 of the register file live in machine registers, the others
+ * in memory. BP and SP live in machine registers as well, and LOD and STO
+ * address the stack directly from BP, or from the static links walked inline
+ * when L is not 0. JMP, JPC and CAL are native jumps to the code of their
+ * target. RTN returns through a table of the native address of each
+ * instruction, since the return address is a PM/0 address on the stack, which
+ * the program could read and write like any other slot. SIO calls back into C,
+ * into the same SIO streams as the interpreter (see sio.h).
+ *
+ * The machine halts in the same state as after runThreadedEngine(): the same
+ * registers, the same stack and the same output, illegal instructions and
+ * stack overflows included.
+ * */
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__)) && !defined(VM_NO_JIT)
+#define VM_HAVE_JIT 1
+#else
+#define VM_HAVE_JIT 0
+#endif
+
+/**
+ * Why the machine halted, as returned by runJIT().
+ *  JIT_HALT    : SIO 3
+ *  JIT_ILLEGAL : an illegal instruction, or a jump out of the loaded program
+ *  JIT_OVERFLOW: a CAL or an INC past the stack limit
+ * */
+enum { JIT_HALT, JIT_ILLEGAL, JIT_OVERFLOW };
+
+/**
+ * Translates the numOfIns (ins)tructions and runs them on the (v)irtual
+ * (m)achine, from its current state, until it halts. The registers are written
+ * back to the machine. Nothing is printed but the output of the program on
+ * (io), which is left in its buffer: the caller reports the illegal instructions and the stack overflows.
+ * Returns why the machine halted, or -1, with the machine left untouched, if
+ * the code could not be translated: no JIT, no executable memory, or a
+ * register index out of the register file, which only the interpreter runs.
+ * */
+int runJIT(struct VirtualMachine* vm, const Instruction* ins, int numOfIns, VMIO* io);
+
+#endif
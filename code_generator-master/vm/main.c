@@ -1,27 +1,158 @@
+
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include "vm.h"
+#include "runner.h"
+#include "profile.h"
+#include "stats.h"
+
+/**
+ * Parses the options given before the positional arguments into the given
+ * VMOptions, the manifest of --batch, the number of workers of --jobs, the
+ * files --profile and --profile-folded write the profile to, and whether the
+ * statistics of the run are printed.
+ * Returns the number of arguments consumed, or -1 if an option is not
+ * recognized.
+ * */
+int parseOptions(int argc, char **argv, VMOptions* options, const char** manifest, int* workers,
+                 const char** profileFile, const char** foldedFile, int* printStats)
+{
+    int i;
+    for(i = 1; i < argc && !strncmp(argv[i], "--", 2); i++)
+    {
+        if( !strcmp(argv[i], "--engine=switch") )        options->engine = VM_ENGINE_SWITCH;
+        else if( !strcmp(argv[i], "--engine=threaded") ) options->engine = VM_ENGINE_THREADED;
+        else if( !strcmp(argv[i], "--engine=jit") )      options->engine = VM_ENGINE_JIT;
+        else if( !strcmp(argv[i], "--engine=jit-check") ) options->engine = VM_ENGINE_JIT_CHECK;
+        else if( !strcmp(argv[i], "--trace=full") )      options->trace = VM_TRACE_FULL;
+        else if( !strcmp(argv[i], "--trace=none") )      options->trace = VM_TRACE_NONE;
+        else if( !strcmp(argv[i], "--trace=ring") )      options->trace = VM_TRACE_RING;
+        else if( !strncmp(argv[i], "--trace-ring-size=", 18) && atoi(argv[i] + 18) > 0 )
+        {
+            options->trace = VM_TRACE_RING;
+            options->traceRingSize = atoi(argv[i] + 18);
+        }
+        else if( !strncmp(argv[i], "--stack-limit=", 14) && atoi(argv[i] + 14) > 0 )
+            options->stackLimit = atoi(argv[i] + 14);
+        else if( !strncmp(argv[i], "--code-limit=", 13) && atoi(argv[i] + 13) > 0 )
+            options->codeLimit = atoi(argv[i] + 13);
+        else if( !strcmp(argv[i], "--batch") && i + 1 < argc ) *manifest = argv[++i];
+        else if( !strncmp(argv[i], "--jobs=", 7) && atoi(argv[i] + 7) > 0 )
+            *workers = atoi(argv[i] + 7);
+        else if( !strncmp(argv[i], "--profile=", 10) && argv[i][10] )         *profileFile = argv[i] + 10;
+        else if( !strncmp(argv[i], "--profile-folded=", 17) && argv[i][17] ) *foldedFile = argv[i] + 17;
+        else if( !strcmp(argv[i], "--stats") )           *printStats = 1;
+        else if( !strcmp(argv[i], "--interactive") )     options->interactive = 1;
+        else
+        {
+            fprintf(stderr, "Unknown option \"%s\"\n", argv[i]);
+            return -1;
+        }
+    }
+
+    return i - 1;
+}
+
+/**
+ * Runs the programs listed in the given manifest on the given number of
+ * workers, and prints the summary on stdout. Returns 0 if all the programs
+ * were run, 1 if any failed, -1 if the manifest could not be run.
+ * */
+int runManifest(const char* path, int workers, VMOptions options)
+{
+    FILE* manifest = fopen(path, "r");
+    if(!manifest)
+    {
+        fprintf(stderr, "Could not open \"%s\"\n", path);
+        return -1;
+    }
+
+    VMJobList list;
+    int err = readVMManifest(manifest, &list);
+    fclose(manifest);
+
+    if(err)
+    {
+        if(err > 0) fprintf(stderr, "%s:%d: expected a code, an input and an output path\n", path, err);
+        else        fprintf(stderr, "Could not read \"%s\"\n", path);
+
+        deleteVMJobList(&list);
+        return -1;
+    }
+
+    VMPool pool;
+    initVMPool(&pool, options.stackLimit);
+
+    workers = runVMJobs(&list, &pool, workers, options);
+
+    int failed = -1;
+    if(workers > 0)
+    {
+        printVMJobSummary(&list, workers, stdout);
+        failed = countVMJobFailures(&list);
+    }
+    else fprintf(stderr, "Could not start the workers\n");
+
+    deleteVMPool(&pool);
+    deleteVMJobList(&list);
+
+    if(failed < 0) return -1;
+    return failed ? 1 : 0;
+}
 
 int main(int argc, char **argv)
 {
     FILE *inp, *outp, *vm_inp, *vm_outp;
 
-    if(argc == 3)
+    // Options come before the positional arguments
+    VMOptions options = getDefaultVMOptions();
+    const char* manifest = NULL;
+    const char* profileFile = NULL;
+    const char* foldedFile = NULL;
+    int workers = 0, printStats = 0;
+    int optionCount = parseOptions(argc, argv, &options, &manifest, &workers, &profileFile, &foldedFile, &printStats);
+
+    if(optionCount < 0) return -1;
+
+    // The programs of --batch are not profiled
+    VMProfile profile;
+    initVMProfile(&profile);
+
+    if((profileFile || foldedFile) && !manifest) options.profile = &profile;
+
+    // Neither are their statistics
+    RunStats stats;
+    initRunStats(&stats);
+
+    if(printStats && !manifest) options.stats = &stats;
+
+    argv[optionCount] = argv[0];
+    argv += optionCount;
+    argc -= optionCount;
+
+    if(manifest && argc == 1)
     {
-        inp     = fopen(argv[1], "r");
+        return runManifest(manifest, workers, options);
+    }
+    else if(argc == 3)
+    {
+        inp     = fopen(argv[1], "rb");
         outp    = fopen(argv[2], "w");
 
         vm_inp  = stdin;
         vm_outp = stdout;
 
-        simulateVM(inp, outp, vm_inp, vm_outp);
+        simulateVMWithOptions(inp, outp, vm_inp, vm_outp, options);
+        if(profile.counts) writeVMProfile(&profile, profileFile, foldedFile);
+        if(options.stats) printRunStats(&stats, stderr);
 
         fclose(inp);
         fclose(outp);
     }
     else if(argc == 5)
     {
-        inp     = fopen(argv[1], "r");
+        inp     = fopen(argv[1], "rb");
         outp    = fopen(argv[2], "w");
 
         // vm_inp
@@ -32,7 +163,9 @@ int main(int argc, char **argv)
         if( strcmp(argv[3], "-") ) vm_outp = fopen(argv[4], "w");
         else                       vm_outp = stdout;
 
-        simulateVM(inp, outp, vm_inp, vm_outp);
+        simulateVMWithOptions(inp, outp, vm_inp, vm_outp, options);
+        if(profile.counts) writeVMProfile(&profile, profileFile, foldedFile);
+        if(options.stats) printRunStats(&stats, stderr);
 
         fclose(inp);
         fclose(outp);
@@ -45,10 +178,57 @@ int main(int argc, char **argv)
     }
     else
     {
-        fprintf(stderr, "Usage: vm.out (ins_inp_file) (simul_outp_file) [vm_inp_file=stdin] [vm_outp_file=stdout]\n");
+        fprintf(stderr, "Usage: vm.out [options] (ins_inp_file) (simul_outp_file) [vm_inp_file=stdin] [vm_outp_file=stdout]\n"
+                        "       vm.out [options] --batch (manifest) [--jobs=N]\n");
+
+        fprintf(stderr, "\n\t--engine=threaded  Run the program on the threaded engine, which decodes the"
+                        "\n\t                   code memory once and dispatches directly between handlers."
+                        "\n\t                   This is the default.\n");
+        fprintf(stderr, "\n\t--engine=switch    Run the program on the switch engine, which fetches and"
+                        "\n\t                   decodes every instruction as it is executed.\n");
+        fprintf(stderr, "\n\t--engine=jit       Translate the code memory into machine code and run it"
+                        "\n\t                   natively (x86-64 only). Traced runs, and programs it could"
+                        "\n\t                   not translate, run on the threaded engine.\n");
+        fprintf(stderr, "\n\t--engine=jit-check Run the program on the JIT, then on the threaded engine, and"
+                        "\n\t                   report on stderr where the output or the final machine"
+                        "\n\t                   state differ. The output is the threaded engine's.\n");
+        fprintf(stderr, "\n\t--trace=full       Write the machine state after every executed instruction"
+                        "\n\t                   to simul_outp_file. This is the default.\n");
+        fprintf(stderr, "\n\t--trace=none       Write only the code memory to simul_outp_file and skip the"
+                        "\n\t                   execution history. Useful for fast runs.\n");
+        fprintf(stderr, "\n\t--trace=ring       Keep the last executed instructions in memory and write"
+                        "\n\t                   them to simul_outp_file when the machine halts.\n");
+        fprintf(stderr, "\n\t--trace-ring-size=N"
+                        "\n\t                   The number of instructions --trace=ring keeps (default %d).\n",
+                        VM_DEFAULT_TRACE_RING_SIZE);
+        fprintf(stderr, "\n\t--stack-limit=N    The number of ints the stack could grow to (default %d)."
+                        "\n\t                   A call or INC past it halts with a stack overflow.\n",
+                        VM_DEFAULT_STACK_LIMIT);
+        fprintf(stderr, "\n\t--code-limit=N     The number of instructions the code memory could hold"
+                        "\n\t                   (default %d).\n",
+                        VM_DEFAULT_CODE_LIMIT);
+        fprintf(stderr, "\n\t--profile=FILE     Count the executions of each instruction, opcode and"
+                        "\n\t                   procedure, and write the hotspots to FILE. The program"
+                        "\n\t                   runs on the threaded engine.\n");
+        fprintf(stderr, "\n\t--profile-folded=FILE"
+                        "\n\t                   Same as --profile, and write the instructions executed in"
+                        "\n\t                   each chain of calls to FILE, as folded stacks for the"
+                        "\n\t                   flame graph tools.\n");
+        fprintf(stderr, "\n\t--interactive      Write the output of the program as soon as it is written, and"
+                        "\n\t                   read its input a line at a time, instead of a buffer at a"
+                        "\n\t                   time. Runs at a terminal are interactive anyway.\n");
+        fprintf(stderr, "\n\t--stats            Print the time taken to load and to run the program, the"
+                        "\n\t                   instructions executed and the stack used on stderr, a"
+                        "\n\t                   key=value pair per line.\n");
+        fprintf(stderr, "\n\t--batch MANIFEST   Run each program listed in the manifest, a line"
+                        "\n\t                   \"ins_inp_file vm_inp_file vm_outp_file\" per program, on a"
+                        "\n\t                   pool of threads, and print a summary on stdout. No"
+                        "\n\t                   simulation output is written.\n");
+        fprintf(stderr, "\n\t--jobs=N           Use N threads for --batch (default one per processor).\n");
 
         fprintf(stderr, "\n\tins_inp_file  The path to the file containing the list of instructions to"
-                        "\n\t              be loaded to code memory of the virtual machine.\n");
+                        "\n\t              be loaded to code memory of the virtual machine, either as"
+                        "\n\t              text or as a binary object file.\n");
 
         fprintf(stderr, "\n\tsimul_outp_file  The path to the file to write the simulation output, which"
                         "\n\t                 contains both code memory and execution history.\n");
@@ -60,5 +240,7 @@ int main(int argc, char **argv)
                         "\n\t             by SIO instructions. Use dash ('-') to assign to stdout.\n");
     }
 
+    deleteVMProfile(&profile);
+
     return 0;
-}
+}
\ No newline at end of file
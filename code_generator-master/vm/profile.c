@@ -0,0 +1,442 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "profile.h"
+
+/**
+ * allows conversion from opcode to opcode string, see vm.c
+ * */
+extern const char *opcodes[];
+
+/**
+ * Counts of a procedure, summed over its nodes, for the report.
+ * */
+typedef struct {
+    int entry;
+    long long calls;
+    long long self;
+    long long total;
+} ProfileProcedure;
+
+/**
+ * The profile being sorted by qsort(), which passes no context.
+ * */
+static const VMProfile* sortedProfile;
+
+/**
+ * Allocates the nodes, the table and the frames of the given profile, at
+ * their initial capacity. Exits if they could not be allocated.
+ * */
+void allocateProfileTree(VMProfile* profile)
+{
+    profile->nodeCapacity = 64;
+    profile->tableSize = 128;
+    profile->frameCapacity = 64;
+
+    profile->nodes = malloc(profile->nodeCapacity * sizeof(ProfileNode));
+    profile->table = calloc(profile->tableSize, sizeof(int));
+    profile->frames = malloc(profile->frameCapacity * sizeof(ProfileFrame));
+
+    if(!profile->nodes || !profile->table || !profile->frames)
+    {
+        fprintf(stderr, "Could not allocate the profile.\n");
+        exit(0);
+    }
+}
+
+void initVMProfile(VMProfile* profile)
+{
+    memset(profile, 0, sizeof(VMProfile));
+}
+
+void deleteVMProfile(VMProfile* profile)
+{
+    free(profile->code);
+    free(profile->counts);
+    free(profile->nodes);
+    free(profile->table);
+    free(profile->frames);
+
+    initVMProfile(profile);
+}
+
+int beginVMProfile(VMProfile* profile, const Instruction* ins, int numOfIns)
+{
+    deleteVMProfile(profile);
+
+    profile->code = malloc((numOfIns ? numOfIns : 1) * sizeof(Instruction));
+    profile->counts = calloc(numOfIns + 1, sizeof(long long));
+
+    if(!profile->code || !profile->counts)
+    {
+        fprintf(stderr, "Could not allocate the profile, the program is not profiled.\n");
+        deleteVMProfile(profile);
+        return -1;
+    }
+
+    memcpy(profile->code, ins, numOfIns * sizeof(Instruction));
+    profile->numOfIns = numOfIns;
+
+    allocateProfileTree(profile);
+
+    // The root, the code run from address 0
+    ProfileNode root = { -1, 0, 0, 1, 0, 0 };
+    profile->nodes[0] = root;
+    profile->numOfNodes = 1;
+    profile->current = 0;
+
+    return 0;
+}
+
+/**
+ * Returns the slot of the hash table of the given profile holding the node
+ * (entry) called from the node (parent), or the empty slot it would be in.
+ * */
+int findProfileSlot(const VMProfile* profile, int parent, int entry)
+{
+    unsigned int hash = (unsigned int)parent * 2654435761u ^ (unsigned int)entry * 40503u;
+    unsigned int mask = (unsigned int)profile->tableSize - 1;
+    unsigned int slot = hash & mask;
+
+    for(;;)
+    {
+        int node = profile->table[slot] - 1;
+
+        if(node < 0) return (int)slot;
+        if(profile->nodes[node].parent == parent && profile->nodes[node].entry == entry) return (int)slot;
+
+        slot = (slot + 1) & mask;
+    }
+}
+
+/**
+ * Returns the node of the procedure at entry called from the node (parent),
+ * adding it to the tree if it is not in it yet.
+ * */
+int getProfileNode(VMProfile* profile, int parent, int entry)
+{
+    int slot = findProfileSlot(profile, parent, entry);
+
+    if(profile->table[slot]) return profile->table[slot] - 1;
+
+    if(profile->numOfNodes == profile->nodeCapacity)
+    {
+        profile->nodeCapacity *= 2;
+        profile->nodes = realloc(profile->nodes, profile->nodeCapacity * sizeof(ProfileNode));
+
+        if(!profile->nodes)
+        {
+            fprintf(stderr, "Could not allocate the profile.\n");
+            exit(0);
+        }
+    }
+
+    int node = profile->numOfNodes++;
+    ProfileNode added = { parent, entry, profile->nodes[parent].depth + 1, 0, 0, 0 };
+    profile->nodes[node] = added;
+    profile->table[slot] = node + 1;
+
+    // Keep the table at most half full
+    if(2 * profile->numOfNodes > profile->tableSize)
+    {
+        int i;
+
+        free(profile->table);
+        profile->tableSize *= 2;
+        profile->table = calloc(profile->tableSize, sizeof(int));
+
+        if(!profile->table)
+        {
+            fprintf(stderr, "Could not allocate the profile.\n");
+            exit(0);
+        }
+
+        for(i = 0; i < profile->numOfNodes; i++)
+            profile->table[findProfileSlot(profile, profile->nodes[i].parent, profile->nodes[i].entry)] = i + 1;
+    }
+
+    return node;
+}
+
+/**
+ * Gives the instructions executed since the last event to the current node.
+ * */
+void chargeProfileNode(VMProfile* profile, long long steps)
+{
+    profile->nodes[profile->current].self += steps - profile->lastSteps;
+    profile->lastSteps = steps;
+}
+
+void profileCall(VMProfile* profile, int entry, int bp, long long steps)
+{
+    chargeProfileNode(profile, steps);
+
+    if(profile->numOfFrames == profile->frameCapacity)
+    {
+        profile->frameCapacity *= 2;
+        profile->frames = realloc(profile->frames, profile->frameCapacity * sizeof(ProfileFrame));
+
+        if(!profile->frames)
+        {
+            fprintf(stderr, "Could not allocate the profile.\n");
+            exit(0);
+        }
+    }
+
+    ProfileFrame frame = { bp, profile->current };
+    profile->frames[profile->numOfFrames++] = frame;
+
+    // A procedure calling itself, or called too deep, stays in the same node
+    ProfileNode* current = &profile->nodes[profile->current];
+
+    if(current->entry != entry && current->depth < VM_PROFILE_MAX_DEPTH)
+        profile->current = getProfileNode(profile, profile->current, entry);
+
+    profile->nodes[profile->current].calls++;
+}
+
+void profileReturn(VMProfile* profile, int bp, long long steps)
+{
+    chargeProfileNode(profile, steps);
+
+    // The activation records above bp were left without a RTN of their own
+    while(profile->numOfFrames > 0 && profile->frames[profile->numOfFrames - 1].bp > bp)
+        profile->numOfFrames--;
+
+    if(profile->numOfFrames > 0 && profile->frames[profile->numOfFrames - 1].bp == bp)
+        profile->current = profile->frames[--profile->numOfFrames].caller;
+}
+
+void endVMProfile(VMProfile* profile, long long steps)
+{
+    chargeProfileNode(profile, steps);
+    profile->steps = steps;
+}
+
+/**
+ * Returns the given count as a percentage of the instructions executed.
+ * */
+double profilePercent(const VMProfile* profile, long long count)
+{
+    return profile->steps ? 100.0 * (double)count / (double)profile->steps : 0.0;
+}
+
+/**
+ * Writes the name of the procedure at entry into the name buffer of the given
+ * size: main for the root, proc_ followed by the address for the others.
+ * */
+void getProfileName(char* name, size_t size, int entry)
+{
+    if(entry == 0) snprintf(name, size, "main");
+    else           snprintf(name, size, "proc_%d", entry);
+}
+
+/**
+ * qsort() comparators: the addresses by their executions, the most first, then
+ * by address, and the procedures by their self cycles, then by entry.
+ * */
+int compareProfileCounts(const void* a, const void* b)
+{
+    long long ca = sortedProfile->counts[*(const int*)a], cb = sortedProfile->counts[*(const int*)b];
+
+    if(ca != cb) return (ca < cb) ? 1 : -1;
+    return *(const int*)a - *(const int*)b;
+}
+
+int compareProfileEntries(const void* a, const void* b)
+{
+    const ProfileNode* na = &sortedProfile->nodes[*(const int*)a];
+    const ProfileNode* nb = &sortedProfile->nodes[*(const int*)b];
+
+    if(na->entry != nb->entry) return (na->entry < nb->entry) ? -1 : 1;
+    return *(const int*)a - *(const int*)b;
+}
+
+int compareProfileProcedures(const void* a, const void* b)
+{
+    const ProfileProcedure* pa = a;
+    const ProfileProcedure* pb = b;
+
+    if(pa->self != pb->self) return (pa->self < pb->self) ? 1 : -1;
+    return pa->entry - pb->entry;
+}
+
+/**
+ * Returns 1 if a caller of the given node, up to the root, is the same
+ * procedure as it: its cycles are then in the total of that caller already.
+ * */
+int isRecursiveNode(const VMProfile* profile, int node)
+{
+    int entry = profile->nodes[node].entry, parent;
+
+    for(parent = profile->nodes[node].parent; parent >= 0; parent = profile->nodes[parent].parent)
+        if(profile->nodes[parent].entry == entry) return 1;
+
+    return 0;
+}
+
+void printVMProfile(VMProfile* profile, FILE* out)
+{
+    int numOfIns = profile->numOfIns, i;
+    int* order = malloc((numOfIns + 1 + profile->numOfNodes) * sizeof(int));
+    ProfileProcedure* procedures = malloc(profile->numOfNodes * sizeof(ProfileProcedure));
+    long long opcodeCounts[25];
+    int opcodeOrder[25];
+
+    if(!order || !procedures)
+    {
+        fprintf(stderr, "Could not allocate the profile report.\n");
+        exit(0);
+    }
+
+    sortedProfile = profile;
+
+    fprintf(out, "Instructions executed: %lld\n", profile->steps);
+
+    // The instructions executed the most
+    for(i = 0; i <= numOfIns; i++) order[i] = i;
+    qsort(order, numOfIns + 1, sizeof(int), compareProfileCounts);
+
+    fprintf(out, "\nHotspots:\n");
+    fprintf(out, "%7s %3s %3s %3s %5s %12s %7s\n", "#", "OP", "R", "L", "M", "COUNT", "%");
+
+    for(i = 0; i < VM_PROFILE_HOTSPOTS && i <= numOfIns && profile->counts[order[i]] > 0; i++)
+    {
+        int pc = order[i];
+
+        // The illegal instructions fetched out of the code are counted last
+        Instruction ins = { 0, 0, 0, 0 };
+        if(pc < numOfIns) ins = profile->code[pc];
+
+        const char* opName = (ins.op >= 1 && ins.op <= 24) ? opcodes[ins.op] : opcodes[0];
+
+        if(pc < numOfIns)
+            fprintf(out, "%7d %3s %3d %3d %5d %12lld %7.2f\n",
+                pc, opName, ins.r, ins.l, ins.m, profile->counts[pc], profilePercent(profile, profile->counts[pc]));
+        else
+            fprintf(out, "%7s %3s %3s %3s %5s %12lld %7.2f\n",
+                "outside", opName, "", "", "", profile->counts[pc], profilePercent(profile, profile->counts[pc]));
+    }
+
+    // The opcodes, from the counts of their instructions
+    memset(opcodeCounts, 0, sizeof(opcodeCounts));
+
+    for(i = 0; i <= numOfIns; i++)
+    {
+        int op = (i < numOfIns) ? profile->code[i].op : 0;
+        opcodeCounts[(op >= 1 && op <= 24) ? op : 0] += profile->counts[i];
+    }
+
+    for(i = 0; i < 25; i++) opcodeOrder[i] = i;
+
+    // Sorted by count, insertion sort on the 25 opcodes
+    int j;
+    for(i = 1; i < 25; i++)
+    {
+        int op = opcodeOrder[i];
+
+        for(j = i; j > 0 && opcodeCounts[opcodeOrder[j - 1]] < opcodeCounts[op]; j--) opcodeOrder[j] = opcodeOrder[j - 1];
+        opcodeOrder[j] = op;
+    }
+
+    fprintf(out, "\nOpcodes:\n");
+    fprintf(out, "%7s %7s %12s %7s\n", "OPCODE", "OP", "COUNT", "%");
+
+    for(i = 0; i < 25 && opcodeCounts[opcodeOrder[i]] > 0; i++)
+    {
+        int op = opcodeOrder[i];
+        fprintf(out, "%7d %7s %12lld %7.2f\n", op, opcodes[op], opcodeCounts[op], profilePercent(profile, opcodeCounts[op]));
+    }
+
+    // The total of each node, the nodes being created after their callers
+    for(i = 0; i < profile->numOfNodes; i++) profile->nodes[i].total = profile->nodes[i].self;
+
+    for(i = profile->numOfNodes - 1; i > 0; i--)
+        profile->nodes[profile->nodes[i].parent].total += profile->nodes[i].total;
+
+    // The procedures, summed over the nodes of the same entry
+    int* nodeOrder = order + numOfIns + 1;
+    int numOfProcedures = 0;
+
+    for(i = 0; i < profile->numOfNodes; i++) nodeOrder[i] = i;
+    qsort(nodeOrder, profile->numOfNodes, sizeof(int), compareProfileEntries);
+
+    for(i = 0; i < profile->numOfNodes; i++)
+    {
+        const ProfileNode* node = &profile->nodes[nodeOrder[i]];
+
+        if(numOfProcedures == 0 || procedures[numOfProcedures - 1].entry != node->entry)
+        {
+            ProfileProcedure procedure = { node->entry, 0, 0, 0 };
+            procedures[numOfProcedures++] = procedure;
+        }
+
+        ProfileProcedure* procedure = &procedures[numOfProcedures - 1];
+        procedure->calls += node->calls;
+        procedure->self += node->self;
+        if(!isRecursiveNode(profile, nodeOrder[i])) procedure->total += node->total;
+    }
+
+    qsort(procedures, numOfProcedures, sizeof(ProfileProcedure), compareProfileProcedures);
+
+    fprintf(out, "\nProcedures:\n");
+    fprintf(out, "%-12s %10s %12s %7s %12s %7s\n", "PROCEDURE", "CALLS", "SELF", "%", "TOTAL", "%");
+
+    for(i = 0; i < numOfProcedures; i++)
+    {
+        char name[32];
+        getProfileName(name, sizeof(name), procedures[i].entry);
+
+        fprintf(out, "%-12s %10lld %12lld %7.2f %12lld %7.2f\n",
+            name, procedures[i].calls,
+            procedures[i].self, profilePercent(profile, procedures[i].self),
+            procedures[i].total, profilePercent(profile, procedures[i].total));
+    }
+
+    free(order);
+    free(procedures);
+}
+
+void printFoldedStacks(VMProfile* profile, FILE* out)
+{
+    int path[VM_PROFILE_MAX_DEPTH + 1];
+    int i;
+
+    for(i = 0; i < profile->numOfNodes; i++)
+    {
+        if(profile->nodes[i].self == 0) continue;
+
+        // The callers, from the node up to the root
+        int depth = 0, node;
+        for(node = i; node >= 0 && depth <= VM_PROFILE_MAX_DEPTH; node = profile->nodes[node].parent)
+            path[depth++] = profile->nodes[node].entry;
+
+        while(depth-- > 0)
+        {
+            char name[32];
+            getProfileName(name, sizeof(name), path[depth]);
+            fprintf(out, "%s%c", name, depth ? ';' : ' ');
+        }
+
+        fprintf(out, "%lld\n", profile->nodes[i].self);
+    }
+}
+
+void writeVMProfile(VMProfile* profile, const char* profileFile, const char* foldedFile)
+{
+    FILE* out;
+
+    if(profileFile && (out = fopen(profileFile, "w")))
+    {
+        printVMProfile(profile, out);
+        fclose(out);
+    }
+    else if(profileFile) fprintf(stderr, "Could not open \"%s\"\n", profileFile);
+
+    if(foldedFile && (out = fopen(foldedFile, "w")))
+    {
+        printFoldedStacks(profile, out);
+        fclose(out);
+    }
+    else if(foldedFile) fprintf(stderr, "Could not open \"%s\"\n", foldedFile);
+}
@@ -0,0 +1,154 @@
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdio.h>
+#include "data.h"
+
+/**
+ * Execution profile of a program run by the virtual machine.
+ *
+ * The engine counts the executions of each instruction, by its address, and
+ * the number of instructions executed. The counts of each opcode are summed
+ * from those of the instructions when the report is printed.
+ *
+ * The procedures are counted on CAL and RTN only, in a calling context tree:
+ * a node per procedure and per chain of callers it was called through, the
+ * root being the code run from address 0. CAL enters the node of its target
+ * under the current one, RTN goes back to the node the activation record it
+ * leaves was entered from: the activation records are matched by their BP,
+ * i.e. following the dynamic links, so a program leaving several of them at
+ * once, or none, is still counted right. The instructions executed between
+ * two such events are the cycles of the current node.
+ *
+ * A procedure calling itself stays in the same node, and the nodes deeper
+ * than VM_PROFILE_MAX_DEPTH take the calls of their callees, so that a deep
+ * recursion neither fills the memory nor the folded stacks.
+ * */
+
+/**
+ * The depth of the deepest node of the calling context tree.
+ * */
+#define VM_PROFILE_MAX_DEPTH 128
+
+/**
+ * The number of instructions the hotspot report lists.
+ * */
+#define VM_PROFILE_HOTSPOTS 20
+
+/**
+ * A node of the calling context tree.
+ * parent: the index of the node of the caller, -1 for the root
+ * entry : the address of the procedure, 0 for the root
+ * depth : the number of callers up to the root
+ * calls : the number of times it was entered
+ * self  : the instructions executed in it, not in its callees
+ * total : the instructions executed in it and in its callees, set by
+ *         printVMProfile()
+ * */
+typedef struct {
+    int parent;
+    int entry;
+    int depth;
+    long long calls;
+    long long self;
+    long long total;
+} ProfileNode;
+
+/**
+ * An activation record entered by a CAL: its BP, and the node of its caller.
+ * */
+typedef struct {
+    int bp;
+    int caller;
+} ProfileFrame;
+
+/**
+ * The profile of a run.
+ * code      : a copy of the numOfIns instructions run
+ * counts    : the executions of each instruction, numOfIns + 1 of them: the
+ *             last one for the illegal instructions fetched out of the code
+ * steps     : the number of instructions executed
+ * nodes     : the calling context tree, numOfNodes in nodeCapacity allocated,
+ *             current the node being run
+ * table     : the node of each (parent, entry) plus one, 0 if none, an open
+ *             addressing hash table of tableSize slots
+ * frames    : the activation records entered, numOfFrames in frameCapacity
+ * lastSteps : steps when the current node was last entered or returned to
+ * */
+typedef struct VMProfile {
+    Instruction* code;
+    int numOfIns;
+    long long* counts;
+    long long steps;
+
+    ProfileNode* nodes;
+    int numOfNodes;
+    int nodeCapacity;
+    int current;
+
+    int* table;
+    int tableSize;
+
+    ProfileFrame* frames;
+    int numOfFrames;
+    int frameCapacity;
+
+    long long lastSteps;
+} VMProfile;
+
+/**
+ * Initializes an empty profile.
+ * */
+void initVMProfile(VMProfile*);
+
+/**
+ * Releases the counts of the profile.
+ * */
+void deleteVMProfile(VMProfile*);
+
+/**
+ * Starts the profile of a run of the numOfIns (ins)tructions, from the root,
+ * dropping what was counted before. Returns 0 on success, -1 if the counts
+ * could not be allocated, in which case the run is not to be profiled.
+ * */
+int beginVMProfile(VMProfile*, const Instruction* ins, int numOfIns);
+
+/**
+ * A CAL to the procedure at entry creates the activation record at bp, after
+ * steps instructions executed, the CAL included.
+ * */
+void profileCall(VMProfile*, int entry, int bp, long long steps);
+
+/**
+ * A RTN leaves the activation record at bp, after steps instructions executed,
+ * the RTN included.
+ * */
+void profileReturn(VMProfile*, int bp, long long steps);
+
+/**
+ * The machine halted after steps instructions executed.
+ * */
+void endVMProfile(VMProfile*, long long steps);
+
+/**
+ * Prints the hotspot report of the given profile: the instructions executed
+ * the most, the opcodes and the procedures, each sorted by the instructions
+ * executed in them.
+ * */
+void printVMProfile(VMProfile*, FILE*);
+
+/**
+ * Prints the calling context tree in the folded stacks format of the flame
+ * graph tools: a line "main;proc_5;proc_12 cycles" per node, the procedures
+ * named after their address, and its self cycles.
+ * */
+void printFoldedStacks(VMProfile*, FILE*);
+
+/**
+ * Writes the hotspot report of the given profile to the file named
+ * profileFile, and its folded stacks to the file named foldedFile, each if not
+ * NULL.
+ * */
+void writeVMProfile(VMProfile*, const char* profileFile, const char* foldedFile);
+
+#endif
@@ -0,0 +1,336 @@
+#include "runner.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The size of each of the SIO stream buffers of a worker.
+ * */
+#define VM_RUNNER_BUFFER_SIZE (1 << 16)
+
+/**
+ * State shared by the workers of runVMJobs(): the programs, the index of the
+ * next one to run, and the pool the machines come from.
+ * */
+typedef struct {
+    VMJobList* list;
+    VMPool* pool;
+    VMOptions options;
+    int next;
+    pthread_mutex_t lock;
+} VMRunner;
+
+void initVMPool(VMPool* pool, int stackLimit)
+{
+    pool->machines = NULL;
+    pool->idle = NULL;
+    pool->numOfMachines = 0;
+    pool->numOfIdle = 0;
+    pool->capacity = 0;
+    pool->stackLimit = stackLimit;
+    pthread_mutex_init(&pool->lock, NULL);
+}
+
+void deleteVMPool(VMPool* pool)
+{
+    int i;
+    for(i = 0; i < pool->numOfMachines; i++)
+    {
+        deleteVM(pool->machines[i]);
+        free(pool->machines[i]);
+    }
+
+    free(pool->machines);
+    free(pool->idle);
+    pthread_mutex_destroy(&pool->lock);
+
+    pool->machines = pool->idle = NULL;
+    pool->numOfMachines = pool->numOfIdle = pool->capacity = 0;
+}
+
+VirtualMachine* acquireVM(VMPool* pool)
+{
+    VirtualMachine* vm = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+
+    if(pool->numOfIdle > 0)
+    {
+        vm = pool->idle[--pool->numOfIdle];
+    }
+    else
+    {
+        // Room for the new machine in both arrays, so that releasing it
+        // .. later needs no allocation
+        if(pool->numOfMachines == pool->capacity)
+        {
+            int capacity = pool->capacity ? pool->capacity * 2 : 8;
+            VirtualMachine** machines = realloc(pool->machines, capacity * sizeof(VirtualMachine*));
+            if(machines) pool->machines = machines;
+
+            VirtualMachine** idle = machines ? realloc(pool->idle, capacity * sizeof(VirtualMachine*)) : NULL;
+            if(idle) pool->idle = idle;
+
+            if(machines && idle) pool->capacity = capacity;
+        }
+
+        if(pool->numOfMachines < pool->capacity)
+        {
+            vm = malloc(sizeof(VirtualMachine));
+
+            if(vm && initVM(vm, pool->stackLimit))
+            {
+                free(vm);
+                vm = NULL;
+            }
+
+            if(vm) pool->machines[pool->numOfMachines++] = vm;
+        }
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return vm;
+}
+
+void releaseVM(VMPool* pool, VirtualMachine* vm)
+{
+    // A machine is reset by simulateCodeOnVM() already, this is cheap then
+    resetVM(vm);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->idle[pool->numOfIdle++] = vm;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Duplicates the given length characters of a string. Returns NULL if no
+ * memory could be allocated.
+ * */
+char* duplicatePath(const char* str, size_t length)
+{
+    char* copy = malloc(length + 1);
+    if(!copy) return NULL;
+
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+
+    return copy;
+}
+
+int readVMManifest(FILE* manifest, VMJobList* list)
+{
+    char line[4096];
+    int lineNum = 0;
+
+    list->jobs = NULL;
+    list->numOfJobs = 0;
+    list->capacity = 0;
+
+    while( fgets(line, sizeof(line), manifest) )
+    {
+        lineNum++;
+
+        // The code, the input and the output path, and nothing else
+        char* fields[4];
+        size_t lengths[4];
+        int numOfFields = 0;
+        char* c = line;
+
+        while(*c && numOfFields < 4)
+        {
+            while(*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n') c++;
+            if(!*c) break;
+
+            fields[numOfFields] = c;
+            while(*c && *c != ' ' && *c != '\t' && *c != '\r' && *c != '\n') c++;
+            lengths[numOfFields] = c - fields[numOfFields];
+            numOfFields++;
+        }
+
+        if(numOfFields == 0 || fields[0][0] == '#') continue;
+        if(numOfFields != 3) return lineNum;
+
+        if(list->numOfJobs == list->capacity)
+        {
+            int capacity = list->capacity ? list->capacity * 2 : 64;
+            VMJob* jobs = realloc(list->jobs, capacity * sizeof(VMJob));
+            if(!jobs) return -1;
+
+            list->jobs = jobs;
+            list->capacity = capacity;
+        }
+
+        VMJob* job = &list->jobs[list->numOfJobs++];
+
+        job->code   = duplicatePath(fields[0], lengths[0]);
+        job->input  = duplicatePath(fields[1], lengths[1]);
+        job->output = duplicatePath(fields[2], lengths[2]);
+        job->status = VM_JOB_PENDING;
+
+        if(!job->code || !job->input || !job->output) return -1;
+    }
+
+    return 0;
+}
+
+void deleteVMJobList(VMJobList* list)
+{
+    int i;
+    for(i = 0; i < list->numOfJobs; i++)
+    {
+        free(list->jobs[i].code);
+        free(list->jobs[i].input);
+        free(list->jobs[i].output);
+    }
+
+    free(list->jobs);
+
+    list->jobs = NULL;
+    list->numOfJobs = list->capacity = 0;
+}
+
+/**
+ * Runs the given program on the given machine, its SIO streams buffered in the
+ * given buffers of VM_RUNNER_BUFFER_SIZE bytes.
+ * */
+void runVMJob(VMJob* job, VirtualMachine* vm, VMOptions options, char* inBuffer, char* outBuffer)
+{
+    FILE* inp = fopen(job->code, "rb");
+    FILE* vmIn = inp ? fopen(job->input, "r") : NULL;
+    FILE* vmOut = vmIn ? fopen(job->output, "w") : NULL;
+
+    if(!inp)        job->status = VM_JOB_CODE_ERROR;
+    else if(!vmIn)  job->status = VM_JOB_INPUT_ERROR;
+    else if(!vmOut) job->status = VM_JOB_OUTPUT_ERROR;
+    else
+    {
+        setvbuf(vmIn, inBuffer, _IOFBF, VM_RUNNER_BUFFER_SIZE);
+        setvbuf(vmOut, outBuffer, _IOFBF, VM_RUNNER_BUFFER_SIZE);
+
+        if(simulateVMOnMachine(vm, inp, NULL, vmIn, vmOut, options)) job->status = VM_JOB_CODE_ERROR;
+        else                                                         job->status = VM_JOB_RAN;
+    }
+
+    // The streams are closed before their buffers are used again
+    if(vmOut) fclose(vmOut);
+    if(vmIn) fclose(vmIn);
+    if(inp) fclose(inp);
+}
+
+void* runVMWorker(void* arg)
+{
+    VMRunner* runner = arg;
+
+    VirtualMachine* vm = acquireVM(runner->pool);
+    char* inBuffer = malloc(VM_RUNNER_BUFFER_SIZE);
+    char* outBuffer = malloc(VM_RUNNER_BUFFER_SIZE);
+
+    for(;;)
+    {
+        pthread_mutex_lock(&runner->lock);
+        int job = (runner->next < runner->list->numOfJobs) ? runner->next++ : -1;
+        pthread_mutex_unlock(&runner->lock);
+
+        if(job < 0) break;
+
+        if(vm && inBuffer && outBuffer)
+            runVMJob(&runner->list->jobs[job], vm, runner->options, inBuffer, outBuffer);
+        else
+            runner->list->jobs[job].status = VM_JOB_MACHINE_ERROR;
+    }
+
+    free(inBuffer);
+    free(outBuffer);
+    if(vm) releaseVM(runner->pool, vm);
+
+    return NULL;
+}
+
+int runVMJobs(VMJobList* list, VMPool* pool, int workers, VMOptions options)
+{
+    if(workers <= 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = online > 0 ? (int)online : 1;
+    }
+
+    if(workers > list->numOfJobs) workers = list->numOfJobs > 0 ? list->numOfJobs : 1;
+
+    pthread_t* threads = calloc(workers, sizeof(pthread_t));
+    if(!threads) return -1;
+
+    VMRunner runner;
+    runner.list = list;
+    runner.pool = pool;
+    runner.options = options;
+    runner.next = 0;
+    pthread_mutex_init(&runner.lock, NULL);
+
+    // Nothing to trace without a simulation output, and the workers do not
+    // .. share a profile or statistics
+    runner.options.trace = VM_TRACE_NONE;
+    runner.options.profile = NULL;
+    runner.options.stats = NULL;
+
+    // The calling thread is the first worker
+    int started = 0, w;
+    for(w = 1; w < workers; w++)
+    {
+        if(pthread_create(&threads[w], NULL, runVMWorker, &runner)) break;
+        started++;
+    }
+
+    runVMWorker(&runner);
+
+    for(w = 1; w <= started; w++) pthread_join(threads[w], NULL);
+
+    pthread_mutex_destroy(&runner.lock);
+    free(threads);
+
+    return started + 1;
+}
+
+int countVMJobFailures(const VMJobList* list)
+{
+    int failed = 0, i;
+
+    for(i = 0; i < list->numOfJobs; i++)
+        if(list->jobs[i].status != VM_JOB_RAN) failed++;
+
+    return failed;
+}
+
+void printVMJobSummary(const VMJobList* list, int workers, FILE* out)
+{
+    int failed = countVMJobFailures(list), i;
+
+    fprintf(out, "Ran %d of %d programs on %d workers, %d failed.\n",
+        list->numOfJobs - failed, list->numOfJobs, workers, failed);
+
+    for(i = 0; i < list->numOfJobs; i++)
+    {
+        const VMJob* job = &list->jobs[i];
+
+        switch(job->status)
+        {
+            case VM_JOB_RAN:
+                break;
+            case VM_JOB_CODE_ERROR:
+                fprintf(out, "  %s: Could not load the code\n", job->code);
+                break;
+            case VM_JOB_INPUT_ERROR:
+                fprintf(out, "  %s: Could not open \"%s\"\n", job->code, job->input);
+                break;
+            case VM_JOB_OUTPUT_ERROR:
+                fprintf(out, "  %s: Could not open \"%s\"\n", job->code, job->output);
+                break;
+            case VM_JOB_MACHINE_ERROR:
+                fprintf(out, "  %s: Could not create a machine\n", job->code);
+                break;
+            default:
+                fprintf(out, "  %s: Not run\n", job->code);
+                break;
+        }
+    }
+}
@@ -0,0 +1,135 @@
+#ifndef __RUNNER_H__
+#define __RUNNER_H__
+
+#include <stdio.h>
+#include <pthread.h>
+#include "vm.h"
+
+/**
+ * Runs many PM/0 programs, listed in a manifest, in a single process on a
+ * fixed number of worker threads.
+ *
+ * A line of the manifest is the path of the code to run, the path of the file
+ * its SIO input is read from and the path of the file its SIO output is written
+ * to, separated by white space. Empty lines and lines starting with # are
+ * skipped. The code is loaded as vm.out loads it, either text or a binary
+ * object file. No simulation output is written.
+ *
+ * The workers take their machines from a VMPool: a machine is reset, not
+ * reserved again, between programs. Each program has its own SIO streams,
+ * fully buffered in buffers the worker owns, so the output of a program is
+ * written in a few large writes and never mixed with the output of another.
+ *
+ * The machine is named by its tag, as vm.h names it, so that this header could
+ * be included after another data.h.
+ * */
+
+/**
+ * Machines of the same stack limit, reused from one run to the next.
+ * machines  : every machine of the pool, numOfMachines of them
+ * idle      : the machines not acquired, numOfIdle of them
+ * capacity  : the number of machines the two arrays could hold
+ * stackLimit: the stack limit of the machines
+ * */
+typedef struct {
+    struct VirtualMachine** machines;
+    struct VirtualMachine** idle;
+    int numOfMachines;
+    int numOfIdle;
+    int capacity;
+    int stackLimit;
+    pthread_mutex_t lock;
+} VMPool;
+
+/**
+ * Initializes an empty pool of machines with the given stack limit. The
+ * machines are created as they are acquired.
+ * */
+void initVMPool(VMPool*, int stackLimit);
+
+/**
+ * Releases every machine of the pool. None of them should be acquired.
+ * */
+void deleteVMPool(VMPool*);
+
+/**
+ * Returns an idle machine of the pool, in the state initVM() leaves it in,
+ * creating one if none is idle. Returns NULL if it could not be created.
+ * */
+struct VirtualMachine* acquireVM(VMPool*);
+
+/**
+ * Gives the given machine, reset, back to the pool it was acquired from.
+ * */
+void releaseVM(VMPool*, struct VirtualMachine*);
+
+/**
+ * What happened to a program of the manifest.
+ *  VM_JOB_PENDING      : it is not run yet
+ *  VM_JOB_RAN          : it ran until the machine halted
+ *  VM_JOB_CODE_ERROR   : the code could not be loaded
+ *  VM_JOB_INPUT_ERROR  : the input file could not be opened
+ *  VM_JOB_OUTPUT_ERROR : the output file could not be opened
+ *  VM_JOB_MACHINE_ERROR: no machine could be created to run it
+ * */
+typedef enum {
+    VM_JOB_PENDING,
+    VM_JOB_RAN,
+    VM_JOB_CODE_ERROR,
+    VM_JOB_INPUT_ERROR,
+    VM_JOB_OUTPUT_ERROR,
+    VM_JOB_MACHINE_ERROR
+} VMJobStatus;
+
+/**
+ * A program of the manifest, and what happened to it.
+ * */
+typedef struct {
+    char* code;
+    char* input;
+    char* output;
+    VMJobStatus status;
+} VMJob;
+
+/**
+ * The programs of a manifest, in its order.
+ * */
+typedef struct {
+    VMJob* jobs;
+    int numOfJobs;
+    int capacity;
+} VMJobList;
+
+/**
+ * Reads the manifest from the given file into the given list. Returns 0 on
+ * success, or the number of the first line that is not a code, an input and
+ * an output path, -1 if no memory could be allocated. The list should be
+ * deleted by deleteVMJobList() in any case.
+ * */
+int readVMManifest(FILE*, VMJobList*);
+
+/**
+ * Releases the jobs of the given list.
+ * */
+void deleteVMJobList(VMJobList*);
+
+/**
+ * Runs the programs of the given list with the given options on the given
+ * number of worker threads, 0 for one per online processor, taking their
+ * machines from the given pool and setting the status of each job. Returns the
+ * number of workers used, or -1 if they could not be started.
+ * */
+int runVMJobs(VMJobList*, VMPool*, int workers, VMOptions);
+
+/**
+ * Prints a summary of the given list on the given file: the number of programs
+ * run and failed, followed by a line for each program that failed.
+ * */
+void printVMJobSummary(const VMJobList*, int workers, FILE*);
+
+/**
+ * Returns the number of programs of the given list that failed.
+ * */
+int countVMJobFailures(const VMJobList*);
+
+#endif
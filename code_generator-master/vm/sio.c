@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include "sio.h"
+
+/**
+ * Terminals are recognized with isatty() where it is available.
+ * */
+#if defined(__unix__) || defined(__APPLE__)
+#define SIO_HAVE_ISATTY 1
+#include <unistd.h>
+#else
+#define SIO_HAVE_ISATTY 0
+#endif
+
+void initVMIO(VMIO* io, FILE* in, FILE* out, int interactive)
+{
+    io->in = in;
+    io->out = out;
+    io->interactive = interactive;
+
+    io->inputStart = 0;
+    io->inputEnd = 0;
+    io->outputLength = 0;
+}
+
+/**
+ * Reads the next characters of the input stream into the input buffer, which
+ * should be empty: a line of an interactive run, a buffer otherwise. Returns
+ * the number of characters read, 0 at the end of the input.
+ * */
+int fillVMInput(VMIO* io)
+{
+    int length = 0;
+
+    io->inputStart = 0;
+    io->inputEnd = 0;
+
+    if(!io->in) return 0;
+
+    if(io->interactive)
+    {
+        int c;
+        while(length < VM_SIO_BUFFER_SIZE && (c = getc(io->in)) != EOF)
+        {
+            io->input[length++] = (char)c;
+            if(c == '\n') break;
+        }
+    }
+    else
+    {
+        length = (int)fread(io->input, 1, VM_SIO_BUFFER_SIZE, io->in);
+    }
+
+    io->inputEnd = length;
+
+    return length;
+}
+
+/**
+ * Returns the next character of the input, without consuming it, or EOF at
+ * the end of the input.
+ * */
+int peekVMInput(VMIO* io)
+{
+    if(io->inputStart == io->inputEnd && !fillVMInput(io)) return EOF;
+
+    return (unsigned char)io->input[io->inputStart];
+}
+
+int readVMInt(VMIO* io, int* value)
+{
+    // The prompt the program wrote is to be seen before it waits for input
+    if(io->interactive) flushVMIO(io);
+
+    // White space of the C locale
+    int c = peekVMInput(io);
+    while(c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r')
+    {
+        io->inputStart++;
+        c = peekVMInput(io);
+    }
+
+    int negative = 0;
+    if(c == '+' || c == '-')
+    {
+        negative = (c == '-');
+        io->inputStart++;
+        c = peekVMInput(io);
+    }
+
+    // The character that is not a digit is left to the next SIO 2
+    if(c < '0' || c > '9') return 0;
+
+    // The number is read as a long, as strtol() does, saturating at its
+    // .. limits, and converted to an int, as fscanf() does
+    unsigned long limit = negative ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;
+    unsigned long magnitude = 0;
+
+    while(c >= '0' && c <= '9')
+    {
+        unsigned long digit = (unsigned long)(c - '0');
+
+        if(magnitude > (limit - digit) / 10) magnitude = limit;
+        else                                 magnitude = magnitude * 10 + digit;
+
+        io->inputStart++;
+        c = peekVMInput(io);
+    }
+
+    long number;
+    if(!negative)                     number = (long)magnitude;
+    else if(magnitude == limit)       number = LONG_MIN;
+    else                              number = -(long)magnitude;
+
+    *value = (int)number;
+
+    return 1;
+}
+
+void writeVMInt(VMIO* io, int value)
+{
+    // The longest int, "-2147483648", fits in 11 characters
+    if(io->outputLength > VM_SIO_BUFFER_SIZE - 11) flushVMIO(io);
+
+    char digits[10];
+    int numOfDigits = 0;
+    unsigned int magnitude = (value < 0) ? 0u - (unsigned int)value : (unsigned int)value;
+
+    do
+    {
+        digits[numOfDigits++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while(magnitude);
+
+    char* out = io->output + io->outputLength;
+
+    if(value < 0) *out++ = '-';
+    while(numOfDigits) *out++ = digits[--numOfDigits];
+
+    io->outputLength = (int)(out - io->output);
+
+    if(io->interactive) flushVMIO(io);
+}
+
+void flushVMIO(VMIO* io)
+{
+    if(io->outputLength && io->out) fwrite(io->output, 1, (size_t)io->outputLength, io->out);
+    io->outputLength = 0;
+
+    if(io->interactive && io->out) fflush(io->out);
+}
+
+int isTerminal(FILE* stream)
+{
+#if SIO_HAVE_ISATTY
+    return stream && isatty(fileno(stream));
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,74 @@
+#ifndef __SIO_H__
+#define __SIO_H__
+
+#include <stdio.h>
+
+/**
+ * The input and the output of SIO 1 and SIO 2, buffered by the virtual machine
+ * itself. The numbers are parsed and formatted by hand instead of through
+ * fscanf() and fprintf(), with the same result as "%d" in the C locale: SIO 2
+ * skips the white space, reads an optional sign and the digits, and leaves the
+ * register as it is if there is no number; SIO 1 writes the number in decimal,
+ * with a minus sign if negative, and nothing else.
+ *
+ * The input is read ahead, a buffer at a time, so what the program did not
+ * read is lost to the input stream. The output is written to the output
+ * stream when its buffer is full and when the machine halts, see flushVMIO().
+ * An interactive run reads the input a line at a time instead, as a terminal
+ * gives it, and writes the output after each SIO 1, and before each SIO 2.
+ * */
+
+/**
+ * The size of each buffer, in bytes.
+ * */
+#define VM_SIO_BUFFER_SIZE (64 * 1024)
+
+/**
+ * The SIO streams of a run.
+ * in, out    : the input and the output streams of the program
+ * interactive: read the input a line at a time, and write the output at once
+ * input      : the characters of in read ahead, from inputStart to inputEnd
+ * output     : the characters not written to out yet, outputLength of them
+ * */
+typedef struct {
+    FILE* in;
+    FILE* out;
+    int interactive;
+
+    char input[VM_SIO_BUFFER_SIZE];
+    int inputStart;
+    int inputEnd;
+
+    char output[VM_SIO_BUFFER_SIZE];
+    int outputLength;
+} VMIO;
+
+/**
+ * Initializes the given SIO streams over the given input and output streams,
+ * with empty buffers.
+ * */
+void initVMIO(VMIO*, FILE* in, FILE* out, int interactive);
+
+/**
+ * Reads a number into value, as fscanf(in, "%d", value) does. Returns 1 if a
+ * number was read, 0 otherwise, in which case value is left as it is.
+ * */
+int readVMInt(VMIO*, int* value);
+
+/**
+ * Writes the given number, as fprintf(out, "%d", value) does.
+ * */
+void writeVMInt(VMIO*, int value);
+
+/**
+ * Writes the buffered output to the output stream, and flushes the stream if
+ * the run is interactive.
+ * */
+void flushVMIO(VMIO*);
+
+/**
+ * Returns whether the given stream is a terminal, which is run interactive.
+ * */
+int isTerminal(FILE*);
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdio.h>
+
+/**
+ * Statistics of a run of the executables, printed by --stats: the time taken
+ * by each phase, the memory, and what the lexer, the code generator and the
+ * virtual machine did.
+ *
+ * All the executables print the same keys in the same order, one key=value
+ * pair per line, the phases and the counts of the stages an executable does
+ * not run being 0. The times are in nanoseconds, both the wall-clock time and
+ * the CPU time of the process.
+ * */
+
+/**
+ * The phases of a run, in the order they are printed.
+ *  STATS_SOURCE_READ: reading the source code (pipeline.out, la.out)
+ *  STATS_LEX        : lexing the source code into tokens (pipeline.out, la.out)
+ *  STATS_TOKEN_IO   : reading the token list (code_generator.out), or writing
+ *                     it for --dump-tokens (pipeline.out) or as the output of
+ *                     the lexer (la.out)
+ *  STATS_CODEGEN    : generating the code from the tokens, and optimizing it
+ *  STATS_EMIT       : writing the code (code_generator.out), or writing it
+ *                     for --dump-code (pipeline.out)
+ *  STATS_LOAD       : reading the code into the code memory (vm.out)
+ *  STATS_EXECUTE    : running the code until the machine halts
+ * */
+typedef enum {
+    STATS_SOURCE_READ,
+    STATS_LEX,
+    STATS_TOKEN_IO,
+    STATS_CODEGEN,
+    STATS_EMIT,
+    STATS_LOAD,
+    STATS_EXECUTE,
+    STATS_PHASES
+} StatsPhase;
+
+/**
+ * The wall-clock and the CPU time, in nanoseconds, of a phase, or the clocks
+ * when it started.
+ * */
+typedef struct {
+    long long wall;
+    long long cpu;
+} PhaseTime;
+
+/**
+ * The statistics of a run.
+ * phases               : the time taken by each phase, summed if it ran several
+ *                        times
+ * started              : the clocks when the phase being timed started
+ * allocatedBytes       : the number of bytes allocated from the arenas
+ * peakAllocatedBytes   : the most bytes the blocks of the arenas held at once
+ * tokens               : the number of tokens lexed or read
+ * symbols              : the number of symbols declared
+ * symbolLookups        : the number of findSymbol() calls
+ * symbolProbes         : the number of symbols they compared to the names
+ * instructionsEmitted  : the number of instructions generated
+ * instructionsExecuted : the number of instructions the machine executed, -1 if
+ *                        they were run by the JIT, which does not count them
+ * maxStackDepth        : the highest slot of the stack the program wrote or
+ *                        held reserved when it halted
+ * */
+typedef struct RunStats {
+    PhaseTime phases[STATS_PHASES];
+    PhaseTime started;
+
+    long long allocatedBytes;
+    long long peakAllocatedBytes;
+
+    long long tokens;
+    long long symbols;
+    long long symbolLookups;
+    long long symbolProbes;
+
+    long long instructionsEmitted;
+    long long instructionsExecuted;
+    int maxStackDepth;
+} RunStats;
+
+/**
+ * Initializes the given statistics, all zero.
+ * */
+void initRunStats(RunStats*);
+
+/**
+ * Starts timing a phase.
+ * */
+void beginPhase(RunStats*);
+
+/**
+ * Adds the time since beginPhase() to the given phase.
+ * */
+void endPhase(RunStats*, StatsPhase);
+
+/**
+ * Returns the largest amount of memory the process held at once, in bytes:
+ * its peak resident set size, 0 if it could not be known.
+ * */
+long long getPeakMemory();
+
+/**
+ * Prints the given statistics on the given file, and the peak memory of the
+ * process before the memory of the arenas, a key=value pair per line.
+ * */
+void printRunStats(const RunStats*, FILE*);
+
+#endif
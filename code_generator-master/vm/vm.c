@@ -0,0 +1,1802 @@
+#include <stdio.h>
+#include "vm.h"
+#include "data.h"
+#include "jit.h"
+#include "profile.h"
+#include "stats.h"
+#include "sio.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Object files are loaded by mapping them into memory where mmap is available.
+ * The stack is reserved as an anonymous mapping as well, see reserveZeroed().
+ * */
+#if defined(__unix__) || defined(__APPLE__)
+#define VM_HAVE_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define VM_HAVE_MMAP 0
+#endif
+
+/* ************************************************************************************ */
+/* Declarations                                                                         */
+/* ************************************************************************************ */
+
+/**
+ * The code memory of the virtual machine.
+ * ins     : the loaded instructions, allocated by loadCode() if not mapped
+ * numOfIns: the number of instructions
+ * mapping : the mapped object file ins points into, NULL if not mapped
+ * mappingSize: the size of the mapping in bytes
+ * */
+typedef struct {
+    Instruction* ins;
+    int numOfIns;
+    void* mapping;
+    size_t mappingSize;
+} CodeMemory;
+
+/**
+ * A step recorded by the trace ring: the executed instruction, its address and
+ * the BP and SP after its execution.
+ * */
+typedef struct {
+    int pc, op, r, l, m, bp, sp;
+} TraceRecord;
+
+/**
+ * Fixed size ring buffer holding the last executed steps of a VM_TRACE_RING run.
+ * records: the buffer of size records
+ * next   : the index the next step is written to
+ * count  : the number of steps recorded so far, including the overwritten ones
+ * */
+typedef struct {
+    TraceRecord* records;
+    int size;
+    int next;
+    long long count;
+} TraceRing;
+
+/**
+ * Recommended design includes the following functions implemented.
+ * However, you are free to change them as you wish inside the vm.c file.
+ * */
+void* reserveZeroed(size_t size);
+
+void releaseZeroed(void* memory, size_t size);
+
+int readInstructions(FILE*, Instruction** ins, int codeLimit);
+
+unsigned int objectChecksum(const Instruction* ins, int numOfIns);
+
+int readObject(FILE*, CodeMemory* code, int codeLimit);
+
+int loadCode(FILE*, CodeMemory* code, int codeLimit);
+
+void unloadCode(CodeMemory* code);
+
+void dumpInstructions(FILE*, Instruction*, int numOfIns);
+
+int getBasePointer(int *stack, int currentBP, int L);
+
+void dumpStack(FILE*, int* stack, int sp, int bp);
+
+int executeInstruction(VirtualMachine* vm, Instruction ins, VMIO* io);
+
+int runSwitchEngine(VirtualMachine* vm, Instruction* ins, int numOfIns, FILE* traceOut, TraceRing* ring, VMIO* io);
+
+int runThreadedEngine(VirtualMachine* vm, Instruction* ins, int numOfIns, FILE* traceOut, TraceRing* ring, VMProfile* profile,
+                      VMIO* io);
+
+void dumpTraceRing(FILE*, TraceRing* ring, VirtualMachine* vm);
+
+int runJITEngine(VirtualMachine* vm, Instruction* ins, int numOfIns, VMIO* io);
+
+int runCheckedEngine(VirtualMachine* vm, Instruction* ins, int numOfIns, FILE* traceOut, TraceRing* ring, VMIO* io);
+
+/* ************************************************************************************ */
+/* Global Data and misc structs & enums                                                 */
+/* ************************************************************************************ */
+
+/**
+ * allows conversion from opcode to opcode string
+ * */
+const char *opcodes[] = 
+{
+    "illegal", // opcode 0 is illegal
+    "lit", "rtn", "lod", "sto", "cal", // 1, 2, 3 ..
+    "inc", "jmp", "jpc", "sio", "sio",
+    "sio", "neg", "add", "sub", "mul",
+    "div", "odd", "mod", "eql", "neq",
+    "lss", "leq", "gtr", "geq"
+};
+
+/**
+ * Returns the string of the given opcode, that of opcode 0 if it is illegal.
+ * */
+const char* opcodeName(int op)
+{
+    return (op >= 1 && op <= 24) ? opcodes[op] : opcodes[0];
+}
+
+enum { CONT, HALT };
+
+/**
+ * The threaded engine dispatches through label addresses (computed goto) when
+ * the compiler supports them. Define VM_NO_COMPUTED_GOTO to force the switch
+ * based dispatch instead.
+ * */
+#if defined(__GNUC__) && !defined(VM_NO_COMPUTED_GOTO)
+#define VM_COMPUTED_GOTO 1
+#else
+#define VM_COMPUTED_GOTO 0
+#endif
+
+/**
+ * An instruction decoded for the threaded engine, packed into 64 bits: the
+ * decoded program takes half the cache the loaded one does, and a third of
+ * what it took with the address of its handler in each instruction. The
+ * handler is looked up from op instead, in a table of a few cache lines.
+ * op: the opcode, 0 (illegal) if the loaded opcode is out of range, or the
+ *     superinstruction the instruction starts, see fuseInstructions()
+ * r, l, m: the fields of the instruction as loaded. r and l are narrowed to
+ *     the ranges below, which the code generator emits well within; a program
+ *     with a field out of them runs on the switch engine instead.
+ * */
+typedef struct {
+    int m;
+    unsigned char op;
+    unsigned char r;
+    short l;
+} ThreadedInstruction;
+
+#define VM_PACKED_MAX_R 255
+#define VM_PACKED_MIN_L (-32768)
+#define VM_PACKED_MAX_L 32767
+
+/**
+ * Superinstructions of the threaded engine: a sequence of instructions the
+ * code generator emits often, run by a single handler. The instruction that
+ * starts the sequence takes the opcode of the superinstruction, and does what
+ * the whole sequence does, reading the fields of the instructions it covers
+ * from the slots that follow. These keep their own opcode, so each instruction
+ * stays at its address: the jumps and the return addresses on the stack need
+ * no remapping, and a jump into the sequence runs the rest of it unfused.
+ *  VM_FUSED_LOD_LOD_ADD: two LODs and an ADD, the operands of a sum
+ *  VM_FUSED_LIT_STO    : a LIT and a STO, the assignment of a constant
+ *  VM_FUSED_EQL_JPC .. VM_FUSED_GEQ_JPC: a comparison and a JPC, the
+ *                        condition of an if or a while
+ * */
+enum {
+    VM_FUSED_LOD_LOD_ADD = 25,
+    VM_FUSED_LIT_STO,
+    VM_FUSED_EQL_JPC,
+    VM_FUSED_NEQ_JPC,
+    VM_FUSED_LSS_JPC,
+    VM_FUSED_LEQ_JPC,
+    VM_FUSED_GTR_JPC,
+    VM_FUSED_GEQ_JPC
+};
+
+void fuseInstructions(ThreadedInstruction* code, int numOfIns);
+
+/**
+ * The threaded engine keeps a display: the base pointer of the innermost
+ * active activation record of each lexical level. LOD, STO and CAL read the
+ * base pointer from it instead of walking the static links. Define
+ * VM_NO_DISPLAY to walk the static links through getBasePointer() instead.
+ * */
+#define VM_MAX_DISPLAY_LEVELS 64
+
+/**
+ * Display state saved by CAL for the activation record it creates, and
+ * restored by RTN. Kept aside the stack so that the stack layout, and thus
+ * the simulation output, does not change.
+ * display: the display entry the new activation record replaced
+ * level  : the lexical level of the caller plus one, 0 if not entered by CAL.
+ *          Hence the links, which are zeroed lazily, need no initialization.
+ * */
+typedef struct DisplayLink {
+    int display;
+    int level;
+} DisplayLink;
+
+/* ************************************************************************************ */
+/* Definitions                                                                          */
+/* ************************************************************************************ */
+
+/**
+ * Returns zeroed memory of the given size in bytes, or NULL if it could not be
+ * allocated. Where mmap is available, the memory is an anonymous mapping that
+ * is only reserved: the system zeroes each page as it is first touched, and
+ * the page mapped after the end is left inaccessible, so that running past
+ * the end faults instead of overwriting other memory. Otherwise, calloc.
+ * */
+void* reserveZeroed(size_t size)
+{
+#if VM_HAVE_MMAP
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t reserved = (size + pageSize - 1) / pageSize * pageSize;
+
+    char* memory = mmap(NULL, reserved + pageSize, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if(memory == MAP_FAILED) return NULL;
+
+    // Guard page
+    mprotect(memory + reserved, pageSize, PROT_NONE);
+
+    return memory;
+#else
+    return calloc(1, size ? size : 1);
+#endif
+}
+
+/**
+ * Releases the memory of the given size returned by reserveZeroed().
+ * */
+void releaseZeroed(void* memory, size_t size)
+{
+    if(!memory) return;
+
+#if VM_HAVE_MMAP
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t reserved = (size + pageSize - 1) / pageSize * pageSize;
+
+    munmap(memory, reserved + pageSize);
+#else
+    free(memory);
+#endif
+}
+
+int initVM(VirtualMachine* vm, int stackLimit)
+{
+	int i = 0;
+	
+    if(vm)
+    {
+		// set initial register file values to 0
+		for (i = 0; i < 16; i++)
+		{
+			vm->RF[i] = 0;
+		}
+
+		// the stack starts zeroed
+		vm->stackSize = stackLimit;
+		vm->stack = reserveZeroed((size_t)stackLimit * sizeof(int));
+
+		if(!vm->stack)
+		{
+			fprintf(stderr, "Could not reserve a stack of %d ints.\n", stackLimit);
+			return -1;
+		}
+
+		// nothing written yet. Without the links, the threaded engine walks
+		// .. the static links instead of keeping a display
+		vm->touched = -1;
+		vm->steps = 0;
+		vm->interrupt = NULL;
+#ifndef VM_NO_DISPLAY
+		vm->links = reserveZeroed((size_t)stackLimit * sizeof(DisplayLink));
+#else
+		vm->links = NULL;
+#endif
+		
+		// sp = 0, bp = 1, pc = 0,
+		// set pointers and program counters to appropriate values
+		vm->BP = 1;
+		vm->SP = 0;
+		vm->PC = 0;
+		vm->IR = 0;
+    }
+
+    return 0;
+}
+
+void deleteVM(VirtualMachine* vm)
+{
+    releaseZeroed(vm->stack, (size_t)vm->stackSize * sizeof(int));
+    releaseZeroed(vm->links, (size_t)vm->stackSize * sizeof(DisplayLink));
+
+    vm->stack = NULL;
+    vm->links = NULL;
+    vm->stackSize = 0;
+}
+
+void resetVM(VirtualMachine* vm)
+{
+    int i;
+
+    // Only the part of the stack a run wrote is not zero anymore
+    int touched = (vm->touched < vm->stackSize) ? vm->touched + 1 : vm->stackSize;
+
+    if(touched > 0)
+    {
+        memset(vm->stack, 0, (size_t)touched * sizeof(int));
+        if(vm->links) memset(vm->links, 0, (size_t)touched * sizeof(DisplayLink));
+    }
+
+    for (i = 0; i < REGISTER_FILE_REG_COUNT; i++) vm->RF[i] = 0;
+
+    vm->BP = 1;
+    vm->SP = 0;
+    vm->PC = 0;
+    vm->IR = 0;
+    vm->touched = -1;
+    vm->steps = 0;
+}
+
+/**
+ * Fill the (ins)tructions array by reading instructions from (in)put file.
+ * The array is allocated here and grows as the instructions are read, up to
+ * codeLimit instructions. It should be freed by the caller.
+ * Return the number of instructions read
+ * */
+int readInstructions(FILE* in, Instruction** ins, int codeLimit)
+{
+    // Instruction index
+    int i = 0;
+
+    // Small programs fit into the initial capacity
+    int capacity = 256;
+    Instruction* buffer = malloc(capacity * sizeof(Instruction));
+
+    while(buffer && i < codeLimit)
+    {
+        if(i == capacity)
+        {
+            capacity = (capacity > codeLimit / 2) ? codeLimit : capacity * 2;
+
+            Instruction* grown = realloc(buffer, capacity * sizeof(Instruction));
+
+            if(!grown)
+            {
+                fprintf(stderr, "Could not allocate the code memory. The rest of the instructions are ignored.\n");
+                break;
+            }
+
+            buffer = grown;
+        }
+
+        if(fscanf(in, "%d %d %d %d", &buffer[i].op, &buffer[i].r, &buffer[i].l, &buffer[i].m) == EOF)
+            break;
+
+        i++;
+    }
+
+    // Whatever does not fit into the code memory is ignored
+    if(i == codeLimit && fscanf(in, "%*d") != EOF)
+    {
+        fprintf(stderr, "Code limit (%d) reached. The rest of the instructions are ignored.\n", codeLimit);
+    }
+
+    *ins = buffer;
+
+    // Return the number of instructions read
+    return i;
+}
+
+/**
+ * Returns the checksum stored in the ObjectHeader of an object file holding
+ * the given (ins)tructions: 32-bit FNV-1a over the bytes of the instructions.
+ * */
+unsigned int objectChecksum(const Instruction* ins, int numOfIns)
+{
+    const unsigned char* bytes = (const unsigned char*)ins;
+    unsigned int hash = 2166136261u;
+
+    size_t i;
+    for(i = 0; i < numOfIns * sizeof(Instruction); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Loads the code memory from a binary object file (see ObjectHeader).
+ * The file is mapped into memory and the instructions are used in place.
+ * If it cannot be mapped (e.g. it is a pipe), the instructions are read into
+ * .. an array allocated for them instead.
+ * Returns 0 on success, -1 if the object file is invalid or holds more than
+ * .. codeLimit instructions.
+ * */
+int readObject(FILE* in, CodeMemory* code, int codeLimit)
+{
+    ObjectHeader header;
+
+    code->ins = NULL;
+    code->numOfIns = 0;
+    code->mapping = NULL;
+    code->mappingSize = 0;
+
+#if VM_HAVE_MMAP
+    struct stat st;
+
+    // Map the whole file when reading it from the beginning
+    if( ftell(in) == 0 && fstat(fileno(in), &st) == 0 && S_ISREG(st.st_mode) &&
+        st.st_size >= (off_t)sizeof(ObjectHeader) )
+    {
+        void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(in), 0);
+
+        if(mapping != MAP_FAILED)
+        {
+            code->mapping = mapping;
+            code->mappingSize = st.st_size;
+
+            memcpy(&header, mapping, sizeof(ObjectHeader));
+            code->ins = (Instruction*)((char*)mapping + sizeof(ObjectHeader));
+        }
+    }
+#endif
+
+    if(!code->mapping)
+    {
+        if(fread(&header, sizeof(ObjectHeader), 1, in) != 1)
+        {
+            fprintf(stderr, "Object file is truncated.\n");
+            return -1;
+        }
+    }
+
+    if( memcmp(header.magic, PM0_OBJECT_MAGIC, sizeof(header.magic)) ||
+        header.version != PM0_OBJECT_VERSION )
+    {
+        fprintf(stderr, "Not a PM/0 object file of version %d.\n", PM0_OBJECT_VERSION);
+        return -1;
+    }
+
+    if(header.numOfIns > (unsigned int)codeLimit)
+    {
+        fprintf(stderr, "Object file has %u instructions, more than the code limit (%d).\n",
+            header.numOfIns, codeLimit);
+        return -1;
+    }
+
+    if(code->mapping)
+    {
+        if(code->mappingSize < sizeof(ObjectHeader) + header.numOfIns * sizeof(Instruction))
+        {
+            fprintf(stderr, "Object file is truncated.\n");
+            return -1;
+        }
+    }
+    else if( !(code->ins = malloc(header.numOfIns * sizeof(Instruction) + 1)) )
+    {
+        fprintf(stderr, "Could not allocate the code memory.\n");
+        return -1;
+    }
+    else if(fread(code->ins, sizeof(Instruction), header.numOfIns, in) != header.numOfIns)
+    {
+        fprintf(stderr, "Object file is truncated.\n");
+        return -1;
+    }
+
+    code->numOfIns = header.numOfIns;
+
+    if(objectChecksum(code->ins, code->numOfIns) != header.checksum)
+    {
+        fprintf(stderr, "Object file checksum mismatch.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Loads the code memory from the given file, which is either a binary object
+ * file or a text file of instructions (one "op r l m" per line), of at most
+ * codeLimit instructions. Returns 0 on success, -1 if the code could not be
+ * loaded. The code memory should be released by unloadCode().
+ * */
+int loadCode(FILE* in, CodeMemory* code, int codeLimit)
+{
+    // A text file starts with a number, an object file with its magic
+    int first = getc(in);
+    ungetc(first, in);
+
+    if(first == PM0_OBJECT_MAGIC[0])
+    {
+        int err = readObject(in, code, codeLimit);
+
+        if(err) unloadCode(code);
+        return err;
+    }
+
+    code->numOfIns = readInstructions(in, &code->ins, codeLimit);
+    code->mapping = NULL;
+    code->mappingSize = 0;
+
+    return code->ins ? 0 : -1;
+}
+
+/**
+ * Releases the object file mapping of the code memory, or the instructions
+ * allocated by loadCode().
+ * */
+void unloadCode(CodeMemory* code)
+{
+#if VM_HAVE_MMAP
+    if(code->mapping) munmap(code->mapping, code->mappingSize);
+#endif
+
+    if(!code->mapping) free(code->ins);
+
+    code->ins = NULL;
+    code->mapping = NULL;
+    code->mappingSize = 0;
+    code->numOfIns = 0;
+}
+
+/**
+ * Dump instructions to the output file
+ * */
+void dumpInstructions(FILE* out, Instruction* ins, int numOfIns)
+{
+    // Header
+    fprintf(out,
+        "***Code Memory***\n%3s %3s %3s %3s %3s \n",
+        "#", "OP", "R", "L", "M"
+        );
+
+    // Instructions
+    int i;
+    for(i = 0; i < numOfIns; i++)
+    {
+        fprintf(
+            out,
+            "%3d %3s %3d %3d %3d \n", // formatting
+            i, opcodeName(ins[i].op), ins[i].r, ins[i].l, ins[i].m
+        );
+    }
+}
+
+/**
+ * Returns the base pointer for the lexiographic level L
+ * */
+int getBasePointer(int *stack, int currentBP, int L)
+{
+    int b1; //find base L levels down
+    b1 = currentBP;
+    while (L > 0)
+    {
+        b1 = stack[b1 + 1];
+        L--;
+    }
+    return b1;
+}
+
+// Function that dumps the whole stack into output file
+// Do not forget to use '|' character between stack frames
+// The activation records are found by walking the dynamic links, and printed
+// .. from the bottom-most one. The stack could hold many more activation
+// .. records than this function could recurse, hence no recursion.
+void dumpStack(FILE* out, int* stack, int sp, int bp)
+{
+    // The base pointers of the activation records, top-most first
+    int local[64];
+    int* bps = local;
+    int count = 0, capacity = 64;
+
+    int b;
+    for(b = bp; b != 0; b = (b == 1) ? 0 : stack[b + 2])
+    {
+        if(count == capacity)
+        {
+            int* grown = malloc(2 * capacity * sizeof(int));
+            if(!grown) break;
+
+            memcpy(grown, bps, count * sizeof(int));
+            if(bps != local) free(bps);
+
+            bps = grown;
+            capacity *= 2;
+        }
+
+        bps[count++] = b;
+    }
+
+    // bottom-most level, where a single zero value lies
+    if(count > 0 && bps[count - 1] == 1)
+    {
+        fprintf(out, "%3d ", 0);
+    }
+
+    int k;
+    for(k = count - 1; k >= 0; k--)
+    {
+        // an activation record ends where the one above it starts
+        int top = (k == 0) ? sp : bps[k - 1] - 1;
+
+        if(bps[k] <= top)
+        {
+            // indicate a new activation record
+            fprintf(out, "| ");
+
+            // print the activation record
+            int i;
+            for(i = bps[k]; i <= top; i++)
+            {
+                fprintf(out, "%3d ", stack[i]);
+            }
+        }
+    }
+
+    if(bps != local) free(bps);
+}
+
+/**
+ * Executes the (ins)truction on the (v)irtual (m)achine.
+ * This changes the state of the virtual machine.
+ * Returns HALT if the executed instruction was meant to halt the VM.
+ * .. Otherwise, returns CONT
+ * */
+int executeInstruction(VirtualMachine* vm, Instruction ins, VMIO* io)
+{
+    switch(ins.op)
+    {
+		// LIT
+		case 1 :
+			vm->RF[ins.r] = ins.m;
+			break;
+			
+		// RTN
+		case 2 :
+			vm->SP = vm->BP - 1;
+			vm->BP = vm->stack[vm->SP + 3];
+			vm->PC = vm->stack[vm->SP + 4];
+			break;
+			
+		// LOD
+		case 3 :
+		{
+			int address = getBasePointer(vm->stack, vm->BP, ins.l) + ins.m;
+			if (address < 0 || address >= vm->stackSize)
+			{
+				fprintf(stderr, "Stack overflow?");
+				return HALT;
+			}
+			vm->RF[ins.r] = vm->stack[address];
+			break;
+		}
+			
+		// STO
+		case 4 :
+		{
+			int address = getBasePointer(vm->stack, vm->BP, ins.l) + ins.m;
+			if (address < 0 || address >= vm->stackSize)
+			{
+				fprintf(stderr, "Stack overflow?");
+				return HALT;
+			}
+			vm->stack[address] = vm->RF[ins.r];
+			if (address > vm->touched) vm->touched = address;
+			break;
+		}
+			
+		// CAL
+		case 5 :
+			if (vm->SP + 4 >= vm->stackSize)
+			{
+				fprintf(stderr, "Stack overflow?");
+				return HALT;
+			}
+			vm->stack[vm->SP + 1] = 0;
+			vm->stack[vm->SP + 2] = getBasePointer(vm->stack, vm->BP, ins.l);
+			vm->stack[vm->SP + 3] = vm->BP;
+			vm->stack[vm->SP + 4] = vm->PC;
+			if (vm->SP + 4 > vm->touched) vm->touched = vm->SP + 4;
+			vm->BP = vm->SP + 1;
+			vm->PC = ins.m;
+			break;
+			
+		// INC
+		case 6 :
+			if (vm->SP + ins.m >= vm->stackSize)
+			{
+				fprintf(stderr, "Stack overflow?");
+				return HALT;
+			}
+			vm->SP = vm->SP + ins.m;
+			break;
+			
+		// JMP
+		case 7 :
+			vm->PC = ins.m;
+			break;
+			
+		// JPC
+		case 8 :
+			if (vm->RF[ins.r] == 0)
+			{
+				vm->PC = ins.m;
+			}
+			break;
+			
+		// SIO 1
+		case 9 :
+			writeVMInt(io, vm->RF[ins.r]);
+			break;
+		
+		// SIO 2
+		case 10 :
+			readVMInt(io, &vm->RF[ins.r]);
+			break;
+			
+		// SIO 3
+		case 11 :
+			return HALT;
+			break;
+		
+		// NEG
+		case 12 :
+			vm->RF[ins.r] = 0 - vm->RF[ins.l];
+			break;
+			
+		// ADD
+		case 13 :
+			vm->RF[ins.r] = vm->RF[ins.l] + vm->RF[ins.m];
+			break;
+			
+		// SUB
+		case 14 :
+			vm->RF[ins.r] = vm->RF[ins.l] - vm->RF[ins.m];
+			break;
+			
+		// MUL
+		case 15 :
+			vm->RF[ins.r] = vm->RF[ins.l] * vm->RF[ins.m];
+			break;
+			
+		// DIV
+		case 16 :
+			vm->RF[ins.r] = vm->RF[ins.l] / vm->RF[ins.m];
+			break;
+			
+		// ODD
+		case 17 :
+			vm->RF[ins.r] = vm->RF[ins.r] % 2;
+			break;
+			
+		// MOD
+		case 18 :
+			vm->RF[ins.r] = vm->RF[ins.l] % vm->RF[ins.m];
+			break;
+			
+		// EQL
+		case 19 :
+			vm->RF[ins.r] = (vm->RF[ins.l] == vm->RF[ins.m]);
+			break;
+			
+		// NEQ
+		case 20 :
+			vm->RF[ins.r] = (vm->RF[ins.l] != vm->RF[ins.m]);
+			break;
+			
+		// LSS
+		case 21 :
+			vm->RF[ins.r] = (vm->RF[ins.l] < vm->RF[ins.m]);
+			break;
+			
+		// LEQ
+		case 22 :
+			vm->RF[ins.r] = (vm->RF[ins.l] <= vm->RF[ins.m]);
+			break;
+			
+		// GTR
+		case 23 :
+			vm->RF[ins.r] = (vm->RF[ins.l] > vm->RF[ins.m]);
+			break;
+			
+		// GEQ
+		case 24 :
+			vm->RF[ins.r] = (vm->RF[ins.l] >= vm->RF[ins.m]);
+			break;
+        default:
+            fprintf(stderr, "Illegal instruction?");
+            return HALT;
+    }
+
+    return CONT;
+}
+
+/**
+ * Records a step to the trace (ring), overwriting the oldest one if it is full.
+ * */
+#define RECORD_STEP(ring, PC, OP, R, L, M, BP, SP)                          \
+    {                                                                       \
+        TraceRecord* record = &(ring)->records[(ring)->next];               \
+        record->pc = (PC); record->op = (OP);                               \
+        record->r  = (R);  record->l  = (L);  record->m = (M);              \
+        record->bp = (BP); record->sp = (SP);                               \
+        if(++(ring)->next == (ring)->size) (ring)->next = 0;                \
+        (ring)->count++;                                                    \
+    }
+
+/**
+ * Writes the steps held by the trace (ring) in the ***Execution*** layout.
+ * The stack is not recorded per step; it is printed for the last step only,
+ * .. from the current state of the (v)irtual (m)achine.
+ * */
+void dumpTraceRing(FILE* out, TraceRing* ring, VirtualMachine* vm)
+{
+    int held = (ring->count < ring->size) ? (int)ring->count : ring->size;
+    int first = (ring->count < ring->size) ? 0 : ring->next;
+
+    fprintf(out, "\n***Execution***\n");
+    fprintf(
+        out,
+        "%3s %3s %3s %3s %3s %3s %3s %3s %3s \n",         // formatting
+        "#", "OP", "R", "L", "M", "PC", "BP", "SP", "STK" // titles
+    );
+
+    if(ring->count > held)
+    {
+        fprintf(out, "... %lld earlier steps not recorded\n", ring->count - held);
+    }
+
+    int i;
+    for(i = 0; i < held; i++)
+    {
+        TraceRecord* record = &ring->records[(first + i) % ring->size];
+
+        // The PC after a step is the address of the following step
+        int nextPC = (i + 1 < held) ? ring->records[(first + i + 1) % ring->size].pc : vm->PC;
+
+        fprintf(
+            out,
+            "%3d %3s %3d %3d %3d %3d %3d %3d ",
+            record->pc, opcodeName(record->op), record->r, record->l, record->m,
+            nextPC, record->bp, record->sp
+        );
+
+        // Print stack info of the last step
+        if(i == held - 1)
+            dumpStack(out, vm->stack, vm->SP, vm->BP);
+
+        fprintf(out, "\n");
+    }
+}
+
+/**
+ * Fetches and executes the instructions one by one through executeInstruction()
+ * until halting. The state of the machine is written to traceOut after each step,
+ * .. unless traceOut is NULL. If a trace (ring) is given, each step is recorded
+ * .. to it instead.
+ * */
+int runSwitchEngine(VirtualMachine* vm, Instruction* ins_array, int numOfIns, FILE* traceOut, TraceRing* ring, VMIO* io)
+{
+	int status = CONT, instrBeingExecuted = 0;
+	Instruction ins;
+
+    // Fetch&Execute the instructions on the virtual machine until halting,
+    // .. or until interrupted
+    while (status == CONT && !(vm->interrupt && *vm->interrupt))
+    {
+        // Fetch - outside of the loaded program, the instruction is illegal
+        if (vm->PC < 0 || vm->PC >= numOfIns)
+        {
+            ins.op = ins.r = ins.l = ins.m = 0;
+        }
+        else
+        {
+        ins.op = ins_array[vm->PC].op;
+		ins.r = ins_array[vm->PC].r;
+		ins.l = ins_array[vm->PC].l;
+		ins.m = ins_array[vm->PC].m;
+        }
+
+        // Advance PC - before execution!
+        instrBeingExecuted = vm->PC++;
+        vm->steps++;
+
+        // Execute the instruction
+        status = executeInstruction(vm, ins, io);
+
+        // Ring trace: keep the step in memory only
+        if(ring)
+        {
+            RECORD_STEP(ring, instrBeingExecuted, ins.op, ins.r, ins.l, ins.m, vm->BP, vm->SP);
+            continue;
+        }
+
+        // Untraced run: nothing to print
+        if(!traceOut) continue;
+
+        // Print current state
+        // Following is a possible way of printing the current state
+        // .. where instrBeingExecuted is the address of the instruction at vm
+        // ..  memory and instr is the instruction being executed.
+        fprintf(
+            traceOut,
+            "%3d %3s %3d %3d %3d %3d %3d %3d ",
+            instrBeingExecuted, // place of instruction at memory
+             opcodeName(ins.op), ins.r, ins.l, ins.m, // instruction info
+             vm->PC, vm->BP, vm->SP // vm info
+        );
+
+        // Print stack info
+		dumpStack(traceOut, vm->stack, vm->SP, vm->BP);
+
+        fprintf(traceOut, "\n");
+    }
+
+    return status;
+}
+
+/**
+ * Marks the superinstructions in the decoded (code): the first instruction of
+ * each sequence of them takes the opcode of the superinstruction, the others
+ * are left as they are. The sequences do not overlap.
+ * */
+void fuseInstructions(ThreadedInstruction* code, int numOfIns)
+{
+    int i = 0;
+    while(i < numOfIns)
+    {
+        int op = code[i].op;
+        int next = (i + 1 < numOfIns) ? code[i + 1].op : 0;
+
+        if(op == 3 && next == 3 && i + 2 < numOfIns && code[i + 2].op == 13)
+        {
+            code[i].op = VM_FUSED_LOD_LOD_ADD;
+            i += 3;
+        }
+        else if(op == 1 && next == 4)
+        {
+            code[i].op = VM_FUSED_LIT_STO;
+            i += 2;
+        }
+        else if(op >= 19 && op <= 24 && next == 8)
+        {
+            code[i].op = VM_FUSED_EQL_JPC + (op - 19);
+            i += 2;
+        }
+        else i++;
+    }
+}
+
+/**
+ * Decodes the (ins)tructions into a packed code memory once, then runs the program
+ * by jumping directly from one handler to the next one. The fetch, the copy of
+ * the instruction and the switch of executeInstruction() are not done per step.
+ * Unless the run is traced or profiled, which see each instruction, the common
+ * sequences of instructions are run as superinstructions, see fuseInstructions().
+ * A program with a field the decoded instructions cannot hold is run by
+ * runSwitchEngine() instead, unprofiled.
+ * The registers are kept in locals and written back to the (v)irtual (m)achine
+ * on halt. The state written to traceOut after each step is the same as the one
+ * runSwitchEngine() writes. Nothing is written if traceOut is NULL. If a trace
+ * (ring) is given, each step is recorded to it instead. If a (profile) is
+ * given, started by beginVMProfile(), the steps are counted into it. The run
+ * halts at a jump, a call or a return once the interrupt of the machine is set.
+ * */
+int runThreadedEngine(VirtualMachine* vm, Instruction* ins, int numOfIns, FILE* traceOut, TraceRing* ring, VMProfile* profile,
+                      VMIO* io)
+{
+    // The decoded program, followed by an illegal instruction: falling off the
+    // .. end of the program executes it. The jumps out of the program are
+    // .. caught by VM_JUMP() instead.
+    ThreadedInstruction* code;
+    const ThreadedInstruction* ip;
+    int i;
+
+    for(i = 0; i < numOfIns; i++)
+    {
+        if(ins[i].r < 0 || ins[i].r > VM_PACKED_MAX_R || ins[i].l < VM_PACKED_MIN_L || ins[i].l > VM_PACKED_MAX_L)
+            return runSwitchEngine(vm, ins, numOfIns, traceOut, ring, io);
+    }
+
+    code = malloc((numOfIns + 1) * sizeof(ThreadedInstruction));
+
+    if(!code)
+    {
+        fprintf(stderr, "Could not allocate the code memory.\n");
+        return HALT;
+    }
+
+    int* stack = vm->stack;
+    int stackSize = vm->stackSize;
+    int* RF = vm->RF;
+    int PC = vm->PC, BP = vm->BP, SP = vm->SP, touched = vm->touched;
+
+    // The instructions executed, and their executions by address if profiled
+    const volatile int* interrupt = vm->interrupt;
+    long long steps = 0;
+    long long* counts = profile ? profile->counts : NULL;
+
+#ifndef VM_NO_DISPLAY
+    // lev is the lexical level of the current activation record. If the
+    // .. program leaves the static chain (e.g. more levels than the display
+    // .. holds), the display is dropped and the static links are walked.
+    // .. The links, one per stack slot, are zeroed along with the stack.
+    int display[VM_MAX_DISPLAY_LEVELS];
+    DisplayLink* links = vm->links;
+    int lev = 0, displayValid = (links != NULL);
+
+    display[0] = BP;
+
+#define VM_BASE(L)                                                          \
+    ((displayValid && (unsigned)(L) <= (unsigned)lev) ?                    \
+        display[lev - (L)] : getBasePointer(stack, BP, (L)))
+#else
+#define VM_BASE(L) getBasePointer(stack, BP, (L))
+#endif
+
+#if VM_COMPUTED_GOTO
+    // Handler of each opcode, indexed by opcode
+    static const void* handlers[] =
+    {
+        &&op_illegal,
+        &&op_lit, &&op_rtn, &&op_lod, &&op_sto, &&op_cal,
+        &&op_inc, &&op_jmp, &&op_jpc, &&op_write, &&op_read,
+        &&op_halt, &&op_neg, &&op_add, &&op_sub, &&op_mul,
+        &&op_div, &&op_odd, &&op_mod, &&op_eql, &&op_neq,
+        &&op_lss, &&op_leq, &&op_gtr, &&op_geq,
+        &&op_lod_lod_add, &&op_lit_sto,
+        &&op_eql_jpc, &&op_neq_jpc, &&op_lss_jpc,
+        &&op_leq_jpc, &&op_gtr_jpc, &&op_geq_jpc
+    };
+#endif
+
+    // Decode the whole code memory. The slot after the loaded program, and the
+    // .. instructions with an unknown opcode, execute as illegal instructions.
+    for(i = 0; i <= numOfIns; i++)
+    {
+        code[i].op = (i < numOfIns && ins[i].op >= 1 && ins[i].op <= 24) ? ins[i].op : 0;
+        code[i].r  = (i < numOfIns) ? ins[i].r : 0;
+        code[i].l  = (i < numOfIns) ? ins[i].l : 0;
+        code[i].m  = (i < numOfIns) ? ins[i].m : 0;
+    }
+
+    if(!traceOut && !ring && !profile) fuseInstructions(code, numOfIns);
+
+/**
+ * The state line of runSwitchEngine(), printed after each step of a traced run,
+ * .. or the step recorded to the trace ring. ADDR is the address of the step.
+ * */
+#define VM_TRACE_AT(ADDR)                                                   \
+    if(ring)                                                                \
+        RECORD_STEP(ring, (ADDR), ip->op, ip->r, ip->l, ip->m, BP, SP)      \
+    else if(traceOut)                                                       \
+    {                                                                       \
+        fprintf(traceOut, "%3d %3s %3d %3d %3d %3d %3d %3d ",               \
+            (ADDR), opcodeName(ip->op), ip->r, ip->l, ip->m,                \
+            PC, BP, SP);                                                    \
+        dumpStack(traceOut, stack, SP, BP);                                 \
+        fprintf(traceOut, "\n");                                            \
+    }
+
+#define VM_TRACE() VM_TRACE_AT((int)(ip - code))
+
+/**
+ * Counts the step fetched at ip.
+ * */
+#define VM_COUNT()                                                          \
+    {                                                                       \
+        steps++;                                                            \
+        if (counts) counts[ip - code]++;                                    \
+    }
+
+/**
+ * Sets PC to the (target) of a jump, call or return. A target out of the loaded
+ * .. program is not fetched from the code memory: see outside. Every loop and
+ * .. every recursion goes through here, so an interrupt is checked here only.
+ * */
+#define VM_JUMP(target)                                                     \
+    {                                                                       \
+        PC = (target);                                                      \
+        if ((unsigned)PC >= (unsigned)numOfIns) goto outside;               \
+        if (interrupt && *interrupt) goto halt;                             \
+    }
+
+#if VM_COMPUTED_GOTO
+#define VM_CASE(label, opcode) label:
+#define VM_NEXT() { VM_TRACE(); ip = &code[PC++]; VM_COUNT(); goto *handlers[ip->op]; }
+
+    // Fetch the first instruction and jump to its handler
+    ip = &code[PC++];
+    VM_COUNT();
+    goto *handlers[ip->op];
+#else
+#define VM_CASE(label, opcode) case opcode:
+#define VM_NEXT() { VM_TRACE(); continue; }
+
+    for(;;)
+    {
+        ip = &code[PC++];
+        VM_COUNT();
+
+        switch(ip->op)
+        {
+#endif
+        // LIT
+        VM_CASE(op_lit, 1)
+            RF[ip->r] = ip->m;
+            VM_NEXT();
+
+        // RTN
+        VM_CASE(op_rtn, 2)
+#ifndef VM_NO_DISPLAY
+            // Restore the display entry and the level of the caller
+            if (displayValid)
+            {
+                if ((unsigned)BP < (unsigned)stackSize && links[BP].level > 0)
+                {
+                    display[lev] = links[BP].display;
+                    lev = links[BP].level - 1;
+                }
+                else displayValid = 0;
+            }
+#endif
+            if (profile) profileReturn(profile, BP, steps);
+            SP = BP - 1;
+            BP = stack[SP + 3];
+            VM_JUMP(stack[SP + 4]);
+            VM_NEXT();
+
+        // LOD
+        VM_CASE(op_lod, 3)
+            {
+                int address = VM_BASE(ip->l) + ip->m;
+                if (address < 0 || address >= stackSize) goto overflow;
+                RF[ip->r] = stack[address];
+            }
+            VM_NEXT();
+
+        // STO
+        VM_CASE(op_sto, 4)
+            {
+                int address = VM_BASE(ip->l) + ip->m;
+                if (address < 0 || address >= stackSize) goto overflow;
+                stack[address] = RF[ip->r];
+                if (address > touched) touched = address;
+            }
+            VM_NEXT();
+
+        // CAL
+        VM_CASE(op_cal, 5)
+            if (SP + 4 >= stackSize) goto overflow;
+            stack[SP + 1] = 0;
+            stack[SP + 2] = VM_BASE(ip->l);
+            stack[SP + 3] = BP;
+            stack[SP + 4] = PC;
+            if (SP + 4 > touched) touched = SP + 4;
+            BP = SP + 1;
+            if (profile) profileCall(profile, ip->m, BP, steps);
+#ifndef VM_NO_DISPLAY
+            // The callee is declared L levels out of the caller: it runs at
+            // .. level lev - L + 1 and becomes the display entry of that level
+            if (displayValid)
+            {
+                int calleeLev = lev - ip->l + 1;
+
+                if ((unsigned)ip->l <= (unsigned)lev && calleeLev < VM_MAX_DISPLAY_LEVELS)
+                {
+                    links[BP].display = display[calleeLev];
+                    links[BP].level = lev + 1;
+                    display[calleeLev] = BP;
+                    lev = calleeLev;
+                }
+                else displayValid = 0;
+            }
+#endif
+            VM_JUMP(ip->m);
+            VM_NEXT();
+
+        // INC
+        VM_CASE(op_inc, 6)
+            if (SP + ip->m >= stackSize) goto overflow;
+            SP = SP + ip->m;
+            VM_NEXT();
+
+        // JMP
+        VM_CASE(op_jmp, 7)
+            VM_JUMP(ip->m);
+            VM_NEXT();
+
+        // JPC
+        VM_CASE(op_jpc, 8)
+            if (RF[ip->r] == 0)
+            {
+                VM_JUMP(ip->m);
+            }
+            VM_NEXT();
+
+        // SIO 1
+        VM_CASE(op_write, 9)
+            writeVMInt(io, RF[ip->r]);
+            VM_NEXT();
+
+        // SIO 2
+        VM_CASE(op_read, 10)
+            readVMInt(io, &RF[ip->r]);
+            VM_NEXT();
+
+        // SIO 3
+        VM_CASE(op_halt, 11)
+            VM_TRACE();
+            goto halt;
+
+        // NEG
+        VM_CASE(op_neg, 12)
+            RF[ip->r] = 0 - RF[ip->l];
+            VM_NEXT();
+
+        // ADD
+        VM_CASE(op_add, 13)
+            RF[ip->r] = RF[ip->l] + RF[ip->m];
+            VM_NEXT();
+
+        // SUB
+        VM_CASE(op_sub, 14)
+            RF[ip->r] = RF[ip->l] - RF[ip->m];
+            VM_NEXT();
+
+        // MUL
+        VM_CASE(op_mul, 15)
+            RF[ip->r] = RF[ip->l] * RF[ip->m];
+            VM_NEXT();
+
+        // DIV
+        VM_CASE(op_div, 16)
+            RF[ip->r] = RF[ip->l] / RF[ip->m];
+            VM_NEXT();
+
+        // ODD
+        VM_CASE(op_odd, 17)
+            RF[ip->r] = RF[ip->r] % 2;
+            VM_NEXT();
+
+        // MOD
+        VM_CASE(op_mod, 18)
+            RF[ip->r] = RF[ip->l] % RF[ip->m];
+            VM_NEXT();
+
+        // EQL
+        VM_CASE(op_eql, 19)
+            RF[ip->r] = (RF[ip->l] == RF[ip->m]);
+            VM_NEXT();
+
+        // NEQ
+        VM_CASE(op_neq, 20)
+            RF[ip->r] = (RF[ip->l] != RF[ip->m]);
+            VM_NEXT();
+
+        // LSS
+        VM_CASE(op_lss, 21)
+            RF[ip->r] = (RF[ip->l] < RF[ip->m]);
+            VM_NEXT();
+
+        // LEQ
+        VM_CASE(op_leq, 22)
+            RF[ip->r] = (RF[ip->l] <= RF[ip->m]);
+            VM_NEXT();
+
+        // GTR
+        VM_CASE(op_gtr, 23)
+            RF[ip->r] = (RF[ip->l] > RF[ip->m]);
+            VM_NEXT();
+
+        // GEQ
+        VM_CASE(op_geq, 24)
+            RF[ip->r] = (RF[ip->l] >= RF[ip->m]);
+            VM_NEXT();
+
+/**
+ * The comparison of ip, then the JPC that follows it, of a compare;JPC
+ * .. superinstruction.
+ * */
+#define VM_COMPARE_JPC(operator)                                            \
+    RF[ip->r] = (RF[ip->l] operator RF[ip->m]);                             \
+    steps++;                                                                \
+    PC++;                                                                   \
+    if (RF[ip[1].r] == 0)                                                   \
+    {                                                                       \
+        VM_JUMP(ip[1].m);                                                   \
+    }                                                                       \
+    VM_NEXT();
+
+        // LOD; LOD; ADD. A LOD out of the stack halts after the steps before it.
+        VM_CASE(op_lod_lod_add, VM_FUSED_LOD_LOD_ADD)
+            {
+                int address = VM_BASE(ip[0].l) + ip[0].m;
+                if (address < 0 || address >= stackSize) goto overflow;
+                RF[ip[0].r] = stack[address];
+                steps++;
+                PC++;
+                address = VM_BASE(ip[1].l) + ip[1].m;
+                if (address < 0 || address >= stackSize) goto overflow;
+                RF[ip[1].r] = stack[address];
+            }
+            RF[ip[2].r] = RF[ip[2].l] + RF[ip[2].m];
+            steps++;
+            PC++;
+            VM_NEXT();
+
+        // LIT; STO
+        VM_CASE(op_lit_sto, VM_FUSED_LIT_STO)
+            RF[ip[0].r] = ip[0].m;
+            steps++;
+            PC++;
+            {
+                int address = VM_BASE(ip[1].l) + ip[1].m;
+                if (address < 0 || address >= stackSize) goto overflow;
+                stack[address] = RF[ip[1].r];
+                if (address > touched) touched = address;
+            }
+            VM_NEXT();
+
+        // EQL .. GEQ; JPC
+        VM_CASE(op_eql_jpc, VM_FUSED_EQL_JPC)
+            VM_COMPARE_JPC(==)
+
+        VM_CASE(op_neq_jpc, VM_FUSED_NEQ_JPC)
+            VM_COMPARE_JPC(!=)
+
+        VM_CASE(op_lss_jpc, VM_FUSED_LSS_JPC)
+            VM_COMPARE_JPC(<)
+
+        VM_CASE(op_leq_jpc, VM_FUSED_LEQ_JPC)
+            VM_COMPARE_JPC(<=)
+
+        VM_CASE(op_gtr_jpc, VM_FUSED_GTR_JPC)
+            VM_COMPARE_JPC(>)
+
+        VM_CASE(op_geq_jpc, VM_FUSED_GEQ_JPC)
+            VM_COMPARE_JPC(>=)
+
+#undef VM_COMPARE_JPC
+
+        VM_CASE(op_illegal, 0)
+            fprintf(stderr, "Illegal instruction?");
+            VM_TRACE();
+            goto halt;
+#if !VM_COMPUTED_GOTO
+        }
+    }
+#endif
+
+overflow:
+    // The stack would grow past its limit: halt without executing
+    fprintf(stderr, "Stack overflow?");
+    VM_TRACE();
+    goto halt;
+
+outside:
+    // The jump left the loaded program. After its step, the instruction at
+    // .. the target is fetched as an illegal one, as runSwitchEngine() does.
+    VM_TRACE();
+    {
+        int addr = PC++;
+        ip = &code[numOfIns];
+        VM_COUNT();
+
+        fprintf(stderr, "Illegal instruction?");
+        VM_TRACE_AT(addr);
+    }
+    goto halt;
+
+#undef VM_TRACE
+#undef VM_TRACE_AT
+#undef VM_COUNT
+#undef VM_JUMP
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_BASE
+
+halt:
+    // Write the registers back to the virtual machine
+    vm->PC = PC;
+    vm->BP = BP;
+    vm->SP = SP;
+    vm->touched = touched;
+    vm->steps = steps;
+
+    if(profile) endVMProfile(profile, steps);
+
+    free(code);
+
+    return HALT;
+}
+
+/**
+ * Runs the (ins)tructions on the JIT, and reports the illegal instruction or
+ * the stack overflow the machine halted on, as the interpreter does. Returns
+ * HALT, or -1 if the JIT could not run them, with nothing run.
+ * */
+int runJITEngine(VirtualMachine* vm, Instruction* ins, int numOfIns, VMIO* io)
+{
+    int status = runJIT(vm, ins, numOfIns, io);
+
+    if(status < 0) return -1;
+
+    // The translated code does not count the instructions it executes
+    vm->steps = -1;
+
+    if(status == JIT_ILLEGAL)  fprintf(stderr, "Illegal instruction?");
+    if(status == JIT_OVERFLOW) fprintf(stderr, "Stack overflow?");
+
+    return HALT;
+}
+
+/**
+ * Copies what is left of (in) to (out).
+ * */
+void copyStream(FILE* in, FILE* out)
+{
+    char buffer[4096];
+    size_t read;
+
+    while( (read = fread(buffer, 1, sizeof(buffer), in)) > 0 )
+        fwrite(buffer, 1, read, out);
+}
+
+/**
+ * Reports on stderr where the run of the JIT, which halted in the state (jit)
+ * with jitStack as the stack it touched and jitOut as its output, differs from
+ * the one of the interpreter, which halted on the (v)irtual (m)achine with out
+ * as its output. Returns the number of differences.
+ * */
+int compareJITRun(const VirtualMachine* jit, const int* jitStack, FILE* jitOut, const VirtualMachine* vm, FILE* out)
+{
+    int differences = 0, i;
+
+    if(jit->PC != vm->PC || jit->BP != vm->BP || jit->SP != vm->SP)
+    {
+        fprintf(stderr, "JIT check: halted with PC %d BP %d SP %d, the interpreter with PC %d BP %d SP %d.\n",
+            jit->PC, jit->BP, jit->SP, vm->PC, vm->BP, vm->SP);
+        differences++;
+    }
+
+    for(i = 0; i < REGISTER_FILE_REG_COUNT; i++)
+    {
+        if(jit->RF[i] == vm->RF[i]) continue;
+
+        fprintf(stderr, "JIT check: RF[%d] is %d, %d on the interpreter.\n", i, jit->RF[i], vm->RF[i]);
+        differences++;
+    }
+
+    if(jit->touched != vm->touched)
+    {
+        fprintf(stderr, "JIT check: wrote the stack up to %d, the interpreter up to %d.\n",
+            jit->touched, vm->touched);
+        differences++;
+    }
+    else
+    {
+        // The first slot that differs only
+        for(i = 0; jitStack && i <= jit->touched && i < jit->stackSize; i++)
+        {
+            if(jitStack[i] == vm->stack[i]) continue;
+
+            fprintf(stderr, "JIT check: stack[%d] is %d, %d on the interpreter.\n", i, jitStack[i], vm->stack[i]);
+            differences++;
+            break;
+        }
+    }
+
+    rewind(jitOut);
+    rewind(out);
+
+    long offset = 0;
+    int a, b;
+
+    do
+    {
+        a = fgetc(jitOut);
+        b = fgetc(out);
+        if(a != b)
+        {
+            fprintf(stderr, "JIT check: the output differs from the interpreter's at byte %ld.\n", offset);
+            differences++;
+            break;
+        }
+        offset++;
+    } while(a != EOF);
+
+    return differences;
+}
+
+/**
+ * Runs the (ins)tructions on the JIT, then again on the threaded engine with
+ * the same input, and reports on stderr where the two runs differ: the output,
+ * the registers and the stack the machine halted with. The output written to
+ * (io), the trace written to traceOut or recorded to the (ring), and the
+ * halting messages, are those of the threaded engine.
+ * */
+int runCheckedEngine(VirtualMachine* vm, Instruction* ins, int numOfIns, FILE* traceOut, TraceRing* ring, VMIO* io)
+{
+    FILE* input = tmpfile();
+    FILE* jitOut = tmpfile();
+    FILE* out = tmpfile();
+
+    // Each run reads and writes through SIO streams of its own
+    VMIO* runIO = malloc(sizeof(VMIO));
+
+    if(!input || !jitOut || !out || !runIO)
+    {
+        fprintf(stderr, "Could not create the files of the JIT check, nothing was checked.\n");
+
+        if(input) fclose(input);
+        if(jitOut) fclose(jitOut);
+        if(out) fclose(out);
+        free(runIO);
+
+        return runThreadedEngine(vm, ins, numOfIns, traceOut, ring, NULL, io);
+    }
+
+    // Both runs read the same input
+    copyStream(io->in, input);
+    rewind(input);
+
+    initVMIO(runIO, input, jitOut, 0);
+
+    int status = runJIT(vm, ins, numOfIns, runIO);
+    flushVMIO(runIO);
+
+    // The state the JIT halted in, and the part of the stack it wrote
+    VirtualMachine jit = *vm;
+    int touched = (vm->touched < vm->stackSize) ? vm->touched + 1 : vm->stackSize;
+    int* jitStack = NULL;
+
+    if(status >= 0 && touched > 0 && (jitStack = malloc((size_t)touched * sizeof(int))))
+        memcpy(jitStack, vm->stack, (size_t)touched * sizeof(int));
+
+    resetVM(vm);
+    rewind(input);
+
+    initVMIO(runIO, input, out, 0);
+    runThreadedEngine(vm, ins, numOfIns, traceOut, ring, NULL, runIO);
+    flushVMIO(runIO);
+
+    if(status < 0)
+        fprintf(stderr, "The JIT could not run the program, nothing was checked.\n");
+    else
+        compareJITRun(&jit, jitStack, jitOut, vm, out);
+
+    rewind(out);
+    flushVMIO(io);
+    copyStream(out, io->out);
+
+    fclose(input);
+    fclose(jitOut);
+    fclose(out);
+    free(jitStack);
+    free(runIO);
+
+    return HALT;
+}
+
+/**
+ * Returns the options simulateVM() runs with.
+ * */
+VMOptions getDefaultVMOptions()
+{
+    VMOptions options;
+
+    options.engine = VM_ENGINE_THREADED;
+    options.trace  = VM_TRACE_FULL;
+    options.traceRingSize = VM_DEFAULT_TRACE_RING_SIZE;
+    options.stackLimit = VM_DEFAULT_STACK_LIMIT;
+    options.codeLimit = VM_DEFAULT_CODE_LIMIT;
+    options.profile = NULL;
+    options.stats = NULL;
+    options.interactive = 0;
+    options.interrupt = NULL;
+
+    return options;
+}
+
+/**
+ * inp: The FILE pointer containing the list of instructions to
+ *         be loaded to code memory of the virtual machine.
+ * 
+ * outp: The FILE pointer to write the simulation output, which
+ *       contains both code memory and execution history.
+ * 
+ * vm_inp: The FILE pointer that is going to be attached as the input
+ *         stream to the virtual machine. Useful to feed input for SIO
+ *         instructions.
+ * 
+ * vm_outp: The FILE pointer that is going to be attached as the output
+ *          stream to the virtual machine. Useful to save the output printed
+ *          by SIO instructions.
+ * */
+void simulateVM(
+    FILE* inp,
+    FILE* outp,
+    FILE* vm_inp,
+    FILE* vm_outp
+    )
+{
+    simulateVMWithOptions(inp, outp, vm_inp, vm_outp, getDefaultVMOptions());
+}
+
+/**
+ * Same as simulateVM(), but runs the program with the given options.
+ * */
+void simulateVMWithOptions(
+    FILE* inp,
+    FILE* outp,
+    FILE* vm_inp,
+    FILE* vm_outp,
+    VMOptions options
+    )
+{
+	CodeMemory code;
+	
+    // Load instructions from file, either text or object file
+    if(options.stats) beginPhase(options.stats);
+	if (loadCode(inp, &code, options.codeLimit)) return;
+    if(options.stats) endPhase(options.stats, STATS_LOAD);
+
+    // Run the loaded instructions
+    simulateCode(code.ins, code.numOfIns, outp, vm_inp, vm_outp, options);
+
+    unloadCode(&code);
+}
+
+int simulateVMOnMachine(
+    VirtualMachine* vm,
+    FILE* inp,
+    FILE* outp,
+    FILE* vm_inp,
+    FILE* vm_outp,
+    VMOptions options
+    )
+{
+	CodeMemory code;
+
+    // Load instructions from file, either text or object file
+    if(options.stats) beginPhase(options.stats);
+	if (loadCode(inp, &code, options.codeLimit)) return -1;
+    if(options.stats) endPhase(options.stats, STATS_LOAD);
+
+    simulateCodeOnVM(vm, code.ins, code.numOfIns, outp, vm_inp, vm_outp, options);
+
+    unloadCode(&code);
+    return 0;
+}
+
+void simulateCode(
+    Instruction* ins,
+    int numOfIns,
+    FILE* outp,
+    FILE* vm_inp,
+    FILE* vm_outp,
+    VMOptions options
+    )
+{
+    VirtualMachine vm;
+
+    // Initialize the virtual machine
+    if(initVM(&vm, options.stackLimit)) return;
+
+    simulateCodeOnVM(&vm, ins, numOfIns, outp, vm_inp, vm_outp, options);
+
+    deleteVM(&vm);
+}
+
+void simulateCodeOnVM(
+    VirtualMachine* vm,
+    Instruction* ins,
+    int numOfIns,
+    FILE* outp,
+    FILE* vm_inp,
+    FILE* vm_outp,
+    VMOptions options
+    )
+{
+    if(numOfIns > options.codeLimit)
+    {
+        fprintf(stderr, "Program has %d instructions, more than the code limit (%d).\n",
+            numOfIns, options.codeLimit);
+        return;
+    }
+
+    // The SIO streams, buffered by the machine: a run at a terminal is
+    // .. interactive whether asked or not
+    VMIO* io = malloc(sizeof(VMIO));
+
+    if(!io)
+    {
+        fprintf(stderr, "Could not allocate the SIO buffers.\n");
+        return;
+    }
+
+    initVMIO(io, vm_inp, vm_outp, options.interactive || isTerminal(vm_inp) || isTerminal(vm_outp));
+
+    // Without a simulation output, there is nothing to trace
+    if(!outp) options.trace = VM_TRACE_NONE;
+
+    // Dump instructions to the output file
+	if(outp) dumpInstructions(outp, ins, numOfIns);
+
+    // The execution history is written only for traced runs
+    FILE* traceOut = (options.trace == VM_TRACE_FULL) ? outp : NULL;
+
+    // Before starting the code execution on the virtual machine,
+    // .. write the header for the simulation part (***Execution***)
+    if(traceOut)
+    {
+        fprintf(traceOut, "\n***Execution***\n");
+        fprintf(
+            traceOut,
+            "%3s %3s %3s %3s %3s %3s %3s %3s %3s \n",         // formatting
+            "#", "OP", "R", "L", "M", "PC", "BP", "SP", "STK" // titles
+        );
+    }
+
+    // Ring trace: the last steps are kept in memory and written on halt
+    TraceRing ring, *ringPtr = NULL;
+
+    if(options.trace == VM_TRACE_RING)
+    {
+        ring.size = (options.traceRingSize > 0) ? options.traceRingSize : VM_DEFAULT_TRACE_RING_SIZE;
+        ring.records = malloc(ring.size * sizeof(TraceRecord));
+        ring.next = 0;
+        ring.count = 0;
+
+        ringPtr = &ring;
+    }
+
+    // Profiled runs count their steps on the threaded engine
+    VMProfile* profile = options.profile;
+
+    if(profile && beginVMProfile(profile, ins, numOfIns)) profile = NULL;
+
+    if(options.stats) beginPhase(options.stats);
+
+    // An interruptible run is not run by the JIT, which could not be halted
+    vm->interrupt = options.interrupt;
+
+    if(options.interrupt && (options.engine == VM_ENGINE_JIT || options.engine == VM_ENGINE_JIT_CHECK))
+        options.engine = VM_ENGINE_THREADED;
+
+    // Execute the instructions on the virtual machine until halting. The JIT
+    // .. runs untraced programs only, the threaded engine runs the others
+    if(profile)
+        runThreadedEngine(vm, ins, numOfIns, traceOut, ringPtr, profile, io);
+    else if(options.engine == VM_ENGINE_SWITCH)
+        runSwitchEngine(vm, ins, numOfIns, traceOut, ringPtr, io);
+    else if(options.engine == VM_ENGINE_JIT_CHECK)
+        runCheckedEngine(vm, ins, numOfIns, traceOut, ringPtr, io);
+    else if(options.engine != VM_ENGINE_JIT || traceOut || ringPtr
+            || runJITEngine(vm, ins, numOfIns, io) != HALT)
+        runThreadedEngine(vm, ins, numOfIns, traceOut, ringPtr, NULL, io);
+
+    // The output left in the buffer once the machine halted
+    flushVMIO(io);
+    free(io);
+
+    // The machine is reset below, what it did is counted first
+    if(options.stats)
+    {
+        endPhase(options.stats, STATS_EXECUTE);
+
+        options.stats->instructionsExecuted = vm->steps;
+        options.stats->maxStackDepth = (vm->touched > vm->SP) ? vm->touched : vm->SP;
+    }
+
+    // The machine halted, possibly on an illegal instruction or a stack
+    // .. overflow: write the steps the ring holds
+    if(ringPtr)
+    {
+        dumpTraceRing(outp, ringPtr, vm);
+        free(ring.records);
+    }
+
+    // Above loop ends when machine halts. Therefore, dump halt message.
+    if(traceOut || ringPtr) fprintf(outp, "HLT\n");
+
+    // The next run starts from a clean machine
+    vm->interrupt = NULL;
+    resetVM(vm);
+    return;
+}
\ No newline at end of file
@@ -2,10 +2,132 @@
 #define __VM_H__
 
 #include <stdio.h>
+#include "data.h"
+
+/**
+ * The machine is declared in data.h. It is named by its tag here, since a
+ * program could include another data.h (with the same guard) before this one.
+ * */
+struct VirtualMachine;
+
+/**
+ * The profile of a run, see profile.h.
+ * */
+struct VMProfile;
+
+/**
+ * The statistics of a run, see stats.h.
+ * */
+struct RunStats;
+
+/**
+ * Execution engines of the virtual machine.
+ *  VM_ENGINE_SWITCH  : fetches each instruction and executes it through the
+ *                      switch in executeInstruction().
+ *  VM_ENGINE_THREADED: decodes the code memory into a handler table once and
+ *                      jumps from handler to handler (computed goto where
+ *                      the compiler supports it, a switch otherwise).
+ *  VM_ENGINE_JIT     : translates the code memory into machine code and runs
+ *                      it natively, see jit.h. Traced runs, and programs the
+ *                      JIT could not translate, run on the threaded engine.
+ *  VM_ENGINE_JIT_CHECK: runs the program on the JIT, then again on the
+ *                      threaded engine with the same input, and reports on
+ *                      stderr where the output or the final machine state
+ *                      differ. The output and the trace are those of the
+ *                      threaded engine. The input is read to its end first.
+ * All engines produce the same simulation output.
+ * */
+typedef enum {
+    VM_ENGINE_SWITCH,
+    VM_ENGINE_THREADED,
+    VM_ENGINE_JIT,
+    VM_ENGINE_JIT_CHECK
+} VMEngine;
+
+/**
+ * What is written to the simulation output while the program runs.
+ *  VM_TRACE_FULL: the machine state after every executed instruction
+ *                 (***Execution***), followed by HLT.
+ *  VM_TRACE_NONE: nothing. Only the code memory dump is written, and the
+ *                 per-step formatting is not done at all.
+ *  VM_TRACE_RING: the last traceRingSize steps are recorded in memory and
+ *                 written in the ***Execution*** layout when the machine halts
+ *                 (SIO 3, an illegal instruction or a stack overflow). The
+ *                 stack is printed for the last step only.
+ * */
+typedef enum {
+    VM_TRACE_FULL,
+    VM_TRACE_NONE,
+    VM_TRACE_RING
+} VMTraceMode;
+
+/**
+ * The number of steps kept by VM_TRACE_RING when no size is given.
+ * */
+#define VM_DEFAULT_TRACE_RING_SIZE 64
+
+/**
+ * The limits the machine runs with when no limit is given: the number of ints
+ * the stack could grow to, and the number of instructions the code memory
+ * could hold. The stack is reserved up to its limit but only the part a
+ * program touches is ever zeroed, so a large limit does not slow down small
+ * programs.
+ * */
+#define VM_DEFAULT_STACK_LIMIT (1 << 20)
+#define VM_DEFAULT_CODE_LIMIT  (1 << 20)
+
+/**
+ * Options that change how simulateVMWithOptions() runs a program.
+ * */
+typedef struct {
+    VMEngine engine;
+    VMTraceMode trace;
+    int traceRingSize; // VM_TRACE_RING only
+    int stackLimit;    // CAL and INC past it halt with a stack overflow
+    int codeLimit;     // programs longer than it are not loaded
+    struct VMProfile* profile; // if not NULL, the run is profiled into it, on
+                               // .. the threaded engine whatever the engine is
+    struct RunStats* stats;    // if not NULL, the loading and the execution of
+                               // .. the program are timed and counted into it
+    int interactive;           // write the output of SIO at once, and read the
+                               // .. input a line at a time, see sio.h. Runs at
+                               // .. a terminal are interactive anyway
+    const volatile int* interrupt; // if not NULL, another thread could set it
+                               // .. to halt the run at its next jump, call or
+                               // .. return, e.g. past a time limit. Such runs
+                               // .. are never run by the JIT, which could not
+                               // .. be halted
+} VMOptions;
+
+/**
+ * Returns the options simulateVM() runs with.
+ * */
+VMOptions getDefaultVMOptions();
+
+/**
+ * Initialize Virtual Machine, with a stack of stackLimit ints.
+ * The stack is not zeroed here, see reserveZeroed(): a machine starts in
+ * constant time whatever its stack limit is.
+ * Returns 0 on success, -1 if the stack could not be reserved.
+ * */
+int initVM(struct VirtualMachine*, int stackLimit);
+
+/**
+ * Releases the stack of the virtual machine.
+ * */
+void deleteVM(struct VirtualMachine*);
+
+/**
+ * Brings the virtual machine back to the state initVM() leaves it in, zeroing
+ * only the part of the stack written since it was last reset. A machine could
+ * thus run many short programs without reserving a stack for each of them.
+ * */
+void resetVM(struct VirtualMachine*);
 
 /**
  * inp: The FILE pointer containing the list of instructions to
  *         be loaded to code memory of the virtual machine.
+ *         Either text or a binary object file (see ObjectHeader in data.h).
  * 
  * outp: The FILE pointer to write the simulation output, which
  *       contains both code memory and execution history.
@@ -26,4 +148,60 @@ void simulateVM(
     FILE* vm_outp
 );
 
+/**
+ * Same as simulateVM(), but runs the program with the given options.
+ * */
+void simulateVMWithOptions(
+    FILE* inp,
+    FILE* outp,
+    FILE* vm_inp,
+    FILE* vm_outp,
+    VMOptions options
+);
+
+/**
+ * Same as simulateVMWithOptions(), but runs on the given (v)irtual (m)achine,
+ * as simulateCodeOnVM() does. Returns 0 if the program was run, -1 if its code
+ * could not be loaded.
+ * */
+int simulateVMOnMachine(
+    struct VirtualMachine* vm,
+    FILE* inp,
+    FILE* outp,
+    FILE* vm_inp,
+    FILE* vm_outp,
+    VMOptions options
+);
+
+/**
+ * Same as simulateVMWithOptions(), but runs the given (ins)tructions, which
+ * are already in memory, instead of loading them from a file. Nothing is run
+ * if numOfIns exceeds the code limit of the options.
+ * outp could be NULL, in which case neither the code memory nor the execution
+ * history is written.
+ * */
+void simulateCode(
+    Instruction* ins,
+    int numOfIns,
+    FILE* outp,
+    FILE* vm_inp,
+    FILE* vm_outp,
+    VMOptions options
+);
+
+/**
+ * Same as simulateCode(), but runs on the given (v)irtual (m)achine, which
+ * should be initialized or reset, instead of a new one, and resets it once the
+ * program halted. The stack limit is the one the machine was initialized with.
+ * */
+void simulateCodeOnVM(
+    struct VirtualMachine* vm,
+    Instruction* ins,
+    int numOfIns,
+    FILE* outp,
+    FILE* vm_inp,
+    FILE* vm_outp,
+    VMOptions options
+);
+
 #endif
\ No newline at end of file
@@ -2,7 +2,9 @@
 #define __LEXICAL_ANALYZER_H__
 
 #include "token.h"
+#include "arena.h"
 #include <stdio.h>
+#include <stddef.h>
 
 /**
  * Enumaration for possible lexer errors.
@@ -46,7 +48,40 @@ typedef struct {
 } LexerOut;
 
 /**
- * Deallocates the memory dynamically allocated for the members of LexerOut.
+ * State of the lexer, which lexes the source code on demand, a token at a
+ * .. time, see lexNextToken().
+ * */
+typedef struct {
+    int lineNum;            // the line number currently being processed
+    int charInd;            // the index of the character currently being processed
+    const char* sourceCode; // source code, not necessarily null terminated
+    int length;             // the number of characters in sourceCode
+    LexErr lexerError;      // LexErr to be filled when Lexer faces an error
+    Token token;            // the token recognized by the last step
+    int hasToken;           // 1 if a token was recognized by the last step
+} LexerState;
+
+/**
+ * Initializes the LexerState with the given length characters of source code,
+ * .. which do not need to be null terminated.
+ * Sets the other fields of the LexerState to their inital values.
+ * Shallow copying is done for the source code field, which should outlive the
+ * .. LexerState.
+ * */
+void initLexerState(LexerState*, const char* sourceCode, size_t length);
+
+/**
+ * Lexes the next token of the source code of the given LexerState into token.
+ * Returns 1 if a token is lexed. Returns 0 at the end of the source code, or
+ * .. if an error is encountered, in which case the lexerError and lineNum
+ * .. fields of the LexerState tell the error and its line. Once it returns 0,
+ * .. it does so for the following calls as well.
+ * */
+int lexNextToken(LexerState*, Token* token);
+
+/**
+ * Empties the members of LexerOut. Their memory is released with the arena
+ * given to lexicalAnalyzer().
  * */
 void deleteLexerOut(LexerOut*);
 
@@ -57,7 +92,17 @@ void deleteLexerOut(LexerOut*);
  * .. with tokens.
  * If the analysis is NOT successful, i.e. errors are found in the given source
  * .. code, returns a LexerOut with lexerError and errorLine fields properly set.
+ * The tokens are allocated from the given arena.
+ * */
+LexerOut lexicalAnalyzer(char* sourceCode, Arena* arena);
+
+/**
+ * Same as lexicalAnalyzer(), but on the given length characters of source
+ * .. code, which do not need to be null terminated, e.g. a memory mapped file
+ * .. (see mapSourceCode()). The source code is scanned in place and only the
+ * .. lexemes of the tokens are copied out of it.
+ * The tokens are lexed with lexNextToken() into the token list.
  * */
-LexerOut lexicalAnalyzer(char* sourceCode);
+LexerOut lexicalAnalyzeBuffer(const char* sourceCode, size_t length, Arena* arena);
 
 #endif
\ No newline at end of file
@@ -4,8 +4,34 @@
  * Necip Yildiran, yildiran@knights.ucf.edu
  * */
 #include <stdio.h>
+#include <string.h>
 #include "lexical_analyzer.h"
 #include "source_code.h"
+#include "stats.h"
+
+/**
+ * Parses the options given before the positional arguments. Sets binary to 1
+ * if the token list should be written as a binary token stream, and printStats
+ * to 1 if the statistics of the run should be printed. Returns the number of
+ * arguments consumed, or -1 if an option is not recognized.
+ * */
+int parseOptions(int argc, char **argv, int* binary, int* printStats)
+{
+    int i;
+    for(i = 1; i < argc && !strncmp(argv[i], "--", 2); i++)
+    {
+        if( !strcmp(argv[i], "--format=text") )        *binary = 0;
+        else if( !strcmp(argv[i], "--format=binary") ) *binary = 1;
+        else if( !strcmp(argv[i], "--stats") )         *printStats = 1;
+        else
+        {
+            fprintf(stderr, "Unknown option \"%s\"\n", argv[i]);
+            return -1;
+        }
+    }
+
+    return i - 1;
+}
 
 int main(int argc, char **argv)
 {
@@ -14,9 +40,20 @@ int main(int argc, char **argv)
     /**********************************/
     /* Parsing Command Line Arguments */
     /**********************************/
+    // Options come before the positional arguments
+    int binary = 0;
+    int printStats = 0;
+    int optionCount = parseOptions(argc, argv, &binary, &printStats);
+
+    if(optionCount < 0) return -1;
+
+    argv[optionCount] = argv[0];
+    argv += optionCount;
+    argc -= optionCount;
+
     if(argc != 3)
     {
-        fprintf(stderr, "Usage: la.out (pl0_source_code_file) (lexical_analyzer_output_file)\n");
+        fprintf(stderr, "Usage: la.out [options] (pl0_source_code_file) (lexical_analyzer_output_file)\n");
 
         fprintf(stderr, "\n       pl0_source_code_file: The path to the file containing the source code for the"
                         "\n            programming language PL/0.\n");
@@ -24,6 +61,13 @@ int main(int argc, char **argv)
         fprintf(stderr, "\n       lexical_analyzer_output_file: The path to the file to write the lexical analyzer"
                         "\n            output, which contains the lexeme table and the symbol table.");
 
+        fprintf(stderr, "\n\n       options:"
+                        "\n            --format=text    Write the token list as text (default)."
+                        "\n            --format=binary  Write only the token list, as a binary token stream"
+                        "\n                             the parser and the code generator can read."
+                        "\n            --stats          Print the statistics of the run on stderr once it is"
+                        "\n                             done, a key=value pair per line.\n");
+
         return -1;
     }
 
@@ -35,7 +79,7 @@ int main(int argc, char **argv)
     }
 
     // open the output file for writing
-    if( !(outp = fopen(argv[2], "w")) )
+    if( !(outp = fopen(argv[2], binary ? "wb" : "w")) )
     {
         fprintf(stderr, "Could not open \"%s\"\n", argv[2]);
 
@@ -48,11 +92,29 @@ int main(int argc, char **argv)
     /**********************************/
     /**** Call to lexical analyzer ****/
     /**********************************/
-    // Read source code
-    char *sourceCode = readSourceCode(inp);
+    // Everything the lexer allocates is released at once at the end
+    Arena arena;
+    initArena(&arena);
+
+    // Each phase is timed for --stats
+    RunStats stats;
+    initRunStats(&stats);
+
+    // Map source code, which is scanned in place
+    SourceCode sourceCode;
+
+    beginPhase(&stats);
+    mapSourceCode(inp, &sourceCode, &arena);
+    endPhase(&stats, STATS_SOURCE_READ);
 
     // Do lexical analysis
-    LexerOut lexerOut = lexicalAnalyzer(sourceCode);
+    beginPhase(&stats);
+    LexerOut lexerOut = lexicalAnalyzeBuffer(sourceCode.text, sourceCode.length, &arena);
+    endPhase(&stats, STATS_LEX);
+
+    stats.tokens = lexerOut.tokenList.numberOfTokens;
+
+    beginPhase(&stats);
 
     if(lexerOut.lexerError != NONE)
     {
@@ -76,6 +138,11 @@ int main(int argc, char **argv)
                 break;
         }
     }
+    else if(binary)
+    {
+        // The token stream is read as it is by the parser and the code generator
+        printTokenListBinary(lexerOut.tokenList, outp);
+    }
     else
     {
         // If the execution of lexical analysis is successful, print success message
@@ -85,8 +152,11 @@ int main(int argc, char **argv)
         printTokenList(lexerOut.tokenList, outp);
     }
 
+    endPhase(&stats, STATS_TOKEN_IO);
+
     deleteLexerOut(&lexerOut);
-    deleteSourceCode(sourceCode);
+    unmapSourceCode(&sourceCode);
+    deleteArena(&arena);
 
     /**********************************/
     /* Closing input and output files */
@@ -96,5 +166,15 @@ int main(int argc, char **argv)
     fclose(inp);
     fclose(outp);
 
+    if(printStats)
+    {
+        // The source code, if it was read rather than mapped, and the tokens
+        ArenaUsage arenaUsage = getArenaUsage();
+        stats.allocatedBytes = arenaUsage.allocated;
+        stats.peakAllocatedBytes = arenaUsage.peak;
+
+        printRunStats(&stats, stderr);
+    }
+
     return 0;
 }
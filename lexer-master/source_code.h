@@ -2,21 +2,46 @@
 #define __SOURCE_CODE_H__
 
 #include <stdio.h>
+#include <stddef.h>
+#include "arena.h"
 
 /**
- * Reads the source code from file until EOF to a null-terminated string.
+ * Source code in memory, as given to lexicalAnalyzeBuffer(): length characters
+ * starting at text, not necessarily null terminated.
+ * mapping is the memory mapping of the file text points into, or NULL if the
+ * .. file was read into an arena instead.
  * */
-char* readSourceCode(FILE*);
+typedef struct {
+    const char* text;
+    size_t length;
+    void* mapping;
+    size_t mappingSize;
+} SourceCode;
 
 /**
- * Prints the source code - simply prints a string.
+ * Reads the source code from file until EOF to a null-terminated string,
+ * allocated from the given arena. The string is released with the arena.
  * */
-void printSourceCode(char*);
+char* readSourceCode(FILE*, Arena*);
+
+/**
+ * Makes the whole source code in the given file available in memory without
+ * copying it: a regular file is mapped into memory where mmap is available.
+ * Otherwise (e.g. a pipe), the file is read with readSourceCode() into the
+ * given arena.
+ * The source code is valid until unmapSourceCode() is called and the arena is
+ * deleted. Returns 0 on success, -1 if there is no source code.
+ * */
+int mapSourceCode(FILE*, SourceCode*, Arena*);
 
 /**
- * Deallocates the memory dynamically allocated for source code string
- * .. - simply calls free on the pointer.
+ * Releases the mapping of the given source code, if any.
  * */
-void deleteSourceCode(char*);
+void unmapSourceCode(SourceCode*);
+
+/**
+ * Prints the source code - simply prints a string.
+ * */
+void printSourceCode(char*);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+/**
+ * The peak memory is read with getrusage() where it is available.
+ * */
+#if defined(__unix__) || defined(__APPLE__)
+#define STATS_HAVE_RUSAGE 1
+#include <sys/resource.h>
+#else
+#define STATS_HAVE_RUSAGE 0
+#endif
+
+/**
+ * The names of the phases, as their keys are prefixed with, see StatsPhase.
+ * */
+const char* phaseNames[STATS_PHASES] =
+{
+    "source_read", "lex", "token_io", "codegen", "emit", "load", "execute"
+};
+
+/**
+ * Returns the wall-clock time and the CPU time of the process, in nanoseconds.
+ * */
+PhaseTime getPhaseClock()
+{
+    PhaseTime clock;
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    clock.wall = (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    clock.cpu = (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+
+    return clock;
+}
+
+void initRunStats(RunStats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+void beginPhase(RunStats* stats)
+{
+    stats->started = getPhaseClock();
+}
+
+void endPhase(RunStats* stats, StatsPhase phase)
+{
+    PhaseTime now = getPhaseClock();
+
+    stats->phases[phase].wall += now.wall - stats->started.wall;
+    stats->phases[phase].cpu  += now.cpu - stats->started.cpu;
+}
+
+long long getPeakMemory()
+{
+#if STATS_HAVE_RUSAGE
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage)) return 0;
+
+#ifdef __APPLE__
+    // In bytes on macOS, in kilobytes elsewhere
+    return (long long)usage.ru_maxrss;
+#else
+    return (long long)usage.ru_maxrss * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+void printRunStats(const RunStats* stats, FILE* out)
+{
+    int i;
+    for(i = 0; i < STATS_PHASES; i++)
+    {
+        fprintf(out, "%s_wall_ns=%lld\n", phaseNames[i], stats->phases[i].wall);
+        fprintf(out, "%s_cpu_ns=%lld\n", phaseNames[i], stats->phases[i].cpu);
+    }
+
+    fprintf(out, "peak_memory_bytes=%lld\n", getPeakMemory());
+    fprintf(out, "allocated_bytes=%lld\n", stats->allocatedBytes);
+    fprintf(out, "peak_allocated_bytes=%lld\n", stats->peakAllocatedBytes);
+    fprintf(out, "tokens=%lld\n", stats->tokens);
+    fprintf(out, "symbols=%lld\n", stats->symbols);
+    fprintf(out, "find_symbol_calls=%lld\n", stats->symbolLookups);
+    fprintf(out, "find_symbol_probes=%lld\n", stats->symbolProbes);
+    fprintf(out, "instructions_emitted=%lld\n", stats->instructionsEmitted);
+    fprintf(out, "instructions_executed=%lld\n", stats->instructionsExecuted);
+    fprintf(out, "max_stack_depth=%d\n", stats->maxStackDepth);
+}
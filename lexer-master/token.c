@@ -1,34 +1,42 @@
 #include "token.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-void initTokenList(TokenList* tokenList)
+void initTokenList(TokenList* tokenList, Arena* arena)
 {
     tokenList->tokens = NULL;
     tokenList->numberOfTokens = 0;
+    tokenList->capacity = 0;
+    tokenList->arena = arena;
 }
 
 void addToken(TokenList* tokenList, Token token)
 {
-    // Increase number of tokens
-    tokenList->numberOfTokens++;
+    // Double the space for tokens when it gets full
+    if(tokenList->numberOfTokens == tokenList->capacity)
+    {
+        int capacity = tokenList->capacity ? 2 * tokenList->capacity : 64;
 
-    // Allocate space for new token
-    tokenList->tokens = (Token*)realloc(tokenList->tokens, (tokenList->numberOfTokens) * sizeof(Token));
+        tokenList->tokens = (Token*)arenaGrow(tokenList->arena, tokenList->tokens,
+            tokenList->capacity * sizeof(Token), capacity * sizeof(Token));
+        tokenList->capacity = capacity;
+    }
 
     // Add token to the end of the list
-    tokenList->tokens[tokenList->numberOfTokens - 1] = token;
+    tokenList->tokens[tokenList->numberOfTokens++] = token;
 }
 
 TokenList getCopy(TokenList src)
 {
     TokenList copy;
     
-    copy.numberOfTokens = src.numberOfTokens;
+    initTokenList(&copy, src.arena);
 
     if(src.tokens)
     {
-        copy.tokens = (Token*)malloc(src.numberOfTokens * sizeof(Token));
+        copy.tokens = (Token*)arenaAlloc(src.arena, src.numberOfTokens * sizeof(Token));
+        copy.numberOfTokens = copy.capacity = src.numberOfTokens;
 
         for(int i = 0; i < src.numberOfTokens; i++)
             copy.tokens[i] = src.tokens[i];
@@ -50,10 +58,48 @@ void printTokenList(TokenList tokenList, FILE* out)
     }
 }
 
-void deleteTokenList(TokenList* tokenList)
+void printTokenListBinary(TokenList tokenList, FILE* out)
 {
-    if(tokenList->tokens)
-        free(tokenList->tokens);
+    if(out == NULL)
+        return;
+
+    TokenStreamHeader header;
+
+    memcpy(header.magic, TOKEN_STREAM_MAGIC, sizeof(header.magic));
+    header.version = TOKEN_STREAM_VERSION;
+    header.numberOfTokens = tokenList.tokens ? tokenList.numberOfTokens : 0;
+    header.lexemeBytes = 0;
+
+    for(int i = 0; i < header.numberOfTokens; i++)
+        header.lexemeBytes += strlen(tokenList.tokens[i].lexeme);
+
+    fwrite(&header, sizeof(TokenStreamHeader), 1, out);
+
+    // Records, each pointing to its lexeme in the lexemes following them
+    unsigned int offset = 0;
+
+    for(int i = 0; i < header.numberOfTokens; i++)
+    {
+        TokenRecord record;
+
+        record.id = tokenList.tokens[i].id;
+        record.lexemeOffset = offset;
+        record.lexemeLength = strlen(tokenList.tokens[i].lexeme);
+
+        fwrite(&record, sizeof(TokenRecord), 1, out);
+
+        offset += record.lexemeLength;
+    }
 
+    // Lexemes
+    for(int i = 0; i < header.numberOfTokens; i++)
+        fputs(tokenList.tokens[i].lexeme, out);
+}
+
+void deleteTokenList(TokenList* tokenList)
+{
+    // The tokens belong to the arena
     tokenList->tokens = NULL;
+    tokenList->numberOfTokens = 0;
+    tokenList->capacity = 0;
 }
\ No newline at end of file
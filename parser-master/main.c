@@ -1,33 +1,70 @@
 #include <stdio.h>
+#include <string.h>
 #include "token.h"
 #include "parser.h"
 
+/**
+ * Reads the options given before the positional arguments into (check) and
+ * (treeFile). Returns the index of the first positional argument, or -1 if an
+ * option is unknown.
+ * */
+int parseOptions(int argc, char **argv, int* check, const char** treeFile)
+{
+    int i;
+    for(i = 1; i < argc && !strncmp(argv[i], "--", 2); i++)
+    {
+        if( !strcmp(argv[i], "--check") )                          *check = 1;
+        else if( !strncmp(argv[i], "--tree=", 7) && argv[i][7] )   *treeFile = argv[i] + 7;
+        else
+        {
+            fprintf(stderr, "Unknown option \"%s\"\n", argv[i]);
+            return -1;
+        }
+    }
+
+    return i;
+}
+
 int main(int argc, char **argv)
 {
-    FILE *inp, *outp;
+    FILE *inp, *outp = NULL;
+    int check = 0;
+    const char* treeFile = NULL;
 
     /**********************************/
     /* Parsing Command Line Arguments */
     /**********************************/
-    if(argc != 3)
+    int optionCount = parseOptions(argc, argv, &check, &treeFile);
+
+    if(optionCount < 0 || argc - optionCount != (check ? 1 : 2))
     {
-        fprintf(stderr, "Usage: parser.out (pl0_lexer_out) (parser_output_file)\n");
+        fprintf(stderr, "Usage: parser.out [options] (pl0_lexer_out) (parser_output_file)\n"
+                        "       parser.out --check [--tree=FILE] (pl0_lexer_out)\n");
 
-        fprintf(stderr, "\n       pl0_lexer_out: The path to the file containing the lexer out for the programming language PL/0.\n");
+        fprintf(stderr, "\n       pl0_lexer_out: The path to the file containing the lexer out for the programming language PL/0,"
+                        "\n       either as text or as a binary token stream.\n");
 
         fprintf(stderr, "\n       parser_output_file: The path to the file to write the parser output, which contains the parsing history, the symbol table and the error message if applicable.\n");
+
+        fprintf(stderr, "\n       options:"
+                        "\n         --check      Only validate the tokens: print nothing, and exit with 0 if the parsing"
+                        "\n                      was successful, with the parser error code otherwise."
+                        "\n         --tree=FILE  Write the parse tree of a successful parsing to FILE, as a binary array"
+                        "\n                      of nodes a tool could map (see parse_tree.h).\n");
         return -1;
     }
 
+    argv += optionCount - 1;
+
     // open the input file for reading
-    if( !(inp = fopen(argv[1], "r")) )
+    if( !(inp = fopen(argv[1], "rb")) )
     {
         fprintf(stderr, "Could not open \"%s\"\n", argv[1]);
         return -1;
     }
 
-    // open the output file for writing
-    if( !(outp = fopen(argv[2], "w")) )
+    // open the output file for writing, unless only validating
+    if( !check && !(outp = fopen(argv[2], "w")) )
     {
         fprintf(stderr, "Could not open \"%s\"\n", argv[2]);
 
@@ -35,22 +72,50 @@ int main(int argc, char **argv)
         fclose(inp);
 
         return -1;
-    }              
+    }
 
     /**********************************/
     /**** Call to parser ****/
     /**********************************/
-    // Read the token list
-    TokenList tokenList = readTokenList(inp);
-    
+    // The token list is released at once at the end
+    Arena arena;
+    initArena(&arena);
+
+    // The tokens are read as the parser parses them
+    TokenFileReader tokenReader;
+    TokenSource tokenSource = openTokenFile(&tokenReader, inp, &arena);
+
+    // The parse tree, if it is to be written
+    ParseTree tree;
+    initParseTree(&tree);
+
     // Run parser
-    int err = parser(tokenList, outp);
+    int err = parserToTree(tokenSource, outp, treeFile ? &tree : NULL);
 
     // Print error - if there exists any
     printParserErr(err, outp);
 
-    // Delete token list created by readTokenList()
-    deleteTokenList(&tokenList);
+    // Write the parse tree of a successful parsing
+    int status = check ? err : 0;
+
+    if(treeFile && !err)
+    {
+        FILE* treeOut = fopen(treeFile, "wb");
+
+        if(!treeOut || writeParseTree(&tree, treeOut))
+        {
+            fprintf(stderr, "Could not write the parse tree to \"%s\"\n", treeFile);
+            status = -1;
+        }
+
+        if(treeOut) fclose(treeOut);
+    }
+
+    deleteParseTree(&tree);
+
+    // Delete the tokens of a token stream, if any
+    deleteTokenList(&tokenReader.tokenList);
+    deleteArena(&arena);
 
     /**********************************/
     /* Closing input and output files */
@@ -60,5 +125,5 @@ int main(int argc, char **argv)
     if(inp) fclose(inp);
     if(outp) fclose(outp);
 
-    return 0;
+    return status;
 }
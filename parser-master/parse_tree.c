@@ -0,0 +1,101 @@
+#include "parse_tree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void initParseTree(ParseTree* tree)
+{
+    tree->nodes = NULL;
+    tree->numberOfNodes = 0;
+    tree->capacity = 0;
+    tree->numberOfTokens = 0;
+    tree->open = -1;
+    tree->failed = 0;
+}
+
+/**
+ * Adds a node to the end of the tree, its end pointing to the node after it.
+ * Returns its index, or -1 if it could not be allocated.
+ * */
+int addParseTreeNode(ParseTree* tree, int nonTerminal, unsigned int token)
+{
+    if(tree->failed) return -1;
+
+    // Double the space for nodes when it gets full
+    if(tree->numberOfNodes == tree->capacity)
+    {
+        unsigned int capacity = tree->capacity ? 2 * tree->capacity : 256;
+        ParseTreeNode* nodes = (ParseTreeNode*)realloc(tree->nodes, capacity * sizeof(ParseTreeNode));
+
+        if(!nodes)
+        {
+            fprintf(stderr, "Could not allocate the parse tree.\n");
+            tree->failed = 1;
+            return -1;
+        }
+
+        tree->nodes = nodes;
+        tree->capacity = capacity;
+    }
+
+    int index = (int)tree->numberOfNodes++;
+
+    tree->nodes[index].nonTerminal = nonTerminal;
+    tree->nodes[index].token = token;
+    tree->nodes[index].firstChild = index + 1;
+    tree->nodes[index].end = index + 1;
+
+    return index;
+}
+
+void openParseTreeNode(ParseTree* tree, int nonTerminal, unsigned int token)
+{
+    int index = addParseTreeNode(tree, nonTerminal, token);
+
+    if(index < 0) return;
+
+    // Remember the parent until the node is closed
+    tree->nodes[index].end = (unsigned int)tree->open;
+    tree->open = index;
+}
+
+void closeParseTreeNode(ParseTree* tree)
+{
+    if(tree->failed || tree->open < 0) return;
+
+    ParseTreeNode* node = &tree->nodes[tree->open];
+
+    tree->open = (int)node->end;
+    node->end = tree->numberOfNodes;
+}
+
+void addParseTreeToken(ParseTree* tree, unsigned int token)
+{
+    if(addParseTreeNode(tree, PARSE_TREE_TOKEN, token) >= 0) tree->numberOfTokens++;
+}
+
+int writeParseTree(const ParseTree* tree, FILE* out)
+{
+    ParseTreeHeader header;
+
+    if(tree->failed || tree->open >= 0) return -1;
+
+    memcpy(header.magic, PARSE_TREE_MAGIC, sizeof(header.magic));
+    header.version = PARSE_TREE_VERSION;
+    header.numberOfNodes = tree->numberOfNodes;
+    header.numberOfTokens = tree->numberOfTokens;
+
+    if(fwrite(&header, sizeof(ParseTreeHeader), 1, out) != 1) return -1;
+
+    if(tree->numberOfNodes &&
+       fwrite(tree->nodes, sizeof(ParseTreeNode), tree->numberOfNodes, out) != tree->numberOfNodes)
+        return -1;
+
+    return 0;
+}
+
+void deleteParseTree(ParseTree* tree)
+{
+    free(tree->nodes);
+    initParseTree(tree);
+}
@@ -0,0 +1,98 @@
+#ifndef __PARSE_TREE_H__
+#define __PARSE_TREE_H__
+
+#include <stdio.h>
+
+/**
+ * Binary parse tree: a ParseTreeHeader, followed by numberOfNodes
+ * ParseTreeNodes, the nodes of the tree in preorder: a non-terminal, then the
+ * subtrees of its children from left to right. The leaves are the tokens the
+ * parser consumed. A tool could map the file and walk the tree in place.
+ * All fields are in the byte order of the machine that wrote it.
+ * */
+#define PARSE_TREE_MAGIC   "PM0P"
+#define PARSE_TREE_VERSION 1
+
+/**
+ * The nonTerminal of a node that is a token.
+ * */
+#define PARSE_TREE_TOKEN (-1)
+
+typedef struct {
+    char magic[4];               // PARSE_TREE_MAGIC, not null terminated
+    unsigned int version;        // PARSE_TREE_VERSION
+    unsigned int numberOfNodes;  // number of ParseTreeNodes following the header
+    unsigned int numberOfTokens; // number of tokens consumed, the leaves of the tree
+} ParseTreeHeader;
+
+/**
+ * A node of the parse tree.
+ * nonTerminal: the NonTerminal of the node, or PARSE_TREE_TOKEN for a token
+ * token      : the index of the token in the token list: the token itself, or
+ *              the first token of the non-terminal, which might consume none
+ * firstChild : the index of the first child, the node after this one
+ * end        : one past the index of the last node of the subtree. The
+ *              children are the nodes from firstChild to end, each child
+ *              followed by its own subtree: the next one is at its end.
+ *              A token has none, firstChild being end.
+ * */
+typedef struct {
+    int nonTerminal;
+    unsigned int token;
+    unsigned int firstChild;
+    unsigned int end;
+} ParseTreeNode;
+
+/**
+ * The parse tree of a parse, built as it parses.
+ * nodes         : numberOfNodes nodes, room for capacity of them
+ * numberOfTokens: the number of token nodes
+ * open          : the index of the non-terminal being parsed, -1 if none.
+ *                 The end of an open node holds the index of its parent
+ *                 until it is closed.
+ * failed        : whether a node could not be allocated, in which case the
+ *                 tree is incomplete and could not be written
+ * */
+typedef struct {
+    ParseTreeNode* nodes;
+    unsigned int numberOfNodes;
+    unsigned int capacity;
+    unsigned int numberOfTokens;
+    int open;
+    int failed;
+} ParseTree;
+
+/**
+ * Initializes the given ParseTree to an empty tree.
+ * */
+void initParseTree(ParseTree*);
+
+/**
+ * Adds a node for the given non-terminal, starting at the given token, as the
+ * last child of the open non-terminal, and opens it.
+ * */
+void openParseTreeNode(ParseTree*, int nonTerminal, unsigned int token);
+
+/**
+ * Closes the open non-terminal: the nodes added from now on are its siblings.
+ * */
+void closeParseTreeNode(ParseTree*);
+
+/**
+ * Adds a node for the given token as the last child of the open non-terminal.
+ * */
+void addParseTreeToken(ParseTree*, unsigned int token);
+
+/**
+ * Writes the given ParseTree to the given FILE, see ParseTreeHeader. All its
+ * nodes should be closed. Returns 0 on success, -1 if the tree is incomplete
+ * or could not be written.
+ * */
+int writeParseTree(const ParseTree*, FILE*);
+
+/**
+ * Releases the nodes of the given ParseTree, and leaves it empty.
+ * */
+void deleteParseTree(ParseTree*);
+
+#endif
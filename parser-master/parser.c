@@ -1,101 +1,126 @@
 #include "token.h"
 #include "data.h"
 #include "symbol.h"
+#include "parser.h"
+#include "parse_tree.h"
 #include <string.h>
 #include <stdlib.h>
 
 /**
- * This pointer is set when by parser() func and used by printParsedToken() func.
- * 
- * You are not required to use it anywhere. The implemented part of the skeleton
- * handles the printing. Instead, You could use the supplied helper functions to
- * manipulate the output file.
- * */
-FILE* _out;
-
-/**
- * Token list iterator used by the parser. It will be set once entered to parser()
- * and reset before exiting parser().
- * 
- * It is better to use the given helper functions to make use of token list iterator.
- * */
-TokenListIterator _token_list_it;
-
-/**
- * Current level.
+ * State of a parse. Each parserFromSource() call has its own, passed to the
+ * functions below, so that parses could run at the same time.
+ * out         : the file the parsing history and the symbol table are
+ *               printed on, used by printCurrentToken() and printNonTerminal(),
+ *               NULL if nothing is printed
+ * tokenSource : source of the tokens, and currentToken the current token
+ *               pulled from it. The parser never looks past the current
+ *               token, so the tokens are pulled only as they are parsed. It
+ *               is better to use the given helper functions to make use of the
+ *               token source.
+ * tokenIndex  : the index of the current token in the token source
+ * currentLevel: the level of the block being parsed
+ * symbolTable : the symbols declared so far
+ * tree        : the parse tree built as the tokens and the non-terminals are
+ *               printed, NULL if none is built
  * */
-unsigned int currentLevel;
+typedef struct {
+    FILE* out;
+    TokenSource tokenSource;
+    Token currentToken;
+    unsigned int tokenIndex;
+    unsigned int currentLevel;
+    SymbolTable symbolTable;
+    ParseTree* tree;
+} ParserContext;
 
 /**
- * Symbol table.
+ * Returns the current token pulled from the token source.
+ * If it is the end of tokens, returns token with id nulsym.
  * */
-SymbolTable symbolTable;
+Token getCurrentToken(ParserContext* context);
 
 /**
- * Returns the current token using the token list iterator.
- * If it is the end of tokens, returns token with id nulsym.
+ * Returns the type of the current token. Returns nulsym if it is the end of tokens.
  * */
-Token getCurrentToken();
+int getCurrentTokenType(ParserContext* context);
 
 /**
- * Returns the type of the current token. Returns nulsym if it is the end of tokens.
+ * Prints the current token on the output file by applying required formatting,
+ * and adds it to the parse tree.
  * */
-int getCurrentTokenType();
+void printCurrentToken(ParserContext* context);
 
 /**
- * Prints the given token on _out by applying required formatting.
+ * Pulls the next token from the token source as the current token.
  * */
-void printCurrentToken();
+void nextToken(ParserContext* context);
 
 /**
- * Advances the position of TokenListIterator by incrementing the current token
- * index by one.
+ * Given an entry from non-terminal enumaration, prints it, and opens its node
+ * in the parse tree.
  * */
-void nextToken();
+void printNonTerminal(ParserContext* context, NonTerminal nonTerminal);
 
 /**
- * Given an entry from non-terminal enumaration, prints it.
+ * Parses a non-terminal with the given function of the grammar, and closes
+ * the node it opened in the parse tree. Returns the error code of the function.
  * */
-void printNonTerminal(NonTerminal nonTerminal);
+int parseNonTerminal(ParserContext* context, int (*nonTerminal)(ParserContext*));
 
 /**
  * Functions used for non-terminals of the grammar
  * */
-int program();
-int block();
-int const_declaration();
-int var_declaration();
-int proc_declaration();
-int statement();
-int condition();
-int relop();
-int expression();
-int term();
-int factor();
-
-Token getCurrentToken()
+int program(ParserContext* context);
+int block(ParserContext* context);
+int const_declaration(ParserContext* context);
+int var_declaration(ParserContext* context);
+int proc_declaration(ParserContext* context);
+int statement(ParserContext* context);
+int condition(ParserContext* context);
+int relop(ParserContext* context);
+int expression(ParserContext* context);
+int term(ParserContext* context);
+int factor(ParserContext* context);
+
+Token getCurrentToken(ParserContext* context)
+{
+    return context->currentToken;
+}
+
+int getCurrentTokenType(ParserContext* context)
 {
-    return getCurrentTokenFromIterator(_token_list_it);
+    return getCurrentToken(context).id;
 }
 
-int getCurrentTokenType()
+void printCurrentToken(ParserContext* context)
 {
-    return getCurrentToken().id;
+    if(context->tree) addParseTreeToken(context->tree, context->tokenIndex);
+
+    if(context->out)
+        fprintf(context->out, "%8s <%s, '%s'>\n", "TOKEN  :", tokenNames[getCurrentToken(context).id], getCurrentToken(context).lexeme);
 }
 
-void printCurrentToken()
+void nextToken(ParserContext* context)
 {
-    fprintf(_out, "%8s <%s, '%s'>\n", "TOKEN  :", tokenNames[getCurrentToken().id], getCurrentToken().lexeme);
+    context->currentToken = context->tokenSource.pull(context->tokenSource.state);
+    context->tokenIndex++;
 }
 
-void nextToken()
+void printNonTerminal(ParserContext* context, NonTerminal nonTerminal)
 {
-    _token_list_it.currentTokenInd++;
+    if(context->tree) openParseTreeNode(context->tree, nonTerminal, context->tokenIndex);
+
+    if(context->out)
+        fprintf(context->out, "%8s %s\n", "NONTERM:", nonTerminalNames[nonTerminal]);
 }
 
-void printNonTerminal(NonTerminal nonTerminal)
+int parseNonTerminal(ParserContext* context, int (*nonTerminal)(ParserContext*))
 {
-    fprintf(_out, "%8s %s\n", "NONTERM:", nonTerminalNames[nonTerminal]);
+    int err = nonTerminal(context);
+
+    if(context->tree) closeParseTreeNode(context->tree);
+
+    return err;
 }
 
 /**
@@ -121,58 +146,69 @@ void printParserErr(int errCode, FILE* fp)
  * */
 int parser(TokenList tokenList, FILE* out)
 {
-    // Set output file pointer
-    _out = out;
+    TokenListIterator it = getTokenListIterator(&tokenList);
+
+    return parserFromSource(getTokenListSource(&it), out);
+}
+
+int parserFromSource(TokenSource tokenSource, FILE* out)
+{
+    return parserToTree(tokenSource, out, NULL);
+}
+
+int parserToTree(TokenSource tokenSource, FILE* out, ParseTree* tree)
+{
+    ParserContext state;
+    ParserContext* context = &state;
+
+    // Set output file pointer, and the tree to build
+    context->out = out;
+    context->tree = tree;
 
     /**
-     * Create a token list iterator, which helps to keep track of the current
-     * token being parsed.
+     * Set the token source, and pull the first token to be parsed, the
+     * .. token 0.
      * */
-    _token_list_it = getTokenListIterator(&tokenList);
+    context->tokenSource = tokenSource;
+    context->tokenIndex = (unsigned int)-1;
+    nextToken(context);
 
     // Initialize current level to 0, which is the global level
-    currentLevel = 0;
+    context->currentLevel = 0;
 
     // Initialize symbol table
-    initSymbolTable(&symbolTable);
+    initSymbolTable(&context->symbolTable);
 
     // Write parsing history header
-    fprintf(_out, "Parsing History\n===============\n");
+    if(context->out) fprintf(context->out, "Parsing History\n===============\n");
 
     // Start parsing by parsing program as the grammar suggests.
-    int err = program();
+    int err = parseNonTerminal(context, program);
 
     // Print symbol table - if no error occured
-    if(!err)
+    if(!err && context->out)
     {
-        fprintf(_out, "\n\n");
-        printSymbolTable(&symbolTable, _out);
+        fprintf(context->out, "\n\n");
+        printSymbolTable(&context->symbolTable, context->out);
     }
 
-    // Reset output file pointer
-    _out = NULL;
-
-    // Reset the global TokenListIterator
-    _token_list_it.currentTokenInd = 0;
-    _token_list_it.tokenList = NULL;
-
     // Delete symbol table
-    deleteSymbolTable(&symbolTable);
+    deleteSymbolTable(&context->symbolTable);
 
     // Return err code - which is 0 if parsing was successful
     return err;
 }
 
-int program()
+int program(ParserContext* context)
 {
-    printNonTerminal(PROGRAM);
+    printNonTerminal(context, PROGRAM);
 
     /**
      * Program is a block followed by "."
      * */
 	 
 	// Parse block.
-    int err = block();
+    int err = parseNonTerminal(context, block);
 
     /**
      * If parsing of block was not successful, immediately stop parsing
@@ -181,7 +217,7 @@ int program()
     if(err) return err;
 
     // After block, period should come
-    if(getCurrentTokenType() != periodsym)
+    if(getCurrentTokenType(context) != periodsym)
     {
         /**
          * Error code 6: Period expected.
@@ -191,15 +227,15 @@ int program()
     }
 
     // It was a periodsym. Consume periodsym.
-    printCurrentToken(); // Printing the token is essential!
-    nextToken(); // Go to the next token..
+    printCurrentToken(context); // Printing the token is essential!
+    nextToken(context); // Go to the next token..
 	
     return 0;
 }
 
-int block()
+int block(ParserContext* context)
 {
-    printNonTerminal(BLOCK);
+    printNonTerminal(context, BLOCK);
 
     /**
      * block is 
@@ -210,7 +246,7 @@ int block()
      * */
 	 
 	// Parse const_declaration.
-    int err = const_declaration();
+    int err = parseNonTerminal(context, const_declaration);
 
     /**
      * If parsing of const_declaration was not successful, immediately stop parsing
@@ -219,7 +255,7 @@ int block()
     if(err) return err;
 
     // Parse var_declaration.
-    err = var_declaration();
+    err = parseNonTerminal(context, var_declaration);
 
     /**
      * If parsing of var_declaration was not successful, immediately stop parsing
@@ -228,7 +264,7 @@ int block()
     if(err) return err;
 	
 	// Parse proc_declaration.
-    err = proc_declaration();
+    err = parseNonTerminal(context, proc_declaration);
 
     /**
      * If parsing of proc_declaration was not successful, immediately stop parsing
@@ -237,7 +273,7 @@ int block()
     if(err) return err;
 	
 	// Parse statement.
-    err = statement();
+    err = parseNonTerminal(context, statement);
 
     /**
      * If parsing of statement was not successful, immediately stop parsing
@@ -248,9 +284,9 @@ int block()
     return 0;
 }
 
-int const_declaration()
+int const_declaration(ParserContext* context)
 {
-    printNonTerminal(CONST_DECLARATION);
+    printNonTerminal(context, CONST_DECLARATION);
 
     /**
      * const_declaration is the following
@@ -267,28 +303,28 @@ int const_declaration()
      * */
 	
 	// Is the current token a constsym?
-    if (getCurrentTokenType() == constsym)
+    if (getCurrentTokenType(context) == constsym)
 	{
 		// Consume constsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 		
 		// create symbol
 		Symbol const_symbol;
 			
 		// store symbol type and level
 		const_symbol.type = CONST;
-		const_symbol.level = currentLevel;
+		const_symbol.level = context->currentLevel;
 		
 		// Is the current token a identsym?
-		if (getCurrentTokenType() == identsym)
+		if (getCurrentTokenType(context) == identsym)
 		{	
 			// store const_symbol name
-			strcpy(const_symbol.name, getCurrentTokenFromIterator(_token_list_it).lexeme);
+			strcpy(const_symbol.name, getCurrentToken(context).lexeme);
 			
 			// Consume identsym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -300,11 +336,11 @@ int const_declaration()
 		}
 		
 		// Is the current token a eqsym? 
-		if (getCurrentTokenType() == eqsym)
+		if (getCurrentTokenType(context) == eqsym)
 		{
 			// Consume eqsym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -316,14 +352,14 @@ int const_declaration()
 		}
 		
 		// Is the current token a numbersym? 
-		if (getCurrentTokenType() == numbersym)
+		if (getCurrentTokenType(context) == numbersym)
 		{
 			// store value for const_symbol
-			const_symbol.value = atoi(getCurrentTokenFromIterator(_token_list_it).lexeme);
+			const_symbol.value = atoi(getCurrentToken(context).lexeme);
 			
 			// Consume numbersym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -335,33 +371,33 @@ int const_declaration()
 		}
 		
 		// add const symbol to symbol table
-		addSymbol(&symbolTable, const_symbol);
+		addSymbol(&context->symbolTable, const_symbol);
 		
 		// Create new const symbol in case of more consts
 		Symbol *new_const_symbol;
 		
-		while (getCurrentTokenType() == commasym)
+		while (getCurrentTokenType(context) == commasym)
 		{
 			// Consume commasym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 			
 			// allocate space for new const symbol
 			new_const_symbol = malloc(sizeof(Symbol));
 			
 			// initialize level and type
-			new_const_symbol->level = currentLevel;
+			new_const_symbol->level = context->currentLevel;
 			new_const_symbol->type = CONST; 
 			
 			// Is the current token a identsym?
-			if (getCurrentTokenType() == identsym)
+			if (getCurrentTokenType(context) == identsym)
 			{
 				// store const_symbol name
-				strcpy(new_const_symbol->name, getCurrentTokenFromIterator(_token_list_it).lexeme);
+				strcpy(new_const_symbol->name, getCurrentToken(context).lexeme);
 				
 				// Consume identsym
-				printCurrentToken(); // Printing the token is essential!
-				nextToken(); // Go to the next token..
+				printCurrentToken(context); // Printing the token is essential!
+				nextToken(context); // Go to the next token..
 			}
 			else
 			{
@@ -373,11 +409,11 @@ int const_declaration()
 			}
 			
 			// Is the current token a eqsym? 
-			if (getCurrentTokenType() == eqsym)
+			if (getCurrentTokenType(context) == eqsym)
 			{
 				// Consume eqsym
-				printCurrentToken(); // Printing the token is essential!
-				nextToken(); // Go to the next token..
+				printCurrentToken(context); // Printing the token is essential!
+				nextToken(context); // Go to the next token..
 			}
 			else
 			{
@@ -389,14 +425,14 @@ int const_declaration()
 			}
 			
 			// Is the current token a numbersym? 
-			if (getCurrentTokenType() == numbersym)
+			if (getCurrentTokenType(context) == numbersym)
 			{
 				// store value for const_symbol
-				new_const_symbol->value = atoi(getCurrentTokenFromIterator(_token_list_it).lexeme);
+				new_const_symbol->value = atoi(getCurrentToken(context).lexeme);
 				
 				// Consume numbersym
-				printCurrentToken(); // Printing the token is essential!
-				nextToken(); // Go to the next token..
+				printCurrentToken(context); // Printing the token is essential!
+				nextToken(context); // Go to the next token..
 			}
 			else
 			{
@@ -408,7 +444,7 @@ int const_declaration()
 			}
 			
 			// add const symbol to symbol table
-			addSymbol(&symbolTable, *new_const_symbol);
+			addSymbol(&context->symbolTable, *new_const_symbol);
 		}
 		
 		/* deallocate memory
@@ -421,11 +457,11 @@ int const_declaration()
 		//free(new_const_symbol);
 		
 		// Is the current token a semicolonsym? 
-		if (getCurrentTokenType() == semicolonsym)
+		if (getCurrentTokenType(context) == semicolonsym)
 		{
 			// Consume semicolonsym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -441,33 +477,33 @@ int const_declaration()
     return 0;
 }
 
-int var_declaration()
+int var_declaration(ParserContext* context)
 {
-    printNonTerminal(VAR_DECLARATION);
+    printNonTerminal(context, VAR_DECLARATION);
 
     // Is the current token a varsym?
-    if (getCurrentTokenType() == varsym)
+    if (getCurrentTokenType(context) == varsym)
 	{
 		// Consume varsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 		
 		// create symbol
 		Symbol var_symbol;
 			
 		// store symbol type and level
 		var_symbol.type = VAR;
-		var_symbol.level = currentLevel;
+		var_symbol.level = context->currentLevel;
 		
 		// Is the current token a identsym?
-		if (getCurrentTokenType() == identsym)
+		if (getCurrentTokenType(context) == identsym)
 		{
 			// store var_symbol name
-			strcpy(var_symbol.name, getCurrentTokenFromIterator(_token_list_it).lexeme);
+			strcpy(var_symbol.name, getCurrentToken(context).lexeme);
 			
 			// Consume identsym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -479,33 +515,33 @@ int var_declaration()
 		}
 		
 		// add var symbol to symbol table
-		addSymbol(&symbolTable, var_symbol);
+		addSymbol(&context->symbolTable, var_symbol);
 		
 		// Create new var symbol in case of more vars
 		Symbol *new_var_symbol;
 		
-		while (getCurrentTokenType() == commasym)
+		while (getCurrentTokenType(context) == commasym)
 		{
 			// Consume commasym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 			
 			// allocate space for new var symbol
 			new_var_symbol = malloc(sizeof(Symbol));
 			
 			// initialize level and type
-			new_var_symbol->level = currentLevel;
+			new_var_symbol->level = context->currentLevel;
 			new_var_symbol->type = VAR; 
 			
 			// Is the current token a identsym?
-			if (getCurrentTokenType() == identsym)
+			if (getCurrentTokenType(context) == identsym)
 			{
 				// store const_symbol name
-				strcpy(new_var_symbol->name, getCurrentTokenFromIterator(_token_list_it).lexeme);
+				strcpy(new_var_symbol->name, getCurrentToken(context).lexeme);
 				
 				// Consume identsym
-				printCurrentToken(); // Printing the token is essential!
-				nextToken(); // Go to the next token..
+				printCurrentToken(context); // Printing the token is essential!
+				nextToken(context); // Go to the next token..
 			}
 			else
 			{
@@ -517,7 +553,7 @@ int var_declaration()
 			}
 			
 			// add var symbol to symbol table
-			addSymbol(&symbolTable, *new_var_symbol);
+			addSymbol(&context->symbolTable, *new_var_symbol);
 		}
 		
 		/* deallocate memory
@@ -530,11 +566,11 @@ int var_declaration()
 		//free(new_var_symbol);
 		
 		// Is the current token a semicolonsym? 
-		if (getCurrentTokenType() == semicolonsym)
+		if (getCurrentTokenType(context) == semicolonsym)
 		{
 			// Consume semicolonsym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -549,32 +585,32 @@ int var_declaration()
     return 0;
 }
 
-int proc_declaration()
+int proc_declaration(ParserContext* context)
 {
-    printNonTerminal(PROC_DECLARATION);
+    printNonTerminal(context, PROC_DECLARATION);
 
-    while (getCurrentTokenType() == procsym)
+    while (getCurrentTokenType(context) == procsym)
 	{
 		// Consume procsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 			
 		// create symbol
 		Symbol proc_symbol;
 			
 		// store symbol type and level
 		proc_symbol.type = PROC;
-		proc_symbol.level = currentLevel;	
+		proc_symbol.level = context->currentLevel;	
 			
 		// Is the current token a identsym?
-		if (getCurrentTokenType() == identsym)
+		if (getCurrentTokenType(context) == identsym)
 		{
 			// store const_symbol name
-			strcpy(proc_symbol.name, getCurrentTokenFromIterator(_token_list_it).lexeme);
+			strcpy(proc_symbol.name, getCurrentToken(context).lexeme);
 			
 			// Consume identsym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -586,14 +622,14 @@ int proc_declaration()
 		}
 		
 		// add proc symbol to symbol table
-		addSymbol(&symbolTable, proc_symbol);
+		addSymbol(&context->symbolTable, proc_symbol);
 		
 		// Is the current token a semicolonsym? 
-		if (getCurrentTokenType() == semicolonsym)
+		if (getCurrentTokenType(context) == semicolonsym)
 		{
 			// Consume semicolonsym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -605,13 +641,13 @@ int proc_declaration()
 		}
 		
 		// increment level before block
-		currentLevel++;
+		context->currentLevel++;
 		
 		// Parse block.
-		int err = block();
+		int err = parseNonTerminal(context, block);
 		
 		// decrement level after block
-		currentLevel--;
+		context->currentLevel--;
 		
 		/**
 		* If parsing of block was not successful, immediately stop parsing
@@ -620,11 +656,11 @@ int proc_declaration()
 		if(err) return err;
 		
 		// Is the current token a semicolonsym? 
-		if (getCurrentTokenType() == semicolonsym)
+		if (getCurrentTokenType(context) == semicolonsym)
 		{
 			// Consume semicolonsym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -639,22 +675,22 @@ int proc_declaration()
     return 0;
 }
 
-int statement()
+int statement(ParserContext* context)
 {
-    printNonTerminal(STATEMENT);
+    printNonTerminal(context, STATEMENT);
 
-    if (getCurrentTokenType() == identsym)
+    if (getCurrentTokenType(context) == identsym)
 	{
 		// Consume identsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 		
 		// Is the current token a becomessym?
-		if (getCurrentTokenType() == becomessym)
+		if (getCurrentTokenType(context) == becomessym)
 		{
 			// Consume becomessym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -666,7 +702,7 @@ int statement()
 		}
 		
 		// Parse expression.
-		int err = expression();
+		int err = parseNonTerminal(context, expression);
 
 		/**
 		* If parsing of expression was not successful, immediately stop parsing
@@ -674,18 +710,18 @@ int statement()
 		* */
 		if(err) return err;
 	}
-	else if (getCurrentTokenType() == callsym)
+	else if (getCurrentTokenType(context) == callsym)
 	{
 		// Consume callsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 		
 		// Is the current token a identsym?
-		if (getCurrentTokenType() == identsym)
+		if (getCurrentTokenType(context) == identsym)
 		{
 			// Consume identsym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -696,14 +732,14 @@ int statement()
 			return 8;
 		}
 	}
-	else if (getCurrentTokenType() == beginsym)
+	else if (getCurrentTokenType(context) == beginsym)
 	{
 		// Consume beginsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 		
 		// Parse statement.
-		int err = statement();
+		int err = parseNonTerminal(context, statement);
 
 		/**
 		* If parsing of statement was not successful, immediately stop parsing
@@ -711,14 +747,14 @@ int statement()
 		* */
 		if(err) return err;
 		
-		while (getCurrentTokenType() == semicolonsym)
+		while (getCurrentTokenType(context) == semicolonsym)
 		{
 			// Consume semicolonsym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 			
 			// Parse statement.
-			err = statement();
+			err = parseNonTerminal(context, statement);
 
 			/**
 			* If parsing of statement was not successful, immediately stop parsing
@@ -728,11 +764,11 @@ int statement()
 		}
 		
 		// Is the current token a endsym?
-		if (getCurrentTokenType() == endsym)
+		if (getCurrentTokenType(context) == endsym)
 		{
 			// Consume endsym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -743,14 +779,14 @@ int statement()
 			return 10;
 		}
 	}
-	else if (getCurrentTokenType() == ifsym)
+	else if (getCurrentTokenType(context) == ifsym)
 	{
 		// Consume ifsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 		
 		// Parse condition.
-		int err = condition();
+		int err = parseNonTerminal(context, condition);
 
 		/**
 		* If parsing of condition was not successful, immediately stop parsing
@@ -759,11 +795,11 @@ int statement()
 		if(err) return err;
 		
 		// Is the current token a thensym?
-		if (getCurrentTokenType() == thensym)
+		if (getCurrentTokenType(context) == thensym)
 		{
 			// Consume thensym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -775,7 +811,7 @@ int statement()
 		}
 		
 		// Parse statement.
-		err = statement();
+		err = parseNonTerminal(context, statement);
 
 		/**
 		* If parsing of statement was not successful, immediately stop parsing
@@ -783,14 +819,14 @@ int statement()
 		* */
 		if(err) return err;
 		
-		if (getCurrentTokenType() == elsesym)
+		if (getCurrentTokenType(context) == elsesym)
 		{
 			// Consume elsesym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 			
 			// Parse statement.
-			err = statement();
+			err = parseNonTerminal(context, statement);
 
 			/**
 			* If parsing of statement was not successful, immediately stop parsing
@@ -799,14 +835,14 @@ int statement()
 			if(err) return err;
 		}
 	}
-	else if (getCurrentTokenType() == whilesym)
+	else if (getCurrentTokenType(context) == whilesym)
 	{
 		// Consume whilesym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 		
 		// Parse condition.
-		int err = condition();
+		int err = parseNonTerminal(context, condition);
 
 		/**
 		* If parsing of condition was not successful, immediately stop parsing
@@ -815,11 +851,11 @@ int statement()
 		if(err) return err;
 		
 		// Is the current token a dosym?
-		if (getCurrentTokenType() == dosym)
+		if (getCurrentTokenType(context) == dosym)
 		{
 			// Consume dosym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -831,7 +867,7 @@ int statement()
 		}
 		
 		// Parse statement.
-		err = statement();
+		err = parseNonTerminal(context, statement);
 
 		/**
 		* If parsing of condition was not successful, immediately stop parsing
@@ -839,18 +875,18 @@ int statement()
 		* */
 		if(err) return err;
 	}
-	else if (getCurrentTokenType() == readsym)
+	else if (getCurrentTokenType(context) == readsym)
 	{
 		// Consume readsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 		
 		// Is the current token a identsym?
-		if (getCurrentTokenType() == identsym)
+		if (getCurrentTokenType(context) == identsym)
 		{
 			// Consume identsym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -861,18 +897,18 @@ int statement()
 			return 3;
 		}
 	}
-	else if (getCurrentTokenType() == writesym)
+	else if (getCurrentTokenType(context) == writesym)
 	{
 		// Consume writesym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 		
 		// Is the current token a identsym?
-		if (getCurrentTokenType() == identsym)
+		if (getCurrentTokenType(context) == identsym)
 		{
 			// Consume identsym
-			printCurrentToken(); // Printing the token is essential!
-			nextToken(); // Go to the next token..
+			printCurrentToken(context); // Printing the token is essential!
+			nextToken(context); // Go to the next token..
 		}
 		else
 		{
@@ -887,19 +923,19 @@ int statement()
     return 0;
 }
 
-int condition()
+int condition(ParserContext* context)
 {
-    printNonTerminal(CONDITION);
+    printNonTerminal(context, CONDITION);
 
     // Is the current token a oddsym?
-	if (getCurrentTokenType() == oddsym)
+	if (getCurrentTokenType(context) == oddsym)
 	{
 		// Consume oddsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 	
 		// Parse expression.
-		int err = expression();
+		int err = parseNonTerminal(context, expression);
 
 		/**
 		* If parsing of statement was not successful, immediately stop parsing
@@ -910,7 +946,7 @@ int condition()
 	else
 	{
 		// Parse expression.
-		int err = expression();
+		int err = parseNonTerminal(context, expression);
 
 		/**
 		* If parsing of statement was not successful, immediately stop parsing
@@ -919,7 +955,7 @@ int condition()
 		if(err) return err;
 		
 		// Parse relop.
-		err = relop();
+		err = parseNonTerminal(context, relop);
 
 		/**
 		* If parsing of statement was not successful, immediately stop parsing
@@ -928,7 +964,7 @@ int condition()
 		if(err) return err;
 		
 		// Parse expression.
-		err = expression();
+		err = parseNonTerminal(context, expression);
 
 		/**
 		* If parsing of statement was not successful, immediately stop parsing
@@ -940,45 +976,45 @@ int condition()
     return 0;
 }
 
-int relop()
+int relop(ParserContext* context)
 {
-    printNonTerminal(REL_OP);
+    printNonTerminal(context, REL_OP);
 
-    if (getCurrentTokenType() == eqsym)
+    if (getCurrentTokenType(context) == eqsym)
 	{
 		// Consume eqsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..	
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..	
 	}
-	else if (getCurrentTokenType() == neqsym)
+	else if (getCurrentTokenType(context) == neqsym)
 	{
 		// Consume neqsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 	}
-	else if (getCurrentTokenType() == lessym)
+	else if (getCurrentTokenType(context) == lessym)
 	{
 		// Consume lessym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 	}
-	else if (getCurrentTokenType() == leqsym)
+	else if (getCurrentTokenType(context) == leqsym)
 	{
 		// Consume leqsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 	}
-	else if (getCurrentTokenType() == gtrsym)
+	else if (getCurrentTokenType(context) == gtrsym)
 	{
 		// Consume gtrsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 	}
-	else if (getCurrentTokenType() == geqsym)
+	else if (getCurrentTokenType(context) == geqsym)
 	{
 		// Consume geqsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 	}
 	else
 	{
@@ -989,25 +1025,25 @@ int relop()
     return 0;
 }
 
-int expression()
+int expression(ParserContext* context)
 {
-    printNonTerminal(EXPRESSION);
+    printNonTerminal(context, EXPRESSION);
 
-    if (getCurrentTokenType() == plussym)
+    if (getCurrentTokenType(context) == plussym)
 	{
 		// Consume plussym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 	}
-	else if (getCurrentTokenType() == minussym)
+	else if (getCurrentTokenType(context) == minussym)
 	{
 		// Consume minussym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 	}
 	
 	// Parse term.
-	int err = term();
+	int err = parseNonTerminal(context, term);
 
 	/**
 	* If parsing of term was not successful, immediately stop parsing
@@ -1015,14 +1051,14 @@ int expression()
 	* */
 	if(err) return err;
 	
-	while (getCurrentTokenType() == plussym || getCurrentTokenType() == minussym)
+	while (getCurrentTokenType(context) == plussym || getCurrentTokenType(context) == minussym)
 	{
 		// Consume plussym or minussym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 		
 		// Parse term.
-		err = term();
+		err = parseNonTerminal(context, term);
 
 		/**
 		* If parsing of term was not successful, immediately stop parsing
@@ -1034,12 +1070,12 @@ int expression()
     return 0;
 }
 
-int term()
+int term(ParserContext* context)
 {
-    printNonTerminal(TERM);
+    printNonTerminal(context, TERM);
 
     // Parse factor.
-	int err = factor();
+	int err = parseNonTerminal(context, factor);
 
 	/**
 	* If parsing of factor was not successful, immediately stop parsing
@@ -1047,14 +1083,14 @@ int term()
 	* */
 	if(err) return err;
 	
-	while (getCurrentTokenType() == multsym || getCurrentTokenType() == slashsym)
+	while (getCurrentTokenType(context) == multsym || getCurrentTokenType(context) == slashsym)
 	{
 		// Consume multsym or slashsym
-		printCurrentToken(); // Printing the token is essential!
-		nextToken(); // Go to the next token..
+		printCurrentToken(context); // Printing the token is essential!
+		nextToken(context); // Go to the next token..
 		
 		// Parse factor.
-		err = factor();
+		err = parseNonTerminal(context, factor);
 
 		/**
 		* If parsing of factor was not successful, immediately stop parsing
@@ -1069,9 +1105,9 @@ int term()
 /**
  * The below function is left fully-implemented as a hint.
  * */
-int factor()
+int factor(ParserContext* context)
 {
-    printNonTerminal(FACTOR);
+    printNonTerminal(context, FACTOR);
 
     /**
      * There are three possibilities for factor:
@@ -1081,34 +1117,34 @@ int factor()
      * */
 
     // Is the current token a identsym?
-    if(getCurrentTokenType() == identsym)
+    if(getCurrentTokenType(context) == identsym)
     {
         // Consume identsym
-        printCurrentToken(); // Printing the token is essential!
-        nextToken(); // Go to the next token..
+        printCurrentToken(context); // Printing the token is essential!
+        nextToken(context); // Go to the next token..
 
         // Success
         return 0;
     }
     // Is that a numbersym?
-    else if(getCurrentTokenType() == numbersym)
+    else if(getCurrentTokenType(context) == numbersym)
     {
         // Consume numbersym
-        printCurrentToken(); // Printing the token is essential!
-        nextToken(); // Go to the next token..
+        printCurrentToken(context); // Printing the token is essential!
+        nextToken(context); // Go to the next token..
 
         // Success
         return 0;
     }
     // Is that a lparentsym?
-    else if(getCurrentTokenType() == lparentsym)
+    else if(getCurrentTokenType(context) == lparentsym)
     {
         // Consume lparentsym
-        printCurrentToken(); // Printing the token is essential!
-        nextToken(); // Go to the next token..
+        printCurrentToken(context); // Printing the token is essential!
+        nextToken(context); // Go to the next token..
 
         // Continue by parsing expression.
-        int err = expression();
+        int err = parseNonTerminal(context, expression);
 
         /**
          * If parsing of expression was not successful, immediately stop parsing
@@ -1118,7 +1154,7 @@ int factor()
         if(err) return err;
 
         // After expression, right-parenthesis should come
-        if(getCurrentTokenType() != rparentsym)
+        if(getCurrentTokenType(context) != rparentsym)
         {
             /**
              * Error code 13: Right parenthesis missing.
@@ -1128,8 +1164,8 @@ int factor()
         }
 
         // It was a rparentsym. Consume rparentsym.
-        printCurrentToken(); // Printing the token is essential!
-        nextToken(); // Go to the next token..
+        printCurrentToken(context); // Printing the token is essential!
+        nextToken(context); // Go to the next token..
     }
     else
     {
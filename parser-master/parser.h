@@ -2,9 +2,26 @@
 #define __PARSER_H__
 
 #include "token.h"
+#include "parse_tree.h"
 
 int parser(TokenList, FILE*);
 
+/**
+ * Same as parser(), but parses the tokens as they are pulled from the given
+ * TokenSource, one at a time, instead of a prebuilt token list.
+ * The state of a parse is its own, so parses could run at the same time on
+ * different threads, each with its own token source and output file.
+ * */
+int parserFromSource(TokenSource, FILE*);
+
+/**
+ * Same as parserFromSource(), and builds the parse tree of the tokens into the
+ * given ParseTree, initialized by initParseTree(), unless it is NULL. Nothing
+ * is printed if the FILE is NULL: the parse only validates the tokens, or
+ * builds the tree. The tree of a failed parse ends where the error was found.
+ * */
+int parserToTree(TokenSource, FILE*, ParseTree*);
+
 void printParserErr(int errCode, FILE*);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,77 @@
+tests="tests_grader.txt"
+parser="../parser.out"
+EMPH='\033[1;31m'
+DEEMPH='\033[0m'
+
+i=0
+passed=0
+failed=0
+
+# check if parser.out and tests_grader.txt exists
+if [[ -e $parser && -e $tests ]] ; then
+    echo "$parser and $tests are found. Starting tests.."
+else
+    echo "$parser or $tests could not be found! Aborting.."
+    exit
+fi
+
+# Same test cases as grader.sh, validated with --check: nothing should be
+#   printed, and the exit status should be the error code of the ground truth,
+#   0 if the parsing was successful. The parse tree of a successful parsing is
+#   written next to out, and should be a header of 16 bytes starting with the
+#   magic, followed by its number of nodes of 16 bytes each.
+while read inp out gt_out ; do
+    # create directories if needed
+    out_dir=$(dirname "$out")
+    mkdir -p "$out_dir"
+    tree="${out%.txt}.tree"
+    rm -f "$tree"
+
+    # run the parser
+    printed="$(./"$parser" --check --tree="$tree" "$inp" 2>&1)"
+    status=$?
+
+    # the error code of the ground truth
+    expected="$(sed -n 's/^PARSING ERROR\[\([0-9]*\)\].*/\1/p' "$gt_out")"
+    expected=${expected:-0}
+
+    _diff=""
+    if [[ $printed ]] ; then
+        _diff="--check printed: $printed"
+    elif [[ $status != $expected ]] ; then
+        _diff="--check exited with $status instead of $expected"
+    elif [[ $expected == 0 ]] ; then
+        magic="$(head -c 4 "$tree" 2>/dev/null)"
+        nodes="$(od -An -t u4 -j 8 -N 4 "$tree" 2>/dev/null | tr -d ' ')"
+        size="$(wc -c < "$tree" 2>/dev/null)"
+
+        if [[ $magic != "PM0P" || -z $nodes || $nodes == 0 || $size != $((16 + 16 * nodes)) ]] ; then
+            _diff="$tree is not a parse tree"
+        fi
+    elif [[ -e $tree ]] ; then
+        _diff="$tree was written for a failed parsing"
+    fi
+
+    if [[ $_diff ]] ; then
+        # sad.. difference found
+        echo "TEST $i FAILED"
+        let failed=$failed+1
+
+        echo "==================================================="
+        echo $_diff
+        echo "==================================================="
+        echo -e "${EMPH}Test this yourself by running the following${DEEMPH}: "
+        echo "  (cd test/; ./\"$parser\" --check --tree=\"$tree\" \"$inp\"; echo \$?)"
+    else
+        # yay! test passed
+        echo "TEST $i PASSED"
+        let passed=$passed+1
+    fi
+
+    let i=$i+1
+
+done < "$tests"
+
+echo "# of tests       : $i"
+echo "# of tests passed: $passed"
+echo "# of tests failed: $failed"
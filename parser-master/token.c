@@ -1,34 +1,42 @@
 #include "token.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-void initTokenList(TokenList* tokenList)
+void initTokenList(TokenList* tokenList, Arena* arena)
 {
     tokenList->tokens = NULL;
     tokenList->numberOfTokens = 0;
+    tokenList->capacity = 0;
+    tokenList->arena = arena;
 }
 
 void addToken(TokenList* tokenList, Token token)
 {
-    // Increase number of tokens
-    tokenList->numberOfTokens++;
+    // Double the space for tokens when it gets full
+    if(tokenList->numberOfTokens == tokenList->capacity)
+    {
+        int capacity = tokenList->capacity ? 2 * tokenList->capacity : 64;
 
-    // Allocate space for new token
-    tokenList->tokens = (Token*)realloc(tokenList->tokens, (tokenList->numberOfTokens) * sizeof(Token));
+        tokenList->tokens = (Token*)arenaGrow(tokenList->arena, tokenList->tokens,
+            tokenList->capacity * sizeof(Token), capacity * sizeof(Token));
+        tokenList->capacity = capacity;
+    }
 
     // Add token to the end of the list
-    tokenList->tokens[tokenList->numberOfTokens - 1] = token;
+    tokenList->tokens[tokenList->numberOfTokens++] = token;
 }
 
 TokenList getCopy(TokenList src)
 {
     TokenList copy;
     
-    copy.numberOfTokens = src.numberOfTokens;
+    initTokenList(&copy, src.arena);
 
     if(src.tokens)
     {
-        copy.tokens = (Token*)malloc(src.numberOfTokens * sizeof(Token));
+        copy.tokens = (Token*)arenaAlloc(src.arena, src.numberOfTokens * sizeof(Token));
+        copy.numberOfTokens = copy.capacity = src.numberOfTokens;
 
         for(int i = 0; i < src.numberOfTokens; i++)
             copy.tokens[i] = src.tokens[i];
@@ -50,15 +58,82 @@ void printTokenList(TokenList tokenList, FILE* out)
     }
 }
 
-TokenList readTokenList(FILE* in)
+/**
+ * Reads a binary token stream from the given file, see TokenStreamHeader.
+ * The records and the lexemes are read at once into the tail of the block
+ * allocated for the tokens, and the tokens are decoded in front of them.
+ * Returns an empty list if the stream is invalid.
+ * */
+TokenList readTokenStream(FILE* in, Arena* arena)
 {
     TokenList tokenList;
+    TokenStreamHeader header;
+
+    initTokenList(&tokenList, arena);
+
+    if( fread(&header, sizeof(TokenStreamHeader), 1, in) != 1 ||
+        memcmp(header.magic, TOKEN_STREAM_MAGIC, sizeof(header.magic)) ||
+        header.version != TOKEN_STREAM_VERSION )
+    {
+        fprintf(stderr, "Not a token stream of version %d.\n", TOKEN_STREAM_VERSION);
+        return tokenList;
+    }
+
+    if(header.numberOfTokens == 0) return tokenList;
+
+    size_t tokensSize = header.numberOfTokens * sizeof(Token);
+    size_t payloadSize = header.numberOfTokens * sizeof(TokenRecord) + header.lexemeBytes;
+
+    char* block = (char*)arenaAlloc(arena, tokensSize + payloadSize);
+
+    if(!block || fread(block + tokensSize, payloadSize, 1, in) != 1)
+    {
+        fprintf(stderr, "Token stream is truncated.\n");
+        return tokenList;
+    }
+
+    Token* tokens = (Token*)block;
+    TokenRecord* records = (TokenRecord*)(block + tokensSize);
+    char* lexemes = (char*)(records + header.numberOfTokens);
+
+    // tokens[i] never overlaps the records, which begin past the last token
+    for(unsigned int i = 0; i < header.numberOfTokens; i++)
+    {
+        TokenRecord record = records[i];
+
+        if( record.lexemeLength > MAX_LEXEME_LENGTH ||
+            record.lexemeOffset > header.lexemeBytes ||
+            record.lexemeLength > header.lexemeBytes - record.lexemeOffset )
+        {
+            fprintf(stderr, "Token stream has an invalid lexeme at token %u.\n", i);
+            return tokenList;
+        }
+
+        tokens[i].id = record.id;
+        memcpy(tokens[i].lexeme, lexemes + record.lexemeOffset, record.lexemeLength);
+        tokens[i].lexeme[record.lexemeLength] = '\0';
+    }
 
-    tokenList.tokens = NULL;
-    tokenList.numberOfTokens = 0;
+    tokenList.tokens = tokens;
+    tokenList.numberOfTokens = tokenList.capacity = header.numberOfTokens;
+
+    return tokenList;
+}
+
+TokenList readTokenList(FILE* in, Arena* arena)
+{
+    TokenList tokenList;
+
+    initTokenList(&tokenList, arena);
 
     if(!in) return tokenList;
 
+    // A token stream starts with its magic, a text list with its header
+    int first = getc(in);
+    ungetc(first, in);
+
+    if(first == TOKEN_STREAM_MAGIC[0]) return readTokenStream(in, arena);
+
     // Skip header, which is 26 characters
     fseek(in, 26, SEEK_CUR);
 
@@ -75,11 +150,11 @@ TokenList readTokenList(FILE* in)
 void deleteTokenList(TokenList* tokenList)
 {
     if(!tokenList) return;
-    
-    if(tokenList->tokens)
-        free(tokenList->tokens);
 
+    // The tokens belong to the arena
     tokenList->tokens = NULL;
+    tokenList->numberOfTokens = 0;
+    tokenList->capacity = 0;
 }
 
 
@@ -109,4 +184,71 @@ Token getCurrentTokenFromIterator(TokenListIterator it)
 void advanceTokenListIterator(TokenListIterator* it)
 {
     if(it) it->currentTokenInd++;
-}
\ No newline at end of file
+}
+
+/**
+ * TokenSource::pull of getTokenListSource()
+ * */
+Token pullTokenFromList(void* state)
+{
+    TokenListIterator* it = (TokenListIterator*)state;
+    Token token = getCurrentTokenFromIterator(*it);
+
+    advanceTokenListIterator(it);
+
+    return token;
+}
+
+/**
+ * TokenSource::pull of openTokenFile() for a text token list
+ * */
+Token pullTokenFromFile(void* state)
+{
+    TokenFileReader* reader = (TokenFileReader*)state;
+    Token token;
+
+    if( !reader->in || fscanf(reader->in, "%10d   %12s\n", &token.id, token.lexeme) != 2 )
+    {
+        // No more tokens, for the following calls as well
+        reader->in = NULL;
+
+        Token nulsymToken = { .id=0, .lexeme="" };
+        return nulsymToken;
+    }
+
+    return token;
+}
+
+TokenSource getTokenListSource(TokenListIterator* it)
+{
+    TokenSource source = { pullTokenFromList, it };
+
+    return source;
+}
+
+TokenSource openTokenFile(TokenFileReader* reader, FILE* in, Arena* arena)
+{
+    reader->in = NULL;
+    initTokenList(&reader->tokenList, arena);
+    reader->it = getTokenListIterator(&reader->tokenList);
+
+    TokenSource source = { pullTokenFromFile, reader };
+
+    if(!in) return source;
+
+    // A token stream starts with its magic, a text list with its header
+    int first = getc(in);
+    ungetc(first, in);
+
+    if(first == TOKEN_STREAM_MAGIC[0])
+    {
+        reader->tokenList = readTokenStream(in, arena);
+        return getTokenListSource(&reader->it);
+    }
+
+    // Skip header, which is 26 characters
+    fseek(in, 26, SEEK_CUR);
+    reader->in = in;
+
+    return source;
+}
@@ -2,6 +2,7 @@
 #define __TOKEN_H__
 
 #include <stdio.h>
+#include "arena.h"
 
 #define MAX_LEXEME_LENGTH 11
 
@@ -15,13 +16,38 @@ typedef struct {
 
 /**
  * The struct to store list of tokens and keep track
- * of number of tokens included in the list
+ * of number of tokens included in the list.
+ * The tokens are allocated from the arena of the list, and released with it.
  * */
 typedef struct {
     Token* tokens;
     int numberOfTokens;
+    int capacity; // the number of tokens allocated
+    Arena* arena;
 } TokenList;
 
+/**
+ * Binary token stream: a TokenStreamHeader, followed by numberOfTokens
+ * TokenRecords and then lexemeBytes characters holding the lexemes. Each
+ * record points into the lexemes by offset and length, lexemes are not null
+ * terminated. All fields are in the byte order of the machine that wrote it.
+ * */
+#define TOKEN_STREAM_MAGIC   "PM0T"
+#define TOKEN_STREAM_VERSION 1
+
+typedef struct {
+    char magic[4];               // TOKEN_STREAM_MAGIC, not null terminated
+    unsigned int version;        // TOKEN_STREAM_VERSION
+    unsigned int numberOfTokens; // number of TokenRecords following the header
+    unsigned int lexemeBytes;    // number of characters following the records
+} TokenStreamHeader;
+
+typedef struct {
+    int id;                    // numerical representation of the token
+    unsigned int lexemeOffset; // index of the first character of the lexeme
+    unsigned int lexemeLength; // at most MAX_LEXEME_LENGTH
+} TokenRecord;
+
 /**
  * The struct that helps to iterate on a TokenList
  * */
@@ -31,21 +57,41 @@ typedef struct {
 } TokenListIterator;
 
 /**
- * Initializes the given TokenList
+ * A source of tokens that are pulled one at a time, e.g. from a token list,
+ * .. from a file as it is read or from a lexer as it lexes.
+ * pull() returns the next token of the given state, or a token with id 0 once
+ * .. all the tokens are consumed, for every following call as well.
  * */
-void initTokenList(TokenList*);
+typedef struct {
+    Token (*pull)(void* state);
+    void* state;
+} TokenSource;
 
 /**
- * Adds the given Token to the given TokenList
+ * State of the TokenSource returned by openTokenFile().
+ * */
+typedef struct {
+    FILE* in;                 // a text token list, read one token at a time
+    TokenList tokenList;      // a binary token stream, read at once
+    TokenListIterator it;
+} TokenFileReader;
+
+/**
+ * Initializes the given TokenList, which will allocate from the given Arena
+ * */
+void initTokenList(TokenList*, Arena*);
+
+/**
+ * Adds the given Token to the given TokenList. The space for the tokens is
+ * grown geometrically.
  * */
 void addToken(TokenList*, Token);
 
 /**
- * Creates and returns a copy of the given TokenList.
- * TokenList dynamically allocates memory for its list.
- * Therefore, shallow copying with assignment operator does not
- * .. guarantee any lifetime of the included tokens list, which
- * .. may cause dangling pointers.
+ * Creates and returns a copy of the given TokenList, allocated from the same
+ * arena.
+ * Shallow copying with assignment operator shares the tokens, and adding
+ * .. tokens to one of the copies is not seen by the other.
  * */
 TokenList getCopy(TokenList);
 
@@ -57,12 +103,14 @@ void printTokenList(TokenList, FILE*);
 /**
  * Reads a list of tokens from given file.
  * The format of the list in the input file should be same as the printTokenList()
- * func prints.
+ * func prints, or a binary token stream (see TokenStreamHeader). A binary token
+ * stream is read at once and its tokens take a single allocation.
+ * The tokens are allocated from the given arena.
  * */
-TokenList readTokenList(FILE*);
+TokenList readTokenList(FILE*, Arena*);
 
 /**
- * Makes the necessary deallocations on the TokenList
+ * Empties the TokenList. The memory of the tokens is released with the arena.
  * */
 void deleteTokenList(TokenList*);
 
@@ -83,4 +131,20 @@ Token getCurrentTokenFromIterator(TokenListIterator);
  * */
 void advanceTokenListIterator(TokenListIterator*);
 
+/**
+ * Returns a TokenSource that pulls the tokens of the list of the given
+ * .. iterator, which should outlive the source.
+ * */
+TokenSource getTokenListSource(TokenListIterator*);
+
+/**
+ * Returns a TokenSource that pulls the tokens from the given file, which is
+ * .. either text or a binary token stream, see readTokenList(). A text token
+ * .. list is read token by token as they are pulled, so it is never whole in
+ * .. memory. A token stream is read at once, its tokens are allocated from the
+ * .. given arena.
+ * The given reader keeps the state of the source and should outlive it.
+ * */
+TokenSource openTokenFile(TokenFileReader*, FILE*, Arena*);
+
 #endif
\ No newline at end of file